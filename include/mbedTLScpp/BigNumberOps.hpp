@@ -0,0 +1,353 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <mbedtls/bignum.h>
+
+#include "BigNumber.hpp"
+#include "Common.hpp"
+#include "Exceptions.hpp"
+
+/**
+ * Fused modular operations on big numbers. Unlike the operators in
+ * \c BigNumber.hpp , which return a new \c BigNum for each step (i.e., a
+ * new \c mbedtls_mpi and its limbs), these write the result into a given
+ * destination, and keep the intermediate values in a \c BigNumScratch ,
+ * whose limbs are allocated once and reused by later calls. E.g.,
+ * \c (a * b + c) % m becomes \c MulAddMod(dest, a, b, c, m, scratch) .
+ *
+ * The destination may be any of the operands, except the modulus (and the
+ * exponent of \c ExpMod ). The reductions still use \c mbedtls_mpi_mod_mpi ,
+ * which has its own short-lived temporaries inside mbed TLS.
+ */
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The intermediate values of the fused operations; reuse one
+ *        instance for many operations (but only on one thread at a time).
+ *
+ */
+class BigNumScratch
+{
+public:
+
+	BigNumScratch() :
+		m_tmp(),
+		m_rr(),
+		m_rrMod()
+	{}
+
+	BigNumScratch(const BigNumScratch& other) = delete;
+	BigNumScratch(BigNumScratch&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~BigNumScratch() = default;
+	// LCOV_EXCL_STOP
+
+	BigNumScratch& operator=(const BigNumScratch& other) = delete;
+	BigNumScratch& operator=(BigNumScratch&& other) = default;
+
+	/**
+	 * @brief Get the temporary value holding the unreduced result.
+	 *
+	 */
+	mbedtls_mpi* GetTmp()
+	{
+		return m_tmp.Get();
+	}
+
+	/**
+	 * @brief Get the Montgomery constant (R^2 mod m) of the given modulus,
+	 *        for \c mbedtls_mpi_exp_mod ; it's kept until another modulus
+	 *        is used, so repeated exponentiations with the same modulus
+	 *        don't compute it again.
+	 *
+	 * @param mod The modulus.
+	 * @return mbedtls_mpi* The constant; empty if not computed yet, in which
+	 *         case \c mbedtls_mpi_exp_mod fills it in.
+	 */
+	mbedtls_mpi* GetRR(const mbedtls_mpi* mod)
+	{
+		if (mbedtls_mpi_cmp_mpi(m_rrMod.Get(), mod) != 0)
+		{
+			mbedtls_mpi_free(m_rr.Get());
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				BigNumScratch::GetRR,
+				mbedtls_mpi_copy,
+				m_rrMod.Get(), mod
+			);
+		}
+
+		return m_rr.Get();
+	}
+
+private:
+
+	BigNum m_tmp;
+	BigNum m_rr;
+	BigNum m_rrMod;
+
+}; // class BigNumScratch
+
+
+namespace Internal
+{
+
+template<typename _dest_BigNumTrait, typename _mod_BigNumTrait>
+inline void CheckModDest(
+	const BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_mod_BigNumTrait>& mod,
+	const char* funcName,
+	const char* operandName = "modulus"
+)
+{
+	dest.NullCheck();
+	mod.NullCheck();
+
+	if (dest.Get() == mod.Get())
+	{
+		throw InvalidArgumentException(
+			std::string(funcName) +
+			" - The destination can't be the " + operandName + "."
+		);
+	}
+}
+
+} // namespace Internal
+
+
+/**
+ * @brief Calculate \c (a * b) mod m , into \c dest .
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c m is not positive).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _b_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void MulMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_b_BigNumTrait>& b,
+	const BigNumberBase<_m_BigNumTrait>& m,
+	BigNumScratch& scratch
+)
+{
+	Internal::CheckModDest(dest, m, "MulMod");
+	a.NullCheck();
+	b.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		MulMod, mbedtls_mpi_mul_mpi, scratch.GetTmp(), a.Get(), b.Get()
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		MulMod, mbedtls_mpi_mod_mpi, dest.Get(), scratch.GetTmp(), m.Get()
+	);
+}
+
+
+/**
+ * @brief Calculate \c (a * b + c) mod m , into \c dest .
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c m is not positive).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _b_BigNumTrait,
+	typename _c_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void MulAddMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_b_BigNumTrait>& b,
+	const BigNumberBase<_c_BigNumTrait>& c,
+	const BigNumberBase<_m_BigNumTrait>& m,
+	BigNumScratch& scratch
+)
+{
+	Internal::CheckModDest(dest, m, "MulAddMod");
+	a.NullCheck();
+	b.NullCheck();
+	c.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		MulAddMod, mbedtls_mpi_mul_mpi, scratch.GetTmp(), a.Get(), b.Get()
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		MulAddMod, mbedtls_mpi_add_mpi, scratch.GetTmp(), scratch.GetTmp(), c.Get()
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		MulAddMod, mbedtls_mpi_mod_mpi, dest.Get(), scratch.GetTmp(), m.Get()
+	);
+}
+
+
+/**
+ * @brief Calculate \c (a + b) mod m , into \c dest .
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c m is not positive).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _b_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void AddMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_b_BigNumTrait>& b,
+	const BigNumberBase<_m_BigNumTrait>& m,
+	BigNumScratch& scratch
+)
+{
+	Internal::CheckModDest(dest, m, "AddMod");
+	a.NullCheck();
+	b.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		AddMod, mbedtls_mpi_add_mpi, scratch.GetTmp(), a.Get(), b.Get()
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		AddMod, mbedtls_mpi_mod_mpi, dest.Get(), scratch.GetTmp(), m.Get()
+	);
+}
+
+
+/**
+ * @brief Calculate \c (a - b) mod m , into \c dest ; the result is in
+ *        [0, m), even if \c a is less than \c b .
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c m is not positive).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _b_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void SubMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_b_BigNumTrait>& b,
+	const BigNumberBase<_m_BigNumTrait>& m,
+	BigNumScratch& scratch
+)
+{
+	Internal::CheckModDest(dest, m, "SubMod");
+	a.NullCheck();
+	b.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		SubMod, mbedtls_mpi_sub_mpi, scratch.GetTmp(), a.Get(), b.Get()
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		SubMod, mbedtls_mpi_mod_mpi, dest.Get(), scratch.GetTmp(), m.Get()
+	);
+}
+
+
+/**
+ * @brief Calculate \c (a ^ e) mod m , into \c dest ; the Montgomery
+ *        constant of \c m is kept in the scratch for the next call.
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m or \c e .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c m is not positive and odd).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _e_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void ExpMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_e_BigNumTrait>& e,
+	const BigNumberBase<_m_BigNumTrait>& m,
+	BigNumScratch& scratch
+)
+{
+	Internal::CheckModDest(dest, m, "ExpMod");
+	Internal::CheckModDest(dest, e, "ExpMod", "exponent");
+	a.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		ExpMod, mbedtls_mpi_exp_mod,
+		dest.Get(), a.Get(), e.Get(), m.Get(), scratch.GetRR(m.Get())
+	);
+}
+
+
+/**
+ * @brief Calculate the inverse of \c a modulo \c m , into \c dest .
+ *
+ * @exception InvalidObjectException Thrown when one or more given objects are
+ *                                   holding a null pointer for the C mbed TLS
+ *                                   object.
+ * @exception InvalidArgumentException Thrown when \c dest is \c m .
+ * @exception mbedTLSRuntimeError    Thrown when mbed TLS C function call failed
+ *                                   (e.g., \c a has no inverse).
+ */
+template<
+	typename _dest_BigNumTrait,
+	typename _a_BigNumTrait,
+	typename _m_BigNumTrait
+>
+inline void InvMod(
+	BigNumberBase<_dest_BigNumTrait>& dest,
+	const BigNumberBase<_a_BigNumTrait>& a,
+	const BigNumberBase<_m_BigNumTrait>& m
+)
+{
+	Internal::CheckModDest(dest, m, "InvMod");
+	a.NullCheck();
+
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		InvMod, mbedtls_mpi_inv_mod, dest.Get(), a.Get(), m.Get()
+	);
+}
+
+
+} // namespace mbedTLScpp
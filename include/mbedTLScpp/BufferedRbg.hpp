@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <memory>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "RandInterfaces.hpp"
+#include "SecretArray.hpp"
+#include "LoadedFunctions.hpp"
+#include "DefaultRbg.hpp"
+
+#include "Internal/ForkGeneration.hpp"
+#include "Internal/make_unique.hpp"
+
+#include <mbedtls/ctr_drbg.h>
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+	/**
+	 * @brief An RBG front-end that draws large blocks of random bits from an
+	 *        underlying RBG, and serves small requests (e.g., nonces, IVs, or
+	 *        \c GetRand<T>() ) from that block, so that the generate overhead
+	 *        of the underlying DRBG is amortized over many requests.
+	 *        Bytes are zeroized from the block as soon as they are handed
+	 *        out, and the whole block is discarded if the process forks.
+	 *        Requests that are not smaller than \c _MaxDrawSize bypass the
+	 *        block, and are served by the underlying RBG directly.
+	 *
+	 *        NOTE: This class is NOT thread-safe; each thread should own its
+	 *        own instance.
+	 *
+	 * @tparam _BlockSize   The size of the block drawn from the underlying RBG
+	 *                      (default to 4 KiB).
+	 * @tparam _MaxDrawSize The maximum number of bytes that can be requested
+	 *                      from the underlying RBG in a single call
+	 *                      (default to \c MBEDTLS_CTR_DRBG_MAX_REQUEST ).
+	 */
+	template<size_t _BlockSize = 4096,
+			size_t _MaxDrawSize = MBEDTLS_CTR_DRBG_MAX_REQUEST>
+	class BufferedRbg : public RbgInterface
+	{
+	public: // Static members:
+
+		using _BaseIntf = RbgInterface;
+
+		static constexpr size_t sk_blockSize = _BlockSize;
+		static constexpr size_t sk_maxDrawSize = _MaxDrawSize;
+
+		static_assert(sk_blockSize > 0, "The block size must be greater than zero.");
+		static_assert(sk_maxDrawSize > 0, "The max draw size must be greater than zero.");
+
+	public:
+
+		/**
+		 * @brief Construct a new Buffered Rbg object on top of a new
+		 *        \c DefaultRbg instance.
+		 *
+		 */
+		BufferedRbg() :
+			BufferedRbg(Internal::make_unique<DefaultRbg>())
+		{}
+
+		/**
+		 * @brief Construct a new Buffered Rbg object on top of the given RBG.
+		 *
+		 * @exception InvalidArgumentException Thrown when the given RBG is null.
+		 * @param rbg The underlying RBG.
+		 */
+		BufferedRbg(std::unique_ptr<RbgInterface> rbg) :
+			m_rbg(std::move(rbg)),
+			m_block(),
+			m_pos(sk_blockSize),
+			m_forkGen(Internal::GetForkGeneration())
+		{
+			if (m_rbg == nullptr)
+			{
+				throw InvalidArgumentException("BufferedRbg::BufferedRbg - The given RBG is null.");
+			}
+		}
+
+		/**
+		 * @brief Move Constructor. The `rhs` will be empty/null afterwards.
+		 *
+		 * @param rhs The other BufferedRbg instance.
+		 */
+		BufferedRbg(BufferedRbg&& rhs) noexcept :
+			m_rbg(std::move(rhs.m_rbg)),
+			m_block(rhs.m_block),
+			m_pos(rhs.m_pos),
+			m_forkGen(rhs.m_forkGen)
+		{
+			rhs.m_block.Zeroize();
+			rhs.m_pos = sk_blockSize;
+		}
+
+		BufferedRbg(const BufferedRbg& rhs) = delete;
+
+		// LCOV_EXCL_START
+		/** @brief	Destructor */
+		virtual ~BufferedRbg() = default;
+		// LCOV_EXCL_STOP
+
+		/**
+		 * @brief Move assignment. The `rhs` will be empty/null afterwards.
+		 *
+		 * @param rhs The other BufferedRbg instance.
+		 * @return BufferedRbg& A reference to this instance.
+		 */
+		BufferedRbg& operator=(BufferedRbg&& rhs) noexcept
+		{
+			if (this != &rhs)
+			{
+				m_rbg = std::move(rhs.m_rbg);
+				m_block = rhs.m_block;
+				m_pos = rhs.m_pos;
+				m_forkGen = rhs.m_forkGen;
+
+				rhs.m_block.Zeroize();
+				rhs.m_pos = sk_blockSize;
+			}
+			return *this;
+		}
+
+		BufferedRbg& operator=(const BufferedRbg& rhs) = delete;
+
+		/**
+		 * @brief Check if the current instance is holding a null pointer for
+		 *        the underlying RBG. If so, exception will be thrown.
+		 *
+		 * @exception InvalidObjectException Thrown when the current instance is
+		 *                                   holding a null pointer for the
+		 *                                   underlying RBG.
+		 */
+		void NullCheck() const
+		{
+			if (m_rbg == nullptr)
+			{
+				throw InvalidObjectException(MBEDTLSCPP_CLASS_NAME_STR(BufferedRbg));
+			}
+		}
+
+		/**
+		 * @brief Fill random bits into the given memory region.
+		 *
+		 * @param buf  The pointer to the beginning of the memory region.
+		 * @param size The size of the memory region.
+		 */
+		virtual void Rand(void* buf, const size_t size) override
+		{
+			NullCheck();
+
+			uint8_t* out = static_cast<uint8_t*>(buf);
+
+			if (size >= sk_maxDrawSize)
+			{
+				// Large requests won't benefit from buffering.
+				DrawDirect(out, size);
+				return;
+			}
+
+			const uint64_t forkGen = Internal::GetForkGeneration();
+			if (m_forkGen != forkGen)
+			{
+				// The block was duplicated by fork; never hand it out twice.
+				Discard();
+				m_forkGen = forkGen;
+			}
+
+			size_t left = size;
+			while (left > 0)
+			{
+				if (m_pos >= sk_blockSize)
+				{
+					Refill();
+				}
+
+				const size_t toCopy = std::min(left, sk_blockSize - m_pos);
+
+				std::memcpy(out, m_block.data() + m_pos, toCopy);
+				StaticLoadedFunctions::GetInstance().SecureZeroize(m_block.data() + m_pos, toCopy);
+
+				m_pos += toCopy;
+				out += toCopy;
+				left -= toCopy;
+			}
+		}
+
+		/**
+		 * @brief Zeroize and discard all the random bits that are buffered but
+		 *        not yet handed out. The next request will draw a new block.
+		 *
+		 */
+		void Discard() noexcept
+		{
+			m_block.Zeroize();
+			m_pos = sk_blockSize;
+		}
+
+		/**
+		 * @brief Get the number of buffered bytes that haven't been handed out.
+		 *
+		 * @return size_t The number of bytes available in the buffer.
+		 */
+		size_t GetBufferedSize() const noexcept
+		{
+			return sk_blockSize - m_pos;
+		}
+
+	private:
+
+		void DrawDirect(uint8_t* out, size_t size)
+		{
+			while (size > 0)
+			{
+				const size_t toDraw = std::min(size, _MaxDrawSize);
+				m_rbg->Rand(out, toDraw);
+
+				out += toDraw;
+				size -= toDraw;
+			}
+		}
+
+		void Refill()
+		{
+			m_pos = sk_blockSize;
+			try
+			{
+				DrawDirect(m_block.data(), sk_blockSize);
+			}
+			catch (...)
+			{
+				// Don't keep a partially filled block around.
+				m_block.Zeroize();
+				throw;
+			}
+			m_pos = 0;
+		}
+
+		std::unique_ptr<RbgInterface> m_rbg;
+		SecretArray<uint8_t, sk_blockSize> m_block;
+		size_t m_pos;
+		uint64_t m_forkGen;
+	};
+}
@@ -106,6 +106,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data.BeginPtr()),
 				data.GetRegionSize());
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Cmac, data.GetRegionSize());
 		}
 
 		/**
@@ -132,6 +133,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(CmacerBase::Finish, mbedtls_cipher_cmac_finish,
 				Get(),
 				static_cast<unsigned char*>(cmac.data()));
+			MBEDTLSCPP_METRICS_COUNT(Cmac, 0);
 
 			return cmac;
 		}
@@ -163,6 +165,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data),
 				size);
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Cmac, size);
 		}
 	};
 
@@ -300,6 +303,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(Cmacer::FinishNoCheck, mbedtls_cipher_cmac_finish,
 				Get(),
 				static_cast<unsigned char*>(cmac.data()));
+			MBEDTLSCPP_METRICS_COUNT(Cmac, 0);
 
 			return cmac;
 		}
@@ -4,13 +4,31 @@
 
 #ifdef MBEDTLS_THREADING_ALT
 
+#include <cstddef>
+#include <cstdint>
+
 #include <mutex>
-#include <memory>
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+#include <atomic>
+#include <chrono>
+#endif
 
 #include <mbedtls/platform.h>
 
 #include "Internal/Memory.hpp"
-#include "Internal/make_unique.hpp"
+
+/**
+ * @brief The number of times a contended lock spins (i.e., retries
+ *        \c try_lock with a CPU relax hint in between) before it falls back to
+ *        a blocking lock. Most of the critical sections in mbed TLS (entropy
+ *        pool, DRBG, ticket keys, session cache) are short, so a short spin
+ *        usually avoids putting the thread to sleep.
+ *        Set it to 0 to always block immediately.
+ */
+#ifndef MBEDTLSCPP_MUTEX_SPIN_COUNT
+#define MBEDTLSCPP_MUTEX_SPIN_COUNT 64
+#endif
 
 #ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 namespace mbedTLScpp
@@ -18,9 +36,58 @@ namespace mbedTLScpp
 namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 #endif
 {
+	namespace Internal
+	{
+		/**
+		 * @brief Hint the CPU that we are in a spin-wait loop.
+		 *
+		 */
+		inline void CpuRelax() noexcept
+		{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || defined(__arm__))
+			__asm__ __volatile__("yield" ::: "memory");
+#endif
+		}
+	}
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+	/**
+	 * @brief Contention statistics of a mutex (or the sum of all mutexes).
+	 *
+	 */
+	struct MutexStats
+	{
+		/** @brief Number of times the lock has been acquired. */
+		uint64_t m_lockCount;
+		/** @brief Number of times the lock was held by others at the first try. */
+		uint64_t m_contendedCount;
+		/** @brief Number of times the spin phase failed, and the thread had to block. */
+		uint64_t m_blockedCount;
+		/** @brief Total time spent waiting on contended locks, in nanoseconds. */
+		uint64_t m_waitNanoSec;
+	};
+#endif // MBEDTLSCPP_MUTEX_STATS
+
+	/**
+	 * @brief The mutex implementation given to mbed TLS when
+	 *        \c MBEDTLS_THREADING_ALT is enabled.
+	 *        The lock state lives inline in the mutex object, so locking and
+	 *        unlocking never allocate; the only allocation happens when mbed
+	 *        TLS initializes the mutex. A contended lock spins for
+	 *        \c MBEDTLSCPP_MUTEX_SPIN_COUNT rounds before it blocks on the
+	 *        underlying \c std::mutex (which sleeps on a futex on Linux).
+	 *
+	 *        If \c MBEDTLSCPP_MUTEX_STATS is defined, each mutex also records
+	 *        its contention statistics, which can be retrieved with
+	 *        \c GetStats() and \c GetGlobalStats() .
+	 */
 	class CppMutexIntf
 	{
-	public:
+	public: // Static members:
+
+		static constexpr size_t sk_spinCount = MBEDTLSCPP_MUTEX_SPIN_COUNT;
 
 		static void MutexInit(mbedtls_threading_mutex_t *mutex) noexcept
 		{
@@ -63,9 +130,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 
 			try
 			{
-				std::unique_ptr<std::unique_lock<std::mutex> > lockPtr =
-					Internal::make_unique<std::unique_lock<std::mutex> >(cppMutex->m_mutex);
-				cppMutex->m_lock = std::move(lockPtr);
+				cppMutex->Lock();
 			}
 			catch (...)
 			{
@@ -85,30 +150,172 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 
 			CppMutexIntf* cppMutex = static_cast<CppMutexIntf*>(*mutex);
 
-			try
-			{
-				cppMutex->m_lock.reset();
-			}
-			catch (...)
+			cppMutex->Unlock();
+
+			return MBEDTLS_EXIT_SUCCESS;
+		}
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+		/**
+		 * @brief Get the contention statistics of the given mbed TLS mutex.
+		 *
+		 * @param mutex The mbed TLS mutex, which must be initialized by
+		 *              \c MutexInit .
+		 * @return MutexStats The statistics; all zeros if the mutex is null.
+		 */
+		static MutexStats GetStats(const mbedtls_threading_mutex_t& mutex) noexcept
+		{
+			if (mutex == nullptr)
 			{
-				return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+				return MutexStats{ 0, 0, 0, 0 };
 			}
+			return static_cast<const CppMutexIntf*>(mutex)->GetStats();
+		}
 
-			return MBEDTLS_EXIT_SUCCESS;
+		/**
+		 * @brief Get the contention statistics summed over all mutexes
+		 *        created through this interface since the program started.
+		 *
+		 * @return MutexStats The statistics.
+		 */
+		static MutexStats GetGlobalStats() noexcept
+		{
+			return GetGlobalCounters().Load();
 		}
+#endif // MBEDTLSCPP_MUTEX_STATS
 
 	public:
 		CppMutexIntf() noexcept :
-			m_mutex(), //noexcept
-			m_lock() //noexcept
+			m_mutex() //noexcept
 		{}
 
 		~CppMutexIntf()
 		{}
 
+		/**
+		 * @brief Acquire the lock; spin for a short while if it's held by
+		 *        others, and then block.
+		 *
+		 * @exception std::system_error Thrown when the underlying mutex
+		 *                              failed to block.
+		 */
+		void Lock()
+		{
+			if (m_mutex.try_lock())
+			{
+#ifdef MBEDTLSCPP_MUTEX_STATS
+				RecordLock(false, false, std::chrono::steady_clock::duration::zero());
+#endif
+				return;
+			}
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+			const auto waitStart = std::chrono::steady_clock::now();
+#endif
+
+			bool isAcquired = false;
+			for (size_t i = 0; i < sk_spinCount && !isAcquired; ++i)
+			{
+				Internal::CpuRelax();
+				isAcquired = m_mutex.try_lock();
+			}
+
+			if (!isAcquired)
+			{
+				m_mutex.lock();
+			}
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+			RecordLock(true, !isAcquired, std::chrono::steady_clock::now() - waitStart);
+#endif
+		}
+
+		/**
+		 * @brief Release the lock.
+		 *
+		 */
+		void Unlock() noexcept
+		{
+			m_mutex.unlock();
+		}
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+		/**
+		 * @brief Get the contention statistics of this mutex.
+		 *
+		 * @return MutexStats The statistics.
+		 */
+		MutexStats GetStats() const noexcept
+		{
+			return m_counters.Load();
+		}
+#endif // MBEDTLSCPP_MUTEX_STATS
+
 	private:
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+		struct Counters
+		{
+			std::atomic<uint64_t> m_lockCount;
+			std::atomic<uint64_t> m_contendedCount;
+			std::atomic<uint64_t> m_blockedCount;
+			std::atomic<uint64_t> m_waitNanoSec;
+
+			Counters() noexcept :
+				m_lockCount(0),
+				m_contendedCount(0),
+				m_blockedCount(0),
+				m_waitNanoSec(0)
+			{}
+
+			void Add(bool isContended, bool isBlocked, uint64_t waitNanoSec) noexcept
+			{
+				m_lockCount.fetch_add(1, std::memory_order_relaxed);
+				if (isContended)
+				{
+					m_contendedCount.fetch_add(1, std::memory_order_relaxed);
+					m_waitNanoSec.fetch_add(waitNanoSec, std::memory_order_relaxed);
+				}
+				if (isBlocked)
+				{
+					m_blockedCount.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+
+			MutexStats Load() const noexcept
+			{
+				return MutexStats{
+					m_lockCount.load(std::memory_order_relaxed),
+					m_contendedCount.load(std::memory_order_relaxed),
+					m_blockedCount.load(std::memory_order_relaxed),
+					m_waitNanoSec.load(std::memory_order_relaxed),
+				};
+			}
+		};
+
+		static Counters& GetGlobalCounters() noexcept
+		{
+			static Counters sk_counters;
+			return sk_counters;
+		}
+
+		void RecordLock(
+			bool isContended,
+			bool isBlocked,
+			std::chrono::steady_clock::duration waitTime
+		) noexcept
+		{
+			const uint64_t waitNanoSec = static_cast<uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(waitTime).count()
+			);
+			m_counters.Add(isContended, isBlocked, waitNanoSec);
+			GetGlobalCounters().Add(isContended, isBlocked, waitNanoSec);
+		}
+
+		Counters m_counters;
+#endif // MBEDTLSCPP_MUTEX_STATS
+
 		std::mutex m_mutex;
-		std::unique_ptr<std::unique_lock<std::mutex> > m_lock;
 	};
 
 	class CppMutexIntfInitializer
@@ -0,0 +1,133 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <tuple>
+
+#if !defined(MBEDTLSCPP_NO_CPU_FEATURES) && \
+	(defined(__GNUC__) || defined(_WIN32)) && \
+	(defined(__x86_64__) || defined(_M_X64) || \
+		defined(__i386__) || defined(_M_IX86))
+#	define MBEDTLSCPP_INTERNAL_CPU_FEATURES_X86
+#	include "Internal/CpuId.hpp"
+#elif !defined(MBEDTLSCPP_NO_CPU_FEATURES) && \
+	defined(__linux__) && defined(__aarch64__)
+#	define MBEDTLSCPP_INTERNAL_CPU_FEATURES_AARCH64
+#	include <sys/auxv.h>
+#endif
+
+/**
+ * The detection can be disabled with \c MBEDTLSCPP_NO_CPU_FEATURES , e.g.,
+ * in environments where the \c cpuid instruction is not allowed (such as
+ * SGX enclaves); all the features are then reported as absent.
+ */
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The CPU features that change which algorithms are the fastest.
+ *
+ */
+struct CpuFeatures
+{
+	/**
+	 * @brief AES instructions (AES-NI on x86, or the AES extension on
+	 *        AArch64).
+	 */
+	bool m_hasAes;
+
+	/**
+	 * @brief Carry-less multiplication (PCLMULQDQ on x86, or PMULL on
+	 *        AArch64), which GCM needs to be fast.
+	 */
+	bool m_hasClmul;
+
+	/**
+	 * @brief SHA-256 instructions (SHA extensions on x86, or the SHA2
+	 *        extension on AArch64).
+	 */
+	bool m_hasSha256;
+
+	/**
+	 * @brief Check if AES-GCM runs in hardware.
+	 *
+	 * @return true if both AES and carry-less multiplication are supported.
+	 */
+	bool HasFastAesGcm() const noexcept
+	{
+		return m_hasAes && m_hasClmul;
+	}
+}; // struct CpuFeatures
+
+
+/**
+ * @brief Detect the features of the CPU running this code.
+ *
+ * @return CpuFeatures The features detected; all absent on platforms where
+ *                     they can't be detected.
+ */
+inline CpuFeatures DetectCpuFeatures()
+{
+	CpuFeatures res = CpuFeatures();
+
+#if defined(MBEDTLSCPP_INTERNAL_CPU_FEATURES_X86)
+	uint32_t maxLeaf = 0;
+	uint32_t ebx = 0;
+	uint32_t ecx = 0;
+
+	std::tie(maxLeaf, std::ignore, std::ignore, std::ignore) =
+		Internal::RunCpuid(0x00, 0x00);
+
+	if (maxLeaf >= 0x01)
+	{
+		std::tie(std::ignore, std::ignore, ecx, std::ignore) =
+			Internal::RunCpuid(0x01, 0x00);
+		res.m_hasClmul = (ecx & (1U << 1))  != 0;
+		res.m_hasAes   = (ecx & (1U << 25)) != 0;
+	}
+	if (maxLeaf >= 0x07)
+	{
+		std::tie(std::ignore, ebx, std::ignore, std::ignore) =
+			Internal::RunCpuid(0x07, 0x00);
+		res.m_hasSha256 = (ebx & (1U << 29)) != 0;
+	}
+#elif defined(MBEDTLSCPP_INTERNAL_CPU_FEATURES_AARCH64)
+	// Bits of AT_HWCAP, from <asm/hwcap.h>.
+	const unsigned long hwCap = getauxval(AT_HWCAP);
+	res.m_hasAes    = (hwCap & (1UL << 3)) != 0;
+	res.m_hasClmul  = (hwCap & (1UL << 4)) != 0;
+	res.m_hasSha256 = (hwCap & (1UL << 6)) != 0;
+#endif
+
+	return res;
+}
+
+
+/**
+ * @brief Get the features of the CPU running this code; they are only
+ *        detected once.
+ *
+ * @return const CpuFeatures& The features detected.
+ */
+inline const CpuFeatures& GetCpuFeatures()
+{
+	static const CpuFeatures sk_features = DetectCpuFeatures();
+	return sk_features;
+}
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,140 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_EC_ACCEL
+
+
+#include <mbedtls/bignum.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/md.h>
+
+#include "EcKeyEnum.hpp"
+
+#ifdef MBEDTLSCPP_EC_ACCEL_P256M
+#	include "EcAccelP256m.hpp"
+#	if !defined(MBEDTLS_PSA_P256M_DRIVER_ENABLED)
+#		error "MBEDTLSCPP_EC_ACCEL_P256M requires MBEDTLS_PSA_P256M_DRIVER_ENABLED."
+#	endif
+#endif // MBEDTLSCPP_EC_ACCEL_P256M
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The EC acceleration backend that accelerates nothing, so every
+ *        operation goes through the generic mbedTLS implementation.
+ *
+ *        The EC key classes consult \c DefaultEcAccel before calling into
+ *        mbedTLS for ECDSA signing, ECDSA verification, and ECDH. Defining
+ *        \c MBEDTLSCPP_EC_ACCEL_P256M makes \c P256mEcAccel (see
+ *        \c EcAccelP256m.hpp ) the default, which accelerates
+ *        \c SECP256R1 . To plug in other implementations, define
+ *        \c MBEDTLSCPP_CUSTOMIZED_EC_ACCEL as the path to a header that
+ *        defines \c DefaultEcAccel with the same static methods as this
+ *        class. A backend can also be given to a single call, as the first
+ *        template argument of \c VerifySign , \c SignInBigNum , or
+ *        \c DeriveSharedKeyInBigNum .
+ *
+ *        Each operation returns an mbedTLS error code; returning
+ *        \c MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE makes the caller fall back to
+ *        the generic mbedTLS implementation.
+ */
+struct NoEcAccel
+{
+	/**
+	 * @brief Check if the given curve has an accelerated implementation.
+	 *
+	 * @param ecType The curve type.
+	 * @return true if accelerated, otherwise, false.
+	 */
+	static constexpr bool IsAccelerated(EcType /* ecType */) noexcept
+	{
+		return false;
+	}
+
+	/**
+	 * @brief ECDSA signing; see \c mbedtls_ecdsa_sign_det_ext for the
+	 *        meaning of the parameters.
+	 *
+	 */
+	static int EcdsaSign(
+		EcType /* ecType */,
+		mbedtls_mpi* /* r */,
+		mbedtls_mpi* /* s */,
+		const mbedtls_mpi* /* d */,
+		const unsigned char* /* hash */,
+		size_t /* hashLen */,
+		mbedtls_md_type_t /* mdAlg */,
+		int (* /* fRng */)(void *, unsigned char *, size_t),
+		void* /* pRng */
+	)
+	{
+		return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+	}
+
+	/**
+	 * @brief ECDSA verification; see \c mbedtls_ecdsa_verify for the
+	 *        meaning of the parameters.
+	 *
+	 */
+	static int EcdsaVerify(
+		EcType /* ecType */,
+		const unsigned char* /* hash */,
+		size_t /* hashLen */,
+		const mbedtls_ecp_point* /* Q */,
+		const mbedtls_mpi* /* r */,
+		const mbedtls_mpi* /* s */
+	)
+	{
+		return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+	}
+
+	/**
+	 * @brief ECDH shared secret computation; see
+	 *        \c mbedtls_ecdh_compute_shared for the meaning of the parameters.
+	 *
+	 */
+	static int EcdhComputeShared(
+		EcType /* ecType */,
+		mbedtls_mpi* /* z */,
+		const mbedtls_ecp_point* /* Q */,
+		const mbedtls_mpi* /* d */,
+		int (* /* fRng */)(void *, unsigned char *, size_t),
+		void* /* pRng */
+	)
+	{
+		return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+	}
+
+}; // struct NoEcAccel
+
+
+#ifdef MBEDTLSCPP_EC_ACCEL_P256M
+using DefaultEcAccel = P256mEcAccel;
+#else
+using DefaultEcAccel = NoEcAccel;
+#endif
+
+
+} // namespace mbedTLScpp
+
+
+#else // !MBEDTLSCPP_CUSTOMIZED_EC_ACCEL
+
+
+#include MBEDTLSCPP_CUSTOMIZED_EC_ACCEL
+
+
+#endif // !MBEDTLSCPP_CUSTOMIZED_EC_ACCEL
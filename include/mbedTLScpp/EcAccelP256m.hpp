@@ -0,0 +1,268 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <mbedtls/bignum.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/md.h>
+#include <mbedtls/platform_util.h>
+
+#if defined(MBEDTLS_PSA_P256M_DRIVER_ENABLED)
+#include <psa/crypto.h>
+
+extern "C" {
+#include <p256-m/p256-m.h>
+}
+#endif // MBEDTLS_PSA_P256M_DRIVER_ENABLED
+
+#include "EcKeyEnum.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+#if defined(MBEDTLS_PSA_P256M_DRIVER_ENABLED)
+
+namespace Internal
+{
+
+/**
+ * @brief Convert a p256-m return value to the mbedTLS error code of the
+ *        generic implementation.
+ *
+ */
+inline int P256mRetToMbedTls(int p256Ret) noexcept
+{
+	switch (p256Ret)
+	{
+	case P256_SUCCESS:
+		return 0;
+	case P256_RANDOM_FAILED:
+		return MBEDTLS_ERR_ECP_RANDOM_FAILED;
+	case P256_INVALID_PUBKEY:
+	case P256_INVALID_PRIVKEY:
+		return MBEDTLS_ERR_ECP_INVALID_KEY;
+	case P256_INVALID_SIGNATURE:
+		return MBEDTLS_ERR_ECP_VERIFY_FAILED;
+	default:
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+	}
+}
+
+/**
+ * @brief Write a point in the p256-m format, i.e., X || Y, both big-endian.
+ *
+ * @return 0 on success, or \c MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE if the
+ *         point isn't in affine coordinates (so the caller falls back to
+ *         mbedTLS).
+ */
+inline int P256mWritePoint(const mbedtls_ecp_point& pt, uint8_t (&buf)[64]) noexcept
+{
+	if (mbedtls_mpi_cmp_int(&pt.MBEDTLS_PRIVATE(Z), 1) != 0)
+	{
+		return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+	}
+
+	int ret = mbedtls_mpi_write_binary(&pt.MBEDTLS_PRIVATE(X), buf, 32);
+	if (ret == 0)
+	{
+		ret = mbedtls_mpi_write_binary(&pt.MBEDTLS_PRIVATE(Y), buf + 32, 32);
+	}
+	return (ret == 0) ? 0 : MBEDTLS_ERR_ECP_INVALID_KEY;
+}
+
+/**
+ * @brief Initialize PSA crypto, whose RNG p256-m draws the ECDSA nonces
+ *        from, once per program.
+ *
+ * @return true if it's ready.
+ */
+inline bool P256mIsRngReady() noexcept
+{
+	static const bool sk_isReady = (psa_crypto_init() == PSA_SUCCESS);
+	return sk_isReady;
+}
+
+} // namespace Internal
+
+
+/**
+ * @brief The EC acceleration backend for \c SECP256R1 , based on p256-m,
+ *        the compact constant-time P-256 implementation that mbed TLS
+ *        ships in \c 3rdparty/p256-m , and builds when
+ *        \c MBEDTLS_PSA_P256M_DRIVER_ENABLED is set. The include directory
+ *        of the \c p256m library target must be visible to the compiler.
+ *
+ *        Define \c MBEDTLSCPP_EC_ACCEL_P256M to make it the
+ *        \c DefaultEcAccel , or give it to a single call, e.g.,
+ *        \c SignInBigNum<P256mEcAccel>(...) . Other curves (including
+ *        \c SECP384R1 ) are left to mbedTLS.
+ *
+ *        p256-m draws the ECDSA nonces from the PSA RNG, rather than the
+ *        given one, so the signatures are randomized instead of
+ *        deterministic, and \c psa_crypto_init is called on the first
+ *        signing; if it fails, signing falls back to mbedTLS.
+ */
+struct P256mEcAccel
+{
+	/**
+	 * @brief Check if the given curve has an accelerated implementation.
+	 *
+	 * @param ecType The curve type.
+	 * @return true if it's \c SECP256R1 , otherwise, false.
+	 */
+	static constexpr bool IsAccelerated(EcType ecType) noexcept
+	{
+		return ecType == EcType::SECP256R1;
+	}
+
+	/**
+	 * @brief ECDSA signing; see \c mbedtls_ecdsa_sign_det_ext for the
+	 *        meaning of the parameters.
+	 *
+	 */
+	static int EcdsaSign(
+		EcType ecType,
+		mbedtls_mpi* r,
+		mbedtls_mpi* s,
+		const mbedtls_mpi* d,
+		const unsigned char* hash,
+		size_t hashLen,
+		mbedtls_md_type_t /* mdAlg */,
+		int (* /* fRng */)(void *, unsigned char *, size_t),
+		void* /* pRng */
+	)
+	{
+		if (!IsAccelerated(ecType) || !Internal::P256mIsRngReady())
+		{
+			return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+		}
+
+		uint8_t priv[32];
+		uint8_t sig[64];
+
+		int ret = mbedtls_mpi_write_binary(d, priv, sizeof(priv));
+		if (ret == 0)
+		{
+			ret = Internal::P256mRetToMbedTls(
+				p256_ecdsa_sign(sig, priv, hash, hashLen)
+			);
+		}
+		mbedtls_platform_zeroize(priv, sizeof(priv));
+
+		if (ret == 0)
+		{
+			ret = mbedtls_mpi_read_binary(r, sig, 32);
+		}
+		if (ret == 0)
+		{
+			ret = mbedtls_mpi_read_binary(s, sig + 32, 32);
+		}
+		return ret;
+	}
+
+	/**
+	 * @brief ECDSA verification; see \c mbedtls_ecdsa_verify for the
+	 *        meaning of the parameters.
+	 *
+	 */
+	static int EcdsaVerify(
+		EcType ecType,
+		const unsigned char* hash,
+		size_t hashLen,
+		const mbedtls_ecp_point* Q,
+		const mbedtls_mpi* r,
+		const mbedtls_mpi* s
+	)
+	{
+		if (!IsAccelerated(ecType))
+		{
+			return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+		}
+
+		uint8_t pub[64];
+		int ret = Internal::P256mWritePoint(*Q, pub);
+		if (ret != 0)
+		{
+			return ret;
+		}
+
+		// r and s are written without their signs, so they're checked here.
+		uint8_t sig[64];
+		if (mbedtls_mpi_cmp_int(r, 1) < 0 ||
+			mbedtls_mpi_cmp_int(s, 1) < 0 ||
+			mbedtls_mpi_write_binary(r, sig, 32) != 0 ||
+			mbedtls_mpi_write_binary(s, sig + 32, 32) != 0)
+		{
+			return MBEDTLS_ERR_ECP_VERIFY_FAILED;
+		}
+
+		return Internal::P256mRetToMbedTls(
+			p256_ecdsa_verify(sig, pub, hash, hashLen)
+		);
+	}
+
+	/**
+	 * @brief ECDH shared secret computation; see
+	 *        \c mbedtls_ecdh_compute_shared for the meaning of the parameters.
+	 *
+	 */
+	static int EcdhComputeShared(
+		EcType ecType,
+		mbedtls_mpi* z,
+		const mbedtls_ecp_point* Q,
+		const mbedtls_mpi* d,
+		int (* /* fRng */)(void *, unsigned char *, size_t),
+		void* /* pRng */
+	)
+	{
+		if (!IsAccelerated(ecType))
+		{
+			return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+		}
+
+		uint8_t pub[64];
+		int ret = Internal::P256mWritePoint(*Q, pub);
+		if (ret != 0)
+		{
+			return ret;
+		}
+
+		uint8_t priv[32];
+		uint8_t secret[32];
+
+		ret = mbedtls_mpi_write_binary(d, priv, sizeof(priv));
+		if (ret == 0)
+		{
+			ret = Internal::P256mRetToMbedTls(
+				p256_ecdh_shared_secret(secret, priv, pub)
+			);
+		}
+		mbedtls_platform_zeroize(priv, sizeof(priv));
+
+		if (ret == 0)
+		{
+			ret = mbedtls_mpi_read_binary(z, secret, sizeof(secret));
+		}
+		mbedtls_platform_zeroize(secret, sizeof(secret));
+		return ret;
+	}
+
+}; // struct P256mEcAccel
+
+#endif // MBEDTLS_PSA_P256M_DRIVER_ENABLED
+
+
+} // namespace mbedTLScpp
@@ -14,6 +14,7 @@
 #include <mbedtls/ecdsa.h>
 
 #include "BigNumber.hpp"
+#include "EcAccel.hpp"
 #include "EcKeyEnum.hpp"
 #include "PKey.hpp"
 
@@ -235,80 +236,114 @@ public:
 }; // class EcGroup
 
 
-namespace Internal
+/**
+ * @brief A per-thread cache of loaded EC groups, one for each \c EcType .
+ *
+ *        Each operation needs a group it can modify (mbedTLS takes it as
+ *        non-const), so the groups can't be shared across threads; without
+ *        the cache, each operation would load a new copy of the group
+ *        (\c mbedtls_ecp_group_copy simply reloads the curve), i.e., read
+ *        the curve constants into newly allocated big numbers, and free it
+ *        afterwards. Instead, each thread keeps its own set of groups, which
+ *        are loaded on first use and live until the thread exits.
+ *
+ *        The saving is the loading and the allocations, not the comb table
+ *        of the base point: in mbed TLS 3.x, that table comes from static
+ *        data for the built-in short Weierstrass curves when
+ *        \c MBEDTLS_ECP_FIXED_POINT_OPTIM is set, and isn't kept in the
+ *        group otherwise.
+ *
+ *        The groups are not allocated through \c Internal::NewObject , since
+ *        they are intentionally kept alive for the lifetime of the thread.
+ */
+class EcGroupCache
 {
+public: // static members:
 
-template<typename _other_PKTrait>
-inline PKeyBase<_other_PKTrait>&& PKeyBaseRRefFilter(
-	PKeyBase<_other_PKTrait>&& other,
-	PKeyAlgmCat algCat,
-	PKeyType reqKeyType
-)
-{
-	// Check algorithm category
-	if (other.GetAlgorithmCat() != algCat)
+	static constexpr size_t sk_numOfTypes =
+		static_cast<size_t>(EcType::CURVE448) + 1;
+
+	/**
+	 * @brief Get the cached group of the given curve, owned by the calling
+	 *        thread. The returned object only borrows the group, and it must
+	 *        not be passed to other threads.
+	 *
+	 * @exception InvalidArgumentException Thrown when the curve type is invalid.
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS failed to load the
+	 *                                group.
+	 * @param type The curve type.
+	 * @return EcGroup<BorrowedEcGroupTrait> The borrowed group.
+	 */
+	static EcGroup<BorrowedEcGroupTrait> GetThreadGroup(EcType type)
 	{
-		throw InvalidArgumentException(
-			"Internal::BaseRRefFilter"
-			" - The algorithm of given PKeyBase doesn't match the required one"
-		);
+		static thread_local EcGroupCache sk_cache;
+
+		return EcGroup<BorrowedEcGroupTrait>(sk_cache.GetGroup(type));
 	}
 
-	// Check key type
-	switch (reqKeyType)
+public:
+
+	EcGroupCache(const EcGroupCache& other) = delete;
+	EcGroupCache(EcGroupCache&& other) = delete;
+
+	// LCOV_EXCL_START
+	~EcGroupCache()
 	{
-	case PKeyType::Public:
+		for (size_t i = 0; i < sk_numOfTypes; ++i)
+		{
+			mbedtls_ecp_group_free(&m_groups[i]);
+		}
+	}
+	// LCOV_EXCL_STOP
+
+	EcGroupCache& operator=(const EcGroupCache& other) = delete;
+	EcGroupCache& operator=(EcGroupCache&& other) = delete;
+
+private:
+
+	EcGroupCache()
 	{
-		if (!other.HasPubKey())
+		for (size_t i = 0; i < sk_numOfTypes; ++i)
 		{
-			throw InvalidArgumentException(
-				"Internal::BaseRRefFilter"
-				" - The given PKeyBase doesn't have public key"
-			);
+			mbedtls_ecp_group_init(&m_groups[i]);
 		}
-		break;
 	}
-	case PKeyType::Private:
+
+	mbedtls_ecp_group& GetGroup(EcType type)
 	{
-		if (other.GetKeyType() != PKeyType::Private)
+		const size_t idx = static_cast<size_t>(type);
+		if (idx >= sk_numOfTypes)
 		{
 			throw InvalidArgumentException(
-				"Internal::BaseRRefFilter"
-				" - The given PKeyBase doesn't have private key"
+				"EcGroupCache::GetGroup"
+				" - Invalid Elliptic Curve type is given."
 			);
 		}
-		break;
-	}
-	default:
-		throw InvalidArgumentException(
-			"Internal::BaseRRefFilter"
-			" - The given PKeyType is invalid"
-		);
-	}
 
-	// All checks passed, return the given object
-	return std::forward<PKeyBase<_other_PKTrait> >(other);
-}
+		mbedtls_ecp_group& grp = m_groups[idx];
+		if (grp.id == mbedtls_ecp_group_id::MBEDTLS_ECP_DP_NONE)
+		{
+			const int mbedRet =
+				mbedtls_ecp_group_load(&grp, ToEcGroupId(type));
+			if (mbedRet != MBEDTLS_EXIT_SUCCESS)
+			{
+				// Don't leave a half-loaded group in the cache.
+				mbedtls_ecp_group_free(&grp);
+				mbedtls_ecp_group_init(&grp);
+			}
+			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+				mbedRet,
+				EcGroupCache::GetGroup,
+				mbedtls_ecp_group_load
+			);
+		}
 
+		return grp;
+	}
 
-template<
-	PKeyAlgmCat _AlgCat,
-	PKeyType _ReqKeyType,
-	typename _other_PKTrait
->
-inline PKeyBase<_other_PKTrait>&& PKeyBaseRRefFilter(
-	PKeyBase<_other_PKTrait>&& other
-)
-{
-	return PKeyBaseRRefFilter(
-		std::forward<PKeyBase<_other_PKTrait> >(other),
-		_AlgCat,
-		_ReqKeyType
-	);
-}
+	mbedtls_ecp_group m_groups[sk_numOfTypes];
 
-
-} // namespace Internal
+}; // class EcGroupCache
 
 
 template<
@@ -677,12 +712,14 @@ public:
 	/**
 	 * @brief	Verify signature.
 	 *
+	 * @tparam	_EcAccel		The EC acceleration backend to try first.
 	 * @tparam	containerType	Type of the container for the hash.
 	 * @param	hash	The hash.
 	 * @param	r   	Elliptic Curve signature's R value.
 	 * @param	s   	Elliptic Curve signature's S value.
 	 */
 	template<
+		typename _EcAccel = DefaultEcAccel,
 		typename _HashCtnType,
 		bool _HashSecrecy,
 		typename _r_Trait,
@@ -696,7 +733,39 @@ public:
 	{
 		const mbedtls_ecp_keypair& ecCtx = GetEcContextRef();
 
-		EcGroup<> ecGrp = CopyGroup();
+		const EcType ecType = GetEcType();
+		if (IsMontgomeryCurve(ecType))
+		{
+			throw InvalidArgumentException(
+				"EcPublicKeyBase::VerifySign"
+				" - ECDSA is not supported on Montgomery curves"
+			);
+		}
+
+		if (_EcAccel::IsAccelerated(ecType))
+		{
+			const int accelRet = _EcAccel::EcdsaVerify(
+				ecType,
+				static_cast<const unsigned char*>(hash.BeginPtr()),
+				hash.GetRegionSize(),
+				&Internal::GetQFromEcPair(ecCtx),
+				r.Get(),
+				s.Get()
+			);
+			if (accelRet != MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE)
+			{
+				MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+					accelRet,
+					EcPublicKeyBase::VerifySign,
+					_EcAccel::EcdsaVerify
+				);
+				MBEDTLSCPP_METRICS_COUNT(Verify, hash.GetRegionSize());
+				return;
+			}
+		}
+
+		EcGroup<BorrowedEcGroupTrait> ecGrp =
+			EcGroupCache::GetThreadGroup(ecType);
 
 		MBEDTLSCPP_MAKE_C_FUNC_CALL(
 			EcPublicKeyBase::VerifySign,
@@ -708,6 +777,8 @@ public:
 			r.Get(),
 			s.Get()
 		);
+
+		MBEDTLSCPP_METRICS_COUNT(Verify, hash.GetRegionSize());
 	}
 
 protected:
@@ -966,6 +1037,7 @@ public:
 	using _Base::GetEcContextRef;
 	using _Base::IsEcContextNull;
 	using _Base::CopyGroup;
+	using _Base::GetEcType;
 
 	using _Base::GetPublicDer;
 	using _Base::GetPublicPem;
@@ -988,6 +1060,7 @@ public:
 	/**
 	 * @brief	Make a signature.
 	 *
+	 * @tparam	_EcAccel		The EC acceleration backend to try first.
 	 * @tparam	_HashCtnType	Type of the container for the hash.
 	 * @tparam	_HashSecrecy	Secrecy of the container for the hash.
 	 * @param	hashType	The type of hash.
@@ -995,7 +1068,11 @@ public:
 	 * @param	rand		The random bit generator.
 	 * @return	A tuple of BigNum's. It's in the order of R and S value.
 	 */
-	template<typename _HashCtnType, bool _HashSecrecy>
+	template<
+		typename _EcAccel = DefaultEcAccel,
+		typename _HashCtnType,
+		bool _HashSecrecy
+	>
 	std::tuple<
 		BigNum /* r */,
 		BigNum /* s */
@@ -1007,11 +1084,47 @@ public:
 	) const
 	{
 		const mbedtls_ecp_keypair& ecCtx = GetEcContextRef();
-		EcGroup<> ecGrp = CopyGroup();
+
+		const EcType ecType = GetEcType();
+		if (IsMontgomeryCurve(ecType))
+		{
+			throw InvalidArgumentException(
+				"EcKeyPairBase::SignInBigNum"
+				" - ECDSA is not supported on Montgomery curves"
+			);
+		}
 
 		BigNum r;
 		BigNum s;
 
+		if (_EcAccel::IsAccelerated(ecType))
+		{
+			const int accelRet = _EcAccel::EcdsaSign(
+				ecType,
+				r.Get(),
+				s.Get(),
+				&Internal::GetDFromEcPair(ecCtx),
+				static_cast<const unsigned char*>(hash.BeginPtr()),
+				hash.GetRegionSize(),
+				GetMbedTlsMdType(hashType),
+				&RbgInterface::CallBack,
+				&rand
+			);
+			if (accelRet != MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE)
+			{
+				MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+					accelRet,
+					EcKeyPairBase::SignInBigNum,
+					_EcAccel::EcdsaSign
+				);
+				MBEDTLSCPP_METRICS_COUNT(Sign, hash.GetRegionSize());
+				return std::make_tuple(r, s);
+			}
+		}
+
+		EcGroup<BorrowedEcGroupTrait> ecGrp =
+			EcGroupCache::GetThreadGroup(ecType);
+
 #ifdef MBEDTLS_ECDSA_DETERMINISTIC
 		MBEDTLSCPP_MAKE_C_FUNC_CALL(
 			EcKeyPairBase::SignInBigNum,
@@ -1041,11 +1154,12 @@ public:
 		);
 #endif // MBEDTLS_ECDSA_DETERMINISTIC
 
+		MBEDTLSCPP_METRICS_COUNT(Sign, hash.GetRegionSize());
 		return std::make_tuple(r, s);
 	}
 
 
-	template<HashType _HashType>
+	template<typename _EcAccel = DefaultEcAccel, HashType _HashType>
 	std::tuple<
 		BigNum /* r */,
 		BigNum /* s */
@@ -1055,19 +1169,20 @@ public:
 		RbgInterface& rand
 	) const
 	{
-		return SignInBigNum(_HashType, CtnFullR(hash), rand);
+		return SignInBigNum<_EcAccel>(_HashType, CtnFullR(hash), rand);
 	}
 
 
 	/**
 	 * @brief	Derive shared key
 	 *
+	 * @tparam	_EcAccel	The EC acceleration backend to try first.
 	 * @param  	pubKey	The public key.
 	 * @param	rand   	The random bit generator.
 	 *
 	 * @return The share key in BigNum
 	 */
-	template<typename _pub_Trait>
+	template<typename _EcAccel = DefaultEcAccel, typename _pub_Trait>
 	BigNum DeriveSharedKeyInBigNum(
 		const EcPublicKeyBase<_pub_Trait>& pubKey,
 		RbgInterface& rand
@@ -1076,9 +1191,34 @@ public:
 		const mbedtls_ecp_keypair& ecCtx    = GetEcContextRef();
 		const mbedtls_ecp_keypair& pubEcCtx = pubKey.GetEcContextRef();
 
-		EcGroup<> ecGrp = CopyGroup();
-
 		BigNum res;
+
+		const EcType ecType = GetEcType();
+		if (_EcAccel::IsAccelerated(ecType))
+		{
+			const int accelRet = _EcAccel::EcdhComputeShared(
+				ecType,
+				res.Get(),
+				&(Internal::GetQFromEcPair(pubEcCtx)),
+				&(Internal::GetDFromEcPair(ecCtx)),
+				&RbgInterface::CallBack,
+				&rand
+			);
+			if (accelRet != MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE)
+			{
+				MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+					accelRet,
+					EcKeyPairBase::DeriveSharedKeyInBigNum,
+					_EcAccel::EcdhComputeShared
+				);
+				MBEDTLSCPP_METRICS_COUNT(Ecdh, 0);
+				return res;
+			}
+		}
+
+		EcGroup<BorrowedEcGroupTrait> ecGrp =
+			EcGroupCache::GetThreadGroup(ecType);
+
 		MBEDTLSCPP_MAKE_C_FUNC_CALL(
 			EcKeyPairBase::DeriveSharedKeyInBigNum,
 			mbedtls_ecdh_compute_shared,
@@ -1090,6 +1230,7 @@ public:
 			&rand
 		);
 
+		MBEDTLSCPP_METRICS_COUNT(Ecdh, 0);
 		return res;
 	}
 
@@ -1684,6 +1825,51 @@ public:
 	}
 
 
+	/**
+	 * @brief	Derive shared key in its fixed-size byte encoding; that is,
+	 *          big-endian for short Weierstrass curves (as used by ECDH in
+	 *          TLS), and little-endian for Montgomery curves (as specified by
+	 *          RFC 7748 for X25519 and X448).
+	 *
+	 * @param  	pubKey	The public key of the peer.
+	 * @param	rand   	The random bit generator.
+	 *
+	 * @return The share key.
+	 */
+	template<typename _pub_Trait>
+	KSecArray DeriveSharedKey(
+		const EcPublicKey<sk_ecType, _pub_Trait>& pubKey,
+		RbgInterface& rand
+	) const
+	{
+		BigNum sharedKey = _Base::DeriveSharedKeyInBigNum(pubKey, rand);
+
+		KSecArray res;
+		if (IsMontgomeryCurve(sk_ecType))
+		{
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				EcKeyPair::DeriveSharedKey,
+				mbedtls_mpi_write_binary_le,
+				sharedKey.Get(),
+				res.data(),
+				res.size()
+			);
+		}
+		else
+		{
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				EcKeyPair::DeriveSharedKey,
+				mbedtls_mpi_write_binary,
+				sharedKey.Get(),
+				res.data(),
+				res.size()
+			);
+		}
+
+		return res;
+	}
+
+
 protected:
 
 
@@ -1695,4 +1881,29 @@ protected:
 }; // class EcKeyPair
 
 
+/**
+ * @brief X25519 (RFC 7748) public key.
+ *
+ */
+using X25519PublicKey = EcPublicKey<EcType::CURVE25519>;
+
+/**
+ * @brief X25519 (RFC 7748) key pair; it can only be used for key agreement.
+ *
+ */
+using X25519KeyPair = EcKeyPair<EcType::CURVE25519>;
+
+/**
+ * @brief X448 (RFC 7748) public key.
+ *
+ */
+using X448PublicKey = EcPublicKey<EcType::CURVE448>;
+
+/**
+ * @brief X448 (RFC 7748) key pair; it can only be used for key agreement.
+ *
+ */
+using X448KeyPair = EcKeyPair<EcType::CURVE448>;
+
+
 } // namespace mbedTLScpp
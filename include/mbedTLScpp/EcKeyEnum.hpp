@@ -75,14 +75,13 @@ inline constexpr size_t GetCurveByteSize(EcType type)
 		(type == EcType::SECP521R1 ? 66UL :
 
 		(type == EcType::CURVE25519? 32UL :
-		//(type == EcType::CURVE448  ? 56UL :
+		(type == EcType::CURVE448  ? 56UL :
 
 		(throw InvalidArgumentException(
 			"Invalid Elliptic Curve type is given."
 		))
 
-		//)
-		))))))))))));
+		)))))))))))));
 }
 
 
@@ -110,6 +109,23 @@ static_assert(GetCurveByteSizeFitsMpi(EcType::SECP256R1) == 32UL, "Programming E
 static_assert(GetCurveByteSizeFitsMpi(EcType::SECP384R1) == 48UL, "Programming Error");
 static_assert(GetCurveByteSizeFitsMpi(EcType::BrPo512R1) == 64UL, "Programming Error");
 static_assert(GetCurveByteSizeFitsMpi(EcType::SECP521R1) == 72UL, "Programming Error");
+static_assert(GetCurveByteSizeFitsMpi(EcType::CURVE25519) == 32UL, "Programming Error");
+static_assert(GetCurveByteSizeFitsMpi(EcType::CURVE448) == 56UL, "Programming Error");
+
+
+/**
+ * @brief	Check if the given curve is a Montgomery curve (i.e., Curve25519
+ *          or Curve448). Keys on Montgomery curves can only be used for key
+ *          agreement (i.e., X25519 and X448), but not for ECDSA.
+ *
+ * @param	type	The curve type.
+ *
+ * @return	true if it's a Montgomery curve, otherwise, false.
+ */
+inline constexpr bool IsMontgomeryCurve(EcType type)
+{
+	return (type == EcType::CURVE25519) || (type == EcType::CURVE448);
+}
 
 
 /**
@@ -136,12 +152,11 @@ inline constexpr mbedtls_ecp_group_id ToEcGroupId(EcType type)
 		(type == EcType::SECP256K1 ? mbedtls_ecp_group_id::MBEDTLS_ECP_DP_SECP256K1 :
 
 		(type == EcType::CURVE25519? mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE25519:
-		//(type == EcType::CURVE448  ? mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE448  :
+		(type == EcType::CURVE448  ? mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE448  :
 
 		(throw InvalidArgumentException("Invalid Elliptic Curve type is given."))
 
-		//)
-		))))))))))));
+		)))))))))))));
 }
 
 
@@ -169,12 +184,11 @@ inline constexpr EcType ToEcType(mbedtls_ecp_group_id type)
 		(type == mbedtls_ecp_group_id::MBEDTLS_ECP_DP_SECP256K1 ? EcType::SECP256K1 :
 
 		(type == mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE25519? EcType::CURVE25519:
-		//(type == mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE448 ? EcType::CURVE448   :
+		(type == mbedtls_ecp_group_id::MBEDTLS_ECP_DP_CURVE448 ? EcType::CURVE448   :
 
 		(throw InvalidArgumentException("Invalid Elliptic Curve type is given."))
 
-		//)
-		))))))))))));
+		)))))))))))));
 }
 
 
@@ -169,6 +169,28 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(), static_cast<unsigned char *>(buf), size
 			);
 		}
+
+		/**
+		 * @brief Add an entropy source to this entropy pool.
+		 *
+		 * @param source    The entropy source polling function.
+		 * @param param     The parameter passed to the polling function.
+		 * @param threshold The minimum number of bytes required from this
+		 *                  source before the pool can release any entropy.
+		 * @param strong    Whether the source is a strong source.
+		 */
+		void AddSource(mbedtls_entropy_f_source_ptr source, void* param,
+			size_t threshold, bool strong)
+		{
+			NullCheck();
+
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				Entropy::AddSource,
+				mbedtls_entropy_add_source,
+				Get(), source, param, threshold,
+				strong ? MBEDTLS_ENTROPY_SOURCE_STRONG : MBEDTLS_ENTROPY_SOURCE_WEAK
+			);
+		}
 	};
 
 	/**
@@ -9,6 +9,8 @@
 #include <mbedtls/error.h>
 #include <mbedtls/platform.h>
 
+#include "Metrics.hpp"
+
 #include "Internal/make_unique.hpp"
 
 #ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
@@ -358,10 +360,19 @@ inline void CheckMbedTlsIntRetVal(
  *        If not, it will construct and throw the mbedTLSRuntimeError exception.
  *
  */
+#ifndef MBEDTLSCPP_TRACE_HOOKS
+#define MBEDTLSCPP_C_FUNC_CALL(CALLER, CALLEE, CALL_STATEMENT) { \
+	int retVal = (CALL_STATEMENT); \
+	MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(retVal, CALLER, CALLEE); \
+}
+#else
 #define MBEDTLSCPP_C_FUNC_CALL(CALLER, CALLEE, CALL_STATEMENT) { \
+	Internal::TraceScope traceScope(#CALLER, #CALLEE); \
 	int retVal = (CALL_STATEMENT); \
+	traceScope.End(retVal); \
 	MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(retVal, CALLER, CALLEE); \
 }
+#endif // MBEDTLSCPP_TRACE_HOOKS
 
 /**
  * @brief Make the call to a specified mbed TLS C function, and check if it returns
@@ -155,6 +155,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				encRes.data(),
 				tag.size(), tag.data()
 			);
+			MBEDTLSCPP_METRICS_COUNT(Gcm, data.GetRegionSize());
 
 			return std::make_pair(encRes, tag);
 		}
@@ -185,6 +186,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				data.BeginBytePtr(),
 				decRes.data()
 			);
+			MBEDTLSCPP_METRICS_COUNT(Gcm, data.GetRegionSize());
 
 			return decRes;
 		}
@@ -128,6 +128,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data.BeginPtr()),
 				data.GetRegionSize());
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Hash, data.GetRegionSize());
 		}
 
 		/**
@@ -155,6 +156,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(HasherBase::Finish, mbedtls_md_finish,
 				Get(),
 				static_cast<unsigned char*>(hash.data()));
+			MBEDTLSCPP_METRICS_COUNT(Hash, 0);
 
 			return hash;
 		}
@@ -184,6 +186,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data),
 				size);
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Hash, size);
 		}
 	};
 
@@ -319,6 +322,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(Hasher::FinishNoCheck, mbedtls_md_finish,
 				Get(),
 				static_cast<unsigned char*>(hash.m_data.data()));
+			MBEDTLSCPP_METRICS_COUNT(Hash, 0);
 
 			return hash;
 		}
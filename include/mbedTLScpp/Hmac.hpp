@@ -101,6 +101,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data.BeginPtr()),
 				data.GetRegionSize());
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Hmac, data.GetRegionSize());
 		}
 
 		/**
@@ -128,6 +129,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(HmacerBase::Finish, mbedtls_md_hmac_finish,
 				Get(),
 				static_cast<unsigned char*>(hmac.data()));
+			MBEDTLSCPP_METRICS_COUNT(Hmac, 0);
 
 			return hmac;
 		}
@@ -164,6 +166,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				Get(),
 				static_cast<const unsigned char*>(data),
 				size);
+			MBEDTLSCPP_METRICS_COUNT_BYTES(Hmac, size);
 		}
 	};
 
@@ -302,6 +305,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			MBEDTLSCPP_MAKE_C_FUNC_CALL(Hmacer::FinishNoCheck, mbedtls_md_hmac_finish,
 				Get(),
 				static_cast<unsigned char*>(hmac.data()));
+			MBEDTLSCPP_METRICS_COUNT(Hmac, 0);
 
 			return hmac;
 		}
@@ -144,6 +144,25 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 				static_cast<unsigned char *>(buf),
 				size
 			);
+			MBEDTLSCPP_METRICS_COUNT(DrbgGenerate, size);
+		}
+
+		/**
+		 * @brief Reseed the DRBG with fresh entropy gathered from its entropy
+		 *        source.
+		 *
+		 */
+		void Reseed()
+		{
+			NullCheck();
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				HmacDrbg::Reseed,
+				mbedtls_hmac_drbg_reseed,
+				Get(),
+				nullptr,
+				0
+			);
+			MBEDTLSCPP_METRICS_COUNT(DrbgReseed, 0);
 		}
 
 		/**
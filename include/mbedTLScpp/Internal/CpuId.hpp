@@ -19,7 +19,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 {
 	namespace Internal
 	{
-		std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>
+		inline std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>
 			RunCpuid(uint32_t func, uint32_t subfunc)
 		{
 			static_assert(std::is_same<uint32_t, unsigned int>::value, "Programming Error.");
@@ -0,0 +1,143 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <string>
+
+#include <mbedtls/platform.h>
+
+#include "../Exceptions.hpp"
+
+// Memory-mapped files are only available on POSIX platforms with a file
+// system; platforms without platform entropy (e.g., enclaves) have neither.
+#if !defined(MBEDTLSCPP_NO_FILE_MAPPING) && \
+	!defined(MBEDTLS_NO_PLATFORM_ENTROPY) && \
+	(defined(__unix__) || defined(__APPLE__))
+#	define MBEDTLSCPP_INTERNAL_FILE_MAPPING
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+namespace Internal
+{
+
+
+#ifdef MBEDTLSCPP_INTERNAL_FILE_MAPPING
+
+/**
+ * @brief A read-only, private mapping of a whole file.
+ *
+ */
+class MappedFile
+{
+public:
+
+	/**
+	 * @brief Map the given file into memory.
+	 *
+	 * @exception RuntimeException Thrown when the file can't be opened or
+	 *                             mapped.
+	 * @param path The path to the file.
+	 */
+	explicit MappedFile(const std::string& path) :
+		m_data(nullptr),
+		m_size(0)
+	{
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			throw RuntimeException(
+				"MappedFile::MappedFile - Failed to open " + path
+			);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			throw RuntimeException(
+				"MappedFile::MappedFile - Failed to stat " + path
+			);
+		}
+
+		// Empty files can't be mapped, but they are valid.
+		if (st.st_size > 0)
+		{
+			void* addr = ::mmap(
+				nullptr,
+				static_cast<size_t>(st.st_size),
+				PROT_READ,
+				MAP_PRIVATE,
+				fd,
+				0
+			);
+			if (addr == MAP_FAILED)
+			{
+				::close(fd);
+				throw RuntimeException(
+					"MappedFile::MappedFile - Failed to map " + path
+				);
+			}
+
+			m_data = static_cast<const uint8_t*>(addr);
+			m_size = static_cast<size_t>(st.st_size);
+		}
+
+		// The mapping stays valid after the descriptor is closed.
+		::close(fd);
+	}
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile(MappedFile&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~MappedFile()
+	{
+		if (m_data != nullptr)
+		{
+			::munmap(const_cast<uint8_t*>(m_data), m_size);
+		}
+	}
+	// LCOV_EXCL_STOP
+
+	MappedFile& operator=(const MappedFile& other) = delete;
+	MappedFile& operator=(MappedFile&& other) = delete;
+
+	const uint8_t* GetData() const noexcept
+	{
+		return m_data;
+	}
+
+	size_t GetSize() const noexcept
+	{
+		return m_size;
+	}
+
+private:
+
+	const uint8_t* m_data;
+	size_t m_size;
+
+}; // class MappedFile
+
+#endif // MBEDTLSCPP_INTERNAL_FILE_MAPPING
+
+
+} // namespace Internal
+} // namespace mbedTLScpp
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+
+#include <mbedtls/platform.h>
+
+// Fork detection is only needed (and only available) on POSIX platforms with
+// an OS; platforms without platform entropy (e.g., enclaves) never fork.
+#if !defined(MBEDTLSCPP_NO_FORK_DETECTION) && \
+	!defined(MBEDTLS_NO_PLATFORM_ENTROPY) && \
+	(defined(__unix__) || defined(__APPLE__))
+#	define MBEDTLSCPP_INTERNAL_FORK_DETECTION
+#	include <pthread.h>
+#endif
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+	namespace Internal
+	{
+		/**
+		 * @brief Get the counter that records how many times the current
+		 *        process has been forked from its ancestors.
+		 *
+		 * @return std::atomic<uint64_t>& The reference to the counter.
+		 */
+		inline std::atomic<uint64_t>& GetForkGenerationCounter() noexcept
+		{
+			static std::atomic<uint64_t> counter(0);
+			return counter;
+		}
+
+#ifdef MBEDTLSCPP_INTERNAL_FORK_DETECTION
+		/**
+		 * @brief The handler called in the child process right after fork.
+		 *
+		 */
+		inline void ForkGenerationChildHandler()
+		{
+			GetForkGenerationCounter().fetch_add(1, std::memory_order_relaxed);
+		}
+#endif // MBEDTLSCPP_INTERNAL_FORK_DETECTION
+
+		/**
+		 * @brief Get the fork generation of the current process. The number
+		 *        is increased in the child process every time the process
+		 *        forks, so that any cached random state that was duplicated
+		 *        by fork can be detected and refreshed.
+		 *        On platforms without fork, it always returns 0.
+		 *
+		 * @return uint64_t The fork generation of the current process.
+		 */
+		inline uint64_t GetForkGeneration() noexcept
+		{
+#ifdef MBEDTLSCPP_INTERNAL_FORK_DETECTION
+			// The handler is registered before the first generation is
+			// read, so no state recorded with a generation can be missed.
+			static const int sk_atForkReg =
+				pthread_atfork(nullptr, nullptr, &ForkGenerationChildHandler);
+			(void)sk_atForkReg;
+#endif // MBEDTLSCPP_INTERNAL_FORK_DETECTION
+
+			return GetForkGenerationCounter().load(std::memory_order_acquire);
+		}
+	}
+}
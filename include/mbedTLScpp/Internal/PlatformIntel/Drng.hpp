@@ -27,6 +27,35 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 			{
 				return Internal::rdrand_get_bytes(size, dest);
 			}
+
+			/**
+			 * @brief Read seed with RDSEED in the bulk mode, which is faster
+			 *        for filling large buffers.
+			 *
+			 * @param dest The destination buffer.
+			 * @param size The number of bytes to read.
+			 * @return size_t The number of bytes actually read.
+			 */
+			inline size_t ReadSeedBulk(uint8_t* dest, size_t size)
+			{
+				return Internal::rdseed_get_bytes_bulk(size, dest,
+					gsk_rdSeedRcRetryPerStep * (
+						(size / sizeof(MaxIntType)) + (size % sizeof(MaxIntType) == 0 ? 0 : 1)
+					)
+				);
+			}
+
+			/**
+			 * @brief Read random bytes with RDRAND in the bulk mode, which is
+			 *        faster for filling large buffers.
+			 *
+			 * @param dest The destination buffer.
+			 * @param size The number of bytes to read.
+			 */
+			inline void ReadRandBulk(uint8_t* dest, size_t size)
+			{
+				return Internal::rdrand_get_bytes_bulk(size, dest);
+			}
 		}
 	}
 }
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mbedtls/entropy.h>
+
+#include "Exceptions.hpp"
+#include "Drng.hpp"
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+	namespace Internal
+	{
+		namespace PlatformIntel
+		{
+			/**
+			 * @brief The minimum number of bytes the entropy pool needs from the
+			 *        RDSEED source before releasing any entropy.
+			 *
+			 */
+			constexpr size_t gsk_rdSeedEntropyThreshold = 32;
+
+			/**
+			 * @brief Entropy source polling function (in the form of
+			 *        \c mbedtls_entropy_f_source_ptr ) that gathers entropy
+			 *        with RDSEED in the bulk mode.
+			 *
+			 * @param data   Unused.
+			 * @param output The buffer to be filled.
+			 * @param len    The size of the buffer.
+			 * @param olen   The number of bytes actually filled.
+			 * @return int mbedTLS error code.
+			 */
+			inline int RdSeedEntropyPoll(void* data, unsigned char* output, size_t len, size_t* olen) noexcept
+			{
+				(void)data;
+
+				try
+				{
+					// RDSEED may run out temporarily; a partial result is
+					// fine, since the pool keeps polling until the threshold.
+					*olen = ReadSeedBulk(output, len);
+					return 0;
+				}
+				catch (...)
+				{
+					*olen = 0;
+					return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+				}
+			}
+
+			/**
+			 * @brief Add RDSEED, in the bulk mode, as a strong source to the
+			 *        given entropy pool.
+			 *
+			 * @exception FeatureUnsupportedException RDSEED is not supported.
+			 * @tparam _EntropyType The type of the entropy object (e.g.,
+			 *                      \c Entropy<> ).
+			 * @param entropy The entropy pool.
+			 */
+			template<typename _EntropyType>
+			inline void AddRdSeedEntropySource(_EntropyType& entropy)
+			{
+				if (!IsRdSeedSupportedCached())
+				{
+					throw FeatureUnsupportedException("mbedTLScpp::Internal::PlatformIntel::AddRdSeedEntropySource - "
+						"RDSEED is not supported on this platform.");
+				}
+
+				entropy.AddSource(&RdSeedEntropyPoll, nullptr, gsk_rdSeedEntropyThreshold, true);
+			}
+		}
+	}
+}
@@ -25,6 +25,12 @@ POSSIBILITY OF SUCH DAMAGE. */
 
 #pragma once
 
+#include <cstring>
+
+#include <algorithm>
+
+#include <mbedtls/platform_util.h>
+
 #include "../../Common.hpp"
 
 #include "Exceptions.hpp"
@@ -187,7 +193,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 
 
 
-				void rdrand_get_bytes(size_t n, uint8_t *dest)
+				inline void rdrand_get_bytes(size_t n, uint8_t *dest)
 				{
 					uint8_t *start         = nullptr;
 					uint8_t *residualstart = nullptr;
@@ -263,6 +269,142 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 					}
 				}
 
+
+
+
+
+				/**
+				 * @brief The number of RDRAND instructions issued back-to-back
+				 *        in the bulk mode.
+				 *
+				 */
+				constexpr size_t gsk_rdRandBulkUnroll = 4;
+
+				/**
+				 * @brief The number of words staged on the stack in the bulk
+				 *        mode, before they are copied to the destination.
+				 *
+				 */
+				constexpr size_t gsk_rdRandBulkStageWords = 32;
+
+				/**
+				 * @brief Same as \c rdrand(x, true) , but without checking if
+				 *        RDRAND is supported. The caller must have done that.
+				 *
+				 */
+				template<typename T,
+					enable_if_t<
+						std::is_same<T, uint16_t>::value
+						|| std::is_same<T, uint32_t>::value
+						|| std::is_same<T, MaxIntType>::value
+					, int> = 0>
+				inline void rdrand_retry_unchecked(T* x)
+				{
+					for (size_t i = 0; i < gsk_rdRandRetryLimit; ++i)
+					{
+						if (rdrand_step(x) != 0)
+						{
+							return;
+						}
+					}
+
+					throw PlatformBusyException("mbedTLScpp::Internal::PlatformIntel::Internal - "
+						"RDRAND no response; try again later.");
+				}
+
+				/**
+				 * @brief Fill \c n words with RDRAND, without checking if RDRAND
+				 *        is supported. The caller must have done that.
+				 *        \c gsk_rdRandBulkUnroll instructions are issued
+				 *        back-to-back, so that they are in flight at the same
+				 *        time; only when any of them fails, the words are
+				 *        retried one by one.
+				 *
+				 */
+				template<typename T,
+					enable_if_t<
+						std::is_same<T, uint16_t>::value
+						|| std::is_same<T, uint32_t>::value
+						|| std::is_same<T, MaxIntType>::value
+					, int> = 0>
+				inline void rdrand_get_n_bulk_unchecked(size_t n, T *dest)
+				{
+					static_assert(gsk_rdRandBulkUnroll == 4, "The loop below is unrolled by 4.");
+
+					size_t i = 0;
+					for (; i + gsk_rdRandBulkUnroll <= n; i += gsk_rdRandBulkUnroll)
+					{
+						uint8_t ok0 = rdrand_step(&dest[i + 0]);
+						uint8_t ok1 = rdrand_step(&dest[i + 1]);
+						uint8_t ok2 = rdrand_step(&dest[i + 2]);
+						uint8_t ok3 = rdrand_step(&dest[i + 3]);
+
+						if ((ok0 & ok1 & ok2 & ok3) == 0)
+						{
+							if (ok0 == 0) { rdrand_retry_unchecked(&dest[i + 0]); }
+							if (ok1 == 0) { rdrand_retry_unchecked(&dest[i + 1]); }
+							if (ok2 == 0) { rdrand_retry_unchecked(&dest[i + 2]); }
+							if (ok3 == 0) { rdrand_retry_unchecked(&dest[i + 3]); }
+						}
+					}
+
+					for (; i < n; ++i)
+					{
+						if (rdrand_step(&dest[i]) == 0)
+						{
+							rdrand_retry_unchecked(&dest[i]);
+						}
+					}
+				}
+
+				/**
+				 * @brief Fill \c n bytes with RDRAND in the bulk mode, which
+				 *        checks if RDRAND is supported only once per call, and
+				 *        keeps multiple RDRAND instructions in flight.
+				 *        It's meant for filling large buffers; the destination
+				 *        doesn't need to be aligned.
+				 *
+				 * @exception FeatureUnsupportedException RDRAND is not supported.
+				 * @exception PlatformBusyException       RDRAND failed after retries.
+				 * @param n    The number of bytes to fill.
+				 * @param dest The destination buffer.
+				 */
+				inline void rdrand_get_bytes_bulk(size_t n, uint8_t *dest)
+				{
+					if (!IsRdRandSupportedCached())
+					{
+						throw FeatureUnsupportedException("mbedTLScpp::Internal::PlatformIntel::Internal - "
+							"RDRAND is not supported on this platform.");
+					}
+
+					MaxIntType stage[gsk_rdRandBulkStageWords];
+
+					try
+					{
+						while (n > 0)
+						{
+							const size_t stageBytes = std::min(n, sizeof(stage));
+							const size_t stageWords =
+								(stageBytes / sizeof(MaxIntType)) +
+								(stageBytes % sizeof(MaxIntType) == 0 ? 0 : 1);
+
+							rdrand_get_n_bulk_unchecked(stageWords, stage);
+							std::memcpy(dest, stage, stageBytes);
+
+							dest += stageBytes;
+							n -= stageBytes;
+						}
+					}
+					catch (...)
+					{
+						mbedtls_platform_zeroize(stage, sizeof(stage));
+						throw;
+					}
+
+					// Don't leave the random output on the stack.
+					mbedtls_platform_zeroize(stage, sizeof(stage));
+				}
+
 			}
 		}
 	}
@@ -25,6 +25,12 @@ POSSIBILITY OF SUCH DAMAGE. */
 
 #pragma once
 
+#include <cstring>
+
+#include <algorithm>
+
+#include <mbedtls/platform_util.h>
+
 #include "../../Common.hpp"
 
 #include "Exceptions.hpp"
@@ -199,7 +205,7 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 
 
 
-				size_t rdseed_get_bytes(size_t n, uint8_t *dest, size_t skip, size_t max_retries)
+				inline size_t rdseed_get_bytes(size_t n, uint8_t *dest, size_t skip, size_t max_retries)
 				{
 					uint8_t *start         = nullptr;
 					uint8_t *residualstart = nullptr;
@@ -301,6 +307,156 @@ namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 
 					return buffsize;
 				}
+
+
+
+
+
+				/**
+				 * @brief The number of RDSEED instructions issued back-to-back
+				 *        in the bulk mode.
+				 *
+				 */
+				constexpr size_t gsk_rdSeedBulkUnroll = 4;
+
+				/**
+				 * @brief The number of words staged on the stack in the bulk
+				 *        mode, before they are copied to the destination.
+				 *
+				 */
+				constexpr size_t gsk_rdSeedBulkStageWords = 32;
+
+				/**
+				 * @brief Retry RDSEED on the given word, without checking if
+				 *        RDSEED is supported. The caller must have done that.
+				 *
+				 * @return true if the word is filled, or false if the retry
+				 *         budget is used up.
+				 */
+				template<typename T,
+					enable_if_t<
+						std::is_same<T, uint16_t>::value
+						|| std::is_same<T, uint32_t>::value
+						|| std::is_same<T, MaxIntType>::value
+					, int> = 0>
+				inline bool rdseed_retry_unchecked(T* x, size_t& retry_count)
+				{
+					while (retry_count > 0)
+					{
+						retry_count--;
+						if (rdseed_step(x) != 0)
+						{
+							return true;
+						}
+					}
+					return false;
+				}
+
+				/**
+				 * @brief Fill \c n words with RDSEED, without checking if RDSEED
+				 *        is supported. The caller must have done that.
+				 *        \c gsk_rdSeedBulkUnroll instructions are issued
+				 *        back-to-back; only the failed words are retried,
+				 *        using the shared retry budget \c max_retries .
+				 *
+				 * @return The number of words filled, counting from the
+				 *         beginning of \c dest .
+				 */
+				template<typename T,
+					enable_if_t<
+						std::is_same<T, uint16_t>::value
+						|| std::is_same<T, uint32_t>::value
+						|| std::is_same<T, MaxIntType>::value
+					, int> = 0>
+				inline size_t rdseed_get_n_bulk_unchecked(size_t n, T *dest, size_t& max_retries)
+				{
+					static_assert(gsk_rdSeedBulkUnroll == 4, "The loop below is unrolled by 4.");
+
+					size_t i = 0;
+					for (; i + gsk_rdSeedBulkUnroll <= n; i += gsk_rdSeedBulkUnroll)
+					{
+						uint8_t ok[gsk_rdSeedBulkUnroll];
+						ok[0] = rdseed_step(&dest[i + 0]);
+						ok[1] = rdseed_step(&dest[i + 1]);
+						ok[2] = rdseed_step(&dest[i + 2]);
+						ok[3] = rdseed_step(&dest[i + 3]);
+
+						if ((ok[0] & ok[1] & ok[2] & ok[3]) == 0)
+						{
+							for (size_t j = 0; j < gsk_rdSeedBulkUnroll; ++j)
+							{
+								if (ok[j] == 0 &&
+									!rdseed_retry_unchecked(&dest[i + j], max_retries))
+								{
+									// Keep the output contiguous.
+									return i + j;
+								}
+							}
+						}
+					}
+
+					for (; i < n; ++i)
+					{
+						if (rdseed_step(&dest[i]) == 0 &&
+							!rdseed_retry_unchecked(&dest[i], max_retries))
+						{
+							return i;
+						}
+					}
+
+					return n;
+				}
+
+				/**
+				 * @brief Fill up to \c n bytes with RDSEED in the bulk mode,
+				 *        which checks if RDSEED is supported only once per call,
+				 *        and keeps multiple RDSEED instructions in flight.
+				 *        The destination doesn't need to be aligned.
+				 *
+				 * @exception FeatureUnsupportedException RDSEED is not supported.
+				 * @param n           The number of bytes to fill.
+				 * @param dest        The destination buffer.
+				 * @param max_retries The total number of retries allowed.
+				 * @return size_t The number of bytes filled, counting from the
+				 *                beginning of \c dest .
+				 */
+				inline size_t rdseed_get_bytes_bulk(size_t n, uint8_t *dest, size_t max_retries)
+				{
+					if (!IsRdSeedSupportedCached())
+					{
+						throw FeatureUnsupportedException("mbedTLScpp::Internal::PlatformIntel::Internal - "
+							"RDSEED is not supported on this platform.");
+					}
+
+					MaxIntType stage[gsk_rdSeedBulkStageWords];
+					size_t filled = 0;
+
+					while (filled < n)
+					{
+						const size_t stageBytes = std::min(n - filled, sizeof(stage));
+						const size_t stageWords =
+							(stageBytes / sizeof(MaxIntType)) +
+							(stageBytes % sizeof(MaxIntType) == 0 ? 0 : 1);
+
+						const size_t gotWords =
+							rdseed_get_n_bulk_unchecked(stageWords, stage, max_retries);
+						const size_t gotBytes =
+							std::min(stageBytes, gotWords * sizeof(MaxIntType));
+
+						std::memcpy(dest + filled, stage, gotBytes);
+						filled += gotBytes;
+
+						if (gotWords < stageWords)
+						{
+							break;
+						}
+					}
+
+					// Don't leave the seed on the stack.
+					mbedtls_platform_zeroize(stage, sizeof(stage));
+
+					return filled;
+				}
 			}
 		}
 	}
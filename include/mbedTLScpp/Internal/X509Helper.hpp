@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <string>
+
 #include <mbedtls/oid.h>
 #include <mbedtls/x509_csr.h>
 #include <mbedtls/x509_crt.h>
@@ -827,5 +830,72 @@ inline const void* GetSignOptsFromCrt(
 	return crt.MBEDTLS_PRIVATE(sig_opts);
 }
 
+
+/**
+ * @brief Build a lookup key for an X.509 name, such that names that mbedTLS
+ *        considers equal when it matches a certificate to its issuer (see
+ *        \c x509_name_cmp in x509_crt.c) get the same key; i.e.,
+ *        UTF8String and PrintableString values are compared without regard
+ *        to their type or the case of ASCII letters.
+ *
+ * @param name The X.509 name.
+ * @return std::string The lookup key.
+ */
+inline std::string GetX509NameLookupKey(const mbedtls_x509_name& name)
+{
+	std::string key;
+
+	auto appendLen = [&key](size_t len)
+	{
+		for (size_t i = 0; i < sizeof(len); ++i)
+		{
+			key.push_back(static_cast<char>((len >> (i * 8)) & 0xFFU));
+		}
+	};
+
+	for (const mbedtls_x509_name* cur = &name; cur != nullptr; cur = cur->next)
+	{
+		key.push_back(static_cast<char>(cur->oid.tag));
+		appendLen(cur->oid.len);
+		key.append(reinterpret_cast<const char*>(cur->oid.p), cur->oid.len);
+
+		const bool isCaseless =
+			(cur->val.tag == MBEDTLS_ASN1_UTF8_STRING) ||
+			(cur->val.tag == MBEDTLS_ASN1_PRINTABLE_STRING);
+
+		key.push_back(
+			isCaseless ? '\0' : static_cast<char>(cur->val.tag)
+		);
+		appendLen(cur->val.len);
+		for (size_t i = 0; i < cur->val.len; ++i)
+		{
+			char ch = static_cast<char>(cur->val.p[i]);
+			if (isCaseless && ch >= 'A' && ch <= 'Z')
+			{
+				ch = static_cast<char>(ch - 'A' + 'a');
+			}
+			key.push_back(ch);
+		}
+
+		key.push_back(static_cast<char>(cur->MBEDTLS_PRIVATE(next_merged)));
+	}
+
+	return key;
+}
+
+
+/**
+ * @brief Get a new version number for trust data (i.e., sets of trusted CAs
+ *        and revocation lists), which is unique in this process; it's used
+ *        to tell whether the trust data has changed.
+ *
+ * @return uint64_t The version number.
+ */
+inline uint64_t NewX509TrustVersion() noexcept
+{
+	static std::atomic<uint64_t> sk_lastVersion(0);
+	return sk_lastVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 } // namespace Internal
 } // namespace mbedTLScpp
@@ -0,0 +1,445 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(MBEDTLSCPP_METRICS) || defined(MBEDTLSCPP_TRACE_HOOKS)
+#include <atomic>
+#endif
+
+#ifdef MBEDTLSCPP_METRICS
+#include <mutex>
+#endif
+
+/**
+ * Observability switches; both are off by default, and cost nothing then:
+ *
+ * - \c MBEDTLSCPP_METRICS counts the operations (and the bytes they
+ *   process) done through this library, in thread-local slots that are
+ *   merged when a snapshot is taken (see \c Metrics::Snapshot ).
+ *
+ * - \c MBEDTLSCPP_TRACE_HOOKS calls the trace hooks (see
+ *   \c Metrics::SetTraceHooks ) before and after every mbed TLS C function
+ *   called through \c MBEDTLSCPP_MAKE_C_FUNC_CALL .
+ */
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The operations counted by the metrics (see \c MBEDTLSCPP_METRICS ).
+ *
+ */
+enum class MetricOp : size_t
+{
+	Hash,
+	Hmac,
+	Cmac,
+	Gcm,
+	Sign,
+	Verify,
+	Ecdh,
+	DrbgGenerate,
+	DrbgReseed,
+	Handshake,
+	Resumption,
+
+	NumOfOps,
+};
+
+
+/**
+ * @brief The begin trace hook; it's given the name of the C++ function
+ *        making the call, and the name of the mbed TLS C function called.
+ *
+ */
+typedef void (*TraceBeginHook)(
+	void* ctx,
+	const char* caller,
+	const char* callee
+);
+
+/**
+ * @brief The end trace hook; it's given the same names as the begin hook,
+ *        and the return value of the mbed TLS C function.
+ *
+ */
+typedef void (*TraceEndHook)(
+	void* ctx,
+	const char* caller,
+	const char* callee,
+	int retVal
+);
+
+/**
+ * @brief A set of trace hooks (see \c MBEDTLSCPP_TRACE_HOOKS ).
+ *
+ */
+struct TraceHooks
+{
+	TraceBeginHook m_begin;
+	TraceEndHook m_end;
+	void* m_ctx;
+}; // struct TraceHooks
+
+
+#ifdef MBEDTLSCPP_METRICS
+
+/**
+ * @brief The counters merged from every thread at some point in time.
+ *
+ */
+struct MetricsSnapshot
+{
+	static constexpr size_t sk_numOfOps =
+		static_cast<size_t>(MetricOp::NumOfOps);
+
+	uint64_t m_ops[sk_numOfOps];
+	uint64_t m_bytes[sk_numOfOps];
+
+	uint64_t GetOps(MetricOp op) const noexcept
+	{
+		return m_ops[static_cast<size_t>(op)];
+	}
+
+	uint64_t GetBytes(MetricOp op) const noexcept
+	{
+		return m_bytes[static_cast<size_t>(op)];
+	}
+
+	/**
+	 * @brief Get the counts since an earlier snapshot; the counters are
+	 *        never reset, so intervals are measured by differences.
+	 *
+	 * @param earlier The earlier snapshot.
+	 * @return MetricsSnapshot The differences.
+	 */
+	MetricsSnapshot Since(const MetricsSnapshot& earlier) const noexcept
+	{
+		MetricsSnapshot res = *this;
+		for (size_t i = 0; i < sk_numOfOps; ++i)
+		{
+			res.m_ops[i]   -= earlier.m_ops[i];
+			res.m_bytes[i] -= earlier.m_bytes[i];
+		}
+		return res;
+	}
+}; // struct MetricsSnapshot
+
+#endif // MBEDTLSCPP_METRICS
+
+
+namespace Internal
+{
+
+
+#ifdef MBEDTLSCPP_METRICS
+
+/**
+ * @brief The counters of one thread. Only the owning thread writes them, so
+ *        a relaxed load and store is enough (no locked read-modify-write);
+ *        other threads only read them when a snapshot is taken.
+ *        The slots of live threads form a list in \c MetricRegistry .
+ */
+class MetricSlot
+{
+public:
+
+	MetricSlot() noexcept :
+		m_ops(),
+		m_bytes(),
+		m_prev(nullptr),
+		m_next(nullptr)
+	{
+		for (size_t i = 0; i < MetricsSnapshot::sk_numOfOps; ++i)
+		{
+			m_ops[i].store(0, std::memory_order_relaxed);
+			m_bytes[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	MetricSlot(const MetricSlot& other) = delete;
+	MetricSlot(MetricSlot&& other) = delete;
+
+	// LCOV_EXCL_START
+	~MetricSlot() = default;
+	// LCOV_EXCL_STOP
+
+	MetricSlot& operator=(const MetricSlot& other) = delete;
+	MetricSlot& operator=(MetricSlot&& other) = delete;
+
+	void Add(MetricOp op, uint64_t ops, uint64_t bytes) noexcept
+	{
+		const size_t idx = static_cast<size_t>(op);
+		m_ops[idx].store(
+			m_ops[idx].load(std::memory_order_relaxed) + ops,
+			std::memory_order_relaxed
+		);
+		m_bytes[idx].store(
+			m_bytes[idx].load(std::memory_order_relaxed) + bytes,
+			std::memory_order_relaxed
+		);
+	}
+
+	void AddTo(MetricsSnapshot& snapshot) const noexcept
+	{
+		for (size_t i = 0; i < MetricsSnapshot::sk_numOfOps; ++i)
+		{
+			snapshot.m_ops[i]   += m_ops[i].load(std::memory_order_relaxed);
+			snapshot.m_bytes[i] += m_bytes[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	std::atomic<uint64_t> m_ops[MetricsSnapshot::sk_numOfOps];
+	std::atomic<uint64_t> m_bytes[MetricsSnapshot::sk_numOfOps];
+	MetricSlot* m_prev;
+	MetricSlot* m_next;
+
+}; // class MetricSlot
+
+
+/**
+ * @brief The registry of the slots of live threads; the counts of exited
+ *        threads are folded into a retired slot.
+ *
+ */
+class MetricRegistry
+{
+public: // Static members:
+
+	static MetricRegistry& GetInstance() noexcept
+	{
+		static MetricRegistry sk_inst;
+		return sk_inst;
+	}
+
+public:
+
+	MetricRegistry() noexcept :
+		m_mutex(),
+		m_head(nullptr),
+		m_retired()
+	{}
+
+	void Register(MetricSlot& slot) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		slot.m_next = m_head;
+		if (m_head != nullptr)
+		{
+			m_head->m_prev = &slot;
+		}
+		m_head = &slot;
+	}
+
+	void Unregister(MetricSlot& slot) noexcept
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < MetricsSnapshot::sk_numOfOps; ++i)
+		{
+			m_retired.m_ops[i].fetch_add(
+				slot.m_ops[i].load(std::memory_order_relaxed),
+				std::memory_order_relaxed
+			);
+			m_retired.m_bytes[i].fetch_add(
+				slot.m_bytes[i].load(std::memory_order_relaxed),
+				std::memory_order_relaxed
+			);
+		}
+
+		if (slot.m_prev != nullptr)
+		{
+			slot.m_prev->m_next = slot.m_next;
+		}
+		else
+		{
+			m_head = slot.m_next;
+		}
+		if (slot.m_next != nullptr)
+		{
+			slot.m_next->m_prev = slot.m_prev;
+		}
+	}
+
+	MetricsSnapshot Snapshot() noexcept
+	{
+		MetricsSnapshot res = MetricsSnapshot();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_retired.AddTo(res);
+		for (const MetricSlot* slot = m_head; slot != nullptr; slot = slot->m_next)
+		{
+			slot->AddTo(res);
+		}
+		return res;
+	}
+
+private:
+
+	std::mutex m_mutex;
+	MetricSlot* m_head;
+	MetricSlot m_retired;
+
+}; // class MetricRegistry
+
+
+/**
+ * @brief Registers the slot of a thread on its first use, and retires it
+ *        when the thread exits.
+ *
+ */
+class ThreadMetricSlot
+{
+public:
+
+	ThreadMetricSlot() noexcept :
+		m_slot()
+	{
+		MetricRegistry::GetInstance().Register(m_slot);
+	}
+
+	// LCOV_EXCL_START
+	~ThreadMetricSlot()
+	{
+		MetricRegistry::GetInstance().Unregister(m_slot);
+	}
+	// LCOV_EXCL_STOP
+
+	MetricSlot m_slot;
+
+}; // class ThreadMetricSlot
+
+
+inline void CountMetric(MetricOp op, uint64_t ops, uint64_t bytes) noexcept
+{
+	static thread_local ThreadMetricSlot sk_slot;
+	sk_slot.m_slot.Add(op, ops, bytes);
+}
+
+#endif // MBEDTLSCPP_METRICS
+
+
+#ifdef MBEDTLSCPP_TRACE_HOOKS
+
+inline std::atomic<const TraceHooks*>& GetTraceHooksPtr() noexcept
+{
+	static std::atomic<const TraceHooks*> sk_hooks(nullptr);
+	return sk_hooks;
+}
+
+/**
+ * @brief Calls the trace hooks around one mbed TLS C function call.
+ *
+ */
+class TraceScope
+{
+public:
+
+	TraceScope(const char* caller, const char* callee) noexcept :
+		m_hooks(GetTraceHooksPtr().load(std::memory_order_acquire)),
+		m_caller(caller),
+		m_callee(callee)
+	{
+		if (m_hooks != nullptr && m_hooks->m_begin != nullptr)
+		{
+			m_hooks->m_begin(m_hooks->m_ctx, m_caller, m_callee);
+		}
+	}
+
+	void End(int retVal) noexcept
+	{
+		if (m_hooks != nullptr && m_hooks->m_end != nullptr)
+		{
+			m_hooks->m_end(m_hooks->m_ctx, m_caller, m_callee, retVal);
+		}
+	}
+
+private:
+
+	const TraceHooks* m_hooks;
+	const char* m_caller;
+	const char* m_callee;
+
+}; // class TraceScope
+
+#endif // MBEDTLSCPP_TRACE_HOOKS
+
+
+} // namespace Internal
+
+
+/**
+ * @brief The entry point of the metrics and the trace hooks.
+ *
+ */
+class Metrics
+{
+public: // Static members:
+
+#ifdef MBEDTLSCPP_METRICS
+	/**
+	 * @brief Merge the counters of all threads, including the ones that have
+	 *        exited.
+	 *
+	 * @return MetricsSnapshot The merged counters.
+	 */
+	static MetricsSnapshot Snapshot() noexcept
+	{
+		return Internal::MetricRegistry::GetInstance().Snapshot();
+	}
+#endif // MBEDTLSCPP_METRICS
+
+#ifdef MBEDTLSCPP_TRACE_HOOKS
+	/**
+	 * @brief Set the trace hooks called around mbed TLS C function calls.
+	 *        The hooks are called on the threads making the calls, so they
+	 *        must be thread-safe, and must not throw.
+	 *
+	 * @param hooks The hooks, which must stay alive until they are replaced,
+	 *              and no call is using them anymore; \c nullptr to stop
+	 *              tracing.
+	 */
+	static void SetTraceHooks(const TraceHooks* hooks) noexcept
+	{
+		Internal::GetTraceHooksPtr().store(hooks, std::memory_order_release);
+	}
+#endif // MBEDTLSCPP_TRACE_HOOKS
+
+}; // class Metrics
+
+
+} // namespace mbedTLScpp
+
+
+#ifdef MBEDTLSCPP_METRICS
+/**
+ * @brief Count one operation, and the bytes it processes.
+ *
+ */
+#define MBEDTLSCPP_METRICS_COUNT(OP, BYTES) \
+	Internal::CountMetric(MetricOp::OP, 1, static_cast<uint64_t>(BYTES))
+
+/**
+ * @brief Count the bytes processed by an operation in progress (e.g., a
+ *        hash update); the operation itself is counted when it finishes.
+ *
+ */
+#define MBEDTLSCPP_METRICS_COUNT_BYTES(OP, BYTES) \
+	Internal::CountMetric(MetricOp::OP, 0, static_cast<uint64_t>(BYTES))
+#else
+#define MBEDTLSCPP_METRICS_COUNT(OP, BYTES) ((void)0)
+#define MBEDTLSCPP_METRICS_COUNT_BYTES(OP, BYTES) ((void)0)
+#endif // MBEDTLSCPP_METRICS
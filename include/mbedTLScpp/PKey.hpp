@@ -383,6 +383,22 @@ public:
 		}
 		else
 #endif
+#if defined(MBEDTLS_ECP_C) && defined(MBEDTLS_ECP_MONTGOMERY_ENABLED)
+		if (mbedtls_pk_get_type(Get()) == MBEDTLS_PK_ECKEY &&
+			mbedtls_ecp_get_type(
+				&Internal::GetGroupFromEcPair(*mbedtls_pk_ec(*Get()))
+			) == MBEDTLS_ECP_TYPE_MONTGOMERY)
+		{
+			// mbed TLS writes keys on Montgomery curves (RFC 8410) in
+			// PKCS #8 format, rather than in SEC1 format.
+			return Internal::DerToPem<SecretString>(
+				CtnFullR(der),
+				Internal::GetPemHeaderPkcs8PrivKey(),
+				Internal::GetPemFooterPkcs8PrivKey()
+			);
+		}
+		else
+#endif
 #if defined(MBEDTLS_ECP_C)
 		if (mbedtls_pk_get_type(Get()) == MBEDTLS_PK_ECKEY)
 		{
@@ -427,6 +443,8 @@ public:
 			&rand
 		);
 
+		MBEDTLSCPP_METRICS_COUNT(Sign, hash.size());
+
 		der.resize(olen);
 
 		return der;
@@ -455,6 +473,8 @@ public:
 			sign.BeginBytePtr(),
 			sign.GetRegionSize()
 		);
+
+		MBEDTLSCPP_METRICS_COUNT(Verify, hash.size());
 	}
 
 protected:
@@ -482,4 +502,80 @@ protected:
 
 }; // class PKeyBase
 
+
+namespace Internal
+{
+
+template<typename _other_PKTrait>
+inline PKeyBase<_other_PKTrait>&& PKeyBaseRRefFilter(
+	PKeyBase<_other_PKTrait>&& other,
+	PKeyAlgmCat algCat,
+	PKeyType reqKeyType
+)
+{
+	// Check algorithm category
+	if (other.GetAlgorithmCat() != algCat)
+	{
+		throw InvalidArgumentException(
+			"Internal::BaseRRefFilter"
+			" - The algorithm of given PKeyBase doesn't match the required one"
+		);
+	}
+
+	// Check key type
+	switch (reqKeyType)
+	{
+	case PKeyType::Public:
+	{
+		if (!other.HasPubKey())
+		{
+			throw InvalidArgumentException(
+				"Internal::BaseRRefFilter"
+				" - The given PKeyBase doesn't have public key"
+			);
+		}
+		break;
+	}
+	case PKeyType::Private:
+	{
+		if (other.GetKeyType() != PKeyType::Private)
+		{
+			throw InvalidArgumentException(
+				"Internal::BaseRRefFilter"
+				" - The given PKeyBase doesn't have private key"
+			);
+		}
+		break;
+	}
+	default:
+		throw InvalidArgumentException(
+			"Internal::BaseRRefFilter"
+			" - The given PKeyType is invalid"
+		);
+	}
+
+	// All checks passed, return the given object
+	return std::forward<PKeyBase<_other_PKTrait> >(other);
+}
+
+
+template<
+	PKeyAlgmCat _AlgCat,
+	PKeyType _ReqKeyType,
+	typename _other_PKTrait
+>
+inline PKeyBase<_other_PKTrait>&& PKeyBaseRRefFilter(
+	PKeyBase<_other_PKTrait>&& other
+)
+{
+	return PKeyBaseRRefFilter(
+		std::forward<PKeyBase<_other_PKTrait> >(other),
+		_AlgCat,
+		_ReqKeyType
+	);
+}
+
+
+} // namespace Internal
+
 } // namespace mbedTLScpp
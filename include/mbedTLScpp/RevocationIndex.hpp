@@ -0,0 +1,281 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <mbedtls/asn1.h>
+#include <mbedtls/x509_crl.h>
+#include <mbedtls/x509_crt.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "X509Crl.hpp"
+
+#include "Internal/X509Helper.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief An index of the certificates revoked by a set of CRLs, keyed by
+ *        issuer name and serial number.
+ *
+ *        mbed TLS keeps the revoked entries of a CRL in a linked list, and
+ *        scans it for every certificate checked against the CRL; with large
+ *        CRLs, that dominates the verification. This index takes two hash
+ *        lookups per certificate instead. It's given to
+ *        \c TlsConfig::SetRevocationIndex , which then checks certificates
+ *        with the index instead of giving the CRLs to mbed TLS.
+ *
+ *        Delta CRLs can be merged into an existing index; entries with the
+ *        \c removeFromCRL reason code are removed from the index.
+ *
+ *        NOTE: The CRLs are taken as they are; their signatures and validity
+ *        periods should be checked before they are merged.
+ *        The index is not thread-safe for modification; to update the index
+ *        used by a TLS config, merge into a copy, and give the copy to a new
+ *        config (see \c TlsConfigHolder ).
+ */
+class RevocationIndex
+{
+public: // Static members:
+
+	/**
+	 * @brief The value of the \c removeFromCRL CRL entry reason code
+	 *        (RFC 5280, section 5.3.1).
+	 */
+	static constexpr int sk_reasonRemoveFromCrl = 8;
+
+	/**
+	 * @brief Get the reason code of a CRL entry.
+	 *
+	 * @param entry The CRL entry.
+	 * @return int The reason code; -1 if the entry doesn't have one.
+	 */
+	static int GetReasonCode(const mbedtls_x509_crl_entry& entry) noexcept
+	{
+		static constexpr uint8_t sk_reasonCodeOid[] = { 0x55, 0x1D, 0x15 };
+
+		const mbedtls_x509_buf& ext = entry.entry_ext;
+		if (ext.p == nullptr ||
+			ext.tag != (MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE))
+		{
+			return -1;
+		}
+
+		// ext.p points to the header of the extension sequence, while
+		// ext.len is the length of its content; the content has been
+		// checked by mbed TLS when the CRL was parsed.
+		const size_t lenOfLen = (ext.p[1] & 0x80U) ? (1 + (ext.p[1] & 0x7FU)) : 1;
+		unsigned char* p = ext.p + 1 + lenOfLen;
+		const unsigned char* end = p + ext.len;
+
+		while (p < end)
+		{
+			size_t len = 0;
+			if (mbedtls_asn1_get_tag(
+					&p, end, &len,
+					MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE
+				) != 0)
+			{
+				return -1;
+			}
+			const unsigned char* extEnd = p + len;
+
+			size_t oidLen = 0;
+			if (mbedtls_asn1_get_tag(&p, extEnd, &oidLen, MBEDTLS_ASN1_OID) != 0)
+			{
+				return -1;
+			}
+			if (oidLen != sizeof(sk_reasonCodeOid) ||
+				std::memcmp(p, sk_reasonCodeOid, oidLen) != 0)
+			{
+				p = const_cast<unsigned char*>(extEnd);
+				continue;
+			}
+			p += oidLen;
+
+			// critical BOOLEAN DEFAULT FALSE
+			int isCritical = 0;
+			mbedtls_asn1_get_bool(&p, extEnd, &isCritical);
+
+			size_t valLen = 0;
+			int reason = -1;
+			if (mbedtls_asn1_get_tag(
+					&p, extEnd, &valLen, MBEDTLS_ASN1_OCTET_STRING
+				) != 0 ||
+				mbedtls_asn1_get_enum(&p, p + valLen, &reason) != 0)
+			{
+				return -1;
+			}
+			return reason;
+		}
+
+		return -1;
+	}
+
+public:
+
+	RevocationIndex() :
+		m_byIssuer(),
+		m_size(0),
+		m_version(Internal::NewX509TrustVersion())
+	{}
+
+	/**
+	 * @brief Construct a new revocation index from the given CRL(s).
+	 *
+	 * @exception InvalidObjectException Thrown when the given CRL is null.
+	 * @param crl The CRL, or a chain of CRLs.
+	 */
+	explicit RevocationIndex(const X509Crl& crl) :
+		RevocationIndex()
+	{
+		Merge(crl);
+	}
+
+	RevocationIndex(const RevocationIndex& other) :
+		m_byIssuer(other.m_byIssuer),
+		m_size(other.m_size),
+		m_version(Internal::NewX509TrustVersion())
+	{}
+
+	RevocationIndex(RevocationIndex&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~RevocationIndex() = default;
+	// LCOV_EXCL_STOP
+
+	RevocationIndex& operator=(const RevocationIndex& other)
+	{
+		if (this != &other)
+		{
+			m_byIssuer = other.m_byIssuer;
+			m_size     = other.m_size;
+			m_version  = Internal::NewX509TrustVersion();
+		}
+		return *this;
+	}
+
+	RevocationIndex& operator=(RevocationIndex&& other) = default;
+
+	/**
+	 * @brief Merge the entries of the given CRL(s) (e.g., a delta CRL) into
+	 *        the index. Entries with the \c removeFromCRL reason code remove
+	 *        the serial number from the index; others add it.
+	 *
+	 * @exception InvalidObjectException Thrown when the given CRL is null.
+	 * @param crl The CRL, or a chain of CRLs.
+	 */
+	void Merge(const X509Crl& crl)
+	{
+		crl.NullCheck();
+
+		for (const mbedtls_x509_crl* cur = crl.Get();
+			cur != nullptr && cur->version != 0;
+			cur = cur->next)
+		{
+			std::unordered_set<std::string>& serials =
+				m_byIssuer[Internal::GetX509NameLookupKey(cur->issuer)];
+
+			for (const mbedtls_x509_crl_entry* entry = &(cur->entry);
+				entry != nullptr && entry->serial.p != nullptr;
+				entry = entry->next)
+			{
+				std::string serial(
+					reinterpret_cast<const char*>(entry->serial.p),
+					entry->serial.len
+				);
+
+				if (GetReasonCode(*entry) == sk_reasonRemoveFromCrl)
+				{
+					m_size -= serials.erase(serial);
+				}
+				else if (serials.insert(std::move(serial)).second)
+				{
+					++m_size;
+				}
+			}
+		}
+
+		m_version = Internal::NewX509TrustVersion();
+	}
+
+	/**
+	 * @brief Check if the given certificate is revoked.
+	 *
+	 * @param cert The certificate.
+	 * @return true if it's revoked by its issuer.
+	 */
+	bool IsRevoked(const mbedtls_x509_crt& cert) const
+	{
+		if (m_size == 0)
+		{
+			return false;
+		}
+
+		auto it = m_byIssuer.find(Internal::GetX509NameLookupKey(cert.issuer));
+		if (it == m_byIssuer.end())
+		{
+			return false;
+		}
+
+		return it->second.find(
+			std::string(
+				reinterpret_cast<const char*>(cert.serial.p),
+				cert.serial.len
+			)
+		) != it->second.end();
+	}
+
+	/**
+	 * @brief Get the number of revoked serial numbers in the index.
+	 *
+	 * @return size_t The number of revoked serial numbers.
+	 */
+	size_t GetSize() const noexcept
+	{
+		return m_size;
+	}
+
+	/**
+	 * @brief Get the version of the index, which changes whenever CRLs are
+	 *        merged into it. Copies get their own versions.
+	 *
+	 * @return uint64_t The version.
+	 */
+	uint64_t GetVersion() const noexcept
+	{
+		return m_version;
+	}
+
+private:
+
+	std::unordered_map<
+		std::string,
+		std::unordered_set<std::string>
+	> m_byIssuer;
+	size_t m_size;
+	uint64_t m_version;
+
+}; // class RevocationIndex
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,1168 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <mbedtls/pk.h>
+#include <mbedtls/rsa.h>
+
+#include "Common.hpp"
+#include "Container.hpp"
+#include "Exceptions.hpp"
+#include "Hash.hpp"
+#include "Metrics.hpp"
+#include "PKey.hpp"
+#include "RandInterfaces.hpp"
+#include "SecretVector.hpp"
+
+/**
+ * The RSA keys work on the \c mbedtls_rsa_context inside the PK context
+ * directly, skipping the generic \c mbedtls_pk_* dispatch. mbed TLS keeps
+ * the CRT parameters (DP, DQ, QP), the Montgomery constants (RN, RP, RQ)
+ * and the blinding values (Vi, Vf) in that context, once they are
+ * computed, so a key object should be kept and reused, rather than parsed
+ * again for each operation (see \c RsaPublicKey::WarmUp ).
+ *
+ * The padding scheme is a setting of the RSA context, which the sign,
+ * verify, encrypt, and decrypt methods change for their duration (see
+ * \c Internal::RsaPaddingScope ); that's why these methods are not const.
+ * While one of them runs, the key must not be used by any other thread,
+ * including through the generic \c mbedtls_pk_* functions; in particular,
+ * don't call them on a key that has been given to a \c TlsConfig , since
+ * TLS signs with the same context, following its padding setting.
+ */
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+#if defined(MBEDTLS_RSA_C)
+
+
+namespace Internal
+{
+
+
+template<typename _PKObjTrait>
+inline PKeyBase<_PKObjTrait>&& RsaPKeyBaseRRefFilter(
+	PKeyBase<_PKObjTrait>&& other,
+	PKeyType reqKeyType
+)
+{
+	PKeyBase<_PKObjTrait>&& firstPass = PKeyBaseRRefFilter(
+		std::forward<PKeyBase<_PKObjTrait> >(other),
+		PKeyAlgmCat::RSA,
+		reqKeyType
+	);
+
+	// RSA_ALT and RSASSA_PSS contexts don't hold a mbedtls_rsa_context
+	if (mbedtls_pk_get_type(firstPass.Get()) != MBEDTLS_PK_RSA)
+	{
+		throw InvalidArgumentException(
+			"Internal::RsaPKeyBaseRRefFilter"
+			" - The given key does not contain a RSA key context"
+		);
+	}
+
+	return std::forward<PKeyBase<_PKObjTrait> >(firstPass);
+}
+
+
+template<PKeyType _ReqKeyType, typename _PKObjTrait>
+inline PKeyBase<_PKObjTrait>&& RsaPKeyBaseRRefFilter(
+	PKeyBase<_PKObjTrait>&& other
+)
+{
+	return RsaPKeyBaseRRefFilter(
+		std::forward<PKeyBase<_PKObjTrait> >(other),
+		_ReqKeyType
+	);
+}
+
+
+/**
+ * @brief Sets the padding scheme of a RSA context for one operation, and
+ *        restores the previous one afterwards, so the key can still be used
+ *        through the generic \c mbedtls_pk_* functions (e.g., by TLS), which
+ *        follow the padding setting of the context. Nothing else may use the
+ *        context while the scope is alive.
+ *
+ */
+class RsaPaddingScope
+{
+public:
+
+	RsaPaddingScope(
+		mbedtls_rsa_context& ctx,
+		int padding,
+		mbedtls_md_type_t hashId
+	) :
+		m_ctx(ctx),
+		m_prevPadding(mbedtls_rsa_get_padding_mode(&ctx)),
+		m_prevHashId(static_cast<mbedtls_md_type_t>(mbedtls_rsa_get_md_alg(&ctx)))
+	{
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Internal::RsaPaddingScope::RsaPaddingScope,
+			mbedtls_rsa_set_padding,
+			&m_ctx,
+			padding,
+			hashId
+		);
+	}
+
+	RsaPaddingScope(const RsaPaddingScope& other) = delete;
+	RsaPaddingScope(RsaPaddingScope&& other) = delete;
+
+	// LCOV_EXCL_START
+	~RsaPaddingScope()
+	{
+		// The previous setting was valid, so this can't fail
+		mbedtls_rsa_set_padding(&m_ctx, m_prevPadding, m_prevHashId);
+	}
+	// LCOV_EXCL_STOP
+
+	RsaPaddingScope& operator=(const RsaPaddingScope& other) = delete;
+	RsaPaddingScope& operator=(RsaPaddingScope&& other) = delete;
+
+private:
+
+	mbedtls_rsa_context& m_ctx;
+	int m_prevPadding;
+	mbedtls_md_type_t m_prevHashId;
+
+}; // class RsaPaddingScope
+
+
+} // namespace Internal
+
+
+template<
+	typename _PKObjTrait = DefaultPKeyObjTrait,
+	enable_if_t<
+		std::is_same<
+			typename _PKObjTrait::CObjType,
+			mbedtls_pk_context
+		>::value,
+		int
+	> = 0
+>
+class RsaPublicKey : public PKeyBase<_PKObjTrait>
+{
+public: // Types and static members:
+
+	using PKObjTrait = _PKObjTrait;
+	using _Base = PKeyBase<_PKObjTrait>;
+	using RsaPublicKeyOwnerType = RsaPublicKey<DefaultPKeyObjTrait>;
+
+	/**
+	 * @brief	Move constructor that moves a general PKeyBase object to RSA
+	 *          public key. If it failed, the \c other will remain the same.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given object is
+	 *                                     not a RSA public key.
+	 *
+	 * @param	other	The PKeyBase instance to convert.
+	 */
+	static RsaPublicKey<PKObjTrait> FromPKeyBase(
+		PKeyBase<PKObjTrait>&& other
+	)
+	{
+		return RsaPublicKey<PKObjTrait>(
+			std::forward<PKeyBase<PKObjTrait> >(other)
+		);
+	}
+
+	/**
+	 * @brief Construct a RSA public key from a given PEM string.
+	 *
+	 * @param pem PEM string in std::string
+	 */
+	static RsaPublicKeyOwnerType FromPEM(const std::string& pem)
+	{
+		using _OwnerTrait = typename RsaPublicKeyOwnerType::PKObjTrait;
+		return RsaPublicKeyOwnerType::FromPKeyBase(
+			PKeyBase<_OwnerTrait>::FromPEM(pem)
+		);
+	}
+
+	/**
+	 * @brief Construct a RSA public key from a given DER bytes.
+	 *
+	 * @param der DER bytes referenced by ContCtnReadOnlyRef
+	 */
+	template<typename _SecCtnType>
+	static RsaPublicKeyOwnerType FromDER(
+		const ContCtnReadOnlyRef<_SecCtnType, false>& der
+	)
+	{
+		using _OwnerTrait = typename RsaPublicKeyOwnerType::PKObjTrait;
+		return RsaPublicKeyOwnerType::FromPKeyBase(
+			PKeyBase<_OwnerTrait>::FromDER(der)
+		);
+	}
+
+	/**
+	 * @brief Construct a new RSA key object that borrows the C object.
+	 *
+	 * @param ptr pointer to the C object to be borrowed.
+	 */
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	static RsaPublicKey<_dummy_PKTrait> Borrow(mbedtls_pk_context* ptr)
+	{
+		auto pk = PKeyBase<_dummy_PKTrait>(ptr);
+
+		return FromPKeyBase(std::move(pk));
+	}
+
+public:
+
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<!_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	RsaPublicKey() :
+		_Base::PKeyBase()
+	{}
+
+
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<!_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	explicit RsaPublicKey(mbedtls_pk_type_t) :
+		RsaPublicKey()
+	{
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaPublicKey::RsaPublicKey,
+			mbedtls_pk_setup,
+			NonVirtualGet(),
+			mbedtls_pk_info_from_type(mbedtls_pk_type_t::MBEDTLS_PK_RSA)
+		);
+	}
+
+
+	/**
+	 * @brief	Move constructor that moves a general PKeyBase object to RSA
+	 *          public key. If it failed, the \c other will remain the same.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given object is
+	 *                                     not a RSA public key.
+	 *
+	 * @param	other	The PKeyBase instance to convert.
+	 */
+	explicit RsaPublicKey(PKeyBase<PKObjTrait>&& other) :
+		RsaPublicKey(
+			std::forward<_Base>(other),
+			Internal::RsaPKeyBaseRRefFilter<PKeyType::Public, PKObjTrait>
+		)
+	{}
+
+
+	/**
+	 * @brief Move Constructor. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other RSA public key instance.
+	 */
+	RsaPublicKey(RsaPublicKey&& rhs) noexcept :
+		_Base::PKeyBase(std::forward<_Base>(rhs)) //noexcept
+	{}
+
+
+	// LCOV_EXCL_START
+	virtual ~RsaPublicKey() = default;
+	// LCOV_EXCL_STOP
+
+
+	/**
+	 * @brief Move assignment. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other RsaPublicKey instance.
+	 * @return RsaPublicKey& A reference to this instance.
+	 */
+	RsaPublicKey& operator=(RsaPublicKey&& rhs) noexcept
+	{
+		_Base::operator=(std::forward<_Base>(rhs)); //noexcept
+
+		return *this;
+	}
+
+
+	using _Base::Get;
+	using _Base::NullCheck;
+	using _Base::NonVirtualGet;
+	using _Base::FreeBaseObject;
+
+	using _Base::GetPublicDer;
+	using _Base::GetPublicPem;
+
+
+	/**
+	 * @brief	Gets PKey algorithm type.
+	 *
+	 * @return	The PKey algorithm type.
+	 */
+	virtual PKeyAlgmCat GetAlgorithmCat() const override
+	{
+		return PKeyAlgmCat::RSA;
+	}
+
+
+	/**
+	 * @brief	Gets PKey type (either public or private).
+	 *
+	 * @return	The PKey type.
+	 */
+	virtual PKeyType GetKeyType() const override
+	{
+		return PKeyType::Public;
+	}
+
+
+	/**
+	 * @brief Check if the current instance is holding a null pointer for
+	 *        the mbedTLS object. If so, exception will be thrown. Helper
+	 *        function to be called before accessing the mbedTLS object.
+	 *
+	 * @exception InvalidObjectException Thrown when the current instance is
+	 *                                   holding a null pointer for the C mbed TLS
+	 *                                   object.
+	 */
+	virtual void NullCheck() const override
+	{
+		_Base::NullCheck(MBEDTLSCPP_CLASS_NAME_STR(RsaPublicKey));
+	}
+
+
+	/**
+	 * @brief	Gets mbed TLS's RSA context.
+	 *
+	 * @exception InvalidObjectException Thrown when the current instance is
+	 *                                   holding a null pointer for the C mbed TLS
+	 *                                   object, or the RSA context.
+	 *
+	 * @return	The mbed TLS's RSA context.
+	 */
+	mbedtls_rsa_context& GetRsaContextRef()
+	{
+		NullCheck();
+		mbedtls_rsa_context* ctx = mbedtls_pk_rsa(*Get());
+		if (ctx == nullptr)
+		{
+			throw InvalidObjectException(
+				MBEDTLSCPP_CLASS_NAME_STR(RsaPublicKey)
+			);
+		}
+
+		return *ctx;
+	}
+
+
+	/**
+	 * @brief	Gets mbed TLS's RSA context.
+	 *
+	 * @exception InvalidObjectException Thrown when the current instance is
+	 *                                   holding a null pointer for the C mbed TLS
+	 *                                   object, or the RSA context.
+	 *
+	 * @return	The mbed TLS's RSA context.
+	 */
+	const mbedtls_rsa_context& GetRsaContextRef() const
+	{
+		NullCheck();
+		const mbedtls_rsa_context* ctx = mbedtls_pk_rsa(*Get());
+		if (ctx == nullptr)
+		{
+			throw InvalidObjectException(
+				MBEDTLSCPP_CLASS_NAME_STR(RsaPublicKey)
+			);
+		}
+
+		return *ctx;
+	}
+
+
+	/**
+	 * @brief	Gets the size of the modulus in bytes, which is also the size
+	 *          of signatures and cipher texts.
+	 *
+	 * @return	The size of the modulus in bytes.
+	 */
+	size_t GetByteSize() const
+	{
+		return mbedtls_rsa_get_len(&GetRsaContextRef());
+	}
+
+
+	/**
+	 * @brief	Gets the size of the modulus in bits.
+	 *
+	 * @return	The size of the modulus in bits.
+	 */
+	size_t GetBitSize() const
+	{
+		return mbedtls_pk_get_bitlen(Get());
+	}
+
+
+	/**
+	 * @brief Run one public key operation, so the Montgomery constant of the
+	 *        modulus (RN) is computed ahead of time, rather than by the first
+	 *        verification or encryption.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 */
+	void WarmUp()
+	{
+		std::vector<uint8_t> buf = GetWarmUpInput();
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaPublicKey::WarmUp,
+			mbedtls_rsa_public,
+			&GetMutableRsaContextRef(),
+			buf.data(),
+			buf.data()
+		);
+	}
+
+
+#if defined(MBEDTLS_PKCS1_V15)
+
+	/**
+	 * @brief	Verify a RSASSA-PKCS1-v1_5 signature.
+	 *
+	 * @exception InvalidArgumentException Thrown when the size of the
+	 *                                     signature doesn't match the key.
+	 * @exception mbedTLSRuntimeError Thrown when the verification failed.
+	 *
+	 * @param	hash	The hash of the message.
+	 * @param	sign	The signature.
+	 */
+	template<
+		HashType _HashTypeVal,
+		typename _SignCtnType,
+		bool _SignCtnSecrecy
+	>
+	void VerifyPkcs1v15Sign(
+		const Hash<_HashTypeVal>& hash,
+		const ContCtnReadOnlyRef<_SignCtnType, _SignCtnSecrecy>& sign
+	)
+	{
+		CheckInputSize(sign.GetRegionSize(), "RsaPublicKey::VerifyPkcs1v15Sign");
+
+		mbedtls_rsa_context& ctx = GetMutableRsaContextRef();
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V15,
+			MBEDTLS_MD_NONE
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaPublicKey::VerifyPkcs1v15Sign,
+			mbedtls_rsa_rsassa_pkcs1_v15_verify,
+			&ctx,
+			GetMbedTlsMdType(_HashTypeVal),
+			static_cast<unsigned int>(hash.size()),
+			hash.data(),
+			sign.BeginBytePtr()
+		);
+
+		MBEDTLSCPP_METRICS_COUNT(Verify, hash.size());
+	}
+
+#endif // MBEDTLS_PKCS1_V15
+
+
+#if defined(MBEDTLS_PKCS1_V21)
+
+	/**
+	 * @brief	Verify a RSASSA-PSS signature, with MGF1 based on the same hash
+	 *          as the message, and any salt length.
+	 *
+	 * @exception InvalidArgumentException Thrown when the size of the
+	 *                                     signature doesn't match the key.
+	 * @exception mbedTLSRuntimeError Thrown when the verification failed.
+	 *
+	 * @param	hash	The hash of the message.
+	 * @param	sign	The signature.
+	 */
+	template<
+		HashType _HashTypeVal,
+		typename _SignCtnType,
+		bool _SignCtnSecrecy
+	>
+	void VerifyPssSign(
+		const Hash<_HashTypeVal>& hash,
+		const ContCtnReadOnlyRef<_SignCtnType, _SignCtnSecrecy>& sign
+	)
+	{
+		CheckInputSize(sign.GetRegionSize(), "RsaPublicKey::VerifyPssSign");
+
+		mbedtls_rsa_context& ctx = GetMutableRsaContextRef();
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V21,
+			GetMbedTlsMdType(_HashTypeVal)
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaPublicKey::VerifyPssSign,
+			mbedtls_rsa_rsassa_pss_verify,
+			&ctx,
+			GetMbedTlsMdType(_HashTypeVal),
+			static_cast<unsigned int>(hash.size()),
+			hash.data(),
+			sign.BeginBytePtr()
+		);
+
+		MBEDTLSCPP_METRICS_COUNT(Verify, hash.size());
+	}
+
+
+	/**
+	 * @brief	Encrypt with RSAES-OAEP, with MGF1 based on the same hash.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call
+	 *                                failed (e.g., the plain text is too
+	 *                                long for the key).
+	 *
+	 * @tparam	_OaepHashType	The hash used by OAEP and MGF1.
+	 * @param	plain	The plain text.
+	 * @param	label	The label associated with the message.
+	 * @param	rand	The random bit generator.
+	 * @return	The cipher text, which is as long as the modulus.
+	 */
+	template<
+		HashType _OaepHashType,
+		typename _PlainCtnType,
+		bool _PlainSecrecy,
+		typename _LabelCtnType,
+		bool _LabelSecrecy
+	>
+	std::vector<uint8_t> OaepEncrypt(
+		const ContCtnReadOnlyRef<_PlainCtnType, _PlainSecrecy>& plain,
+		const ContCtnReadOnlyRef<_LabelCtnType, _LabelSecrecy>& label,
+		RbgInterface& rand
+	)
+	{
+		return OaepEncrypt(
+			_OaepHashType,
+			plain.BeginBytePtr(), plain.GetRegionSize(),
+			label.BeginBytePtr(), label.GetRegionSize(),
+			rand
+		);
+	}
+
+
+	/**
+	 * @brief	Encrypt with RSAES-OAEP, with MGF1 based on the same hash,
+	 *          and an empty label.
+	 *
+	 * @tparam	_OaepHashType	The hash used by OAEP and MGF1.
+	 * @param	plain	The plain text.
+	 * @param	rand	The random bit generator.
+	 * @return	The cipher text, which is as long as the modulus.
+	 */
+	template<
+		HashType _OaepHashType,
+		typename _PlainCtnType,
+		bool _PlainSecrecy
+	>
+	std::vector<uint8_t> OaepEncrypt(
+		const ContCtnReadOnlyRef<_PlainCtnType, _PlainSecrecy>& plain,
+		RbgInterface& rand
+	)
+	{
+		return OaepEncrypt(
+			_OaepHashType,
+			plain.BeginBytePtr(), plain.GetRegionSize(),
+			nullptr, 0,
+			rand
+		);
+	}
+
+#endif // MBEDTLS_PKCS1_V21
+
+protected:
+
+	using _Base::GetPrivateDer;
+	using _Base::GetPrivatePem;
+
+
+	template<typename _FilterFunc>
+	RsaPublicKey(
+		PKeyBase<PKObjTrait>&& other,
+		_FilterFunc filterFunc
+	) :
+		_Base::PKeyBase(
+			filterFunc(
+				std::forward<_Base>(other)
+			)
+		)
+	{}
+
+
+	/**
+	 * @brief The RSA context is modified by the operations (caches, blinding
+	 *        values, and padding settings), even when the key is not; the
+	 *        padding settings are why the operations are not const.
+	 *
+	 */
+	mbedtls_rsa_context& GetMutableRsaContextRef()
+	{
+		NullCheck();
+		mbedtls_rsa_context* ctx = mbedtls_pk_rsa(*_Base::MutableGet());
+		if (ctx == nullptr)
+		{
+			throw InvalidObjectException(
+				MBEDTLSCPP_CLASS_NAME_STR(RsaPublicKey)
+			);
+		}
+
+		return *ctx;
+	}
+
+
+	/**
+	 * @brief mbed TLS reads exactly one modulus size from the input of
+	 *        verifications and decryptions.
+	 *
+	 */
+	void CheckInputSize(size_t size, const char* funcName) const
+	{
+		if (size != GetByteSize())
+		{
+			throw InvalidArgumentException(
+				std::string(funcName) +
+				" - The size of the input doesn't match the key"
+			);
+		}
+	}
+
+
+	/**
+	 * @brief Get an input for the warm-up operations, i.e., the value 2,
+	 *        which is less than any valid modulus.
+	 *
+	 */
+	std::vector<uint8_t> GetWarmUpInput() const
+	{
+		std::vector<uint8_t> buf(GetByteSize(), 0);
+		if (!buf.empty())
+		{
+			buf.back() = 2;
+		}
+
+		return buf;
+	}
+
+
+#if defined(MBEDTLS_PKCS1_V21)
+
+	std::vector<uint8_t> OaepEncrypt(
+		HashType oaepHashType,
+		const uint8_t* plain, size_t plainSize,
+		const uint8_t* label, size_t labelSize,
+		RbgInterface& rand
+	)
+	{
+		mbedtls_rsa_context& ctx = GetMutableRsaContextRef();
+
+		std::vector<uint8_t> res(mbedtls_rsa_get_len(&ctx));
+
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V21,
+			GetMbedTlsMdType(oaepHashType)
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaPublicKey::OaepEncrypt,
+			mbedtls_rsa_rsaes_oaep_encrypt,
+			&ctx,
+			&RbgInterface::CallBack,
+			&rand,
+			label,
+			labelSize,
+			plainSize,
+			plain,
+			res.data()
+		);
+
+		return res;
+	}
+
+#endif // MBEDTLS_PKCS1_V21
+
+
+}; // class RsaPublicKey
+
+
+template<
+	typename _PKObjTrait = DefaultPKeyObjTrait,
+	enable_if_t<
+		std::is_same<
+			typename _PKObjTrait::CObjType,
+			mbedtls_pk_context
+		>::value,
+		int
+	> = 0
+>
+class RsaKeyPair : public RsaPublicKey<_PKObjTrait>
+{
+public: // Types and static members:
+
+	using PKObjTrait = _PKObjTrait;
+	using _Base = RsaPublicKey<_PKObjTrait>;
+	using RsaKeyPairOwnerType = RsaKeyPair<DefaultPKeyObjTrait>;
+
+	/**
+	 * @brief The default public exponent of generated keys.
+	 *
+	 */
+	static constexpr int sk_defExponent = 65537;
+
+	/**
+	 * @brief	Move constructor that moves a general PKeyBase object to RSA
+	 *          Key pair. If it failed, the \c other will remain the same.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given object is
+	 *                                     not a RSA private key.
+	 *
+	 * @param	other	The PKeyBase instance to convert.
+	 */
+	static RsaKeyPair<PKObjTrait> FromPKeyBase(
+		PKeyBase<PKObjTrait>&& other
+	)
+	{
+		return RsaKeyPair<PKObjTrait>(
+			std::forward<PKeyBase<PKObjTrait> >(other)
+		);
+	}
+
+	/**
+	 * @brief Construct a RSA key pair from a given PEM string.
+	 *
+	 * @param pem PEM string in SecretString
+	 */
+	static RsaKeyPairOwnerType FromPEM(
+		const SecretString& pem,
+		RbgInterface& rand
+	)
+	{
+		using _OwnerTrait = typename RsaKeyPairOwnerType::PKObjTrait;
+		return RsaKeyPairOwnerType::FromPKeyBase(
+			PKeyBase<_OwnerTrait>::FromPEM(pem, rand)
+		);
+	}
+
+	/**
+	 * @brief Construct a RSA key pair from a given DER bytes.
+	 *
+	 * @param der DER bytes referenced by ContCtnReadOnlyRef
+	 */
+	template<typename _SecCtnType>
+	static RsaKeyPairOwnerType FromDER(
+		const ContCtnReadOnlyRef<_SecCtnType, true>& der,
+		RbgInterface& rand
+	)
+	{
+		using _OwnerTrait = typename RsaKeyPairOwnerType::PKObjTrait;
+		return RsaKeyPairOwnerType::FromPKeyBase(
+			PKeyBase<_OwnerTrait>::FromDER(der, rand)
+		);
+	}
+
+#if defined(MBEDTLS_GENPRIME)
+
+	/**
+	 * @brief Generate a new RSA key pair.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param bitSize  The size of the modulus in bits.
+	 * @param rand     The random bit generator.
+	 * @param exponent The public exponent.
+	 */
+	static RsaKeyPairOwnerType Generate(
+		unsigned int bitSize,
+		RbgInterface& rand,
+		int exponent = sk_defExponent
+	)
+	{
+		RsaKeyPairOwnerType res(MBEDTLS_PK_RSA);
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaKeyPair::Generate,
+			mbedtls_rsa_gen_key,
+			&res.GetRsaContextRef(),
+			&RbgInterface::CallBack,
+			&rand,
+			bitSize,
+			exponent
+		);
+
+		return res;
+	}
+
+#endif // MBEDTLS_GENPRIME
+
+	/**
+	 * @brief Construct a new RSA key object that borrows the C object.
+	 *
+	 * @param ptr pointer to the C object to be borrowed.
+	 */
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	static RsaKeyPair<_dummy_PKTrait> Borrow(mbedtls_pk_context* ptr)
+	{
+		auto pk = PKeyBase<_dummy_PKTrait>(ptr);
+
+		return FromPKeyBase(std::move(pk));
+	}
+
+public:
+
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<!_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	RsaKeyPair() :
+		_Base::RsaPublicKey()
+	{}
+
+
+	template<
+		typename _dummy_PKTrait = PKObjTrait,
+		enable_if_t<!_dummy_PKTrait::sk_isBorrower, int> = 0
+	>
+	explicit RsaKeyPair(mbedtls_pk_type_t x) :
+		_Base::RsaPublicKey(x)
+	{}
+
+
+	/**
+	 * @brief	Move constructor that moves a general PKeyBase object to RSA
+	 *          Key pair. If it failed, the \c other will remain the same.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given object is
+	 *                                     not a RSA private key.
+	 *
+	 * @param	other	The PKeyBase instance to convert.
+	 */
+	explicit RsaKeyPair(PKeyBase<PKObjTrait>&& other) :
+		_Base::RsaPublicKey(
+			std::forward<PKeyBase<PKObjTrait> >(other),
+			Internal::RsaPKeyBaseRRefFilter<PKeyType::Private, PKObjTrait>
+		)
+	{}
+
+
+	/**
+	 * @brief Move Constructor. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other RSA key pair instance.
+	 */
+	RsaKeyPair(RsaKeyPair&& rhs) noexcept :
+		_Base::RsaPublicKey(std::forward<_Base>(rhs)) //noexcept
+	{}
+
+
+	// LCOV_EXCL_START
+	virtual ~RsaKeyPair() = default;
+	// LCOV_EXCL_STOP
+
+
+	/**
+	 * @brief Move assignment. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other RsaKeyPair instance.
+	 * @return RsaKeyPair& A reference to this instance.
+	 */
+	RsaKeyPair& operator=(RsaKeyPair&& rhs) noexcept
+	{
+		_Base::operator=(std::forward<_Base>(rhs)); //noexcept
+
+		return *this;
+	}
+
+
+	using _Base::Get;
+	using _Base::NullCheck;
+	using _Base::NonVirtualGet;
+	using _Base::FreeBaseObject;
+
+	using _Base::GetRsaContextRef;
+	using _Base::GetByteSize;
+	using _Base::GetBitSize;
+	using _Base::WarmUp;
+
+	using _Base::GetPublicDer;
+	using _Base::GetPublicPem;
+
+	using _Base::GetPrivateDer;
+	using _Base::GetPrivatePem;
+
+
+	/**
+	 * @brief	Gets PKey type (either public or private).
+	 *
+	 * @return	The PKey type.
+	 */
+	virtual PKeyType GetKeyType() const override
+	{
+		return PKeyType::Private;
+	}
+
+
+	/**
+	 * @brief Run one private key operation, so the Montgomery constants of
+	 *        the primes (RP, RQ) and of the modulus (RN), and the blinding
+	 *        values, are computed ahead of time, rather than by the first
+	 *        signing or decryption.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param rand The random bit generator, used for blinding.
+	 */
+	void WarmUp(RbgInterface& rand)
+	{
+		std::vector<uint8_t> buf = _Base::GetWarmUpInput();
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaKeyPair::WarmUp,
+			mbedtls_rsa_private,
+			&GetRsaContextRef(),
+			&RbgInterface::CallBack,
+			&rand,
+			buf.data(),
+			buf.data()
+		);
+	}
+
+
+#if defined(MBEDTLS_PKCS1_V15)
+
+	/**
+	 * @brief	Make a RSASSA-PKCS1-v1_5 signature.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 *
+	 * @param	hash	The hash of the message.
+	 * @param	rand	The random bit generator, used for blinding.
+	 * @return	The signature, which is as long as the modulus.
+	 */
+	template<HashType _HashTypeVal>
+	std::vector<uint8_t> SignPkcs1v15(
+		const Hash<_HashTypeVal>& hash,
+		RbgInterface& rand
+	)
+	{
+		mbedtls_rsa_context& ctx = _Base::GetMutableRsaContextRef();
+
+		std::vector<uint8_t> sign(mbedtls_rsa_get_len(&ctx));
+
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V15,
+			MBEDTLS_MD_NONE
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaKeyPair::SignPkcs1v15,
+			mbedtls_rsa_rsassa_pkcs1_v15_sign,
+			&ctx,
+			&RbgInterface::CallBack,
+			&rand,
+			GetMbedTlsMdType(_HashTypeVal),
+			static_cast<unsigned int>(hash.size()),
+			hash.data(),
+			sign.data()
+		);
+
+		MBEDTLSCPP_METRICS_COUNT(Sign, hash.size());
+
+		return sign;
+	}
+
+#endif // MBEDTLS_PKCS1_V15
+
+
+#if defined(MBEDTLS_PKCS1_V21)
+
+	/**
+	 * @brief	Make a RSASSA-PSS signature, with MGF1 based on the same hash
+	 *          as the message, and a salt as long as the hash (mbed TLS
+	 *          uses the hash length for \c MBEDTLS_RSA_SALT_LEN_ANY ).
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 *
+	 * @param	hash	The hash of the message.
+	 * @param	rand	The random bit generator.
+	 * @return	The signature, which is as long as the modulus.
+	 */
+	template<HashType _HashTypeVal>
+	std::vector<uint8_t> SignPss(
+		const Hash<_HashTypeVal>& hash,
+		RbgInterface& rand
+	)
+	{
+		mbedtls_rsa_context& ctx = _Base::GetMutableRsaContextRef();
+
+		std::vector<uint8_t> sign(mbedtls_rsa_get_len(&ctx));
+
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V21,
+			GetMbedTlsMdType(_HashTypeVal)
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaKeyPair::SignPss,
+			mbedtls_rsa_rsassa_pss_sign,
+			&ctx,
+			&RbgInterface::CallBack,
+			&rand,
+			GetMbedTlsMdType(_HashTypeVal),
+			static_cast<unsigned int>(hash.size()),
+			hash.data(),
+			sign.data()
+		);
+
+		MBEDTLSCPP_METRICS_COUNT(Sign, hash.size());
+
+		return sign;
+	}
+
+
+	/**
+	 * @brief	Decrypt a RSAES-OAEP cipher text, with MGF1 based on the same
+	 *          hash.
+	 *
+	 * @exception InvalidArgumentException Thrown when the size of the
+	 *                                     cipher text doesn't match the key.
+	 * @exception mbedTLSRuntimeError Thrown when the decryption failed.
+	 *
+	 * @tparam	_OaepHashType	The hash used by OAEP and MGF1.
+	 * @param	cipher	The cipher text.
+	 * @param	label	The label associated with the message.
+	 * @param	rand	The random bit generator, used for blinding.
+	 * @return	The plain text.
+	 */
+	template<
+		HashType _OaepHashType,
+		typename _CipherCtnType,
+		bool _CipherSecrecy,
+		typename _LabelCtnType,
+		bool _LabelSecrecy
+	>
+	SecretVector<uint8_t> OaepDecrypt(
+		const ContCtnReadOnlyRef<_CipherCtnType, _CipherSecrecy>& cipher,
+		const ContCtnReadOnlyRef<_LabelCtnType, _LabelSecrecy>& label,
+		RbgInterface& rand
+	)
+	{
+		return OaepDecrypt(
+			_OaepHashType,
+			cipher.BeginBytePtr(), cipher.GetRegionSize(),
+			label.BeginBytePtr(), label.GetRegionSize(),
+			rand
+		);
+	}
+
+
+	/**
+	 * @brief	Decrypt a RSAES-OAEP cipher text, with MGF1 based on the same
+	 *          hash, and an empty label.
+	 *
+	 * @tparam	_OaepHashType	The hash used by OAEP and MGF1.
+	 * @param	cipher	The cipher text.
+	 * @param	rand	The random bit generator, used for blinding.
+	 * @return	The plain text.
+	 */
+	template<
+		HashType _OaepHashType,
+		typename _CipherCtnType,
+		bool _CipherSecrecy
+	>
+	SecretVector<uint8_t> OaepDecrypt(
+		const ContCtnReadOnlyRef<_CipherCtnType, _CipherSecrecy>& cipher,
+		RbgInterface& rand
+	)
+	{
+		return OaepDecrypt(
+			_OaepHashType,
+			cipher.BeginBytePtr(), cipher.GetRegionSize(),
+			nullptr, 0,
+			rand
+		);
+	}
+
+#endif // MBEDTLS_PKCS1_V21
+
+protected:
+
+#if defined(MBEDTLS_PKCS1_V21)
+
+	SecretVector<uint8_t> OaepDecrypt(
+		HashType oaepHashType,
+		const uint8_t* cipher, size_t cipherSize,
+		const uint8_t* label, size_t labelSize,
+		RbgInterface& rand
+	)
+	{
+		_Base::CheckInputSize(cipherSize, "RsaKeyPair::OaepDecrypt");
+
+		mbedtls_rsa_context& ctx = _Base::GetMutableRsaContextRef();
+
+		SecretVector<uint8_t> res(mbedtls_rsa_get_len(&ctx));
+		size_t olen = 0;
+
+		Internal::RsaPaddingScope padding(
+			ctx,
+			MBEDTLS_RSA_PKCS_V21,
+			GetMbedTlsMdType(oaepHashType)
+		);
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			RsaKeyPair::OaepDecrypt,
+			mbedtls_rsa_rsaes_oaep_decrypt,
+			&ctx,
+			&RbgInterface::CallBack,
+			&rand,
+			label,
+			labelSize,
+			&olen,
+			cipher,
+			res.data(),
+			res.size()
+		);
+
+		res.resize(olen);
+
+		return res;
+	}
+
+#endif // MBEDTLS_PKCS1_V21
+
+}; // class RsaKeyPair
+
+
+#endif // MBEDTLS_RSA_C
+
+
+} // namespace mbedTLScpp
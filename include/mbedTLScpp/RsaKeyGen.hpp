@@ -0,0 +1,755 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mbedtls/bignum.h>
+#include <mbedtls/rsa.h>
+
+#include "BigNumber.hpp"
+#include "Common.hpp"
+#include "DefaultRbg.hpp"
+#include "Exceptions.hpp"
+#include "RsaKey.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+#if defined(MBEDTLS_GENPRIME)
+
+namespace Internal
+{
+
+
+/**
+ * @brief Get the number of Miller-Rabin rounds for a random candidate of
+ *        the given size, for an error probability below 2^-100 (FIPS 186-4,
+ *        table C.3); the same as \c mbedtls_mpi_gen_prime uses.
+ *
+ */
+inline int GetPrimeTestRounds(size_t bitSize) noexcept
+{
+	return (bitSize >= 1450) ?  4 :
+		(bitSize >= 1150) ?  5 :
+		(bitSize >= 1000) ?  6 :
+		(bitSize >=  850) ?  7 :
+		(bitSize >=  750) ?  8 :
+		(bitSize >=  500) ? 13 :
+		(bitSize >=  250) ? 28 :
+		(bitSize >=  150) ? 40 : 51;
+}
+
+
+/**
+ * @brief Search a window of candidates of exactly \c bitSize bits, after a
+ *        random start with the two top bits set (so the product of two of
+ *        them has twice the size). The residues of the start modulo the odd
+ *        primes below 1000 are computed once, and then updated for each
+ *        candidate in the window, so the candidates with a small factor (in
+ *        \c cand , or in (cand - 1) / 2 for safe primes) are sieved out
+ *        before any Miller-Rabin round.
+ *
+ * @param cand     The candidate found, if it's accepted.
+ * @param bitSize  The size of the prime in bits.
+ * @param isSafe   Whether (cand - 1) / 2 must be a prime as well.
+ * @param exponent If not null, (cand - 1) must be co-prime with it.
+ * @param rand     The random bit generator.
+ * @return true if a candidate in the window is accepted.
+ */
+inline bool TryPrimeCandidate(
+	BigNum& cand,
+	size_t bitSize,
+	bool isSafe,
+	const BigNum* exponent,
+	RbgInterface& rand
+)
+{
+	static constexpr uint16_t sk_smallPrimes[] = {
+		  3,   5,   7,  11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,
+		 53,  59,  61,  67,  71,  73,  79,  83,  89,  97, 101, 103, 107, 109,
+		113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191,
+		193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269,
+		271, 277, 281, 283, 293, 307, 311, 313, 317, 331, 337, 347, 349, 353,
+		359, 367, 373, 379, 383, 389, 397, 401, 409, 419, 421, 431, 433, 439,
+		443, 449, 457, 461, 463, 467, 479, 487, 491, 499, 503, 509, 521, 523,
+		541, 547, 557, 563, 569, 571, 577, 587, 593, 599, 601, 607, 613, 617,
+		619, 631, 641, 643, 647, 653, 659, 661, 673, 677, 683, 691, 701, 709,
+		719, 727, 733, 739, 743, 751, 757, 761, 769, 773, 787, 797, 809, 811,
+		821, 823, 827, 829, 839, 853, 857, 859, 863, 877, 881, 883, 887, 907,
+		911, 919, 929, 937, 941, 947, 953, 967, 971, 977, 983, 991, 997,
+	};
+	static constexpr size_t sk_numOfSmallPrimes =
+		sizeof(sk_smallPrimes) / sizeof(sk_smallPrimes[0]);
+	static constexpr uint32_t sk_windowSize = 256;
+
+	const size_t byteSize = (bitSize + 7) / 8;
+	const int rounds = GetPrimeTestRounds(bitSize);
+	// A safe prime is 3 mod 4 (for bit sizes above 2), so the step keeps
+	// bit 1 set.
+	const uint32_t step = isSafe ? 4 : 2;
+
+	BigNum start;
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		Internal::TryPrimeCandidate,
+		mbedtls_mpi_fill_random,
+		start.Get(), byteSize, &RbgInterface::CallBack, &rand
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		Internal::TryPrimeCandidate,
+		mbedtls_mpi_shift_r,
+		start.Get(), (byteSize * 8) - bitSize
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		Internal::TryPrimeCandidate,
+		mbedtls_mpi_set_bit,
+		start.Get(), bitSize - 1, 1
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		Internal::TryPrimeCandidate,
+		mbedtls_mpi_set_bit,
+		start.Get(), bitSize - 2, 1
+	);
+	MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		Internal::TryPrimeCandidate,
+		mbedtls_mpi_set_bit,
+		start.Get(), 0, 1
+	);
+	if (isSafe)
+	{
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Internal::TryPrimeCandidate,
+			mbedtls_mpi_set_bit,
+			start.Get(), 1, 1
+		);
+	}
+
+	// Only the primes below 2^(bitSize - 2) are used, so neither the
+	// candidate nor (cand - 1) / 2 can be one of them.
+	size_t numOfPrimes = 0;
+	uint32_t residues[sk_numOfSmallPrimes];
+	for (; numOfPrimes < sk_numOfSmallPrimes; ++numOfPrimes)
+	{
+		const uint32_t prime = sk_smallPrimes[numOfPrimes];
+		if (bitSize - 2 < 32 && prime >= (uint32_t(1) << (bitSize - 2)))
+		{
+			break;
+		}
+
+		mbedtls_mpi_uint res = 0;
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Internal::TryPrimeCandidate,
+			mbedtls_mpi_mod_int,
+			&res, start.Get(), static_cast<mbedtls_mpi_sint>(prime)
+		);
+		residues[numOfPrimes] = static_cast<uint32_t>(res);
+	}
+
+	for (uint32_t offset = 0; offset < sk_windowSize * step; offset += step)
+	{
+		// p divides cand if cand = 0 (mod p), and, p being odd, it divides
+		// (cand - 1) / 2 if cand = 1 (mod p).
+		bool hasSmallFactor = false;
+		for (size_t i = 0; !hasSmallFactor && i < numOfPrimes; ++i)
+		{
+			const uint32_t res = (residues[i] + offset) % sk_smallPrimes[i];
+			hasSmallFactor = (res == 0) || (isSafe && res == 1);
+		}
+		if (hasSmallFactor)
+		{
+			continue;
+		}
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Internal::TryPrimeCandidate,
+			mbedtls_mpi_add_int,
+			cand.Get(), start.Get(), static_cast<mbedtls_mpi_sint>(offset)
+		);
+		if (mbedtls_mpi_bitlen(cand.Get()) != bitSize)
+		{
+			// Went past the largest number of this size.
+			return false;
+		}
+
+		if (exponent != nullptr)
+		{
+			BigNum tmp;
+			BigNum gcd;
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				Internal::TryPrimeCandidate,
+				mbedtls_mpi_sub_int,
+				tmp.Get(), cand.Get(), 1
+			);
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				Internal::TryPrimeCandidate,
+				mbedtls_mpi_gcd,
+				gcd.Get(), exponent->Get(), tmp.Get()
+			);
+			if (mbedtls_mpi_cmp_int(gcd.Get(), 1) != 0)
+			{
+				continue;
+			}
+		}
+
+		int ret = mbedtls_mpi_is_prime_ext(
+			cand.Get(), rounds, &RbgInterface::CallBack, &rand
+		);
+		if (ret == MBEDTLS_ERR_MPI_NOT_ACCEPTABLE)
+		{
+			continue;
+		}
+		MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+			ret, Internal::TryPrimeCandidate, mbedtls_mpi_is_prime_ext
+		);
+
+		if (isSafe)
+		{
+			BigNum half;
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				Internal::TryPrimeCandidate,
+				mbedtls_mpi_copy,
+				half.Get(), cand.Get()
+			);
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				Internal::TryPrimeCandidate,
+				mbedtls_mpi_shift_r,
+				half.Get(), 1
+			);
+
+			ret = mbedtls_mpi_is_prime_ext(
+				half.Get(), rounds, &RbgInterface::CallBack, &rand
+			);
+			if (ret == MBEDTLS_ERR_MPI_NOT_ACCEPTABLE)
+			{
+				continue;
+			}
+			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+				ret, Internal::TryPrimeCandidate, mbedtls_mpi_is_prime_ext
+			);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * @brief Search for primes on several threads, each with its own DRBG; it
+ *        returns as soon as enough primes are found, after the threads
+ *        finish the candidates at hand.
+ *
+ * @exception RuntimeException Thrown when the search is cancelled.
+ * @param numOfThreads The number of threads to search on.
+ * @param numOfPrimes  The number of primes to find.
+ * @param bitSize      The size of the primes in bits.
+ * @param isSafe       Whether to find safe primes.
+ * @param exponent     If not null, (p - 1) must be co-prime with it.
+ * @param minDiffBits  Any two primes found must differ in more than this
+ *                     many bits.
+ * @param cancel       If not null, the search stops when it's set.
+ * @return The primes found.
+ */
+inline std::vector<BigNum> SearchPrimes(
+	size_t numOfThreads,
+	size_t numOfPrimes,
+	size_t bitSize,
+	bool isSafe,
+	const BigNum* exponent,
+	size_t minDiffBits,
+	const std::atomic<bool>* cancel
+)
+{
+	std::mutex mutex;
+	std::vector<BigNum> found;
+	std::exception_ptr error;
+	std::atomic<bool> isDone(false);
+
+	auto worker = [&]()
+	{
+		try
+		{
+			DefaultRbg rand;
+			BigNum cand;
+			while (
+				!isDone.load(std::memory_order_relaxed) &&
+				(cancel == nullptr || !cancel->load(std::memory_order_relaxed))
+			)
+			{
+				if (!TryPrimeCandidate(cand, bitSize, isSafe, exponent, rand))
+				{
+					continue;
+				}
+
+				BigNum diff;
+				std::lock_guard<std::mutex> lock(mutex);
+				bool isAccepted = !isDone.load(std::memory_order_relaxed);
+				for (size_t i = 0; isAccepted && i < found.size(); ++i)
+				{
+					MBEDTLSCPP_MAKE_C_FUNC_CALL(
+						Internal::SearchPrimes,
+						mbedtls_mpi_sub_mpi,
+						diff.Get(), cand.Get(), found[i].Get()
+					);
+					isAccepted = mbedtls_mpi_bitlen(diff.Get()) > minDiffBits;
+				}
+				if (isAccepted)
+				{
+					found.push_back(cand);
+					if (found.size() >= numOfPrimes)
+					{
+						isDone.store(true, std::memory_order_relaxed);
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (error == nullptr)
+			{
+				error = std::current_exception();
+			}
+			isDone.store(true, std::memory_order_relaxed);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numOfThreads);
+	try
+	{
+		for (size_t i = 0; i < numOfThreads; ++i)
+		{
+			threads.emplace_back(worker);
+		}
+	}
+	catch (...)
+	{
+		isDone.store(true, std::memory_order_relaxed);
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		throw;
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (error != nullptr)
+	{
+		std::rethrow_exception(error);
+	}
+	if (found.size() < numOfPrimes)
+	{
+		throw RuntimeException(
+			"Internal::SearchPrimes - The search has been cancelled."
+		);
+	}
+
+	return found;
+}
+
+
+} // namespace Internal
+
+
+#if defined(MBEDTLS_RSA_C)
+
+/**
+ * @brief Generates RSA keys, and primes, on several threads: each thread
+ *        tests its own random candidates (with its own \c DefaultRbg ), and
+ *        the search stops as soon as enough primes are found. The keys are
+ *        equivalent to those of \c mbedtls_rsa_gen_key .
+ *
+ */
+class RsaKeyGenerator
+{
+public: // Static members:
+
+	/**
+	 * @brief Get the default number of threads, i.e., one per hardware
+	 *        thread.
+	 *
+	 */
+	static size_t GetDefaultNumOfThreads() noexcept
+	{
+		const size_t num = std::thread::hardware_concurrency();
+		return num == 0 ? 1 : num;
+	}
+
+public:
+
+	/**
+	 * @brief Construct a new RSA key generator.
+	 *
+	 * @exception InvalidArgumentException Thrown when \c numOfThreads is zero.
+	 * @param numOfThreads The number of threads used by each generation.
+	 */
+	RsaKeyGenerator(size_t numOfThreads = GetDefaultNumOfThreads()) :
+		m_numOfThreads(numOfThreads)
+	{
+		if (m_numOfThreads == 0)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyGenerator::RsaKeyGenerator"
+				" - The number of threads must be greater than zero."
+			);
+		}
+	}
+
+	RsaKeyGenerator(const RsaKeyGenerator& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~RsaKeyGenerator() = default;
+	// LCOV_EXCL_STOP
+
+	RsaKeyGenerator& operator=(const RsaKeyGenerator& other) = default;
+
+	/**
+	 * @brief Generate a new RSA key pair.
+	 *
+	 * @exception InvalidArgumentException Thrown when the size or the
+	 *                                     exponent is invalid.
+	 * @exception RuntimeException Thrown when \c cancel is set.
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param bitSize  The size of the modulus in bits; an even number no less
+	 *                 than \c MBEDTLS_RSA_GEN_KEY_MIN_BITS .
+	 * @param exponent The public exponent; an odd number greater than 1.
+	 * @param cancel   If not null, the generation stops when it's set.
+	 * @return RsaKeyPair<> The new key pair.
+	 */
+	RsaKeyPair<> Generate(
+		unsigned int bitSize,
+		int exponent = RsaKeyPair<>::sk_defExponent,
+		const std::atomic<bool>* cancel = nullptr
+	) const
+	{
+		if (bitSize < MBEDTLS_RSA_GEN_KEY_MIN_BITS || (bitSize % 2) != 0)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyGenerator::Generate - Invalid key size."
+			);
+		}
+		if (exponent < 3 || (exponent % 2) == 0)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyGenerator::Generate - Invalid public exponent."
+			);
+		}
+
+		BigNum e(exponent);
+		// The same minimum distance between the primes as mbed TLS.
+		const size_t minDiffBits = (bitSize >= 200) ? ((bitSize >> 1) - 99) : 0;
+
+		while (true)
+		{
+			std::vector<BigNum> primes = Internal::SearchPrimes(
+				m_numOfThreads, 2, bitSize >> 1, false, &e, minDiffBits, cancel
+			);
+
+			// P > Q, for compatibility with other implementations.
+			if (mbedtls_mpi_cmp_mpi(primes[0].Get(), primes[1].Get()) < 0)
+			{
+				mbedtls_mpi_swap(primes[0].Get(), primes[1].Get());
+			}
+
+			RsaKeyPair<> res(MBEDTLS_PK_RSA);
+			mbedtls_rsa_context& ctx = res.GetRsaContextRef();
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				RsaKeyGenerator::Generate,
+				mbedtls_rsa_import,
+				&ctx, nullptr, primes[0].Get(), primes[1].Get(), nullptr, e.Get()
+			);
+			// Computes N, D, and the CRT parameters.
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				RsaKeyGenerator::Generate,
+				mbedtls_rsa_complete,
+				&ctx
+			);
+
+			// As mbedtls_rsa_gen_key does, D must be larger than
+			// 2^(bitSize/2) (FIPS 186-4, B.3.1); this rarely fails.
+			BigNum d;
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				RsaKeyGenerator::Generate,
+				mbedtls_rsa_export,
+				&ctx, nullptr, nullptr, nullptr, d.Get(), nullptr
+			);
+			if (mbedtls_mpi_bitlen(d.Get()) <= (bitSize >> 1))
+			{
+				continue;
+			}
+
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				RsaKeyGenerator::Generate,
+				mbedtls_rsa_check_privkey,
+				&ctx
+			);
+
+			return res;
+		}
+	}
+
+	/**
+	 * @brief Generate a random prime.
+	 *
+	 * @exception InvalidArgumentException Thrown when the size is too small.
+	 * @param bitSize The size of the prime in bits.
+	 * @param isSafe  Whether to generate a safe prime, i.e., (p - 1) / 2 is
+	 *                also a prime (e.g., for Diffie-Hellman groups).
+	 * @param cancel  If not null, the generation stops when it's set.
+	 * @return BigNum The new prime, of exactly \c bitSize bits.
+	 */
+	BigNum GeneratePrime(
+		size_t bitSize,
+		bool isSafe = false,
+		const std::atomic<bool>* cancel = nullptr
+	) const
+	{
+		if (bitSize < 3 || bitSize > MBEDTLS_MPI_MAX_BITS)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyGenerator::GeneratePrime - Invalid prime size."
+			);
+		}
+
+		return std::move(Internal::SearchPrimes(
+			m_numOfThreads, 1, bitSize, isSafe, nullptr, 0, cancel
+		)[0]);
+	}
+
+	size_t GetNumOfThreads() const noexcept
+	{
+		return m_numOfThreads;
+	}
+
+private:
+
+	size_t m_numOfThreads;
+
+}; // class RsaKeyGenerator
+
+
+/**
+ * @brief A pool of RSA keys generated in the background, so a key can be
+ *        taken without waiting for the generation, as long as the demand
+ *        doesn't outpace the generator.
+ *
+ */
+class RsaKeyPool
+{
+public:
+
+	/**
+	 * @brief Construct a new key pool, and start filling it.
+	 *
+	 * @exception InvalidArgumentException Thrown when the key size, the
+	 *                                     exponent, or the pool size is
+	 *                                     invalid.
+	 * @exception std::system_error Thrown when the thread can't be started.
+	 * @param generator The generator used in the background.
+	 * @param bitSize   The size of the keys in bits.
+	 * @param poolSize  The number of keys kept ready.
+	 * @param exponent  The public exponent.
+	 */
+	RsaKeyPool(
+		const RsaKeyGenerator& generator,
+		unsigned int bitSize,
+		size_t poolSize,
+		int exponent = RsaKeyPair<>::sk_defExponent
+	) :
+		m_generator(generator),
+		m_bitSize(bitSize),
+		m_exponent(exponent),
+		m_poolSize(poolSize),
+		m_mutex(),
+		m_cond(),
+		m_keys(),
+		m_isStopping(false),
+		m_thread()
+	{
+		if (m_poolSize == 0)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyPool::RsaKeyPool - The pool size must be greater than zero."
+			);
+		}
+		if (bitSize < MBEDTLS_RSA_GEN_KEY_MIN_BITS || (bitSize % 2) != 0 ||
+			exponent < 3 || (exponent % 2) == 0)
+		{
+			throw InvalidArgumentException(
+				"RsaKeyPool::RsaKeyPool - Invalid key size, or public exponent."
+			);
+		}
+
+		m_thread = std::thread(&RsaKeyPool::FillerMain, this);
+	}
+
+	RsaKeyPool(const RsaKeyPool& other) = delete;
+	RsaKeyPool(RsaKeyPool&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~RsaKeyPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_cond.notify_all();
+
+		if (m_thread.joinable())
+		{
+			m_thread.join();
+		}
+	}
+	// LCOV_EXCL_STOP
+
+	RsaKeyPool& operator=(const RsaKeyPool& other) = delete;
+	RsaKeyPool& operator=(RsaKeyPool&& other) = delete;
+
+	/**
+	 * @brief Take a key from the pool; if the pool is empty, a key is
+	 *        generated on the calling thread instead.
+	 *
+	 * @return RsaKeyPair<> The key pair.
+	 */
+	RsaKeyPair<> Get()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (!m_keys.empty())
+			{
+				RsaKeyPair<> key = std::move(m_keys.front());
+				m_keys.pop_front();
+				lock.unlock();
+
+				m_cond.notify_all();
+				return key;
+			}
+		}
+
+		return m_generator.Generate(m_bitSize, m_exponent);
+	}
+
+	/**
+	 * @brief Wait until the pool holds at least the given number of keys.
+	 *
+	 * @param numOfKeys The number of keys to wait for; it's capped by the
+	 *                  pool size.
+	 */
+	void WaitForKeys(size_t numOfKeys)
+	{
+		numOfKeys = (numOfKeys < m_poolSize) ? numOfKeys : m_poolSize;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(
+			lock,
+			[this, numOfKeys]()
+			{
+				return m_isStopping || m_keys.size() >= numOfKeys;
+			}
+		);
+	}
+
+	/**
+	 * @brief Get the number of keys ready in the pool.
+	 *
+	 */
+	size_t GetNumOfKeys() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_keys.size();
+	}
+
+private:
+
+	void FillerMain() noexcept
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cond.wait(
+				lock,
+				[this]()
+				{
+					return m_isStopping || m_keys.size() < m_poolSize;
+				}
+			);
+			if (m_isStopping)
+			{
+				return;
+			}
+
+			lock.unlock();
+			try
+			{
+				RsaKeyPair<> key =
+					m_generator.Generate(m_bitSize, m_exponent, &m_isStopping);
+
+				lock.lock();
+				m_keys.push_back(std::move(key));
+				m_cond.notify_all();
+			}
+			catch (...)
+			{
+				// Cancelled, or failed; in the latter case, it's retried
+				// after a while. The lock is already held if it failed
+				// while adding the key.
+				if (!lock.owns_lock())
+				{
+					lock.lock();
+				}
+				m_cond.wait_for(
+					lock,
+					std::chrono::seconds(1),
+					[this]()
+					{
+						return m_isStopping.load();
+					}
+				);
+			}
+		}
+	}
+
+	RsaKeyGenerator m_generator;
+	unsigned int m_bitSize;
+	int m_exponent;
+	size_t m_poolSize;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<RsaKeyPair<> > m_keys;
+	std::atomic<bool> m_isStopping;
+	std::thread m_thread;
+
+}; // class RsaKeyPool
+
+#endif // MBEDTLS_RSA_C
+
+#endif // MBEDTLS_GENPRIME
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+
+#include <memory>
+#include <type_traits>
+
+#include "Common.hpp"
+#include "RandInterfaces.hpp"
+#include "Entropy.hpp"
+#include "CtrDrbg.hpp"
+#include "HmacDrbg.hpp"
+
+#include "Internal/ForkGeneration.hpp"
+#include "Internal/make_unique.hpp"
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+	/**
+	 * @brief An RBG adapter that forwards every request to a DRBG owned by
+	 *        the calling thread. The per-thread DRBG is lazily created on the
+	 *        first request made by that thread, and is seeded from its own
+	 *        entropy pool, so threads never contend on a shared entropy
+	 *        context or a shared DRBG.
+	 *        If the process forks, the DRBG of the forking thread is reseeded
+	 *        in the child before its next use, so parent and child never
+	 *        produce the same random stream.
+	 *
+	 *        This adapter holds no state by itself, thus, one instance can be
+	 *        shared by any number of threads.
+	 *
+	 * @tparam _RbgType The DRBG type. It must be constructible from a
+	 *                  \c std::unique_ptr<EntropyInterface> , and provides a
+	 *                  \c Reseed() method (e.g., \c CtrDrbg or \c HmacDrbg ).
+	 */
+	template<typename _RbgType = CtrDrbg<>,
+		enable_if_t<std::is_base_of<RbgInterface, _RbgType>::value, int> = 0>
+	class ThreadLocalRbg : public RbgInterface
+	{
+	public: // Static members:
+
+		using RbgType   = _RbgType;
+		using _BaseIntf = RbgInterface;
+
+		/**
+		 * @brief Get the DRBG owned by the calling thread. It will be created
+		 *        on the first call made by each thread, and it will be
+		 *        reseeded if the process has forked since the last call.
+		 *
+		 * @return RbgType& The reference to the DRBG of the calling thread.
+		 */
+		static RbgType& GetThreadInstance()
+		{
+			static thread_local ThreadState sk_state;
+
+			const uint64_t forkGen = Internal::GetForkGeneration();
+
+			if (sk_state.m_rbg == nullptr)
+			{
+				sk_state.m_rbg = Internal::make_unique<RbgType>(
+					Internal::make_unique<Entropy<> >());
+				sk_state.m_forkGen = forkGen;
+			}
+			else if (sk_state.m_forkGen != forkGen)
+			{
+				sk_state.m_rbg->Reseed();
+				sk_state.m_forkGen = forkGen;
+			}
+
+			return *sk_state.m_rbg;
+		}
+
+	public:
+
+		ThreadLocalRbg() = default;
+
+		// LCOV_EXCL_START
+		virtual ~ThreadLocalRbg() = default;
+		// LCOV_EXCL_STOP
+
+		/**
+		 * @brief Fill random bits into the given memory region, using the DRBG
+		 *        owned by the calling thread.
+		 *
+		 * @param buf  The pointer to the beginning of the memory region.
+		 * @param size The size of the memory region.
+		 */
+		virtual void Rand(void* buf, const size_t size) override
+		{
+			GetThreadInstance().Rand(buf, size);
+		}
+
+	private:
+
+		struct ThreadState
+		{
+			std::unique_ptr<RbgType> m_rbg;
+			uint64_t m_forkGen = 0;
+		};
+	};
+
+	/**
+	 * @brief Thread-local RBG backed by per-thread Ctr-DRBGs.
+	 *
+	 */
+	using ThreadLocalCtrDrbg = ThreadLocalRbg<CtrDrbg<> >;
+
+	/**
+	 * @brief Thread-local RBG backed by per-thread Hmac-DRBGs.
+	 *
+	 */
+	using ThreadLocalHmacDrbg = ThreadLocalRbg<HmacDrbg<> >;
+}
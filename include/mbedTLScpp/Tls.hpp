@@ -9,11 +9,22 @@
 
 #include "ObjectBase.hpp"
 
+#include <cstring>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <mbedtls/ssl.h>
 
 #include "Common.hpp"
 #include "Exceptions.hpp"
 #include "TlsConfig.hpp"
+#include "TlsDtls.hpp"
+#include "TlsHandshakeStats.hpp"
+#include "TlsKtls.hpp"
+#include "TlsRecordSizer.hpp"
 #include "TlsSession.hpp"
 
 
@@ -88,7 +99,7 @@ public: // Static members:
 			}
 			else
 			{
-				return ctxTls->m_conn->Send(buf, len);
+				return ctxTls->ConnSend(buf, len);
 			}
 		}
 		catch (const mbedTLSRuntimeError& e)
@@ -123,7 +134,7 @@ public: // Static members:
 			}
 			else
 			{
-				return ctxTls->m_conn->Recv(buf, len);
+				return ctxTls->ConnRecv(buf, len);
 			}
 		}
 		catch (const mbedTLSRuntimeError& e)
@@ -159,7 +170,7 @@ public: // Static members:
 			}
 			else
 			{
-				return ctxTls->m_conn->RecvTimeout(buf, len, t);
+				return ctxTls->ConnRecvTimeout(buf, len, t);
 			}
 		}
 		catch (const mbedTLSRuntimeError& e)
@@ -181,7 +192,16 @@ public:
 	) :
 		_Base::ObjectBase(),
 		m_tlsConfig(tlsConfig),
-		m_conn(std::move(connForHandshake))
+		m_conn(std::move(connForHandshake)),
+		m_peerCert(),
+		m_ktls(),
+		m_hsStats(),
+		m_hsTrace(),
+		m_isHsCounted(false),
+		m_hasHsKeyExchange(false),
+		m_recordSizer(),
+		m_pendingRecordLen(0),
+		m_dtlsTimer()
 	{
 		if (m_tlsConfig == nullptr)
 		{
@@ -207,6 +227,35 @@ public:
 			nullptr
 		);
 
+		m_hsStats = m_tlsConfig->GetHandshakeStats();
+		if (m_hsStats != nullptr)
+		{
+			m_hsTrace = Internal::make_unique<TlsHandshakeTrace>();
+		}
+
+		if (m_tlsConfig->IsDatagram())
+		{
+			// DTLS can't do without a retransmission timer.
+			m_dtlsTimer = Internal::make_unique<TlsDtlsTimer>();
+			mbedtls_ssl_set_timer_cb(
+				NonVirtualGet(),
+				m_dtlsTimer.get(),
+				&TlsDtlsTimer::SetCallBack,
+				&TlsDtlsTimer::GetCallBack
+			);
+		}
+
+		if (m_tlsConfig->IsKtlsOffloadEnabled())
+		{
+			// The secrets must be captured before the handshake starts.
+			m_ktls = Internal::make_unique<TlsKtls>();
+			mbedtls_ssl_set_export_keys_cb(
+				NonVirtualGet(),
+				&TlsKtls::ExportKeysCallBack,
+				m_ktls.get()
+			);
+		}
+
 		if (session)
 		{
 			session->NullCheck();
@@ -227,10 +276,11 @@ public:
 
 		if (m_conn != nullptr)
 		{
-			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			const int mbedRet = HandshakeWaitAsync();
+			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+				mbedRet,
 				Tls::Tls,
-				mbedtls_ssl_handshake,
-				NonVirtualGet()
+				mbedtls_ssl_handshake
 			);
 		}
 	}
@@ -244,7 +294,20 @@ public:
 	Tls(Tls&& rhs) noexcept :
 		_Base::ObjectBase(std::forward<_Base>(rhs)), //noexcept
 		m_tlsConfig(std::move(rhs.m_tlsConfig)),
-		m_conn(std::move(rhs.m_conn))
+		m_conn(std::move(rhs.m_conn)),
+#ifdef __cpp_lib_atomic_shared_ptr
+		m_peerCert(rhs.m_peerCert.exchange(nullptr)),
+#else
+		m_peerCert(std::move(rhs.m_peerCert)),
+#endif
+		m_ktls(std::move(rhs.m_ktls)),
+		m_hsStats(std::move(rhs.m_hsStats)),
+		m_hsTrace(std::move(rhs.m_hsTrace)),
+		m_isHsCounted(rhs.m_isHsCounted),
+		m_hasHsKeyExchange(rhs.m_hasHsKeyExchange),
+		m_recordSizer(std::move(rhs.m_recordSizer)),
+		m_pendingRecordLen(rhs.m_pendingRecordLen),
+		m_dtlsTimer(std::move(rhs.m_dtlsTimer))
 	{
 		RecoverBioPtrs(NonVirtualGet());
 	}
@@ -252,7 +315,13 @@ public:
 	Tls(const Tls& rhs) = delete;
 
 	// LCOV_EXCL_START
-	virtual ~Tls() = default;
+	virtual ~Tls()
+	{
+		// mbedtls_ssl_free may call back into the config (e.g., to cancel a
+		// pending async operation), so free the SSL context while this
+		// instance still holds its reference to the config.
+		FreeBaseObject();
+	}
 	// LCOV_EXCL_STOP
 
 	/**
@@ -264,12 +333,27 @@ public:
 	 */
 	Tls& operator=(Tls&& rhs) noexcept
 	{
-		_Base::operator=(std::forward<_Base>(rhs)); //noexcept
-
 		if (this != &rhs)
 		{
+			// Free the SSL context before its config may be released.
+			FreeBaseObject(); //noexcept
+			_Base::operator=(std::forward<_Base>(rhs)); //noexcept
+
 			m_tlsConfig = std::move(rhs.m_tlsConfig);
 			m_conn = std::move(rhs.m_conn);
+#ifdef __cpp_lib_atomic_shared_ptr
+			m_peerCert.store(rhs.m_peerCert.exchange(nullptr));
+#else
+			m_peerCert = std::move(rhs.m_peerCert);
+#endif
+			m_ktls = std::move(rhs.m_ktls);
+			m_hsStats = std::move(rhs.m_hsStats);
+			m_hsTrace = std::move(rhs.m_hsTrace);
+			m_isHsCounted = rhs.m_isHsCounted;
+			m_hasHsKeyExchange = rhs.m_hasHsKeyExchange;
+			m_recordSizer = std::move(rhs.m_recordSizer);
+			m_pendingRecordLen = rhs.m_pendingRecordLen;
+			m_dtlsTimer = std::move(rhs.m_dtlsTimer);
 
 			RecoverBioPtrs(Get());
 		}
@@ -349,25 +433,150 @@ public:
 		);
 	}
 
-	void Handshake()
+	/**
+	 * @brief Set the host name of the server; on the client side, it's sent
+	 *        to the server as the SNI, and it's checked against the server's
+	 *        certificate. It must be set before the handshake.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param hostname The host name of the server.
+	 */
+	void SetHostname(const std::string& hostname)
+	{
+		NullCheck();
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Tls::SetHostname,
+			mbedtls_ssl_set_hostname,
+			NonVirtualGet(),
+			hostname.c_str()
+		);
+	}
+
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C)
+	/**
+	 * @brief Set the transport-level ID of the client (e.g., its address
+	 *        and port), which the DTLS hello verification cookie is bound
+	 *        to. It's only for DTLS servers, and must be set before the
+	 *        handshake.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param id  The ID of the client.
+	 * @param len The length of the ID, in bytes.
+	 */
+	void SetClientTransportId(const void* id, size_t len)
 	{
 		NullCheck();
 
 		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			Tls::SetClientTransportId,
+			mbedtls_ssl_set_client_transport_id,
+			NonVirtualGet(),
+			static_cast<const unsigned char*>(id),
+			len
+		);
+	}
+#endif // MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_SRV_C
+
+#ifdef MBEDTLS_SSL_PROTO_DTLS
+	/**
+	 * @brief Set the maximum size of the datagrams sent by DTLS (i.e., the
+	 *        path MTU minus the IP and UDP headers), so handshake messages
+	 *        are fragmented instead of being dropped by the network.
+	 *
+	 * @param mtu The maximum datagram size, in bytes; 0 for no limit.
+	 */
+	void SetMtu(uint16_t mtu)
+	{
+		NullCheck();
+
+		mbedtls_ssl_set_mtu(NonVirtualGet(), mtu);
+	}
+#endif // MBEDTLS_SSL_PROTO_DTLS
+
+	/**
+	 * @brief Get the DTLS retransmission timer; while it's running, the
+	 *        non-blocking handshake should be resumed once it expires (see
+	 *        \c TlsDtlsTimer::GetExpiry ), even if nothing was received.
+	 *
+	 * @return The timer; \c nullptr if the transport is not datagram.
+	 */
+	const TlsDtlsTimer* GetDtlsTimer() const noexcept
+	{
+		return m_dtlsTimer.get();
+	}
+
+	/**
+	 * @brief Perform the handshake, and block until it's over; this includes
+	 *        waiting for the private key operations running on the async
+	 *        executor (see \c TlsConfig::SetAsyncPrivKeyExecutor ).
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the handshake failed.
+	 * @exception RuntimeException    Thrown when a private key operation is
+	 *                                queued on an executor that is not
+	 *                                self-driven (see
+	 *                                \c TlsAsyncExecutorIntf::IsSelfDriven ).
+	 */
+	void Handshake()
+	{
+		NullCheck();
+
+		const int mbedRet = HandshakeWaitAsync();
+		MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+			mbedRet,
 			Tls::Handshake,
-			mbedtls_ssl_handshake,
-			Get()
+			mbedtls_ssl_handshake
 		);
 	}
 
+	/**
+	 * @brief Perform the handshake as far as possible, without waiting for
+	 *        the connection, or for the private key operations running on
+	 *        the async executor (see \c TlsConfig::SetAsyncPrivKeyExecutor ).
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the handshake failed.
+	 * @return int \c MBEDTLS_EXIT_SUCCESS if the handshake is over;
+	 *             otherwise, \c MBEDTLS_ERR_SSL_WANT_READ ,
+	 *             \c MBEDTLS_ERR_SSL_WANT_WRITE ,
+	 *             \c MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS , or
+	 *             \c MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS , in which case this
+	 *             function should be called again later (for DTLS, also
+	 *             when the retransmission timer expires; see
+	 *             \c GetDtlsTimer ); or, on DTLS servers,
+	 *             \c MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED , in which case
+	 *             the client has been asked to prove its address, and this
+	 *             context should be discarded (see \c TlsDtlsServerDemux ).
+	 */
+	int HandshakeNonBlocking()
+	{
+		NullCheck();
+
+		const int mbedRet = HandshakeImpl();
+		if (
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_READ) &&
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_WRITE) &&
+			(mbedRet != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) &&
+			(mbedRet != MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS) &&
+			(mbedRet != MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED)
+		)
+		{
+			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+				mbedRet, Tls::HandshakeNonBlocking, mbedtls_ssl_handshake
+			);
+		}
+
+		return mbedRet;
+	}
+
 	void HandshakeStep()
 	{
 		NullCheck();
 
-		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+		const int mbedRet = HandshakeStepImpl();
+		MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+			mbedRet,
 			Tls::Handshake,
-			mbedtls_ssl_handshake_step,
-			Get()
+			mbedtls_ssl_handshake_step
 		);
 	}
 
@@ -388,12 +597,45 @@ public:
 			);
 		}
 
+		if (IsKtlsTxEnabled())
+		{
+			const int retVal = m_ktls->Send(buf, len);
+			if (retVal < 0)
+			{
+				MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+					retVal, Tls::SendData, send
+				);
+			}
+			return retVal;
+		}
+
+		TlsRecordSizer::ClockType::time_point now;
+		if (m_recordSizer != nullptr)
+		{
+			now = TlsRecordSizer::ClockType::now();
+			// After a WANT_WRITE, mbedtls_ssl_write must be given the same
+			// length again, since the record has already been built.
+			const size_t recSize = (m_pendingRecordLen != 0) ?
+				m_pendingRecordLen :
+				m_recordSizer->GetRecordSize(now);
+			len = (len < recSize) ? len : recSize;
+		}
+
 		int retVal = mbedtls_ssl_write(
 			Get(),
 			static_cast<const unsigned char*>(buf),
 			len
 		);
 
+		if (m_recordSizer != nullptr)
+		{
+			m_pendingRecordLen = (retVal == MBEDTLS_ERR_SSL_WANT_WRITE) ? len : 0;
+			if (retVal > 0)
+			{
+				m_recordSizer->OnSent(static_cast<size_t>(retVal), now);
+			}
+		}
+
 		if (retVal < 0)
 		{
 			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
@@ -404,6 +646,33 @@ public:
 		return retVal;
 	}
 
+	/**
+	 * @brief Set the dynamic record sizing policy; with a policy, each call
+	 *        to \c SendData sends at most one record, of the size given by
+	 *        the policy, and returns the number of bytes sent, so the caller
+	 *        must loop until all the data is sent (as it must already do for
+	 *        data longer than the maximum fragment length).
+	 *        It has no effect once the sending is offloaded to the kernel
+	 *        (see \c EnableKtls ).
+	 *
+	 * @param recordSizer The policy; \c nullptr to always fill the records up
+	 *                    to the maximum fragment length (the default).
+	 */
+	void SetRecordSizer(std::unique_ptr<TlsRecordSizer> recordSizer)
+	{
+		m_recordSizer = std::move(recordSizer);
+	}
+
+	/**
+	 * @brief Get the dynamic record sizing policy (see \c SetRecordSizer ).
+	 *
+	 * @return The policy; \c nullptr if there is none.
+	 */
+	TlsRecordSizer* GetRecordSizer() const noexcept
+	{
+		return m_recordSizer.get();
+	}
+
 	int RecvData(void* buf, size_t len)
 	{
 		NullCheck();
@@ -414,6 +683,21 @@ public:
 			);
 		}
 
+		if (IsKtlsRxEnabled())
+		{
+			const int retVal = m_ktls->Recv(buf, len);
+			if (
+				(retVal < 0) &&
+				(retVal != MBEDTLS_ERR_SSL_WANT_READ)
+			)
+			{
+				MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+					retVal, Tls::RecvData, recvmsg
+				);
+			}
+			return retVal;
+		}
+
 		int retVal = mbedtls_ssl_read(
 			Get(),
 			static_cast<unsigned char*>(buf),
@@ -433,6 +717,77 @@ public:
 		return retVal;
 	}
 
+	/**
+	 * @brief Move the record protection of this connection into the kernel
+	 *        (kTLS), once the handshake is over; afterwards, \c SendData and
+	 *        \c RecvData go straight through the socket, and plain data can
+	 *        be sent with \c sendfile as well, if the sending direction is
+	 *        offloaded (see \c IsKtlsTxEnabled ).
+	 *        The kernel offload must be enabled in the TLS config (see
+	 *        \c TlsConfig::SetKtlsOffload ), and all the data received so far
+	 *        must have been read.
+	 *
+	 *        NOTE: If this returns \c true , the receiving direction is
+	 *        with the kernel, and mbed TLS must not read from the connection
+	 *        anymore (e.g., for renegotiation). The sending direction is with
+	 *        the kernel only if \c IsKtlsTxEnabled is also true; otherwise,
+	 *        \c SendData still encrypts through mbed TLS, and writes to the
+	 *        connection given to this instance. If it returns \c false , the
+	 *        connection stays with mbed TLS in both directions, as it was.
+	 *
+	 * @exception InvalidObjectException Thrown when the current instance is
+	 *                                   null.
+	 * @param sock The descriptor of the TCP socket of this connection.
+	 * @return true if (at least the receiving direction of) the connection is
+	 *         offloaded; false if the kernel, the cipher suite, or the
+	 *         platform doesn't support it.
+	 */
+	bool EnableKtls(int sock)
+	{
+		NullCheck();
+
+		if (m_ktls == nullptr)
+		{
+			return false;
+		}
+
+		return m_ktls->Install(sock, *Get());
+	}
+
+	/**
+	 * @brief Check if the kernel encrypts the data sent (see \c EnableKtls ).
+	 *
+	 * @return true if the sending direction is offloaded.
+	 */
+	bool IsKtlsTxEnabled() const noexcept
+	{
+		return (m_ktls != nullptr) && m_ktls->IsTxOffloaded();
+	}
+
+	/**
+	 * @brief Check if the kernel decrypts the data received
+	 *        (see \c EnableKtls ).
+	 *
+	 * @return true if the receiving direction is offloaded.
+	 */
+	bool IsKtlsRxEnabled() const noexcept
+	{
+		return (m_ktls != nullptr) && m_ktls->IsRxOffloaded();
+	}
+
+	/**
+	 * @brief Get the trace of the (first) handshake of this connection; it's
+	 *        only recorded when the TLS config has handshake statistics (see
+	 *        \c TlsConfig::SetHandshakeStats ), to which it's added once the
+	 *        handshake is over.
+	 *
+	 * @return The trace; \c nullptr if the handshake is not traced.
+	 */
+	const TlsHandshakeTrace* GetHandshakeTrace() const noexcept
+	{
+		return m_hsTrace.get();
+	}
+
 	TlsSession GetSession() const
 	{
 		NullCheck();
@@ -488,6 +843,68 @@ public:
 		return _CertType::FromDER(CtnFullR(borrowedDer));
 	}
 
+	/**
+	 * @brief Get the peer's certificate as a shared object.
+	 *        Unlike \c GetPeerCert , the DER is copied once into a buffer
+	 *        that the certificate references (see
+	 *        \c X509Cert::FromDERNoCopy ), rather than being exported and
+	 *        parsed from a copy; and the certificate is parsed once per
+	 *        connection, so repeated calls (e.g., by every request handler
+	 *        for authorization) only share the same object.
+	 *
+	 *        The returned certificate stays valid after this TLS context is
+	 *        gone or has renegotiated. This method may be called by multiple
+	 *        threads at the same time.
+	 *
+	 * @exception InvalidArgumentException Thrown when the peer's certificate
+	 *                                     is not available.
+	 * @exception mbedTLSRuntimeError      Thrown when mbed TLS C function
+	 *                                     call failed.
+	 * @return std::shared_ptr<const X509Cert> The peer's certificate.
+	 */
+	std::shared_ptr<const X509Cert> GetSharedPeerCert() const
+	{
+		const mbedtls_x509_crt& peer = *(BorrowPeerCert().Get());
+
+#ifdef __cpp_lib_atomic_shared_ptr
+		std::shared_ptr<const X509Cert> cachedCert =
+			m_peerCert.load(std::memory_order_acquire);
+#else
+		std::shared_ptr<const X509Cert> cachedCert =
+			std::atomic_load_explicit(&m_peerCert, std::memory_order_acquire);
+#endif
+		if (cachedCert != nullptr)
+		{
+			// The peer may have presented another certificate after
+			// renegotiation.
+			const mbedtls_x509_buf& cached = cachedCert->Get()->raw;
+			if (cached.len == peer.raw.len &&
+				std::memcmp(cached.p, peer.raw.p, cached.len) == 0)
+			{
+				return cachedCert;
+			}
+		}
+
+		std::shared_ptr<const std::vector<uint8_t> > der =
+			std::make_shared<std::vector<uint8_t> >(
+				peer.raw.p, peer.raw.p + peer.raw.len
+			);
+
+		// Concurrent callers may each parse a copy; any of them can be kept.
+		std::shared_ptr<const X509Cert> peerCert = std::make_shared<X509Cert>(
+			X509Cert::FromDERNoCopy(CtnFullR(*der), der)
+		);
+#ifdef __cpp_lib_atomic_shared_ptr
+		m_peerCert.store(peerCert, std::memory_order_release);
+#else
+		std::atomic_store_explicit(
+			&m_peerCert, peerCert, std::memory_order_release
+		);
+#endif
+
+		return peerCert;
+	}
+
 protected:
 
 	const std::unique_ptr<ConnType>& GetConnPtr() const
@@ -524,10 +941,212 @@ protected:
 		}
 	}
 
+	/**
+	 * @brief Make one step of the handshake; same as
+	 *        \c mbedtls_ssl_handshake_step , but also timed and counted, if
+	 *        the handshake is traced (or counted by the metrics).
+	 *
+	 * @return int The return value of \c mbedtls_ssl_handshake_step .
+	 */
+	int HandshakeStepImpl()
+	{
+		mbedtls_ssl_context* ctx = NonVirtualGet();
+		if (!IsSteppingHandshake())
+		{
+			return mbedtls_ssl_handshake_step(ctx);
+		}
+
+		const int state = ctx->MBEDTLS_PRIVATE(state);
+		if (!IsTracingHandshake())
+		{
+			const int mbedRet = mbedtls_ssl_handshake_step(ctx);
+			CountHandshakeStep(state, mbedRet);
+			return mbedRet;
+		}
+
+		const uint64_t ioWaitBefore = m_hsTrace->GetIoWaitTime();
+		const TlsHandshakeTrace::ClockType::time_point start =
+			TlsHandshakeTrace::ClockType::now();
+
+		const int mbedRet = mbedtls_ssl_handshake_step(ctx);
+
+		m_hsTrace->AddStep(
+			state, start, TlsHandshakeTrace::ClockType::now(), ioWaitBefore
+		);
+
+		if (mbedRet == MBEDTLS_EXIT_SUCCESS)
+		{
+			if (mbedtls_ssl_is_handshake_over(ctx))
+			{
+				m_hsTrace->Finish();
+				m_hsStats->Record(*m_hsTrace);
+			}
+		}
+		else if (
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_READ) &&
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_WRITE) &&
+			(mbedRet != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) &&
+			(mbedRet != MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS) &&
+			// Not a failure; the client is asked to prove its address.
+			(mbedRet != MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED)
+		)
+		{
+			m_hsTrace->Finish();
+			m_hsStats->RecordFailure(*m_hsTrace);
+		}
+		CountHandshakeStep(state, mbedRet);
+
+		return mbedRet;
+	}
+
 private:
 
+	int HandshakeWaitAsync()
+	{
+		int mbedRet = HandshakeImpl();
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+		while (mbedRet == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS)
+		{
+			// This is the blocking API, so sleep until the private key
+			// operation running on the async executor is done.
+			Internal::TlsAsyncWait(*NonVirtualGet());
+			mbedRet = HandshakeImpl();
+		}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+		return mbedRet;
+	}
+
+	bool IsTracingHandshake() const noexcept
+	{
+		return (m_hsTrace != nullptr) && !m_hsTrace->IsFinished();
+	}
+
+	bool IsSteppingHandshake() const noexcept
+	{
+#ifdef MBEDTLSCPP_METRICS
+		if (!m_isHsCounted)
+		{
+			return true;
+		}
+#endif // MBEDTLSCPP_METRICS
+		return IsTracingHandshake();
+	}
+
+	int HandshakeImpl()
+	{
+		if (!IsSteppingHandshake())
+		{
+			return mbedtls_ssl_handshake(NonVirtualGet());
+		}
+
+		// Same as mbedtls_ssl_handshake, but one step at a time, so each
+		// step can be timed and counted.
+		int mbedRet = MBEDTLS_EXIT_SUCCESS;
+		while (mbedRet == MBEDTLS_EXIT_SUCCESS &&
+			!mbedtls_ssl_is_handshake_over(NonVirtualGet()))
+		{
+			mbedRet = HandshakeStepImpl();
+		}
+		return mbedRet;
+	}
+
+	void CountHandshakeStep(int state, int mbedRet) noexcept
+	{
+#ifdef MBEDTLSCPP_METRICS
+		mbedtls_ssl_context* ctx = NonVirtualGet();
+
+		// An abbreviated (resumed) TLS 1.2 handshake skips the key exchange.
+		m_hasHsKeyExchange = m_hasHsKeyExchange ||
+			(state == MBEDTLS_SSL_CLIENT_KEY_EXCHANGE);
+
+		if (!m_isHsCounted &&
+			mbedRet == MBEDTLS_EXIT_SUCCESS &&
+			mbedtls_ssl_is_handshake_over(ctx))
+		{
+			m_isHsCounted = true;
+			MBEDTLSCPP_METRICS_COUNT(Handshake, 0);
+			if (!m_hasHsKeyExchange &&
+				mbedtls_ssl_get_version_number(ctx) == MBEDTLS_SSL_VERSION_TLS1_2)
+			{
+				MBEDTLSCPP_METRICS_COUNT(Resumption, 0);
+			}
+		}
+#else
+		(void)state;
+		(void)mbedRet;
+#endif // MBEDTLSCPP_METRICS
+	}
+
+	int ConnSend(const unsigned char* buf, size_t len)
+	{
+		if (!IsTracingHandshake())
+		{
+			return m_conn->Send(buf, len);
+		}
+
+		const TlsHandshakeTrace::ClockType::time_point start =
+			TlsHandshakeTrace::ClockType::now();
+		const int ret = m_conn->Send(buf, len);
+		m_hsTrace->AddIoWait(TlsHandshakeTrace::ClockType::now() - start);
+		if (ret > 0)
+		{
+			m_hsTrace->GetSent().Feed(buf, static_cast<size_t>(ret));
+		}
+		return ret;
+	}
+
+	int ConnRecv(unsigned char* buf, size_t len)
+	{
+		if (!IsTracingHandshake())
+		{
+			return m_conn->Recv(buf, len);
+		}
+
+		const TlsHandshakeTrace::ClockType::time_point start =
+			TlsHandshakeTrace::ClockType::now();
+		const int ret = m_conn->Recv(buf, len);
+		m_hsTrace->AddIoWait(TlsHandshakeTrace::ClockType::now() - start);
+		if (ret > 0)
+		{
+			m_hsTrace->GetRecv().Feed(buf, static_cast<size_t>(ret));
+		}
+		return ret;
+	}
+
+	int ConnRecvTimeout(unsigned char* buf, size_t len, uint32_t t)
+	{
+		if (!IsTracingHandshake())
+		{
+			return m_conn->RecvTimeout(buf, len, t);
+		}
+
+		const TlsHandshakeTrace::ClockType::time_point start =
+			TlsHandshakeTrace::ClockType::now();
+		const int ret = m_conn->RecvTimeout(buf, len, t);
+		m_hsTrace->AddIoWait(TlsHandshakeTrace::ClockType::now() - start);
+		if (ret > 0)
+		{
+			m_hsTrace->GetRecv().Feed(buf, static_cast<size_t>(ret));
+		}
+		return ret;
+	}
+
 	std::shared_ptr<const TlsConfig> m_tlsConfig;
 	std::unique_ptr<ConnType> m_conn;
+#ifdef __cpp_lib_atomic_shared_ptr
+	mutable std::atomic<std::shared_ptr<const X509Cert> > m_peerCert;
+#else
+	// Only accessed through the atomic functions, outside of the moves.
+	mutable std::shared_ptr<const X509Cert> m_peerCert;
+#endif
+	std::unique_ptr<TlsKtls> m_ktls;
+	std::shared_ptr<TlsHandshakeStats> m_hsStats;
+	std::unique_ptr<TlsHandshakeTrace> m_hsTrace;
+	bool m_isHsCounted;
+	bool m_hasHsKeyExchange;
+	std::unique_ptr<TlsRecordSizer> m_recordSizer;
+	size_t m_pendingRecordLen;
+	std::unique_ptr<TlsDtlsTimer> m_dtlsTimer;
 
 }; // class Tls
 
@@ -0,0 +1,688 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "PKey.hpp"
+#include "RandInterfaces.hpp"
+#include "SecretVector.hpp"
+#include "ThreadLocalRbg.hpp"
+
+#include "Internal/make_unique.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The interface of executors that run the private key operations of
+ *        TLS server handshakes (i.e., signing the server key exchange, or
+ *        decrypting the RSA premaster secret) off the connection thread.
+ *        See \c TlsConfig::SetAsyncPrivKeyExecutor .
+ *
+ */
+class TlsAsyncExecutorIntf
+{
+public:
+
+	TlsAsyncExecutorIntf() = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsAsyncExecutorIntf() = default;
+	// LCOV_EXCL_STOP
+
+	/**
+	 * @brief Submit a private key operation. The executor may run the task
+	 *        on any thread at any later time, but every accepted task must be
+	 *        run exactly once.
+	 *
+	 * @param task The task to run.
+	 * @return true if the task is accepted; false if the executor can't take
+	 *         more work, in which case the handshake performs the operation
+	 *         inline, as if no executor were installed.
+	 */
+	virtual bool Submit(std::function<void()> task) = 0;
+
+	/**
+	 * @brief Check if accepted tasks are run without any further call from
+	 *        the user (e.g., by worker threads). Only then can the blocking
+	 *        \c Tls APIs (i.e., \c Tls::Handshake and the connecting
+	 *        constructor) wait for a private key operation; otherwise, they
+	 *        throw, and \c Tls::HandshakeNonBlocking must be used instead.
+	 *
+	 * @return true if tasks are run by the executor itself, otherwise, false.
+	 */
+	virtual bool IsSelfDriven() const noexcept
+	{
+		return false;
+	}
+
+}; // class TlsAsyncExecutorIntf
+
+
+/**
+ * @brief An executor that runs private key operations on a fixed number of
+ *        worker threads. At most \c maxQueueSize operations can be waiting
+ *        for a worker; beyond that, new operations are rejected, and the
+ *        handshakes fall back to inline operations.
+ *        Pending operations are still run when the pool is destroyed.
+ *
+ */
+class TlsAsyncWorkerPool : public TlsAsyncExecutorIntf
+{
+public:
+
+	/**
+	 * @brief Construct a new worker pool, and start the worker threads.
+	 *
+	 * @exception InvalidArgumentException Thrown when \c numOfThreads is zero.
+	 * @exception std::system_error Thrown when a thread can't be started.
+	 * @param numOfThreads The number of worker threads.
+	 * @param maxQueueSize The maximum number of operations waiting for a
+	 *                     worker.
+	 */
+	TlsAsyncWorkerPool(size_t numOfThreads, size_t maxQueueSize) :
+		TlsAsyncExecutorIntf(),
+		m_maxQueueSize(maxQueueSize),
+		m_mutex(),
+		m_cond(),
+		m_queue(),
+		m_isStopping(false),
+		m_workers()
+	{
+		if (numOfThreads == 0)
+		{
+			throw InvalidArgumentException(
+				"TlsAsyncWorkerPool::TlsAsyncWorkerPool"
+				" - The number of threads must be greater than zero."
+			);
+		}
+
+		m_workers.reserve(numOfThreads);
+		try
+		{
+			for (size_t i = 0; i < numOfThreads; ++i)
+			{
+				m_workers.emplace_back(&TlsAsyncWorkerPool::WorkerMain, this);
+			}
+		}
+		catch (...)
+		{
+			Stop();
+			throw;
+		}
+	}
+
+	TlsAsyncWorkerPool(const TlsAsyncWorkerPool& other) = delete;
+	TlsAsyncWorkerPool(TlsAsyncWorkerPool&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsAsyncWorkerPool()
+	{
+		Stop();
+	}
+	// LCOV_EXCL_STOP
+
+	TlsAsyncWorkerPool& operator=(const TlsAsyncWorkerPool& other) = delete;
+	TlsAsyncWorkerPool& operator=(TlsAsyncWorkerPool&& other) = delete;
+
+	virtual bool Submit(std::function<void()> task) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_isStopping || m_queue.size() >= m_maxQueueSize)
+			{
+				return false;
+			}
+			m_queue.push_back(std::move(task));
+		}
+		m_cond.notify_one();
+
+		return true;
+	}
+
+	virtual bool IsSelfDriven() const noexcept override
+	{
+		return true;
+	}
+
+	/**
+	 * @brief Get the number of operations waiting for a worker.
+	 *
+	 * @return size_t The number of waiting operations.
+	 */
+	size_t GetQueueSize() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+	/**
+	 * @brief Get the number of worker threads.
+	 *
+	 * @return size_t The number of worker threads.
+	 */
+	size_t GetNumOfThreads() const noexcept
+	{
+		return m_workers.size();
+	}
+
+private:
+
+	void WorkerMain() noexcept
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true)
+		{
+			m_cond.wait(
+				lock,
+				[this]()
+				{
+					return m_isStopping || !m_queue.empty();
+				}
+			);
+			if (m_queue.empty())
+			{
+				// Stopping, and all pending operations are done.
+				return;
+			}
+
+			std::function<void()> task = std::move(m_queue.front());
+			m_queue.pop_front();
+
+			lock.unlock();
+			try
+			{
+				task();
+			}
+			catch (...)
+			{}
+			lock.lock();
+		}
+	}
+
+	void Stop() noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_cond.notify_all();
+
+		for (std::thread& worker : m_workers)
+		{
+			if (worker.joinable())
+			{
+				worker.join();
+			}
+		}
+		m_workers.clear();
+	}
+
+	size_t m_maxQueueSize;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<std::function<void()> > m_queue;
+	bool m_isStopping;
+	std::vector<std::thread> m_workers;
+
+}; // class TlsAsyncWorkerPool
+
+
+/**
+ * @brief An executor that only queues private key operations; they are run
+ *        when \c RunPending() is called, e.g., by a central loop that
+ *        batches or rate-limits the operations, or forwards them to a
+ *        signing service.
+ *
+ */
+class TlsAsyncDeferredExecutor : public TlsAsyncExecutorIntf
+{
+public:
+
+	TlsAsyncDeferredExecutor() :
+		TlsAsyncExecutorIntf(),
+		m_mutex(),
+		m_queue()
+	{}
+
+	TlsAsyncDeferredExecutor(const TlsAsyncDeferredExecutor& other) = delete;
+	TlsAsyncDeferredExecutor(TlsAsyncDeferredExecutor&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsAsyncDeferredExecutor() = default;
+	// LCOV_EXCL_STOP
+
+	TlsAsyncDeferredExecutor& operator=(const TlsAsyncDeferredExecutor& other) = delete;
+	TlsAsyncDeferredExecutor& operator=(TlsAsyncDeferredExecutor&& other) = delete;
+
+	virtual bool Submit(std::function<void()> task) override
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(std::move(task));
+
+		return true;
+	}
+
+	virtual bool IsSelfDriven() const noexcept override
+	{
+		return false;
+	}
+
+	/**
+	 * @brief Run all operations queued so far on the calling thread.
+	 *
+	 * @return size_t The number of operations run.
+	 */
+	size_t RunPending()
+	{
+		std::deque<std::function<void()> > tasks;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			tasks.swap(m_queue);
+		}
+
+		for (std::function<void()>& task : tasks)
+		{
+			task();
+		}
+
+		return tasks.size();
+	}
+
+	/**
+	 * @brief Get the number of queued operations.
+	 *
+	 * @return size_t The number of queued operations.
+	 */
+	size_t GetPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_queue.size();
+	}
+
+private:
+
+	mutable std::mutex m_mutex;
+	std::deque<std::function<void()> > m_queue;
+
+}; // class TlsAsyncDeferredExecutor
+
+
+namespace Internal
+{
+
+
+/**
+ * @brief Private copies of one private key, for the operations run on the
+ *        async executor. mbed TLS doesn't make a \c mbedtls_pk_context
+ *        safe to use on several threads at once (e.g., an EC key gives its
+ *        group to mbed TLS as non-const), so each running operation takes a
+ *        copy that no other thread uses, and gives it back afterwards.
+ *        There are at most as many copies as operations that ran at the
+ *        same time.
+ *
+ */
+class TlsAsyncPrivKeyCopies
+{
+public:
+
+	/**
+	 * @brief Construct a new set of copies, and make the first copy.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the key can't be copied
+	 *                                (e.g., it's not exportable).
+	 * @param key  The private key.
+	 * @param rand The random bit generator used to parse the copy.
+	 */
+	TlsAsyncPrivKeyCopies(
+		std::shared_ptr<const PKeyBase<> > key,
+		RbgInterface& rand
+	) :
+		m_key(std::move(key)),
+		m_mutex(),
+		m_spares()
+	{
+		m_key->NullCheck();
+		m_spares.push_back(MakeCopy(rand));
+	}
+
+	TlsAsyncPrivKeyCopies(const TlsAsyncPrivKeyCopies& other) = delete;
+	TlsAsyncPrivKeyCopies(TlsAsyncPrivKeyCopies&& other) = delete;
+
+	// LCOV_EXCL_START
+	~TlsAsyncPrivKeyCopies() = default;
+	// LCOV_EXCL_STOP
+
+	TlsAsyncPrivKeyCopies& operator=(const TlsAsyncPrivKeyCopies& other) = delete;
+	TlsAsyncPrivKeyCopies& operator=(TlsAsyncPrivKeyCopies&& other) = delete;
+
+	const std::shared_ptr<const PKeyBase<> >& GetKey() const noexcept
+	{
+		return m_key;
+	}
+
+	/**
+	 * @brief Take a copy for exclusive use; a new copy is made if all of
+	 *        them are in use.
+	 *
+	 * @param rand The random bit generator used to parse a new copy.
+	 * @return The copy; give it back with \c Release .
+	 */
+	std::unique_ptr<PKeyBase<> > Acquire(RbgInterface& rand)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_spares.empty())
+			{
+				std::unique_ptr<PKeyBase<> > copy = std::move(m_spares.back());
+				m_spares.pop_back();
+				return copy;
+			}
+		}
+
+		return MakeCopy(rand);
+	}
+
+	/**
+	 * @brief Give back a copy taken by \c Acquire .
+	 *
+	 * @param copy The copy.
+	 */
+	void Release(std::unique_ptr<PKeyBase<> > copy) noexcept
+	{
+		try
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_spares.push_back(std::move(copy));
+		}
+		catch (...)
+		{
+			// Not kept for reuse; the next operation makes a new copy.
+		}
+	}
+
+private:
+
+	std::unique_ptr<PKeyBase<> > MakeCopy(RbgInterface& rand) const
+	{
+		const SecretVector<uint8_t> der = m_key->GetPrivateDer();
+
+		return Internal::make_unique<PKeyBase<> >(
+			PKeyBase<>::FromDER(CtnFullR(der), rand)
+		);
+	}
+
+	std::shared_ptr<const PKeyBase<> > m_key;
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<PKeyBase<> > > m_spares;
+
+}; // class TlsAsyncPrivKeyCopies
+
+
+/**
+ * @brief The state of one asynchronous private key operation. It's shared by
+ *        the TLS context (through the async operation data) and the task
+ *        given to the executor, so either side can go away first.
+ *
+ */
+class TlsAsyncPrivKeyOp
+{
+public:
+
+	TlsAsyncPrivKeyOp(
+		std::shared_ptr<TlsAsyncPrivKeyCopies> keyCopies,
+		bool isWaitable,
+		bool isSign,
+		mbedtls_md_type_t mdAlg,
+		const unsigned char* input,
+		size_t inputLen
+	) :
+		m_keyCopies(std::move(keyCopies)),
+		m_isWaitable(isWaitable),
+		m_isSign(isSign),
+		m_mdAlg(mdAlg),
+		m_input(input, input + inputLen),
+		m_output(MBEDTLS_PK_SIGNATURE_MAX_SIZE),
+		m_outputLen(0),
+		m_ret(MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS),
+		m_mutex(),
+		m_cond(),
+		m_isDone(false),
+		m_isCancelled(false)
+	{}
+
+	// LCOV_EXCL_START
+	~TlsAsyncPrivKeyOp() = default;
+	// LCOV_EXCL_STOP
+
+	/**
+	 * @brief Run the operation; called by the executor.
+	 *
+	 */
+	void Run() noexcept
+	{
+		if (m_isCancelled.load(std::memory_order_relaxed))
+		{
+			// The handshake is gone; don't waste time on the key operation.
+			m_ret = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+			Finish();
+			return;
+		}
+
+		try
+		{
+			// Executors may run operations on any thread, so use the DRBG
+			// owned by the running thread.
+			ThreadLocalCtrDrbg rbg;
+
+			std::unique_ptr<PKeyBase<> > key = m_keyCopies->Acquire(rbg);
+
+			if (m_isSign)
+			{
+				m_ret = mbedtls_pk_sign(
+					key->Get(),
+					m_mdAlg,
+					m_input.data(),
+					m_input.size(),
+					m_output.data(),
+					m_output.size(),
+					&m_outputLen,
+					&RbgInterface::CallBack,
+					&rbg
+				);
+			}
+			else
+			{
+				m_ret = mbedtls_pk_decrypt(
+					key->Get(),
+					m_input.data(),
+					m_input.size(),
+					m_output.data(),
+					&m_outputLen,
+					m_output.size(),
+					&RbgInterface::CallBack,
+					&rbg
+				);
+			}
+
+			m_keyCopies->Release(std::move(key));
+		}
+		catch (const mbedTLSRuntimeError& e)
+		{
+			m_ret = e.GetErrorCode();
+		}
+		catch (...)
+		{
+			m_ret = MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+		}
+
+		Finish();
+	}
+
+	/**
+	 * @brief Mark the operation as cancelled, so that it won't be run if it
+	 *        hasn't been started yet.
+	 *
+	 */
+	void Cancel() noexcept
+	{
+		m_isCancelled.store(true, std::memory_order_relaxed);
+	}
+
+	bool IsDone() const noexcept
+	{
+		return m_isDone.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Check if the executor runs the operation by itself, so
+	 *        \c Wait can be called.
+	 *
+	 */
+	bool IsWaitable() const noexcept
+	{
+		return m_isWaitable;
+	}
+
+	/**
+	 * @brief Block until the operation is done.
+	 *
+	 */
+	void Wait() const
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cond.wait(
+			lock,
+			[this]()
+			{
+				return IsDone();
+			}
+		);
+	}
+
+	/**
+	 * @brief Get the result of a finished operation.
+	 *
+	 * @param output     The buffer to receive the output.
+	 * @param outputLen  The length of the output.
+	 * @param outputSize The size of the buffer.
+	 * @return int The mbed TLS error code of the operation.
+	 */
+	int GetResult(
+		unsigned char* output,
+		size_t* outputLen,
+		size_t outputSize
+	) const noexcept
+	{
+		if (m_ret != MBEDTLS_EXIT_SUCCESS)
+		{
+			return m_ret;
+		}
+		if (m_outputLen > outputSize)
+		{
+			return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+		}
+
+		std::memcpy(output, m_output.data(), m_outputLen);
+		*outputLen = m_outputLen;
+
+		return MBEDTLS_EXIT_SUCCESS;
+	}
+
+private:
+
+	void Finish() noexcept
+	{
+		{
+			// Hold the lock, so the flag can't change between the check and
+			// the sleep in Wait().
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isDone.store(true, std::memory_order_release);
+		}
+		m_cond.notify_all();
+	}
+
+	std::shared_ptr<TlsAsyncPrivKeyCopies> m_keyCopies;
+	bool m_isWaitable;
+	bool m_isSign;
+	mbedtls_md_type_t m_mdAlg;
+	std::vector<uint8_t> m_input;
+	SecretVector<uint8_t> m_output;
+	size_t m_outputLen;
+	int m_ret;
+	mutable std::mutex m_mutex;
+	mutable std::condition_variable m_cond;
+	std::atomic<bool> m_isDone;
+	std::atomic<bool> m_isCancelled;
+
+}; // class TlsAsyncPrivKeyOp
+
+
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+/**
+ * @brief Block until the private key operation pending on the given TLS
+ *        context is done; used by the blocking handshake after it gets
+ *        \c MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS .
+ *
+ * @exception RuntimeException Thrown when the operation is queued on an
+ *                             executor that is not self-driven (see
+ *                             \c TlsAsyncExecutorIntf::IsSelfDriven ), so
+ *                             waiting for it would never end.
+ * @param ssl The TLS context.
+ */
+inline void TlsAsyncWait(mbedtls_ssl_context& ssl)
+{
+	const std::shared_ptr<TlsAsyncPrivKeyOp>* op =
+		static_cast<const std::shared_ptr<TlsAsyncPrivKeyOp>*>(
+			mbedtls_ssl_get_async_operation_data(&ssl)
+		);
+	if (op == nullptr)
+	{
+		return;
+	}
+
+	if (!(*op)->IsWaitable())
+	{
+		throw RuntimeException(
+			"Internal::TlsAsyncWait - The private key operation is queued on"
+			" an executor that is driven by the caller; use"
+			" Tls::HandshakeNonBlocking instead."
+		);
+	}
+
+	(*op)->Wait();
+}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+
+
+} // namespace Internal
+
+
+} // namespace mbedTLScpp
@@ -8,13 +8,31 @@
 
 #include "ObjectBase.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ciphersuites.h>
 
 #include "Common.hpp"
+#include "CpuFeatures.hpp"
+#include "EcKeyEnum.hpp"
 #include "Exceptions.hpp"
 #include "PKey.hpp"
 #include "RandInterfaces.hpp"
+#include "RevocationIndex.hpp"
+#include "TlsAsyncPrivKey.hpp"
+#include "TlsDtls.hpp"
+#include "TlsHandshakeStats.hpp"
+#include "TlsKtls.hpp"
 #include "TlsSessTktMgrIntf.hpp"
+#include "TlsSniCertTable.hpp"
+#include "TlsVerifyCache.hpp"
+#include "TrustStore.hpp"
 #include "X509Cert.hpp"
 #include "X509Crl.hpp"
 
@@ -36,6 +54,132 @@ enum class TlsVersion : uint8_t
 	Tls1_2_To_1_3 = 23,
 }; // enum class TlsVersion
 
+
+/**
+ * @brief Translate the curve type to the IANA TLS named group ID.
+ *
+ * @exception InvalidArgumentException Thrown when the given curve can't be
+ *                                     used as a TLS named group.
+ * @param type The curve type.
+ * @return constexpr uint16_t The IANA TLS named group ID.
+ */
+inline constexpr uint16_t ToTlsGroupId(EcType type)
+{
+	return
+		(type == EcType::SECP192R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP192R1 :
+		(type == EcType::SECP224R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP224R1 :
+		(type == EcType::SECP256R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1 :
+		(type == EcType::SECP384R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP384R1 :
+		(type == EcType::SECP521R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP521R1 :
+
+		(type == EcType::BrPo256R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_BP256R1 :
+		(type == EcType::BrPo384R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_BP384R1 :
+		(type == EcType::BrPo512R1 ? MBEDTLS_SSL_IANA_TLS_GROUP_BP512R1 :
+
+		(type == EcType::SECP192K1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP192K1 :
+		(type == EcType::SECP224K1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP224K1 :
+		(type == EcType::SECP256K1 ? MBEDTLS_SSL_IANA_TLS_GROUP_SECP256K1 :
+
+		(type == EcType::CURVE25519? MBEDTLS_SSL_IANA_TLS_GROUP_X25519 :
+		(type == EcType::CURVE448  ? MBEDTLS_SSL_IANA_TLS_GROUP_X448 :
+
+		(throw InvalidArgumentException("Invalid Elliptic Curve type is given."))
+
+		)))))))))))));
+}
+
+
+/**
+ * @brief The preferred order of (EC)DHE groups for servers and clients that
+ *        care about handshake cost; X25519 first, since it is several times
+ *        cheaper than P-256, followed by P-256 and P-384 for peers that
+ *        don't support X25519.
+ *
+ * @return const std::vector<EcType>& The preferred order of groups.
+ */
+inline const std::vector<EcType>& GetFastTlsGroupPreference()
+{
+	static const std::vector<EcType> sk_groups = {
+		EcType::CURVE25519,
+		EcType::SECP256R1,
+		EcType::SECP384R1,
+	};
+	return sk_groups;
+}
+
+/**
+ * @brief The preferred order of cipher suites for servers and clients that
+ *        care about bulk encryption cost, on the given CPU. AES-GCM comes
+ *        first when it runs in hardware (AES and carry-less multiplication
+ *        instructions); otherwise, ChaCha20-Poly1305 comes first, since it's
+ *        several times faster than AES-GCM in software. AES-128 is preferred
+ *        over AES-256, since it has fewer rounds. The other suites enabled
+ *        in mbed TLS follow, in mbed TLS's default order, so peers that
+ *        don't support the preferred ones can still connect.
+ *
+ * @param cpu The features of the CPU (see \c GetCpuFeatures ).
+ * @return std::vector<int> The list of cipher suite IDs, most preferred
+ *                          first (without the terminating zero).
+ */
+inline std::vector<int> GetFastTlsCipherSuitePreference(
+	const CpuFeatures& cpu = GetCpuFeatures()
+)
+{
+	static constexpr int sk_aesGcm[] = {
+#ifdef MBEDTLS_SSL_PROTO_TLS1_3
+		MBEDTLS_TLS1_3_AES_128_GCM_SHA256,
+		MBEDTLS_TLS1_3_AES_256_GCM_SHA384,
+#endif
+		MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+		MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+		MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+		MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+	};
+	static constexpr int sk_chachaPoly[] = {
+#ifdef MBEDTLS_SSL_PROTO_TLS1_3
+		MBEDTLS_TLS1_3_CHACHA20_POLY1305_SHA256,
+#endif
+		MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256,
+		MBEDTLS_TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256,
+	};
+
+	std::vector<int> res;
+
+	// Suites disabled in the mbed TLS build are unknown to it, and skipped.
+	auto appendSuites = [&res](const int* begin, const int* end)
+	{
+		for (const int* it = begin; it != end; ++it)
+		{
+			if (mbedtls_ssl_ciphersuite_from_id(*it) != nullptr &&
+				std::find(res.begin(), res.end(), *it) == res.end())
+			{
+				res.push_back(*it);
+			}
+		}
+	};
+
+	if (cpu.HasFastAesGcm())
+	{
+		appendSuites(std::begin(sk_aesGcm), std::end(sk_aesGcm));
+		appendSuites(std::begin(sk_chachaPoly), std::end(sk_chachaPoly));
+	}
+	else
+	{
+		appendSuites(std::begin(sk_chachaPoly), std::end(sk_chachaPoly));
+		appendSuites(std::begin(sk_aesGcm), std::end(sk_aesGcm));
+	}
+
+	const int* defSuites = mbedtls_ssl_list_ciphersuites();
+	const int* defSuitesEnd = defSuites;
+	while (*defSuitesEnd != 0)
+	{
+		++defSuitesEnd;
+	}
+	appendSuites(defSuites, defSuitesEnd);
+
+	return res;
+}
+
 /**
  * @brief TLS Config object allocator.
  *
@@ -75,6 +219,11 @@ public: // Static members:
 	using TlsConfObjTrait = DefaultTlsConfObjTrait;
 	using _Base           = ObjectBase<TlsConfObjTrait>;
 
+	using AsyncKeyCopiesMap = std::unordered_map<
+		const PKeyBase<>*,
+		std::shared_ptr<Internal::TlsAsyncPrivKeyCopies>
+	>;
+
 	/**
 	 * @brief	Certificate verify call back function that is given to the mbed TLS's certificate
 	 * 			verification function call.
@@ -100,13 +249,94 @@ public: // Static members:
 			return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
 		}
 
+		TlsConfig* config = static_cast<TlsConfig*>(inst);
+		int ret = MBEDTLS_ERR_X509_FATAL_ERROR;
 		try
 		{
-			return static_cast<TlsConfig*>(inst)->CustomVerifyCert(
+			config->CheckCertByConfig(*cert, *flag);
+
+			ret = config->CustomVerifyCert(
 				*cert,
 				depth,
 				*flag
 			);
+
+			if (ret == MBEDTLS_EXIT_SUCCESS)
+			{
+				config->RecordVerifyResult(*cert, depth, *flag);
+			}
+		}
+		catch (const mbedTLSRuntimeError& e)
+		{
+			ret = e.GetErrorCode();
+		}
+		catch (...)
+		{
+			ret = MBEDTLS_ERR_X509_FATAL_ERROR;
+		}
+
+		if (ret != MBEDTLS_EXIT_SUCCESS)
+		{
+			// mbed TLS stops calling back; the verification is over.
+			GetVerifyState().Reset();
+		}
+		return ret;
+	}
+
+#ifdef MBEDTLS_SSL_SERVER_NAME_INDICATION
+	/**
+	 * @brief SNI call back function given to mbed TLS, which selects the
+	 *        certificate chain and private key for the requested server name.
+	 *
+	 * @param [in]	inst The pointer to 'this instance'. Must be not null.
+	 * @param [in]	ssl  The TLS context of the handshake.
+	 * @param [in]	name The server name requested by the client.
+	 * @param 		len  The length of the server name.
+	 *
+	 * @return	\c MBEDTLS_EXIT_SUCCESS if a certificate is selected, or the
+	 *          default certificate can be used; otherwise, an error code,
+	 *          which aborts the handshake.
+	 */
+	static int SniCallBack(
+		void* inst,
+		mbedtls_ssl_context* ssl,
+		const unsigned char* name,
+		size_t len
+	) noexcept
+	{
+		if (inst == nullptr ||
+			ssl == nullptr ||
+			(len > 0 && name == nullptr))
+		{
+			return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+		}
+
+		try
+		{
+			const TlsConfig* config = static_cast<const TlsConfig*>(inst);
+
+			const TlsSniCertTable::Entry* entry = nullptr;
+			if (config->m_sniTable != nullptr)
+			{
+				entry = config->m_sniTable->Find(
+					reinterpret_cast<const char*>(name),
+					len
+				);
+			}
+
+			if (entry == nullptr)
+			{
+				// Fall back to the default certificate, if there is one.
+				return config->m_cert != nullptr ?
+					MBEDTLS_EXIT_SUCCESS :
+					MBEDTLS_ERR_SSL_UNRECOGNIZED_NAME;
+			}
+
+			return mbedtls_ssl_set_hs_own_cert(
+				ssl,
+				entry->m_chain->MutableGet(),
+				entry->m_prvKey->MutableGet()
+			);
 		}
 		catch (const mbedTLSRuntimeError& e)
 		{
@@ -114,10 +344,184 @@ public: // Static members:
 		}
 		catch (...)
 		{
+			return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+		}
+	}
+#endif // MBEDTLS_SSL_SERVER_NAME_INDICATION
+
+#ifdef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+	/**
+	 * @brief Trusted CA call back function given to mbed TLS when a
+	 *        verification cache is installed
+	 *        (see \c mbedtls_x509_crt_ca_cb_t ).
+	 *        If the chain starting from \c child has passed verification
+	 *        before, no trusted CA is returned, so mbed TLS only looks for
+	 *        the issuer in the rest of the presented chain; at the top of the
+	 *        chain, \c CertVerifyCallBack then clears the resulting
+	 *        \c MBEDTLS_X509_BADCERT_NOT_TRUSTED flag. Otherwise, the
+	 *        candidates are found in the trusted CAs.
+	 *        The cache key computed here is kept for the rest of the
+	 *        verification (see \c GetVerifyCacheKey ).
+	 *
+	 * @param [in]	inst          The pointer to 'this instance'. Must be not
+	 *                            null.
+	 * @param [in]	child         The certificate whose issuer is looked for.
+	 * @param [out]	candidateCas  Receives the list of candidates.
+	 *
+	 * @return	The mbed TLS error code.
+	 */
+	static int VerifyCacheCaCallBack(
+		void* inst,
+		const mbedtls_x509_crt* child,
+		mbedtls_x509_crt** candidateCas
+	) noexcept
+	{
+		if (inst == nullptr ||
+			child == nullptr ||
+			candidateCas == nullptr)
+		{
+			return MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+		}
+		*candidateCas = nullptr;
+
+		const TlsConfig* config = static_cast<const TlsConfig*>(inst);
+		try
+		{
+			if (config->m_verifyCache != nullptr &&
+				config->m_verifyCache->Contains(
+					config->GetVerifyCacheKey(*child, true)
+				))
+			{
+				return MBEDTLS_EXIT_SUCCESS;
+			}
+		}
+		catch (...)
+		{
+			// mbed TLS aborts the verification without calling back.
+			GetVerifyState().Reset();
 			return MBEDTLS_ERR_X509_FATAL_ERROR;
 		}
+
+		const TrustStore* anchors = config->GetTrustAnchors();
+		const int ret = anchors != nullptr ?
+			TrustStore::CaCallBack(
+				const_cast<TrustStore*>(anchors),
+				child,
+				candidateCas
+			) :
+			MBEDTLS_EXIT_SUCCESS;
+		if (ret != MBEDTLS_EXIT_SUCCESS)
+		{
+			GetVerifyState().Reset();
+		}
+		return ret;
+	}
+#endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+	/**
+	 * @brief Call back function given to mbed TLS to start an asynchronous
+	 *        signing operation; see \c mbedtls_ssl_async_sign_t .
+	 *
+	 */
+	static int AsyncSignCallBack(
+		mbedtls_ssl_context* ssl,
+		mbedtls_x509_crt* cert,
+		mbedtls_md_type_t mdAlg,
+		const unsigned char* hash,
+		size_t hashLen
+	) noexcept
+	{
+		return AsyncStart(ssl, cert, true, mdAlg, hash, hashLen);
+	}
+
+	/**
+	 * @brief Call back function given to mbed TLS to start an asynchronous
+	 *        decryption operation; see \c mbedtls_ssl_async_decrypt_t .
+	 *
+	 */
+	static int AsyncDecryptCallBack(
+		mbedtls_ssl_context* ssl,
+		mbedtls_x509_crt* cert,
+		const unsigned char* input,
+		size_t inputLen
+	) noexcept
+	{
+		return AsyncStart(
+			ssl, cert, false, mbedtls_md_type_t::MBEDTLS_MD_NONE, input, inputLen
+		);
 	}
 
+	/**
+	 * @brief Call back function given to mbed TLS to collect the result of
+	 *        an asynchronous operation; see \c mbedtls_ssl_async_resume_t .
+	 *
+	 * @return \c MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if the operation is still
+	 *         running; otherwise, the result of the operation.
+	 */
+	static int AsyncResumeCallBack(
+		mbedtls_ssl_context* ssl,
+		unsigned char* output,
+		size_t* outputLen,
+		size_t outputSize
+	) noexcept
+	{
+		if (ssl == nullptr ||
+			outputLen == nullptr ||
+			(outputSize > 0 && output == nullptr))
+		{
+			return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+		}
+
+		std::shared_ptr<Internal::TlsAsyncPrivKeyOp>* op =
+			static_cast<std::shared_ptr<Internal::TlsAsyncPrivKeyOp>*>(
+				mbedtls_ssl_get_async_operation_data(ssl)
+			);
+		if (op == nullptr)
+		{
+			return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+		}
+
+		if (!(*op)->IsDone())
+		{
+			return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+		}
+
+		const int mbedRet = (*op)->GetResult(output, outputLen, outputSize);
+
+		mbedtls_ssl_set_async_operation_data(ssl, nullptr);
+		Internal::DelObject(op);
+
+		return mbedRet;
+	}
+
+	/**
+	 * @brief Call back function given to mbed TLS to cancel an asynchronous
+	 *        operation; see \c mbedtls_ssl_async_cancel_t .
+	 *
+	 */
+	static void AsyncCancelCallBack(mbedtls_ssl_context* ssl) noexcept
+	{
+		if (ssl == nullptr)
+		{
+			return;
+		}
+
+		std::shared_ptr<Internal::TlsAsyncPrivKeyOp>* op =
+			static_cast<std::shared_ptr<Internal::TlsAsyncPrivKeyOp>*>(
+				mbedtls_ssl_get_async_operation_data(ssl)
+			);
+		if (op != nullptr)
+		{
+			// The task given to the executor keeps its own reference.
+			(*op)->Cancel();
+
+			mbedtls_ssl_set_async_operation_data(ssl, nullptr);
+			Internal::DelObject(op);
+		}
+	}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+
 	static void SetTlsVersion(
 		typename TlsConfObjTrait::CObjType& obj,
 		TlsVersion ver
@@ -202,7 +606,21 @@ public:
 		m_cert(cert),
 		m_prvKey(prvKey),
 		m_rand(std::move(rand)),
-		m_ticketMgr(ticketMgr)
+		m_ticketMgr(ticketMgr),
+		m_groups(),
+		m_cipherSuites(),
+		m_asyncExecutor(),
+		m_asyncKeyCopies(),
+		m_sniTable(),
+		m_trustStore(),
+		m_caIndex(),
+		m_verifyCache(),
+		m_revocationIndex(),
+		m_crlIndex(),
+		m_crlVersion(crl != nullptr ? Internal::NewX509TrustVersion() : 0),
+		m_isKtlsOffloadEnabled(false),
+		m_hsStats(),
+		m_dtlsCookie()
 	{
 		mbedtls_ssl_conf_rng(
 			NonVirtualGet(),
@@ -311,7 +729,21 @@ public:
 		m_cert(std::move(rhs.m_cert)),          //noexcept
 		m_prvKey(std::move(rhs.m_prvKey)),      //noexcept
 		m_rand(std::move(rhs.m_rand)),          //noexcept
-		m_ticketMgr(std::move(rhs.m_ticketMgr)) //noexcept
+		m_ticketMgr(std::move(rhs.m_ticketMgr)), //noexcept
+		m_groups(std::move(rhs.m_groups)),      //noexcept
+		m_cipherSuites(std::move(rhs.m_cipherSuites)), //noexcept
+		m_asyncExecutor(std::move(rhs.m_asyncExecutor)), //noexcept
+		m_asyncKeyCopies(std::move(rhs.m_asyncKeyCopies)), //noexcept
+		m_sniTable(std::move(rhs.m_sniTable)),  //noexcept
+		m_trustStore(std::move(rhs.m_trustStore)), //noexcept
+		m_caIndex(std::move(rhs.m_caIndex)),    //noexcept
+		m_verifyCache(std::move(rhs.m_verifyCache)), //noexcept
+		m_revocationIndex(std::move(rhs.m_revocationIndex)), //noexcept
+		m_crlIndex(std::move(rhs.m_crlIndex)),  //noexcept
+		m_crlVersion(rhs.m_crlVersion),         //noexcept
+		m_isKtlsOffloadEnabled(rhs.m_isKtlsOffloadEnabled), //noexcept
+		m_hsStats(std::move(rhs.m_hsStats)),    //noexcept
+		m_dtlsCookie(std::move(rhs.m_dtlsCookie)) //noexcept
 	{
 		if (NonVirtualGet() != nullptr)
 		{
@@ -320,6 +752,9 @@ public:
 				&TlsConfig::CertVerifyCallBack,
 				this
 			);
+			RecoverAsyncCallBacks(*NonVirtualGet());
+			RecoverSniCallBack(*NonVirtualGet());
+			RecoverTrustCallBack(*NonVirtualGet());
 		}
 	}
 
@@ -348,6 +783,20 @@ public:
 			m_prvKey    = std::move(rhs.m_prvKey);    //noexcept
 			m_rand      = std::move(rhs.m_rand);      //noexcept
 			m_ticketMgr = std::move(rhs.m_ticketMgr); //noexcept
+			m_groups    = std::move(rhs.m_groups);    //noexcept
+			m_cipherSuites = std::move(rhs.m_cipherSuites); //noexcept
+			m_asyncExecutor = std::move(rhs.m_asyncExecutor); //noexcept
+			m_asyncKeyCopies = std::move(rhs.m_asyncKeyCopies); //noexcept
+			m_sniTable  = std::move(rhs.m_sniTable);  //noexcept
+			m_trustStore = std::move(rhs.m_trustStore); //noexcept
+			m_caIndex   = std::move(rhs.m_caIndex);   //noexcept
+			m_verifyCache = std::move(rhs.m_verifyCache); //noexcept
+			m_revocationIndex = std::move(rhs.m_revocationIndex); //noexcept
+			m_crlIndex    = std::move(rhs.m_crlIndex);    //noexcept
+			m_crlVersion  = rhs.m_crlVersion;         //noexcept
+			m_isKtlsOffloadEnabled = rhs.m_isKtlsOffloadEnabled; //noexcept
+			m_hsStats     = std::move(rhs.m_hsStats);     //noexcept
+			m_dtlsCookie  = std::move(rhs.m_dtlsCookie);  //noexcept
 
 			if (Get() != nullptr)
 			{
@@ -356,6 +805,9 @@ public:
 					&TlsConfig::CertVerifyCallBack,
 					this
 				);
+				RecoverAsyncCallBacks(*Get());
+				RecoverSniCallBack(*Get());
+				RecoverTrustCallBack(*Get());
 			}
 		}
 
@@ -416,13 +868,945 @@ public:
 		return MBEDTLS_EXIT_SUCCESS;
 	}
 
+	/**
+	 * @brief Set the (EC)DHE groups offered or accepted during handshakes,
+	 *        in the order of preference.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given list is empty,
+	 *                                     or contains a curve that can't be
+	 *                                     used as a TLS named group.
+	 * @param groups The list of groups, most preferred first
+	 *               (e.g., \c GetFastTlsGroupPreference() ).
+	 */
+	void SetGroups(const std::vector<EcType>& groups)
+	{
+		NullCheck();
+
+		if (groups.empty())
+		{
+			throw InvalidArgumentException(
+				"TlsConfig::SetGroups - The list of groups is empty."
+			);
+		}
+
+		std::vector<uint16_t> groupIds;
+		groupIds.reserve(groups.size() + 1);
+		for (const EcType group : groups)
+		{
+			groupIds.push_back(ToTlsGroupId(group));
+		}
+		groupIds.push_back(MBEDTLS_SSL_IANA_TLS_GROUP_NONE);
+
+		// mbed TLS only keeps the pointer, so the list must live as long as
+		// this config.
+		m_groups = std::move(groupIds);
+		mbedtls_ssl_conf_groups(NonVirtualGet(), m_groups.data());
+	}
+
+	/**
+	 * @brief Set the cipher suites offered or accepted during handshakes,
+	 *        in the order of preference; it replaces the list chosen by the
+	 *        preset given to the constructor.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given list is empty,
+	 *                                     or contains a suite that is unknown
+	 *                                     to (or disabled in) mbed TLS.
+	 * @param suites The list of cipher suite IDs, most preferred first
+	 *               (e.g., \c GetFastTlsCipherSuitePreference() ).
+	 */
+	void SetCipherSuites(const std::vector<int>& suites)
+	{
+		NullCheck();
+
+		if (suites.empty())
+		{
+			throw InvalidArgumentException(
+				"TlsConfig::SetCipherSuites - The list of cipher suites is empty."
+			);
+		}
+
+		std::vector<int> suiteIds;
+		suiteIds.reserve(suites.size() + 1);
+		for (const int suite : suites)
+		{
+			if (mbedtls_ssl_ciphersuite_from_id(suite) == nullptr)
+			{
+				throw InvalidArgumentException(
+					"TlsConfig::SetCipherSuites - Unknown cipher suite is given."
+				);
+			}
+			suiteIds.push_back(suite);
+		}
+		suiteIds.push_back(0);
+
+		// mbed TLS only keeps the pointer, so the list must live as long as
+		// this config.
+		m_cipherSuites = std::move(suiteIds);
+		mbedtls_ssl_conf_ciphersuites(NonVirtualGet(), m_cipherSuites.data());
+	}
+
+	/**
+	 * @brief Get the cipher suites currently offered or accepted, in the
+	 *        order of preference (i.e., the ones chosen by the preset given
+	 *        to the constructor, unless they have been changed since).
+	 *
+	 * @return std::vector<int> The list of cipher suite IDs, most preferred
+	 *                          first (without the terminating zero).
+	 */
+	std::vector<int> GetCipherSuites() const
+	{
+		NullCheck();
+
+		std::vector<int> res;
+		const int* suites = Get()->MBEDTLS_PRIVATE(ciphersuite_list);
+		for (; suites != nullptr && *suites != 0; ++suites)
+		{
+			res.push_back(*suites);
+		}
+		return res;
+	}
+
+	/**
+	 * @brief Get the (EC)DHE groups currently offered or accepted, in the
+	 *        order of preference.
+	 *
+	 * @return std::vector<uint16_t> The list of IANA TLS named group IDs,
+	 *                               most preferred first (without the
+	 *                               terminating \c MBEDTLS_SSL_IANA_TLS_GROUP_NONE ).
+	 */
+	std::vector<uint16_t> GetGroups() const
+	{
+		NullCheck();
+
+		std::vector<uint16_t> res;
+		const uint16_t* groups = Get()->MBEDTLS_PRIVATE(group_list);
+		for (; groups != nullptr && *groups != MBEDTLS_SSL_IANA_TLS_GROUP_NONE;
+			++groups)
+		{
+			res.push_back(*groups);
+		}
+		return res;
+	}
+
+	/**
+	 * @brief Reorder the current cipher suites and groups (see
+	 *        \c GetCipherSuites and \c GetGroups ), so the ones that are the
+	 *        fastest on the given CPU come first (see
+	 *        \c GetFastTlsCipherSuitePreference and
+	 *        \c GetFastTlsGroupPreference ). Nothing is added or removed, so
+	 *        a restrictive preset (e.g., \c MBEDTLS_SSL_PRESET_SUITEB ) stays
+	 *        as restrictive as it was.
+	 *
+	 * @param cpu The features of the CPU; by default, the ones of the CPU
+	 *            running this code.
+	 */
+	void SetFastPreference(const CpuFeatures& cpu = GetCpuFeatures())
+	{
+		NullCheck();
+
+		const std::vector<int> curSuites = GetCipherSuites();
+		if (!curSuites.empty())
+		{
+			std::vector<int> suites;
+			suites.reserve(curSuites.size());
+			for (const int suite : GetFastTlsCipherSuitePreference(cpu))
+			{
+				if (std::find(curSuites.begin(), curSuites.end(), suite) !=
+					curSuites.end())
+				{
+					suites.push_back(suite);
+				}
+			}
+			for (const int suite : curSuites)
+			{
+				if (std::find(suites.begin(), suites.end(), suite) ==
+					suites.end())
+				{
+					suites.push_back(suite);
+				}
+			}
+			SetCipherSuites(suites);
+		}
+
+		const std::vector<uint16_t> curGroups = GetGroups();
+		if (!curGroups.empty())
+		{
+			std::vector<uint16_t> groupIds;
+			groupIds.reserve(curGroups.size() + 1);
+			for (const EcType group : GetFastTlsGroupPreference())
+			{
+				const uint16_t groupId = ToTlsGroupId(group);
+				if (std::find(curGroups.begin(), curGroups.end(), groupId) !=
+					curGroups.end())
+				{
+					groupIds.push_back(groupId);
+				}
+			}
+			for (const uint16_t groupId : curGroups)
+			{
+				if (std::find(groupIds.begin(), groupIds.end(), groupId) ==
+					groupIds.end())
+				{
+					groupIds.push_back(groupId);
+				}
+			}
+			groupIds.push_back(MBEDTLS_SSL_IANA_TLS_GROUP_NONE);
+
+			m_groups = std::move(groupIds);
+			mbedtls_ssl_conf_groups(NonVirtualGet(), m_groups.data());
+		}
+	}
+
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+	/**
+	 * @brief Install an executor for the private key operations of server
+	 *        handshakes. Once installed, \c Tls::HandshakeNonBlocking reports
+	 *        \c MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS while the operation is
+	 *        running on the executor, instead of blocking the connection
+	 *        thread. Operations that the executor rejects, or that use a key
+	 *        unknown to this config, are performed inline.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param executor The executor; \c nullptr to perform all operations inline.
+	 */
+	void SetAsyncPrivKeyExecutor(std::shared_ptr<TlsAsyncExecutorIntf> executor)
+	{
+		NullCheck();
+
+		m_asyncExecutor = std::move(executor);
+		RebuildAsyncKeyCopies();
+		RecoverAsyncCallBacks(*NonVirtualGet());
+	}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+
+#ifdef MBEDTLS_SSL_SERVER_NAME_INDICATION
+	/**
+	 * @brief Select the certificate chain and private key by the server
+	 *        name the client requests (SNI). Names that aren't in the table
+	 *        are served with the certificate given to the constructor; if
+	 *        there is none, such handshakes are aborted.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param table The table of server names; \c nullptr to disable SNI
+	 *              based selection.
+	 */
+	void SetSniCertTable(std::shared_ptr<const TlsSniCertTable> table)
+	{
+		NullCheck();
+
+		m_sniTable = std::move(table);
+		RebuildAsyncKeyCopies();
+		RecoverSniCallBack(*NonVirtualGet());
+	}
+#endif // MBEDTLS_SSL_SERVER_NAME_INDICATION
+
+	/**
+	 * @brief Check the peer's certificates against the given revocation
+	 *        index, instead of the CRL given to the constructor; the CRL is
+	 *        then no longer given to mbed TLS, which scans the revoked entries
+	 *        linearly for every certificate.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param index The revocation index; \c nullptr to go back to the CRL
+	 *              given to the constructor (if any).
+	 */
+	void SetRevocationIndex(std::shared_ptr<const RevocationIndex> index)
+	{
+		NullCheck();
+
+		m_revocationIndex = std::move(index);
+		ApplyTrustSettings();
+	}
+
+#ifdef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+	/**
+	 * @brief Verify the peer's certificate against the given trust store,
+	 *        instead of the CA chain given to the constructor; the issuers
+	 *        are then found by hash lookups, rather than by a linear scan
+	 *        over the CA chain. Peer verification becomes required.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 *        NOTE: mbed TLS doesn't check CRLs for the CAs found through the
+	 *        callback; instead, the certificates are checked against the
+	 *        revocation index (see \c SetRevocationIndex ), or an index built
+	 *        from the CRL given to the constructor, by \c CertVerifyCallBack ,
+	 *        while the signatures of the CRL are not verified.
+	 *
+	 * @param store The trust store; \c nullptr to go back to the CA chain
+	 *              given to the constructor (if any).
+	 */
+	void SetTrustStore(std::shared_ptr<const TrustStore> store)
+	{
+		NullCheck();
+
+		if (store != nullptr)
+		{
+			mbedtls_ssl_conf_authmode(
+				NonVirtualGet(),
+				MBEDTLS_SSL_VERIFY_REQUIRED
+			);
+		}
+
+		m_trustStore = std::move(store);
+		ApplyTrustSettings();
+	}
+
+	/**
+	 * @brief Cache the certificate chains presented by peers that have
+	 *        passed verification. When a peer presents a cached chain again,
+	 *        the top of the presented chain is accepted without looking it
+	 *        up in the trusted CAs, so the lookup and the signature check by
+	 *        the CA are skipped. mbed TLS still walks the whole presented
+	 *        chain, and checks the signature of every link in it, as well as
+	 *        the validity period, the key usage, and the CRL of every
+	 *        presented certificate.
+	 *        The cache key includes the versions of the trusted CAs and the
+	 *        CRL, so the cached results are not used once they change.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @exception InvalidArgumentException Thrown when there is no trusted CA
+	 *                                     to verify against.
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param cache The cache, which may be shared by multiple configs;
+	 *              \c nullptr to disable caching.
+	 */
+	void SetVerifyCache(std::shared_ptr<TlsVerifyCache> cache)
+	{
+		NullCheck();
+
+		if (cache != nullptr && m_caIndex == nullptr)
+		{
+			if (m_ca == nullptr && m_trustStore == nullptr)
+			{
+				throw InvalidArgumentException(
+					"TlsConfig::SetVerifyCache"
+					" - Trusted CAs are required to verify peers."
+				);
+			}
+
+			if (m_ca != nullptr)
+			{
+				// The CA chain is indexed as well, since the CAs will be
+				// given through the callback.
+				std::shared_ptr<TrustStore> caIndex =
+					std::make_shared<TrustStore>();
+				caIndex->Add(*m_ca);
+				m_caIndex = std::move(caIndex);
+			}
+		}
+
+		m_verifyCache = std::move(cache);
+		ApplyTrustSettings();
+	}
+#endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+
+	/**
+	 * @brief Let the TLS connections using this config capture their traffic
+	 *        secrets during the handshake, so that the record protection can
+	 *        be moved into the kernel afterwards (see \c Tls::EnableKtls ).
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @param enable Whether to enable the kernel TLS offload.
+	 */
+	void SetKtlsOffload(bool enable)
+	{
+		NullCheck();
+
+		m_isKtlsOffloadEnabled = enable && TlsKtls::IsSupported();
+	}
+
+	/**
+	 * @brief Check if the kernel TLS offload is enabled
+	 *        (see \c SetKtlsOffload ).
+	 *
+	 * @return true if it's enabled and supported on this platform.
+	 */
+	bool IsKtlsOffloadEnabled() const noexcept
+	{
+		return m_isKtlsOffloadEnabled;
+	}
+
+	/**
+	 * @brief Check if this config is for DTLS (i.e., it was constructed with
+	 *        \c isStream being \c false ).
+	 *
+	 * @return true if the transport is datagram.
+	 */
+	bool IsDatagram() const
+	{
+		NullCheck();
+
+		return Get()->MBEDTLS_PRIVATE(transport) ==
+			MBEDTLS_SSL_TRANSPORT_DATAGRAM;
+	}
+
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_COOKIE_C)
+	/**
+	 * @brief Set the cookies used by DTLS servers for the hello
+	 *        verification; a DTLS server needs either cookies, or the hello
+	 *        verification disabled, to accept any handshake.
+	 *        This should be called before the config is used by any TLS
+	 *        connection.
+	 *
+	 * @param cookie The cookies, which may be shared by multiple configs;
+	 *               \c nullptr to disable the hello verification (only
+	 *               acceptable if the addresses of clients can't be spoofed).
+	 */
+	void SetDtlsCookie(std::shared_ptr<TlsDtlsCookie> cookie)
+	{
+		NullCheck();
+
+		if (cookie != nullptr)
+		{
+			cookie->NullCheck();
+
+			mbedtls_ssl_conf_dtls_cookies(
+				NonVirtualGet(),
+				&mbedtls_ssl_cookie_write,
+				&mbedtls_ssl_cookie_check,
+				cookie->Get()
+			);
+		}
+		else
+		{
+			mbedtls_ssl_conf_dtls_cookies(
+				NonVirtualGet(), nullptr, nullptr, nullptr
+			);
+		}
+
+		m_dtlsCookie = std::move(cookie);
+	}
+#endif // MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_COOKIE_C
+
+#ifdef MBEDTLS_SSL_PROTO_DTLS
+	/**
+	 * @brief Set the range of the DTLS retransmission timeout; it starts at
+	 *        the minimum, and doubles after each retransmission, until the
+	 *        maximum is reached, after which the handshake fails with
+	 *        \c MBEDTLS_ERR_SSL_TIMEOUT .
+	 *
+	 * @param minMs The initial timeout, in milliseconds (1000 by default).
+	 * @param maxMs The maximum timeout, in milliseconds (60000 by default).
+	 */
+	void SetDtlsHandshakeTimeout(uint32_t minMs, uint32_t maxMs)
+	{
+		NullCheck();
+
+		if (minMs == 0 || maxMs < minMs)
+		{
+			throw InvalidArgumentException(
+				"TlsConfig::SetDtlsHandshakeTimeout - Invalid timeout range."
+			);
+		}
+
+		mbedtls_ssl_conf_handshake_timeout(NonVirtualGet(), minMs, maxMs);
+	}
+#endif // MBEDTLS_SSL_PROTO_DTLS
+
+	/**
+	 * @brief Trace the handshakes of the TLS connections using this config,
+	 *        and aggregate the traces into the given statistics. Without
+	 *        statistics, the handshakes are not traced at all.
+	 *        This should be called before the config is used by any TLS
+	 *        connection; connections pick up the statistics when they are
+	 *        constructed.
+	 *
+	 * @param stats The statistics, which may be shared by multiple configs;
+	 *              \c nullptr to disable the tracing.
+	 */
+	void SetHandshakeStats(std::shared_ptr<TlsHandshakeStats> stats)
+	{
+		NullCheck();
+
+		m_hsStats = std::move(stats);
+	}
+
+	/**
+	 * @brief Get the handshake statistics (see \c SetHandshakeStats ).
+	 *
+	 * @return The statistics; \c nullptr if the tracing is disabled.
+	 */
+	std::shared_ptr<TlsHandshakeStats> GetHandshakeStats() const noexcept
+	{
+		return m_hsStats;
+	}
+
+protected:
+
+	/**
+	 * @brief Get the private key that pairs with the given certificate of
+	 *        this side, for asynchronous private key operations. Only the
+	 *        keys given to this config (directly, or through the SNI table)
+	 *        are used on the executor; operations with any other key are
+	 *        performed inline.
+	 *
+	 * @param cert The certificate chosen for the handshake.
+	 * @return The private key; \c nullptr if it's unknown to this config.
+	 */
+	virtual std::shared_ptr<const PKeyBase<> > GetAsyncPrivKey(
+		const mbedtls_x509_crt& cert
+	) const
+	{
+		if (m_cert != nullptr && m_cert->Get() == &cert)
+		{
+			return m_prvKey;
+		}
+		if (m_sniTable != nullptr)
+		{
+			return m_sniTable->FindPrivKey(cert);
+		}
+		return nullptr;
+	}
+
+	/**
+	 * @brief Make the private copies of the keys used on the executor (see
+	 *        \c Internal::TlsAsyncPrivKeyCopies ), so that the operations
+	 *        running on the executor never share a key with each other, or
+	 *        with the handshakes performing operations inline.
+	 *        Keys that can't be exported (e.g., opaque keys) get no copies,
+	 *        and their operations are performed inline.
+	 *
+	 */
+	void RebuildAsyncKeyCopies()
+	{
+		AsyncKeyCopiesMap keyCopies;
+
+		if (m_asyncExecutor != nullptr)
+		{
+			if (m_prvKey != nullptr)
+			{
+				AddAsyncKeyCopies(keyCopies, m_prvKey);
+			}
+			if (m_sniTable != nullptr)
+			{
+				for (const auto& certKey : m_sniTable->GetPrivKeys())
+				{
+					AddAsyncKeyCopies(keyCopies, certKey.second);
+				}
+			}
+		}
+
+		m_asyncKeyCopies.swap(keyCopies);
+	}
+
 	private:
+
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+		static int AsyncStart(
+			mbedtls_ssl_context* ssl,
+			mbedtls_x509_crt* cert,
+			bool isSign,
+			mbedtls_md_type_t mdAlg,
+			const unsigned char* input,
+			size_t inputLen
+		) noexcept
+		{
+			if (ssl == nullptr ||
+				cert == nullptr ||
+				(inputLen > 0 && input == nullptr))
+			{
+				return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+			}
+
+			try
+			{
+				const TlsConfig* inst = static_cast<const TlsConfig*>(
+					mbedtls_ssl_conf_get_async_config_data(
+						mbedtls_ssl_context_get_config(ssl)
+					)
+				);
+				if (inst == nullptr || inst->m_asyncExecutor == nullptr)
+				{
+					return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+				}
+
+				std::shared_ptr<const PKeyBase<> > key =
+					inst->GetAsyncPrivKey(*cert);
+				if (key == nullptr)
+				{
+					return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+				}
+
+				AsyncKeyCopiesMap::const_iterator keyCopies =
+					inst->m_asyncKeyCopies.find(key.get());
+				if (keyCopies == inst->m_asyncKeyCopies.end())
+				{
+					return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+				}
+
+				std::shared_ptr<Internal::TlsAsyncPrivKeyOp> op =
+					std::make_shared<Internal::TlsAsyncPrivKeyOp>(
+						keyCopies->second,
+						inst->m_asyncExecutor->IsSelfDriven(),
+						isSign,
+						mdAlg,
+						input,
+						inputLen
+					);
+
+				if (!inst->m_asyncExecutor->Submit(
+						[op]()
+						{
+							op->Run();
+						}
+					))
+				{
+					return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+				}
+
+				mbedtls_ssl_set_async_operation_data(
+					ssl,
+					Internal::NewObject<
+						std::shared_ptr<Internal::TlsAsyncPrivKeyOp>
+					>(std::move(op))
+				);
+
+				return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+			}
+			catch (const mbedTLSRuntimeError& e)
+			{
+				return e.GetErrorCode();
+			}
+			catch (...)
+			{
+				return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+			}
+		}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+
+		void AddAsyncKeyCopies(
+			AsyncKeyCopiesMap& keyCopies,
+			const std::shared_ptr<const PKeyBase<> >& key
+		)
+		{
+			if (keyCopies.find(key.get()) != keyCopies.end())
+			{
+				return;
+			}
+
+			try
+			{
+				keyCopies.emplace(
+					key.get(),
+					std::make_shared<Internal::TlsAsyncPrivKeyCopies>(
+						key, *m_rand
+					)
+				);
+			}
+			catch (const mbedTLSRuntimeError&)
+			{
+				// The key can't be copied; use it inline.
+			}
+		}
+
+		void RecoverAsyncCallBacks(typename TlsConfObjTrait::CObjType& obj) noexcept
+		{
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+			if (m_asyncExecutor != nullptr)
+			{
+				mbedtls_ssl_conf_async_private_cb(
+					&obj,
+					&TlsConfig::AsyncSignCallBack,
+					&TlsConfig::AsyncDecryptCallBack,
+					&TlsConfig::AsyncResumeCallBack,
+					&TlsConfig::AsyncCancelCallBack,
+					this
+				);
+			}
+			else
+			{
+				mbedtls_ssl_conf_async_private_cb(
+					&obj, nullptr, nullptr, nullptr, nullptr, nullptr
+				);
+			}
+#else
+			(void)obj;
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+		}
+
+		struct VerifyState
+		{
+			std::vector<const mbedtls_x509_crt*> m_chain;
+			std::vector<
+				std::pair<const mbedtls_x509_crt*, std::string>
+			> m_cacheKeys;
+			uint32_t m_flags = 0;
+			bool m_isCacheHit = false;
+
+			void Reset() noexcept
+			{
+				m_chain.clear();
+				m_cacheKeys.clear();
+				m_flags = 0;
+				m_isCacheHit = false;
+			}
+		}; // struct VerifyState
+
+		/**
+		 * @brief Get the state of the verification running on this thread;
+		 *        mbed TLS calls back for every certificate of a chain in a
+		 *        row, from the top to the leaf (i.e., depth 0).
+		 *
+		 */
+		static VerifyState& GetVerifyState() noexcept
+		{
+			static thread_local VerifyState sk_state;
+			return sk_state;
+		}
+
+		bool IsUsingCaCallBack() const noexcept
+		{
+			return m_verifyCache != nullptr || m_trustStore != nullptr;
+		}
+
+		const TrustStore* GetTrustAnchors() const noexcept
+		{
+			return m_trustStore != nullptr ?
+				m_trustStore.get() :
+				m_caIndex.get();
+		}
+
+		std::string MakeVerifyCacheKey(const mbedtls_x509_crt& chain) const
+		{
+			const TrustStore* anchors = GetTrustAnchors();
+			const RevocationIndex* revIndex = GetActiveRevocationIndex();
+			return TlsVerifyCache::MakeKey(
+				chain,
+				anchors != nullptr ? anchors->GetVersion() : 0,
+				revIndex != nullptr ? revIndex->GetVersion() : m_crlVersion
+			);
+		}
+
+		/**
+		 * @brief Get the cache key of the chain starting from the given
+		 *        certificate, computed at most once per verification.
+		 *        mbed TLS calls \c VerifyCacheCaCallBack for every presented
+		 *        certificate that the verify callbacks look up later, so the
+		 *        CA callback recomputes the key (\c isFresh ), and the verify
+		 *        callbacks reuse it; a key left behind by an aborted
+		 *        verification is never reused.
+		 *
+		 * @param chain   The chain, starting from the certificate given.
+		 * @param isFresh Whether to compute the key, even if it's already
+		 *                known.
+		 */
+		const std::string& GetVerifyCacheKey(
+			const mbedtls_x509_crt& chain,
+			bool isFresh
+		) const
+		{
+			VerifyState& state = GetVerifyState();
+			for (auto& item : state.m_cacheKeys)
+			{
+				if (item.first == &chain)
+				{
+					if (isFresh)
+					{
+						item.second = MakeVerifyCacheKey(chain);
+					}
+					return item.second;
+				}
+			}
+
+			state.m_cacheKeys.emplace_back(&chain, MakeVerifyCacheKey(chain));
+			return state.m_cacheKeys.back().second;
+		}
+
+		/**
+		 * @brief Get the revocation index that the certificates are checked
+		 *        against by \c CertVerifyCallBack ; \c nullptr if the CRL
+		 *        (if any) is checked by mbed TLS.
+		 *
+		 */
+		const RevocationIndex* GetActiveRevocationIndex() const noexcept
+		{
+			if (m_revocationIndex != nullptr)
+			{
+				return m_revocationIndex.get();
+			}
+			return IsUsingCaCallBack() ? m_crlIndex.get() : nullptr;
+		}
+
+		/**
+		 * @brief Apply the checks that are done by this config instead of
+		 *        mbed TLS; i.e., check the certificate against the revocation
+		 *        index, and accept the top of a chain that has been verified
+		 *        before.
+		 *
+		 */
+		void CheckCertByConfig(
+			const mbedtls_x509_crt& cert,
+			uint32_t& flag
+		) const
+		{
+			const RevocationIndex* revIndex = GetActiveRevocationIndex();
+			if (revIndex != nullptr && revIndex->IsRevoked(cert))
+			{
+				flag |= MBEDTLS_X509_BADCERT_REVOKED;
+			}
+
+			if (m_verifyCache != nullptr &&
+				(flag & MBEDTLS_X509_BADCERT_NOT_TRUSTED) &&
+				m_verifyCache->Contains(GetVerifyCacheKey(cert, false)))
+			{
+				flag &= ~static_cast<uint32_t>(MBEDTLS_X509_BADCERT_NOT_TRUSTED);
+				GetVerifyState().m_isCacheHit = true;
+			}
+		}
+
+		/**
+		 * @brief Record the verification result of a certificate; once the
+		 *        leaf is reached, and the whole chain has passed, cache every
+		 *        presented part of the chain that mbed TLS has verified.
+		 *
+		 */
+		void RecordVerifyResult(
+			const mbedtls_x509_crt& cert,
+			int depth,
+			uint32_t flag
+		) const
+		{
+			if (m_verifyCache == nullptr)
+			{
+				return;
+			}
+
+			VerifyState& state = GetVerifyState();
+			state.m_chain.push_back(&cert);
+			state.m_flags |= flag;
+
+			if (depth != 0)
+			{
+				return;
+			}
+
+			// Results derived from the cache are not cached again, so the
+			// time to live counts from the full verification.
+			if (state.m_flags == 0 && !state.m_isCacheHit)
+			{
+				for (const mbedtls_x509_crt* node = &cert;
+					node != nullptr;
+					node = node->next)
+				{
+					if (std::find(
+							state.m_chain.begin(),
+							state.m_chain.end(),
+							node
+						) != state.m_chain.end())
+					{
+						m_verifyCache->Insert(GetVerifyCacheKey(*node, false));
+					}
+				}
+			}
+
+			state.Reset();
+		}
+
+		/**
+		 * @brief Register the CA callback, or the CA chain, according to the
+		 *        trust settings.
+		 *
+		 */
+		void ApplyTrustSettings()
+		{
+			if (IsUsingCaCallBack())
+			{
+				if (m_crl != nullptr && m_crlIndex == nullptr)
+				{
+					m_crlIndex = std::make_shared<RevocationIndex>(*m_crl);
+				}
+				RecoverTrustCallBack(*NonVirtualGet());
+			}
+			else
+			{
+#ifdef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+				// Setting the CA callback clears the CA chain; restore it.
+				mbedtls_ssl_conf_ca_cb(NonVirtualGet(), nullptr, nullptr);
+#endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+				if (m_ca != nullptr)
+				{
+					// The CRL is left to the revocation index, if there is
+					// one.
+					mbedtls_ssl_conf_ca_chain(
+						NonVirtualGet(),
+						m_ca->MutableGet(),
+						(m_crl != nullptr && m_revocationIndex == nullptr) ?
+							m_crl->MutableGet() :
+							nullptr
+					);
+				}
+			}
+		}
+
+		void RecoverTrustCallBack(typename TlsConfObjTrait::CObjType& obj) noexcept
+		{
+#ifdef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+			if (m_verifyCache != nullptr)
+			{
+				mbedtls_ssl_conf_ca_cb(
+					&obj,
+					&TlsConfig::VerifyCacheCaCallBack,
+					this
+				);
+			}
+			else if (m_trustStore != nullptr)
+			{
+				mbedtls_ssl_conf_ca_cb(
+					&obj,
+					&TrustStore::CaCallBack,
+					const_cast<TrustStore*>(m_trustStore.get())
+				);
+			}
+#else
+			(void)obj;
+#endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+		}
+
+		void RecoverSniCallBack(typename TlsConfObjTrait::CObjType& obj) noexcept
+		{
+#ifdef MBEDTLS_SSL_SERVER_NAME_INDICATION
+			if (m_sniTable != nullptr)
+			{
+				mbedtls_ssl_conf_sni(&obj, &TlsConfig::SniCallBack, this);
+			}
+			else
+			{
+				mbedtls_ssl_conf_sni(&obj, nullptr, nullptr);
+			}
+#else
+			(void)obj;
+#endif // MBEDTLS_SSL_SERVER_NAME_INDICATION
+		}
+
 		std::shared_ptr<const X509Cert> m_ca;
 		std::shared_ptr<const X509Crl>  m_crl;
 		std::shared_ptr<const X509Cert> m_cert;
 		std::shared_ptr<const PKeyBase<> > m_prvKey;
 		std::unique_ptr<RbgInterface> m_rand;
 		std::shared_ptr<TlsSessTktMgrIntf > m_ticketMgr;
+		std::vector<uint16_t> m_groups;
+		std::vector<int> m_cipherSuites;
+		std::shared_ptr<TlsAsyncExecutorIntf> m_asyncExecutor;
+		AsyncKeyCopiesMap m_asyncKeyCopies;
+		std::shared_ptr<const TlsSniCertTable> m_sniTable;
+		std::shared_ptr<const TrustStore> m_trustStore;
+		std::shared_ptr<const TrustStore> m_caIndex;
+		std::shared_ptr<TlsVerifyCache> m_verifyCache;
+		std::shared_ptr<const RevocationIndex> m_revocationIndex;
+		std::shared_ptr<const RevocationIndex> m_crlIndex;
+		uint64_t m_crlVersion;
+		bool m_isKtlsOffloadEnabled;
+		std::shared_ptr<TlsHandshakeStats> m_hsStats;
+		std::shared_ptr<TlsDtlsCookie> m_dtlsCookie;
 }; // class TlsConfig
 
 } // namespace mbedTLScpp
@@ -0,0 +1,156 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+
+#include "Exceptions.hpp"
+#include "TlsConfig.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief Publishes the current TLS config for new connections, so that the
+ *        certificates, CAs, CRLs, or any other settings can be rotated at
+ *        runtime (read-copy-update style):
+ *        build a new \c TlsConfig , and give it to \c SetConfig ; every
+ *        connection constructed afterwards with \c GetConfig() uses the new
+ *        config, while the existing connections keep the config they
+ *        started with, which is freed once the last of them is gone.
+ *
+ *        Both \c GetConfig and \c SetConfig are atomic operations on the
+ *        shared pointer, so the accept path never waits on a lock held
+ *        while a new config is being built.
+ */
+class TlsConfigHolder
+{
+public:
+
+	/**
+	 * @brief Construct a new TLS config holder.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given config is null.
+	 * @param config The initial config.
+	 */
+	explicit TlsConfigHolder(std::shared_ptr<const TlsConfig> config) :
+		m_config(CheckConfig(std::move(config))),
+		m_version(0)
+	{}
+
+	TlsConfigHolder(const TlsConfigHolder& other) = delete;
+	TlsConfigHolder(TlsConfigHolder&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsConfigHolder() = default;
+	// LCOV_EXCL_STOP
+
+	TlsConfigHolder& operator=(const TlsConfigHolder& other) = delete;
+	TlsConfigHolder& operator=(TlsConfigHolder&& other) = delete;
+
+	/**
+	 * @brief Get the current config; it should be given to new connections.
+	 *
+	 * @return std::shared_ptr<const TlsConfig> The current config.
+	 */
+	std::shared_ptr<const TlsConfig> GetConfig() const noexcept
+	{
+#ifdef __cpp_lib_atomic_shared_ptr
+		return m_config.load(std::memory_order_acquire);
+#else
+		return std::atomic_load_explicit(&m_config, std::memory_order_acquire);
+#endif
+	}
+
+	/**
+	 * @brief Publish a new config for the connections constructed from now
+	 *        on.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given config is null.
+	 * @param config The new config.
+	 */
+	void SetConfig(std::shared_ptr<const TlsConfig> config)
+	{
+		ExchangeConfig(std::move(config));
+	}
+
+	/**
+	 * @brief Publish a new config for the connections constructed from now
+	 *        on, and get the previous one.
+	 *
+	 * @exception InvalidArgumentException Thrown when the given config is null.
+	 * @param config The new config.
+	 * @return std::shared_ptr<const TlsConfig> The previous config.
+	 */
+	std::shared_ptr<const TlsConfig> ExchangeConfig(
+		std::shared_ptr<const TlsConfig> config
+	)
+	{
+		config = CheckConfig(std::move(config));
+
+#ifdef __cpp_lib_atomic_shared_ptr
+		std::shared_ptr<const TlsConfig> prev =
+			m_config.exchange(std::move(config), std::memory_order_acq_rel);
+#else
+		std::shared_ptr<const TlsConfig> prev =
+			std::atomic_exchange_explicit(
+				&m_config, std::move(config), std::memory_order_acq_rel
+			);
+#endif
+		m_version.fetch_add(1, std::memory_order_relaxed);
+
+		return prev;
+	}
+
+	/**
+	 * @brief Get the number of times the config has been replaced.
+	 *
+	 * @return uint64_t The number of replacements.
+	 */
+	uint64_t GetVersion() const noexcept
+	{
+		return m_version.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	static std::shared_ptr<const TlsConfig> CheckConfig(
+		std::shared_ptr<const TlsConfig> config
+	)
+	{
+		if (config == nullptr)
+		{
+			throw InvalidArgumentException(
+				"TlsConfigHolder - The given TLS config is null."
+			);
+		}
+		config->NullCheck();
+
+		return config;
+	}
+
+#ifdef __cpp_lib_atomic_shared_ptr
+	std::atomic<std::shared_ptr<const TlsConfig> > m_config;
+#else
+	std::shared_ptr<const TlsConfig> m_config;
+#endif
+	std::atomic<uint64_t> m_version;
+
+}; // class TlsConfigHolder
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,302 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include "ObjectBase.hpp"
+
+#include <cstdint>
+
+#include <chrono>
+
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_cookie.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "RandInterfaces.hpp"
+
+/**
+ * DTLS (i.e., \c TlsConfig constructed with \c isStream being \c false )
+ * places more requirements on the \c ConnType of \c Tls :
+ *
+ * - \c Send must send the whole buffer as one datagram, or fail.
+ * - \c Recv must return exactly one datagram per call (truncated to the
+ *   given length), or \c MBEDTLS_ERR_SSL_WANT_READ if there is none.
+ * - \c RecvTimeout (see \c Tls::EnableRecvTimeout ) must do the same, and
+ *   return \c MBEDTLS_ERR_SSL_TIMEOUT after the given time, so the blocking
+ *   handshake can retransmit lost flights.
+ *
+ * The retransmission timer (see \c TlsDtlsTimer ) is installed by \c Tls
+ * itself.
+ */
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The DTLS retransmission timer given to
+ *        \c mbedtls_ssl_set_timer_cb ; it's based on the monotonic clock.
+ *
+ */
+class TlsDtlsTimer
+{
+public: // Static members:
+
+	using ClockType = std::chrono::steady_clock;
+
+	static void SetCallBack(void* ctx, uint32_t intMs, uint32_t finMs) noexcept
+	{
+		if (ctx != nullptr)
+		{
+			static_cast<TlsDtlsTimer*>(ctx)->Set(intMs, finMs, ClockType::now());
+		}
+	}
+
+	static int GetCallBack(void* ctx) noexcept
+	{
+		if (ctx == nullptr)
+		{
+			return -1;
+		}
+		return static_cast<const TlsDtlsTimer*>(ctx)->Get(ClockType::now());
+	}
+
+public:
+
+	TlsDtlsTimer() :
+		m_start(),
+		m_intDelay(),
+		m_finDelay(),
+		m_isRunning(false)
+	{}
+
+	TlsDtlsTimer(const TlsDtlsTimer& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsDtlsTimer() = default;
+	// LCOV_EXCL_STOP
+
+	TlsDtlsTimer& operator=(const TlsDtlsTimer& other) = default;
+
+	/**
+	 * @brief Start, or cancel, the timer.
+	 *
+	 * @param intMs The intermediate delay, in milliseconds.
+	 * @param finMs The final delay, in milliseconds; 0 to cancel the timer.
+	 * @param now   The current time.
+	 */
+	void Set(uint32_t intMs, uint32_t finMs, ClockType::time_point now) noexcept
+	{
+		m_start = now;
+		m_intDelay = std::chrono::milliseconds(intMs);
+		m_finDelay = std::chrono::milliseconds(finMs);
+		m_isRunning = (finMs != 0);
+	}
+
+	/**
+	 * @brief Get the status of the timer, as \c mbedtls_ssl_get_timer_t
+	 *        expects.
+	 *
+	 * @param now The current time.
+	 * @return int -1 if cancelled, 0 if no delay has passed, 1 if only the
+	 *             intermediate delay has passed, and 2 if the final delay
+	 *             has passed.
+	 */
+	int Get(ClockType::time_point now) const noexcept
+	{
+		if (!m_isRunning)
+		{
+			return -1;
+		}
+
+		const ClockType::duration elapsed = now - m_start;
+		if (elapsed >= m_finDelay)
+		{
+			return 2;
+		}
+		if (elapsed >= m_intDelay)
+		{
+			return 1;
+		}
+		return 0;
+	}
+
+	bool IsRunning() const noexcept
+	{
+		return m_isRunning;
+	}
+
+	/**
+	 * @brief Get the time at which the final delay expires, i.e., when the
+	 *        handshake should be resumed to retransmit the last flight.
+	 *
+	 * @return ClockType::time_point The expiry time; only meaningful while
+	 *                               the timer is running.
+	 */
+	ClockType::time_point GetExpiry() const noexcept
+	{
+		return m_start + m_finDelay;
+	}
+
+private:
+
+	ClockType::time_point m_start;
+	ClockType::duration m_intDelay;
+	ClockType::duration m_finDelay;
+	bool m_isRunning;
+
+}; // class TlsDtlsTimer
+
+
+class TlsDtlsCookie;
+
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_COOKIE_C)
+
+/**
+ * @brief DTLS cookie object allocator.
+ *
+ */
+struct TlsDtlsCookieObjAllocator : DefaultAllocBase
+{
+	typedef mbedtls_ssl_cookie_ctx      CObjType;
+
+	using DefaultAllocBase::NewObject;
+	using DefaultAllocBase::DelObject;
+
+	static void Init(CObjType* ptr)
+	{
+		return mbedtls_ssl_cookie_init(ptr);
+	}
+
+	static void Free(CObjType* ptr) noexcept
+	{
+		return mbedtls_ssl_cookie_free(ptr);
+	}
+}; // struct TlsDtlsCookieObjAllocator
+
+
+/**
+ * @brief DTLS cookie object trait.
+ *
+ */
+using DefaultTlsDtlsCookieObjTrait = ObjTraitBase<TlsDtlsCookieObjAllocator,
+											false,
+											false>;
+
+
+/**
+ * @brief The cookies of the DTLS hello verification (see
+ *        \c TlsConfig::SetDtlsCookie ); a server only keeps state for a
+ *        client once the client has proven that it can receive at its
+ *        address, which prevents amplification attacks with spoofed
+ *        addresses. One instance can be shared by several configs, and by
+ *        several threads.
+ *
+ */
+class TlsDtlsCookie : public ObjectBase<DefaultTlsDtlsCookieObjTrait>
+{
+public: // Static members:
+
+	using TlsDtlsCookieObjTrait = DefaultTlsDtlsCookieObjTrait;
+	using _Base                 = ObjectBase<TlsDtlsCookieObjTrait>;
+
+public:
+
+	/**
+	 * @brief Construct a new DTLS cookie object, with a fresh secret key.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param rand The Random Bit Generator, only used to generate the key.
+	 */
+	TlsDtlsCookie(RbgInterface& rand) :
+		_Base::ObjectBase()
+	{
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			TlsDtlsCookie::TlsDtlsCookie,
+			mbedtls_ssl_cookie_setup,
+			NonVirtualGet(),
+			&RbgInterface::CallBack, &rand
+		);
+	}
+
+	/**
+	 * @brief Move Constructor. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other TlsDtlsCookie instance.
+	 */
+	TlsDtlsCookie(TlsDtlsCookie&& rhs) noexcept :
+		_Base::ObjectBase(std::forward<_Base>(rhs)) //noexcept
+	{}
+
+	TlsDtlsCookie(const TlsDtlsCookie& rhs) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsDtlsCookie() = default;
+	// LCOV_EXCL_STOP
+
+	/**
+	 * @brief Move assignment. The `rhs` will be empty/null afterwards.
+	 *
+	 * @exception None No exception thrown
+	 * @param rhs The other TlsDtlsCookie instance.
+	 * @return TlsDtlsCookie& A reference to this instance.
+	 */
+	TlsDtlsCookie& operator=(TlsDtlsCookie&& rhs) noexcept
+	{
+		_Base::operator=(std::forward<_Base>(rhs)); //noexcept
+
+		return *this;
+	}
+
+	TlsDtlsCookie& operator=(const TlsDtlsCookie& other) = delete;
+
+	/**
+	 * @brief Check if the current instance is holding a null pointer for
+	 *        the mbedTLS object. If so, exception will be thrown. Helper
+	 *        function to be called before accessing the mbedTLS object.
+	 *
+	 * @exception InvalidObjectException Thrown when the current instance is
+	 *                                   holding a null pointer for the C mbed
+	 *                                   TLS object.
+	 */
+	virtual void NullCheck() const
+	{
+		_Base::NullCheck(MBEDTLSCPP_CLASS_NAME_STR(TlsDtlsCookie));
+	}
+
+	using _Base::NullCheck;
+	using _Base::Get;
+	using _Base::NonVirtualGet;
+	using _Base::Swap;
+
+	/**
+	 * @brief Set how long the cookies stay valid.
+	 *
+	 * @param sec The lifetime of cookies, in seconds; the default is
+	 *            \c MBEDTLS_SSL_COOKIE_TIMEOUT .
+	 */
+	void SetTimeout(unsigned long sec)
+	{
+		NullCheck();
+
+		mbedtls_ssl_cookie_set_timeout(NonVirtualGet(), sec);
+	}
+
+}; // class TlsDtlsCookie
+
+#endif // MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_COOKIE_C
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,480 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "Tls.hpp"
+#include "TlsConfig.hpp"
+#include "TlsDtls.hpp"
+
+#include "Internal/make_unique.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The connection of one DTLS peer behind a shared datagram socket;
+ *        the datagrams received from the peer are queued into it (see
+ *        \c PushDatagram ), and the ones sent to the peer go through the
+ *        given send function, along with the peer's address.
+ *
+ */
+class TlsDtlsPeerConn
+{
+public: // Static members:
+
+	/**
+	 * @brief Sends one datagram to the given peer address; it returns the
+	 *        number of bytes sent, or a negative mbed TLS error code (e.g.,
+	 *        \c MBEDTLS_ERR_SSL_WANT_WRITE ).
+	 */
+	using SendFuncType = std::function<
+		int(const std::string& peerAddr, const void* buf, size_t len)
+	>;
+
+public:
+
+	TlsDtlsPeerConn(std::string peerAddr, SendFuncType sendFunc) :
+		m_peerAddr(std::move(peerAddr)),
+		m_sendFunc(std::move(sendFunc)),
+		m_datagrams()
+	{}
+
+	TlsDtlsPeerConn(const TlsDtlsPeerConn& other) = delete;
+	TlsDtlsPeerConn(TlsDtlsPeerConn&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsDtlsPeerConn() = default;
+	// LCOV_EXCL_STOP
+
+	TlsDtlsPeerConn& operator=(const TlsDtlsPeerConn& other) = delete;
+	TlsDtlsPeerConn& operator=(TlsDtlsPeerConn&& other) = default;
+
+	virtual int Send(const void* buf, size_t len)
+	{
+		return m_sendFunc(m_peerAddr, buf, len);
+	}
+
+	virtual int Recv(void* buf, size_t len)
+	{
+		if (m_datagrams.empty())
+		{
+			return MBEDTLS_ERR_SSL_WANT_READ;
+		}
+
+		// A datagram is received as a whole, or its rest is lost.
+		const std::vector<uint8_t>& datagram = m_datagrams.front();
+		const size_t byteRecv = len < datagram.size() ? len : datagram.size();
+		std::memcpy(buf, datagram.data(), byteRecv);
+		m_datagrams.pop_front();
+
+		return static_cast<int>(byteRecv);
+	}
+
+	virtual int RecvTimeout(void* buf, size_t len, uint32_t /* t */)
+	{
+		// The datagrams are pushed by the demultiplexer; never wait.
+		return Recv(buf, len);
+	}
+
+	/**
+	 * @brief Queue a datagram received from the peer.
+	 *
+	 * @param buf The datagram.
+	 * @param len The length of the datagram.
+	 */
+	void PushDatagram(const void* buf, size_t len)
+	{
+		const uint8_t* begin = static_cast<const uint8_t*>(buf);
+		m_datagrams.emplace_back(begin, begin + len);
+	}
+
+	const std::string& GetPeerAddr() const noexcept
+	{
+		return m_peerAddr;
+	}
+
+private:
+
+	std::string m_peerAddr;
+	SendFuncType m_sendFunc;
+	std::deque<std::vector<uint8_t> > m_datagrams;
+
+}; // class TlsDtlsPeerConn
+
+
+/**
+ * @brief A DTLS connection with one peer behind a shared datagram socket.
+ *        Unlike \c Tls , the handshake is not performed by the constructor,
+ *        but driven by the datagrams pushed into its connection (see
+ *        \c TlsDtlsServerDemux ).
+ *
+ */
+class TlsDtlsPeer : public Tls<TlsDtlsPeerConn>
+{
+public: // Static members:
+
+	using _Base = Tls<TlsDtlsPeerConn>;
+
+public:
+
+	/**
+	 * @brief Construct a new DTLS peer.
+	 *
+	 * @exception InvalidArgumentException Thrown when the config is not for
+	 *                                     DTLS.
+	 * @exception mbedTLSRuntimeError      Thrown when mbed TLS C function
+	 *                                     call failed.
+	 * @param tlsConfig The DTLS config.
+	 * @param conn      The connection with the peer; on servers, the peer's
+	 *                  address is also the client transport ID, which the
+	 *                  hello verification cookie is bound to.
+	 */
+	TlsDtlsPeer(
+		std::shared_ptr<const TlsConfig> tlsConfig,
+		std::unique_ptr<TlsDtlsPeerConn> conn
+	) :
+		_Base::Tls(tlsConfig, nullptr, nullptr)
+	{
+		if (!tlsConfig->IsDatagram() || conn == nullptr)
+		{
+			throw InvalidArgumentException(
+				"TlsDtlsPeer::TlsDtlsPeer"
+				" - A DTLS config and a connection are required."
+			);
+		}
+
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C)
+		if (mbedtls_ssl_conf_get_endpoint(tlsConfig->Get()) ==
+			MBEDTLS_SSL_IS_SERVER)
+		{
+			SetClientTransportId(
+				conn->GetPeerAddr().data(),
+				conn->GetPeerAddr().size()
+			);
+		}
+#endif // MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_SRV_C
+
+		_Base::GetConnPtr() = std::move(conn);
+	}
+
+	TlsDtlsPeer(const TlsDtlsPeer& rhs) = delete;
+	TlsDtlsPeer(TlsDtlsPeer&& rhs) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsDtlsPeer() = default;
+	// LCOV_EXCL_STOP
+
+	TlsDtlsPeer& operator=(const TlsDtlsPeer& other) = delete;
+	TlsDtlsPeer& operator=(TlsDtlsPeer&& other) = delete;
+
+	TlsDtlsPeerConn& GetConn()
+	{
+		return *(_Base::GetConnPtr());
+	}
+
+	const TlsDtlsPeerConn& GetConn() const
+	{
+		return *(_Base::GetConnPtr());
+	}
+
+	/**
+	 * @brief Check if a ClientHello has been accepted by this (server)
+	 *        context, i.e., the handshake has moved on to the server's
+	 *        flight; junk datagrams, and ClientHellos without a valid
+	 *        cookie, don't get it there.
+	 *
+	 * @return true if the handshake is past the ClientHello.
+	 */
+	bool HasPassedClientHello() const
+	{
+		NullCheck();
+
+		return Get()->MBEDTLS_PRIVATE(state) > MBEDTLS_SSL_CLIENT_HELLO;
+	}
+
+}; // class TlsDtlsPeer
+
+
+/**
+ * @brief Demultiplexes the datagrams received on one server socket into
+ *        per-peer DTLS connections, found by the peer's address in a hash
+ *        table. The first datagram from a new address is handled by a
+ *        context outside of the table, and the peer is only kept once a
+ *        ClientHello has been accepted, so junk datagrams don't fill the
+ *        table.
+ *
+ *        The config must have cookies (see \c TlsConfig::SetDtlsCookie );
+ *        otherwise, a ClientHello is accepted without the hello
+ *        verification, and ClientHellos from spoofed addresses do fill the
+ *        table.
+ *
+ *        It's not thread-safe; it's meant to be driven by the thread
+ *        reading the socket.
+ */
+class TlsDtlsServerDemux
+{
+public: // Static members:
+
+	using SendFuncType = TlsDtlsPeerConn::SendFuncType;
+
+	static constexpr size_t sk_defMaxNumOfPeers = 4096;
+
+public:
+
+	/**
+	 * @brief Construct a new DTLS server demultiplexer.
+	 *
+	 * @exception InvalidArgumentException Thrown when the config is not for
+	 *                                     DTLS servers.
+	 * @param tlsConfig     The DTLS server config.
+	 * @param sendFunc      The function sending datagrams on the socket.
+	 * @param maxNumOfPeers The maximum number of peers; datagrams from new
+	 *                      peers are dropped once it's reached.
+	 */
+	TlsDtlsServerDemux(
+		std::shared_ptr<const TlsConfig> tlsConfig,
+		SendFuncType sendFunc,
+		size_t maxNumOfPeers = sk_defMaxNumOfPeers
+	) :
+		m_tlsConfig(std::move(tlsConfig)),
+		m_sendFunc(std::move(sendFunc)),
+		m_maxNumOfPeers(maxNumOfPeers),
+		m_peers()
+	{
+		if (m_tlsConfig == nullptr ||
+			!m_tlsConfig->IsDatagram() ||
+			mbedtls_ssl_conf_get_endpoint(m_tlsConfig->Get()) !=
+				MBEDTLS_SSL_IS_SERVER)
+		{
+			throw InvalidArgumentException(
+				"TlsDtlsServerDemux::TlsDtlsServerDemux"
+				" - A DTLS server config is required."
+			);
+		}
+	}
+
+	TlsDtlsServerDemux(const TlsDtlsServerDemux& other) = delete;
+	TlsDtlsServerDemux(TlsDtlsServerDemux&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsDtlsServerDemux() = default;
+	// LCOV_EXCL_STOP
+
+	TlsDtlsServerDemux& operator=(const TlsDtlsServerDemux& other) = delete;
+	TlsDtlsServerDemux& operator=(TlsDtlsServerDemux&& other) = default;
+
+	/**
+	 * @brief Route a datagram received from a peer to its connection, and
+	 *        continue its handshake if it's not over yet.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the peer's handshake failed;
+	 *                                the peer is removed.
+	 * @param peerAddr The address of the peer (e.g., the bytes of its
+	 *                 \c sockaddr ).
+	 * @param buf      The datagram.
+	 * @param len      The length of the datagram.
+	 * @return The peer, if its handshake is over, so the application data
+	 *         can be read from it (see \c Tls::RecvData ); otherwise,
+	 *         \c nullptr .
+	 */
+	TlsDtlsPeer* OnDatagram(
+		const std::string& peerAddr,
+		const void* buf,
+		size_t len
+	)
+	{
+		PeerMapType::iterator it = m_peers.find(peerAddr);
+		if (it == m_peers.end())
+		{
+			if (m_peers.size() >= m_maxNumOfPeers)
+			{
+				return nullptr;
+			}
+
+			return OnNewPeerDatagram(peerAddr, buf, len);
+		}
+
+		TlsDtlsPeer& peer = *(it->second);
+		peer.GetConn().PushDatagram(buf, len);
+		if (peer.HasHandshakeOver())
+		{
+			return &peer;
+		}
+
+		return ContinueHandshake(it) ? &peer : nullptr;
+	}
+
+	/**
+	 * @brief Resume the handshakes whose retransmission timer has expired;
+	 *        it should be called periodically (e.g., whenever the socket
+	 *        has been idle for a while). Peers whose handshake fails, or
+	 *        times out, are removed.
+	 *
+	 * @return size_t The number of peers removed.
+	 */
+	size_t OnTimer()
+	{
+		size_t numOfRemoved = 0;
+		const TlsDtlsTimer::ClockType::time_point now =
+			TlsDtlsTimer::ClockType::now();
+
+		for (PeerMapType::iterator it = m_peers.begin(); it != m_peers.end(); )
+		{
+			TlsDtlsPeer& peer = *(it->second);
+			const TlsDtlsTimer* timer = peer.GetDtlsTimer();
+			if (peer.HasHandshakeOver() ||
+				timer == nullptr || timer->Get(now) != 2)
+			{
+				++it;
+				continue;
+			}
+
+			// Erasing an entry doesn't invalidate the others.
+			PeerMapType::iterator next = std::next(it);
+			try
+			{
+				ContinueHandshake(it);
+			}
+			catch (const mbedTLSRuntimeError&)
+			{
+				++numOfRemoved;
+			}
+			it = next;
+		}
+
+		return numOfRemoved;
+	}
+
+	/**
+	 * @brief Find the peer with the given address.
+	 *
+	 * @param peerAddr The address of the peer.
+	 * @return The peer; \c nullptr if there is none.
+	 */
+	TlsDtlsPeer* Find(const std::string& peerAddr)
+	{
+		PeerMapType::iterator it = m_peers.find(peerAddr);
+		return it != m_peers.end() ? it->second.get() : nullptr;
+	}
+
+	/**
+	 * @brief Remove the peer with the given address (e.g., once it has
+	 *        closed the connection, or has been idle for too long).
+	 *
+	 * @param peerAddr The address of the peer.
+	 * @return true if the peer was found and removed.
+	 */
+	bool Remove(const std::string& peerAddr)
+	{
+		return m_peers.erase(peerAddr) != 0;
+	}
+
+	size_t GetNumOfPeers() const noexcept
+	{
+		return m_peers.size();
+	}
+
+private:
+
+	using PeerMapType =
+		std::unordered_map<std::string, std::unique_ptr<TlsDtlsPeer> >;
+
+	/**
+	 * @brief Handle the first datagram from an address that has no peer yet;
+	 *        the peer is added to the table only if its ClientHello has been
+	 *        accepted (i.e., with a valid cookie), otherwise, it's dropped
+	 *        along with the datagram.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the handshake failed.
+	 * @return The peer, if its handshake is over; otherwise, \c nullptr .
+	 */
+	TlsDtlsPeer* OnNewPeerDatagram(
+		const std::string& peerAddr,
+		const void* buf,
+		size_t len
+	)
+	{
+		std::unique_ptr<TlsDtlsPeer> peer = Internal::make_unique<TlsDtlsPeer>(
+			m_tlsConfig,
+			Internal::make_unique<TlsDtlsPeerConn>(peerAddr, m_sendFunc)
+		);
+		peer->GetConn().PushDatagram(buf, len);
+
+		const int mbedRet = peer->HandshakeNonBlocking();
+		if (mbedRet == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED ||
+			!peer->HasPassedClientHello())
+		{
+			return nullptr;
+		}
+
+		TlsDtlsPeer* peerPtr = peer.get();
+		m_peers.emplace(peerAddr, std::move(peer));
+		return mbedRet == MBEDTLS_EXIT_SUCCESS ? peerPtr : nullptr;
+	}
+
+	/**
+	 * @brief Continue the handshake of a peer; the peer is removed if the
+	 *        handshake failed, or if the client has been asked to prove its
+	 *        address (its next ClientHello, with the cookie, starts over
+	 *        with a new context).
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when the handshake failed.
+	 * @param it The peer's entry.
+	 * @return true if the handshake is over.
+	 */
+	bool ContinueHandshake(PeerMapType::iterator it)
+	{
+		int mbedRet = MBEDTLS_EXIT_SUCCESS;
+		try
+		{
+			mbedRet = it->second->HandshakeNonBlocking();
+		}
+		catch (...)
+		{
+			m_peers.erase(it);
+			throw;
+		}
+
+		if (mbedRet == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED)
+		{
+			m_peers.erase(it);
+			return false;
+		}
+		return mbedRet == MBEDTLS_EXIT_SUCCESS;
+	}
+
+	std::shared_ptr<const TlsConfig> m_tlsConfig;
+	SendFuncType m_sendFunc;
+	size_t m_maxNumOfPeers;
+	PeerMapType m_peers;
+
+}; // class TlsDtlsServerDemux
+
+
+} // namespace mbedTLScpp
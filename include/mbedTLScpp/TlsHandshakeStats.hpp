@@ -0,0 +1,633 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief A lock-free histogram of durations, in nanoseconds, with buckets of
+ *        power-of-two widths; bucket \c i holds the durations in
+ *        [2^(i-1), 2^i) , and the last bucket holds everything longer.
+ *        Recording takes a few relaxed atomic increments, so it can be
+ *        shared by all the threads serving connections.
+ */
+class TlsLatencyHistogram
+{
+public: // Static members:
+
+	/**
+	 * @brief The number of buckets; the last regular bucket ends at 2^38 ns,
+	 *        i.e., about 4.6 minutes.
+	 */
+	static constexpr size_t sk_numOfBuckets = 40;
+
+	/**
+	 * @brief Get the index of the bucket that holds the given duration.
+	 *
+	 * @param nanoSec The duration.
+	 * @return size_t The index of the bucket.
+	 */
+	static size_t GetBucketIndex(uint64_t nanoSec) noexcept
+	{
+		size_t idx = 0;
+		while (nanoSec != 0 && idx < (sk_numOfBuckets - 1))
+		{
+			nanoSec >>= 1;
+			++idx;
+		}
+		return idx;
+	}
+
+	/**
+	 * @brief Get the (exclusive) upper bound of the given bucket.
+	 *
+	 * @param idx The index of the bucket.
+	 * @return uint64_t The upper bound in nanoseconds; \c UINT64_MAX for the
+	 *                  last bucket.
+	 */
+	static uint64_t GetBucketUpperBound(size_t idx) noexcept
+	{
+		return idx < (sk_numOfBuckets - 1) ?
+			(static_cast<uint64_t>(1) << idx) :
+			UINT64_MAX;
+	}
+
+public:
+
+	TlsLatencyHistogram() :
+		m_buckets(),
+		m_count(),
+		m_sum()
+	{
+		Reset();
+	}
+
+	TlsLatencyHistogram(const TlsLatencyHistogram& other) = delete;
+	TlsLatencyHistogram(TlsLatencyHistogram&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsLatencyHistogram() = default;
+	// LCOV_EXCL_STOP
+
+	TlsLatencyHistogram& operator=(const TlsLatencyHistogram& other) = delete;
+	TlsLatencyHistogram& operator=(TlsLatencyHistogram&& other) = delete;
+
+	void Record(uint64_t nanoSec) noexcept
+	{
+		m_buckets[GetBucketIndex(nanoSec)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(nanoSec, std::memory_order_relaxed);
+	}
+
+	uint64_t GetCount() const noexcept
+	{
+		return m_count.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Get the sum of all the recorded durations.
+	 *
+	 * @return uint64_t The sum in nanoseconds.
+	 */
+	uint64_t GetSum() const noexcept
+	{
+		return m_sum.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Get the number of durations recorded in the given bucket.
+	 *
+	 * @exception InvalidArgumentException Thrown when the index is out of
+	 *                                     range.
+	 * @param idx The index of the bucket.
+	 * @return uint64_t The number of durations.
+	 */
+	uint64_t GetBucketCount(size_t idx) const
+	{
+		if (idx >= sk_numOfBuckets)
+		{
+			throw InvalidArgumentException(
+				"TlsLatencyHistogram::GetBucketCount"
+				" - The bucket index is out of range."
+			);
+		}
+		return m_buckets[idx].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Estimate the given percentile, by the upper bound of the bucket
+	 *        where it falls. The buckets are read one by one, so, while
+	 *        other threads are recording, it's only an approximation.
+	 *
+	 * @param percent The percentile, in [0, 100].
+	 * @return uint64_t The upper bound in nanoseconds; 0 if nothing has been
+	 *                  recorded.
+	 */
+	uint64_t GetPercentile(double percent) const noexcept
+	{
+		const uint64_t count = GetCount();
+		if (count == 0)
+		{
+			return 0;
+		}
+
+		const double target = (percent / 100.0) * static_cast<double>(count);
+		uint64_t cumulative = 0;
+		for (size_t i = 0; i < sk_numOfBuckets; ++i)
+		{
+			cumulative += m_buckets[i].load(std::memory_order_relaxed);
+			if (cumulative > 0 && static_cast<double>(cumulative) >= target)
+			{
+				return GetBucketUpperBound(i);
+			}
+		}
+		return GetBucketUpperBound(sk_numOfBuckets - 1);
+	}
+
+	void Reset() noexcept
+	{
+		for (std::atomic<uint64_t>& bucket : m_buckets)
+		{
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		m_count.store(0, std::memory_order_relaxed);
+		m_sum.store(0, std::memory_order_relaxed);
+	}
+
+private:
+
+	std::atomic<uint64_t> m_buckets[sk_numOfBuckets];
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sum;
+
+}; // class TlsLatencyHistogram
+
+
+/**
+ * @brief The trace of the handshake of a single TLS connection: how long
+ *        each handshake state took, how long was spent waiting on the
+ *        connection, and the bytes and records exchanged in each direction.
+ *        It's filled in by \c Tls , when the TLS config has handshake
+ *        statistics (see \c TlsConfig::SetHandshakeStats ).
+ *
+ *        Records are counted from the record headers in the byte stream, so
+ *        the counts are only meaningful for the stream transport.
+ */
+class TlsHandshakeTrace
+{
+public: // Static members:
+
+	using ClockType = std::chrono::steady_clock;
+
+	/**
+	 * @brief The time spent in a handshake state. Consecutive steps in the
+	 *        same state (e.g., while waiting for data) are merged.
+	 */
+	struct Step
+	{
+		int m_state;
+		uint64_t m_startNanoSec;
+		uint64_t m_durationNanoSec;
+		uint64_t m_ioWaitNanoSec;
+	}; // struct Step
+
+	/**
+	 * @brief The bytes and records sent or received in one direction.
+	 *
+	 */
+	class Direction
+	{
+	public:
+
+		Direction() :
+			m_bytes(0),
+			m_records(0),
+			m_hdr(),
+			m_hdrLen(0),
+			m_remaining(0)
+		{}
+
+		void Feed(const unsigned char* buf, size_t len) noexcept
+		{
+			m_bytes += len;
+
+			// Follows the record boundaries; a header can be split across
+			// calls.
+			while (len > 0)
+			{
+				if (m_remaining > 0)
+				{
+					const size_t skip = len < m_remaining ? len : m_remaining;
+					m_remaining -= skip;
+					buf += skip;
+					len -= skip;
+					continue;
+				}
+
+				m_hdr[m_hdrLen++] = *buf++;
+				--len;
+				if (m_hdrLen == sizeof(m_hdr))
+				{
+					++m_records;
+					m_remaining = (static_cast<size_t>(m_hdr[3]) << 8) | m_hdr[4];
+					m_hdrLen = 0;
+				}
+			}
+		}
+
+		uint64_t GetBytes() const noexcept
+		{
+			return m_bytes;
+		}
+
+		uint64_t GetRecords() const noexcept
+		{
+			return m_records;
+		}
+
+	private:
+
+		uint64_t m_bytes;
+		uint64_t m_records;
+		unsigned char m_hdr[5];
+		size_t m_hdrLen;
+		size_t m_remaining;
+
+	}; // class Direction
+
+	static uint64_t ToNanoSec(ClockType::duration d) noexcept
+	{
+		return static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()
+		);
+	}
+
+public:
+
+	TlsHandshakeTrace() :
+		m_start(),
+		m_steps(),
+		m_totalNanoSec(0),
+		m_ioWaitNanoSec(0),
+		m_sent(),
+		m_recv(),
+		m_isStarted(false),
+		m_isFinished(false)
+	{}
+
+	TlsHandshakeTrace(const TlsHandshakeTrace& other) = default;
+	TlsHandshakeTrace(TlsHandshakeTrace&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsHandshakeTrace() = default;
+	// LCOV_EXCL_STOP
+
+	TlsHandshakeTrace& operator=(const TlsHandshakeTrace& other) = default;
+	TlsHandshakeTrace& operator=(TlsHandshakeTrace&& other) = default;
+
+	/**
+	 * @brief Record a handshake step that started in the given state.
+	 *
+	 * @param state        The handshake state when the step started.
+	 * @param stepStart    When the step started.
+	 * @param stepEnd      When the step ended.
+	 * @param ioWaitBefore The time spent waiting on the connection before the
+	 *                     step started (see \c GetIoWaitTime ).
+	 */
+	void AddStep(
+		int state,
+		ClockType::time_point stepStart,
+		ClockType::time_point stepEnd,
+		uint64_t ioWaitBefore
+	)
+	{
+		if (!m_isStarted)
+		{
+			m_start = stepStart;
+			m_isStarted = true;
+		}
+
+		const uint64_t duration = ToNanoSec(stepEnd - stepStart);
+		const uint64_t ioWait = m_ioWaitNanoSec - ioWaitBefore;
+		if (!m_steps.empty() && m_steps.back().m_state == state)
+		{
+			m_steps.back().m_durationNanoSec += duration;
+			m_steps.back().m_ioWaitNanoSec += ioWait;
+		}
+		else
+		{
+			m_steps.push_back(
+				Step{ state, ToNanoSec(stepStart - m_start), duration, ioWait }
+			);
+		}
+		m_totalNanoSec = ToNanoSec(stepEnd - m_start);
+	}
+
+	void AddIoWait(ClockType::duration d) noexcept
+	{
+		m_ioWaitNanoSec += ToNanoSec(d);
+	}
+
+	void Finish() noexcept
+	{
+		m_isFinished = true;
+	}
+
+	bool IsFinished() const noexcept
+	{
+		return m_isFinished;
+	}
+
+	const std::vector<Step>& GetSteps() const noexcept
+	{
+		return m_steps;
+	}
+
+	/**
+	 * @brief Get the time from the start of the first handshake step to the
+	 *        end of the last one, including the time between steps (e.g.,
+	 *        waiting in an event loop).
+	 *
+	 * @return uint64_t The time in nanoseconds.
+	 */
+	uint64_t GetTotalTime() const noexcept
+	{
+		return m_totalNanoSec;
+	}
+
+	/**
+	 * @brief Get the time spent inside the send and receive calls of the
+	 *        connection during the handshake.
+	 *
+	 * @return uint64_t The time in nanoseconds.
+	 */
+	uint64_t GetIoWaitTime() const noexcept
+	{
+		return m_ioWaitNanoSec;
+	}
+
+	Direction& GetSent() noexcept
+	{
+		return m_sent;
+	}
+
+	const Direction& GetSent() const noexcept
+	{
+		return m_sent;
+	}
+
+	Direction& GetRecv() noexcept
+	{
+		return m_recv;
+	}
+
+	const Direction& GetRecv() const noexcept
+	{
+		return m_recv;
+	}
+
+private:
+
+	ClockType::time_point m_start;
+	std::vector<Step> m_steps;
+	uint64_t m_totalNanoSec;
+	uint64_t m_ioWaitNanoSec;
+	Direction m_sent;
+	Direction m_recv;
+	bool m_isStarted;
+	bool m_isFinished;
+
+}; // class TlsHandshakeTrace
+
+
+/**
+ * @brief Aggregated handshake statistics of all the connections using a TLS
+ *        config (see \c TlsConfig::SetHandshakeStats ): histograms of the
+ *        handshake time, of the time spent in each handshake state, and of
+ *        the time spent waiting on the connection; and the total bytes and
+ *        records exchanged during handshakes.
+ *
+ *        Everything is updated with relaxed atomic operations, so the
+ *        statistics can be shared by multiple configs, and read while
+ *        connections are being served.
+ */
+class TlsHandshakeStats
+{
+public: // Static members:
+
+	/**
+	 * @brief The number of handshake states tracked; later states are
+	 *        counted in the last histogram.
+	 */
+	static constexpr size_t sk_maxNumOfStates = 48;
+
+public:
+
+	TlsHandshakeStats() :
+		m_total(),
+		m_ioWait(),
+		m_states(),
+		m_numOfFailures(),
+		m_bytesSent(),
+		m_bytesRecv(),
+		m_recordsSent(),
+		m_recordsRecv()
+	{
+		Reset();
+	}
+
+	TlsHandshakeStats(const TlsHandshakeStats& other) = delete;
+	TlsHandshakeStats(TlsHandshakeStats&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsHandshakeStats() = default;
+	// LCOV_EXCL_STOP
+
+	TlsHandshakeStats& operator=(const TlsHandshakeStats& other) = delete;
+	TlsHandshakeStats& operator=(TlsHandshakeStats&& other) = delete;
+
+	/**
+	 * @brief Add the trace of a completed handshake.
+	 *
+	 * @param trace The trace.
+	 */
+	void Record(const TlsHandshakeTrace& trace) noexcept
+	{
+		m_total.Record(trace.GetTotalTime());
+		m_ioWait.Record(trace.GetIoWaitTime());
+
+		// A state may be visited more than once (e.g., when steps in other
+		// states are interleaved), but it's counted once per handshake.
+		uint64_t perState[sk_maxNumOfStates] = { 0 };
+		bool isVisited[sk_maxNumOfStates] = { false };
+		for (const TlsHandshakeTrace::Step& step : trace.GetSteps())
+		{
+			const size_t idx = GetStateIndex(step.m_state);
+			perState[idx] += step.m_durationNanoSec;
+			isVisited[idx] = true;
+		}
+		for (size_t i = 0; i < sk_maxNumOfStates; ++i)
+		{
+			if (isVisited[i])
+			{
+				m_states[i].Record(perState[i]);
+			}
+		}
+
+		AddTraffic(trace);
+	}
+
+	/**
+	 * @brief Count a failed handshake; its traffic is still added.
+	 *
+	 * @param trace The trace.
+	 */
+	void RecordFailure(const TlsHandshakeTrace& trace) noexcept
+	{
+		m_numOfFailures.fetch_add(1, std::memory_order_relaxed);
+		AddTraffic(trace);
+	}
+
+	/**
+	 * @brief Get the histogram of the whole handshake time.
+	 *
+	 */
+	const TlsLatencyHistogram& GetTotalHistogram() const noexcept
+	{
+		return m_total;
+	}
+
+	/**
+	 * @brief Get the histogram of the time spent waiting on the connection
+	 *        per handshake.
+	 *
+	 */
+	const TlsLatencyHistogram& GetIoWaitHistogram() const noexcept
+	{
+		return m_ioWait;
+	}
+
+	/**
+	 * @brief Get the histogram of the time spent in the given handshake
+	 *        state per handshake (e.g., \c MBEDTLS_SSL_SERVER_KEY_EXCHANGE ).
+	 *
+	 * @exception InvalidArgumentException Thrown when the state is negative.
+	 * @param state The handshake state, as in \c mbedtls_ssl_states .
+	 */
+	const TlsLatencyHistogram& GetStateHistogram(int state) const
+	{
+		if (state < 0)
+		{
+			throw InvalidArgumentException(
+				"TlsHandshakeStats::GetStateHistogram"
+				" - The handshake state is invalid."
+			);
+		}
+		return m_states[GetStateIndex(state)];
+	}
+
+	uint64_t GetNumOfHandshakes() const noexcept
+	{
+		return m_total.GetCount();
+	}
+
+	uint64_t GetNumOfFailures() const noexcept
+	{
+		return m_numOfFailures.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetBytesSent() const noexcept
+	{
+		return m_bytesSent.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetBytesRecv() const noexcept
+	{
+		return m_bytesRecv.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetRecordsSent() const noexcept
+	{
+		return m_recordsSent.load(std::memory_order_relaxed);
+	}
+
+	uint64_t GetRecordsRecv() const noexcept
+	{
+		return m_recordsRecv.load(std::memory_order_relaxed);
+	}
+
+	void Reset() noexcept
+	{
+		m_total.Reset();
+		m_ioWait.Reset();
+		for (TlsLatencyHistogram& hist : m_states)
+		{
+			hist.Reset();
+		}
+		m_numOfFailures.store(0, std::memory_order_relaxed);
+		m_bytesSent.store(0, std::memory_order_relaxed);
+		m_bytesRecv.store(0, std::memory_order_relaxed);
+		m_recordsSent.store(0, std::memory_order_relaxed);
+		m_recordsRecv.store(0, std::memory_order_relaxed);
+	}
+
+private:
+
+	static size_t GetStateIndex(int state) noexcept
+	{
+		const size_t idx = state < 0 ? 0 : static_cast<size_t>(state);
+		return idx < sk_maxNumOfStates ? idx : (sk_maxNumOfStates - 1);
+	}
+
+	void AddTraffic(const TlsHandshakeTrace& trace) noexcept
+	{
+		m_bytesSent.fetch_add(
+			trace.GetSent().GetBytes(), std::memory_order_relaxed
+		);
+		m_bytesRecv.fetch_add(
+			trace.GetRecv().GetBytes(), std::memory_order_relaxed
+		);
+		m_recordsSent.fetch_add(
+			trace.GetSent().GetRecords(), std::memory_order_relaxed
+		);
+		m_recordsRecv.fetch_add(
+			trace.GetRecv().GetRecords(), std::memory_order_relaxed
+		);
+	}
+
+	TlsLatencyHistogram m_total;
+	TlsLatencyHistogram m_ioWait;
+	TlsLatencyHistogram m_states[sk_maxNumOfStates];
+	std::atomic<uint64_t> m_numOfFailures;
+	std::atomic<uint64_t> m_bytesSent;
+	std::atomic<uint64_t> m_bytesRecv;
+	std::atomic<uint64_t> m_recordsSent;
+	std::atomic<uint64_t> m_recordsRecv;
+
+}; // class TlsHandshakeStats
+
+
+} // namespace mbedTLScpp
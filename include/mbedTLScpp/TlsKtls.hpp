@@ -0,0 +1,591 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <mbedtls/cipher.h>
+#include <mbedtls/hkdf.h>
+#include <mbedtls/md.h>
+#include <mbedtls/platform_util.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_ciphersuites.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+
+// Kernel TLS is only available on Linux; platforms without platform entropy
+// (e.g., enclaves) have no kernel sockets either.
+#if !defined(MBEDTLSCPP_NO_KTLS) && \
+	!defined(MBEDTLS_NO_PLATFORM_ENTROPY) && \
+	defined(__linux__)
+#	define MBEDTLSCPP_INTERNAL_KTLS
+#	include <cerrno>
+#	include <linux/tls.h>
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#	include <sys/socket.h>
+#	include <mbedtls/net_sockets.h>
+#	ifndef SOL_TLS
+#		define SOL_TLS 282
+#	endif
+#	ifndef TCP_ULP
+#		define TCP_ULP 31
+#	endif
+#endif
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief Moves the record protection of an established TLS connection into
+ *        the Linux kernel (kTLS), so that the application data is written to
+ *        and read from the socket as plain text (which also allows
+ *        \c sendfile ), and the kernel encrypts and decrypts the records.
+ *
+ *        The traffic secrets are captured by the key export callback of
+ *        mbed TLS during the handshake (see \c TlsConfig::SetKtlsOffload );
+ *        once the handshake is over, the traffic keys are derived from them,
+ *        and installed on the socket together with the current record
+ *        sequence numbers (see \c Tls::EnableKtls ).
+ *        Only AES-GCM cipher suites over TLS 1.2 and TLS 1.3 are supported.
+ *
+ *        The receiving direction is installed first, and the sending one
+ *        only if that succeeded; so, if the kernel refuses (e.g., the \c tls
+ *        module isn't loaded, or the cipher isn't supported), either
+ *        nothing is offloaded, or only the receiving direction is, while mbed
+ *        TLS keeps protecting the sent records. Either way, the connection
+ *        stays usable.
+ */
+class TlsKtls
+{
+public: // Static members:
+
+	/**
+	 * @brief The callback given to mbed TLS (see
+	 *        \c mbedtls_ssl_set_export_keys_cb ) that captures the secrets.
+	 *
+	 */
+	static void ExportKeysCallBack(
+		void* inst,
+		mbedtls_ssl_key_export_type type,
+		const unsigned char* secret,
+		size_t secretLen,
+		const unsigned char clientRandom[32],
+		const unsigned char serverRandom[32],
+		mbedtls_tls_prf_types prfType
+	) noexcept
+	{
+		if (inst == nullptr || secret == nullptr)
+		{
+			return;
+		}
+		TlsKtls* ktls = static_cast<TlsKtls*>(inst);
+
+		switch (type)
+		{
+		case MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET:
+			if (secretLen == sizeof(ktls->m_master))
+			{
+				std::memcpy(ktls->m_master, secret, secretLen);
+				std::memcpy(ktls->m_randoms, serverRandom, 32);
+				std::memcpy(ktls->m_randoms + 32, clientRandom, 32);
+				ktls->m_prfType = prfType;
+				ktls->m_hasSecrets = true;
+			}
+			break;
+
+#ifdef MBEDTLS_SSL_PROTO_TLS1_3
+		case MBEDTLS_SSL_KEY_EXPORT_TLS1_3_CLIENT_APPLICATION_TRAFFIC_SECRET:
+		case MBEDTLS_SSL_KEY_EXPORT_TLS1_3_SERVER_APPLICATION_TRAFFIC_SECRET:
+			if (secretLen <= sizeof(ktls->m_cltAppSecret))
+			{
+				const bool isClient = (type ==
+					MBEDTLS_SSL_KEY_EXPORT_TLS1_3_CLIENT_APPLICATION_TRAFFIC_SECRET);
+				std::memcpy(
+					isClient ? ktls->m_cltAppSecret : ktls->m_svrAppSecret,
+					secret,
+					secretLen
+				);
+				ktls->m_appSecretLen = secretLen;
+				ktls->m_hasSecrets = true;
+			}
+			break;
+#endif // MBEDTLS_SSL_PROTO_TLS1_3
+
+		default:
+			break;
+		}
+	}
+
+	/**
+	 * @brief Check if kernel TLS is supported on this platform.
+	 *
+	 * @return true if it's supported by this build.
+	 */
+	static constexpr bool IsSupported() noexcept
+	{
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+public:
+
+	TlsKtls() :
+		m_master(),
+		m_randoms(),
+		m_prfType(MBEDTLS_SSL_TLS_PRF_NONE),
+		m_cltAppSecret(),
+		m_svrAppSecret(),
+		m_appSecretLen(0),
+		m_hasSecrets(false),
+		m_socket(-1),
+		m_isTxOffloaded(false),
+		m_isRxOffloaded(false)
+	{}
+
+	TlsKtls(const TlsKtls& other) = delete;
+	TlsKtls(TlsKtls&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsKtls()
+	{
+		ClearSecrets();
+	}
+	// LCOV_EXCL_STOP
+
+	TlsKtls& operator=(const TlsKtls& other) = delete;
+	TlsKtls& operator=(TlsKtls&& other) = delete;
+
+	/**
+	 * @brief Install the traffic keys of the given connection on the given
+	 *        socket. The secrets are cleared afterwards, whether it
+	 *        succeeded or not, so the keys can only be installed once.
+	 *
+	 * @param sock The socket of the connection.
+	 * @param ssl  The connection, whose handshake is over.
+	 * @return true if at least one direction is offloaded.
+	 */
+	bool Install(int sock, const mbedtls_ssl_context& ssl) noexcept
+	{
+		if (m_isRxOffloaded)
+		{
+			return true;
+		}
+
+		bool res = false;
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+		if (m_hasSecrets && CanInstall(ssl))
+		{
+			res = InstallKeys(sock, ssl);
+		}
+#else
+		(void)sock;
+		(void)ssl;
+#endif // MBEDTLSCPP_INTERNAL_KTLS
+		ClearSecrets();
+		return res;
+	}
+
+	bool IsTxOffloaded() const noexcept
+	{
+		return m_isTxOffloaded;
+	}
+
+	bool IsRxOffloaded() const noexcept
+	{
+		return m_isRxOffloaded;
+	}
+
+	/**
+	 * @brief Send application data through the socket, which encrypts it.
+	 *
+	 * @param buf The data.
+	 * @param len The length of the data.
+	 * @return int The number of bytes sent, or
+	 *             \c MBEDTLS_ERR_SSL_WANT_WRITE , or
+	 *             \c MBEDTLS_ERR_NET_SEND_FAILED .
+	 */
+	int Send(const void* buf, size_t len) noexcept
+	{
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+		ssize_t ret = -1;
+		do
+		{
+			ret = ::send(m_socket, buf, len, MSG_NOSIGNAL);
+		} while (ret < 0 && errno == EINTR);
+
+		if (ret < 0)
+		{
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ?
+				MBEDTLS_ERR_SSL_WANT_WRITE :
+				MBEDTLS_ERR_NET_SEND_FAILED;
+		}
+		return static_cast<int>(ret);
+#else
+		(void)buf;
+		(void)len;
+		return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif // MBEDTLSCPP_INTERNAL_KTLS
+	}
+
+	/**
+	 * @brief Receive application data through the socket, which decrypts
+	 *        it. Post-handshake messages (e.g., TLS 1.3 session tickets) are
+	 *        skipped, and alerts are reported like mbed TLS does.
+	 *
+	 * @param buf The buffer.
+	 * @param len The size of the buffer.
+	 * @return int The number of bytes received, or
+	 *             \c MBEDTLS_ERR_SSL_WANT_READ , or another mbed TLS error
+	 *             code.
+	 */
+	int Recv(void* buf, size_t len) noexcept
+	{
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+		static constexpr unsigned char sk_appDataType = 23;
+		static constexpr unsigned char sk_alertType = 21;
+
+		while (true)
+		{
+			union
+			{
+				char m_buf[CMSG_SPACE(sizeof(unsigned char))];
+				struct cmsghdr m_align;
+			} ctrl;
+			struct iovec iov;
+			iov.iov_base = buf;
+			iov.iov_len = len;
+			struct msghdr msg;
+			std::memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = ctrl.m_buf;
+			msg.msg_controllen = sizeof(ctrl.m_buf);
+
+			const ssize_t ret = ::recvmsg(m_socket, &msg, 0);
+			if (ret < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					return MBEDTLS_ERR_SSL_WANT_READ;
+				}
+				return (errno == EBADMSG) ?
+					MBEDTLS_ERR_SSL_INVALID_MAC :
+					MBEDTLS_ERR_NET_RECV_FAILED;
+			}
+			if (ret == 0)
+			{
+				return MBEDTLS_ERR_SSL_CONN_EOF;
+			}
+
+			const struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+			if (cmsg == nullptr ||
+				cmsg->cmsg_level != SOL_TLS ||
+				cmsg->cmsg_type != TLS_GET_RECORD_TYPE)
+			{
+				return static_cast<int>(ret);
+			}
+
+			const unsigned char recordType = *CMSG_DATA(cmsg);
+			if (recordType == sk_appDataType)
+			{
+				return static_cast<int>(ret);
+			}
+			if (recordType == sk_alertType)
+			{
+				const unsigned char* alert =
+					static_cast<const unsigned char*>(buf);
+				return (ret >= 2 &&
+					alert[1] == MBEDTLS_SSL_ALERT_MSG_CLOSE_NOTIFY) ?
+						MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY :
+						MBEDTLS_ERR_SSL_FATAL_ALERT_MESSAGE;
+			}
+			// Post-handshake messages are not supported; skip them.
+		}
+#else
+		(void)buf;
+		(void)len;
+		return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif // MBEDTLSCPP_INTERNAL_KTLS
+	}
+
+private:
+
+	void ClearSecrets() noexcept
+	{
+		mbedtls_platform_zeroize(m_master, sizeof(m_master));
+		mbedtls_platform_zeroize(m_cltAppSecret, sizeof(m_cltAppSecret));
+		mbedtls_platform_zeroize(m_svrAppSecret, sizeof(m_svrAppSecret));
+		m_hasSecrets = false;
+	}
+
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+
+	struct TrafficKeys
+	{
+		unsigned char m_key[32];
+		unsigned char m_salt[4];
+		unsigned char m_iv[8];
+	}; // struct TrafficKeys
+
+	static bool CanInstall(const mbedtls_ssl_context& ssl) noexcept
+	{
+		mbedtls_ssl_context& mutSsl = const_cast<mbedtls_ssl_context&>(ssl);
+
+		// Nothing may be left in the buffers of mbed TLS, since the kernel
+		// takes over right from the current position of the stream.
+		return mbedtls_ssl_is_handshake_over(&mutSsl) &&
+			mbedtls_ssl_context_get_config(&ssl)->MBEDTLS_PRIVATE(transport) ==
+				MBEDTLS_SSL_TRANSPORT_STREAM &&
+			ssl.MBEDTLS_PRIVATE(out_left) == 0 &&
+			mbedtls_ssl_check_pending(&ssl) == 0 &&
+			mbedtls_ssl_get_bytes_avail(&ssl) == 0;
+	}
+
+	static size_t GetKeyLen(const mbedtls_ssl_context& ssl) noexcept
+	{
+		const mbedtls_ssl_ciphersuite_t* suite = mbedtls_ssl_ciphersuite_from_id(
+			mbedtls_ssl_get_ciphersuite_id_from_ssl(&ssl)
+		);
+		if (suite == nullptr)
+		{
+			return 0;
+		}
+		switch (suite->MBEDTLS_PRIVATE(cipher))
+		{
+		case MBEDTLS_CIPHER_AES_128_GCM:
+			return 16;
+		case MBEDTLS_CIPHER_AES_256_GCM:
+			return 32;
+		default:
+			return 0;
+		}
+	}
+
+	bool DeriveTls12Keys(
+		size_t keyLen,
+		TrafficKeys& clt,
+		TrafficKeys& svr
+	) const noexcept
+	{
+		// client_write_key | server_write_key | client_IV | server_IV
+		// (RFC 5246, section 6.3; AEAD suites have no MAC keys)
+		unsigned char keyBlock[(32 + 4) * 2];
+		const size_t keyBlockLen = (keyLen + 4) * 2;
+		if (mbedtls_ssl_tls_prf(
+				m_prfType,
+				m_master, sizeof(m_master),
+				"key expansion",
+				m_randoms, sizeof(m_randoms),
+				keyBlock, keyBlockLen
+			) != 0)
+		{
+			return false;
+		}
+
+		std::memcpy(clt.m_key, keyBlock, keyLen);
+		std::memcpy(svr.m_key, keyBlock + keyLen, keyLen);
+		std::memcpy(clt.m_salt, keyBlock + (keyLen * 2), 4);
+		std::memcpy(svr.m_salt, keyBlock + (keyLen * 2) + 4, 4);
+		mbedtls_platform_zeroize(keyBlock, sizeof(keyBlock));
+
+		// The explicit nonce used by mbed TLS is the record sequence number,
+		// which is filled in by the caller.
+		return true;
+	}
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(TLS_1_3_VERSION)
+	static bool HkdfExpandLabel(
+		const unsigned char* secret,
+		size_t secretLen,
+		const char* label,
+		unsigned char* out,
+		size_t outLen
+	) noexcept
+	{
+		// HkdfLabel (RFC 8446, section 7.1), with an empty context.
+		static constexpr char sk_prefix[] = "tls13 ";
+		const size_t labelLen = std::strlen(label);
+		unsigned char info[2 + 1 + (sizeof(sk_prefix) - 1) + 16 + 1];
+		size_t infoLen = 0;
+		info[infoLen++] = static_cast<unsigned char>((outLen >> 8) & 0xFFU);
+		info[infoLen++] = static_cast<unsigned char>(outLen & 0xFFU);
+		info[infoLen++] =
+			static_cast<unsigned char>((sizeof(sk_prefix) - 1) + labelLen);
+		std::memcpy(info + infoLen, sk_prefix, sizeof(sk_prefix) - 1);
+		infoLen += sizeof(sk_prefix) - 1;
+		std::memcpy(info + infoLen, label, labelLen);
+		infoLen += labelLen;
+		info[infoLen++] = 0;
+
+		const mbedtls_md_info_t* mdInfo = mbedtls_md_info_from_type(
+			secretLen == 48 ? MBEDTLS_MD_SHA384 : MBEDTLS_MD_SHA256
+		);
+		return mdInfo != nullptr &&
+			mbedtls_hkdf_expand(
+				mdInfo, secret, secretLen, info, infoLen, out, outLen
+			) == 0;
+	}
+
+	bool DeriveTls13Keys(
+		const unsigned char* secret,
+		size_t keyLen,
+		TrafficKeys& keys
+	) const noexcept
+	{
+		unsigned char iv[12];
+		const bool res =
+			HkdfExpandLabel(secret, m_appSecretLen, "key", keys.m_key, keyLen) &&
+			HkdfExpandLabel(secret, m_appSecretLen, "iv", iv, sizeof(iv));
+		std::memcpy(keys.m_salt, iv, 4);
+		std::memcpy(keys.m_iv, iv + 4, 8);
+		mbedtls_platform_zeroize(iv, sizeof(iv));
+		return res;
+	}
+#endif // MBEDTLS_SSL_PROTO_TLS1_3 && TLS_1_3_VERSION
+
+	static bool SetKeys(
+		int sock,
+		int direction,
+		uint16_t version,
+		size_t keyLen,
+		const TrafficKeys& keys,
+		const unsigned char* recSeq
+	) noexcept
+	{
+		int ret = -1;
+		if (keyLen == 16)
+		{
+			struct tls12_crypto_info_aes_gcm_128 info;
+			std::memset(&info, 0, sizeof(info));
+			info.info.version = version;
+			info.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+			std::memcpy(info.key, keys.m_key, sizeof(info.key));
+			std::memcpy(info.salt, keys.m_salt, sizeof(info.salt));
+			std::memcpy(info.iv, keys.m_iv, sizeof(info.iv));
+			std::memcpy(info.rec_seq, recSeq, sizeof(info.rec_seq));
+			ret = ::setsockopt(sock, SOL_TLS, direction, &info, sizeof(info));
+			mbedtls_platform_zeroize(&info, sizeof(info));
+		}
+		else
+		{
+			struct tls12_crypto_info_aes_gcm_256 info;
+			std::memset(&info, 0, sizeof(info));
+			info.info.version = version;
+			info.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+			std::memcpy(info.key, keys.m_key, sizeof(info.key));
+			std::memcpy(info.salt, keys.m_salt, sizeof(info.salt));
+			std::memcpy(info.iv, keys.m_iv, sizeof(info.iv));
+			std::memcpy(info.rec_seq, recSeq, sizeof(info.rec_seq));
+			ret = ::setsockopt(sock, SOL_TLS, direction, &info, sizeof(info));
+			mbedtls_platform_zeroize(&info, sizeof(info));
+		}
+		return ret == 0;
+	}
+
+	bool InstallKeys(int sock, const mbedtls_ssl_context& ssl) noexcept
+	{
+		const size_t keyLen = GetKeyLen(ssl);
+		if (keyLen == 0)
+		{
+			return false;
+		}
+
+		TrafficKeys clt;
+		TrafficKeys svr;
+		uint16_t version = 0;
+		bool isDerived = false;
+		switch (mbedtls_ssl_get_version_number(&ssl))
+		{
+		case MBEDTLS_SSL_VERSION_TLS1_2:
+			version = TLS_1_2_VERSION;
+			isDerived = DeriveTls12Keys(keyLen, clt, svr);
+			break;
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(TLS_1_3_VERSION)
+		case MBEDTLS_SSL_VERSION_TLS1_3:
+			version = TLS_1_3_VERSION;
+			isDerived = DeriveTls13Keys(m_cltAppSecret, keyLen, clt) &&
+				DeriveTls13Keys(m_svrAppSecret, keyLen, svr);
+			break;
+#endif // MBEDTLS_SSL_PROTO_TLS1_3 && TLS_1_3_VERSION
+		default:
+			break;
+		}
+
+		const bool isServer =
+			mbedtls_ssl_context_get_config(&ssl)->MBEDTLS_PRIVATE(endpoint) ==
+				MBEDTLS_SSL_IS_SERVER;
+		TrafficKeys& txKeys = isServer ? svr : clt;
+		TrafficKeys& rxKeys = isServer ? clt : svr;
+
+		const unsigned char* txSeq = ssl.MBEDTLS_PRIVATE(cur_out_ctr);
+		const unsigned char* rxSeq = ssl.MBEDTLS_PRIVATE(in_ctr);
+		if (version == TLS_1_2_VERSION)
+		{
+			std::memcpy(txKeys.m_iv, txSeq, sizeof(txKeys.m_iv));
+			std::memcpy(rxKeys.m_iv, rxSeq, sizeof(rxKeys.m_iv));
+		}
+
+		static constexpr char sk_ulpName[] = "tls";
+		if (isDerived &&
+			::setsockopt(
+				sock, SOL_TCP, TCP_ULP, sk_ulpName, sizeof(sk_ulpName)
+			) == 0)
+		{
+			// Receiving first; mbed TLS can keep sending, but once the
+			// kernel sends, mbed TLS must not receive anything that needs
+			// a reply.
+			m_isRxOffloaded =
+				SetKeys(sock, TLS_RX, version, keyLen, rxKeys, rxSeq);
+			m_isTxOffloaded = m_isRxOffloaded &&
+				SetKeys(sock, TLS_TX, version, keyLen, txKeys, txSeq);
+		}
+
+		mbedtls_platform_zeroize(&clt, sizeof(clt));
+		mbedtls_platform_zeroize(&svr, sizeof(svr));
+
+		if (m_isRxOffloaded)
+		{
+			m_socket = sock;
+		}
+		return m_isRxOffloaded;
+	}
+
+#endif // MBEDTLSCPP_INTERNAL_KTLS
+
+	unsigned char m_master[48];
+	unsigned char m_randoms[64];
+	mbedtls_tls_prf_types m_prfType;
+	unsigned char m_cltAppSecret[48];
+	unsigned char m_svrAppSecret[48];
+	size_t m_appSecretLen;
+	bool m_hasSecrets;
+
+	int m_socket;
+	bool m_isTxOffloaded;
+	bool m_isRxOffloaded;
+
+}; // class TlsKtls
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,556 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	define MBEDTLSCPP_INTERNAL_LOADGEN_RUSAGE
+#	include <sys/resource.h>
+#endif
+
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "Tls.hpp"
+#include "TlsConfig.hpp"
+#include "TlsHandshakeStats.hpp"
+#include "TlsMemTransport.hpp"
+#include "TlsSession.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief The options of a load generation run (see \c TlsLoadGen ).
+ *
+ */
+struct TlsLoadGenOptions
+{
+	TlsLoadGenOptions() :
+		m_numOfPairs(1),
+		m_numOfConnsPerPair(100),
+		m_durationMs(0),
+		m_resumptionRatio(0.0),
+		m_bulkBytes(0),
+		m_capacity(TlsMemConn::sk_defCapacity)
+	{}
+
+	/**
+	 * @brief The number of client and server pairs running concurrently,
+	 *        each on its own thread.
+	 */
+	size_t m_numOfPairs;
+
+	/**
+	 * @brief The number of connections made by each pair, one after
+	 *        another.
+	 */
+	size_t m_numOfConnsPerPair;
+
+	/**
+	 * @brief The time limit of the run, in milliseconds; 0 for no limit
+	 *        (i.e., only \c m_numOfConnsPerPair limits the run).
+	 */
+	uint32_t m_durationMs;
+
+	/**
+	 * @brief The fraction of connections that resume the session of an
+	 *        earlier full handshake (the server config needs session
+	 *        tickets, or a session cache, for resumptions to happen).
+	 */
+	double m_resumptionRatio;
+
+	/**
+	 * @brief The number of bytes sent from the client to the server on
+	 *        each connection, after the handshake.
+	 */
+	size_t m_bulkBytes;
+
+	/**
+	 * @brief The capacity of the in-memory transport, in each direction.
+	 */
+	size_t m_capacity;
+}; // struct TlsLoadGenOptions
+
+
+/**
+ * @brief The results of a load generation run.
+ *
+ */
+struct TlsLoadGenReport
+{
+	uint64_t m_numOfHandshakes;
+
+	/**
+	 * @brief The number of handshakes that resumed the offered session, and
+	 *        the number of the ones where the server declined it, and made
+	 *        a full handshake instead.
+	 */
+	uint64_t m_numOfResumptions;
+	uint64_t m_numOfResumptionFallbacks;
+
+	uint64_t m_numOfFailures;
+	uint64_t m_bytesTransferred;
+	uint64_t m_elapsedNanoSec;
+
+	/**
+	 * @brief The median and the 99th percentile of the handshake latency
+	 *        (both sides, in nanoseconds); they are the upper bounds of
+	 *        power-of-2 buckets (see \c TlsLatencyHistogram ).
+	 */
+	uint64_t m_hsLatencyP50;
+	uint64_t m_hsLatencyP99;
+
+	/**
+	 * @brief The peak resident memory of the whole process, in bytes; 0
+	 *        where it can't be measured.
+	 */
+	uint64_t m_peakMemBytes;
+
+	double GetHandshakesPerSec() const noexcept
+	{
+		return m_elapsedNanoSec == 0 ? 0.0 :
+			(static_cast<double>(m_numOfHandshakes) * 1e9 /
+				static_cast<double>(m_elapsedNanoSec));
+	}
+
+	/**
+	 * @brief Get the throughput of the bulk transfers, in bytes per second.
+	 *
+	 */
+	double GetThroughput() const noexcept
+	{
+		return m_elapsedNanoSec == 0 ? 0.0 :
+			(static_cast<double>(m_bytesTransferred) * 1e9 /
+				static_cast<double>(m_elapsedNanoSec));
+	}
+}; // struct TlsLoadGenReport
+
+
+namespace Internal
+{
+
+/**
+ * @brief A TLS connection over the in-memory transport, whose handshake is
+ *        driven by the load generator, rather than by the constructor.
+ *
+ */
+class TlsLoadGenEndpoint : public Tls<TlsMemConn>
+{
+public: // Static members:
+
+	using _Base = Tls<TlsMemConn>;
+
+public:
+
+	TlsLoadGenEndpoint(
+		std::shared_ptr<const TlsConfig> tlsConfig,
+		std::shared_ptr<const TlsSession> session,
+		std::unique_ptr<TlsMemConn> conn
+	) :
+		_Base::Tls(tlsConfig, session, nullptr),
+		m_hasCertStep(false)
+	{
+		_Base::GetConnPtr() = std::move(conn);
+	}
+
+	TlsLoadGenEndpoint(const TlsLoadGenEndpoint& rhs) = delete;
+	TlsLoadGenEndpoint(TlsLoadGenEndpoint&& rhs) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsLoadGenEndpoint() = default;
+	// LCOV_EXCL_STOP
+
+	TlsLoadGenEndpoint& operator=(const TlsLoadGenEndpoint& other) = delete;
+	TlsLoadGenEndpoint& operator=(TlsLoadGenEndpoint&& other) = delete;
+
+	/**
+	 * @brief The same as \c Tls::HandshakeNonBlocking , but one step at a
+	 *        time, to see which states the handshake goes through.
+	 *
+	 */
+	int HandshakeNonBlocking()
+	{
+		_Base::NullCheck();
+
+		int mbedRet = MBEDTLS_EXIT_SUCCESS;
+		while (mbedRet == MBEDTLS_EXIT_SUCCESS && !_Base::HasHandshakeOver())
+		{
+			m_hasCertStep = m_hasCertStep ||
+				(_Base::Get()->MBEDTLS_PRIVATE(state) ==
+					MBEDTLS_SSL_SERVER_CERTIFICATE);
+			mbedRet = _Base::HandshakeStepImpl();
+		}
+
+		if (
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_READ) &&
+			(mbedRet != MBEDTLS_ERR_SSL_WANT_WRITE) &&
+			(mbedRet != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) &&
+			(mbedRet != MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS)
+		)
+		{
+			MBEDTLSCPP_THROW_IF_ERROR_CODE_NON_SUCCESS(
+				mbedRet,
+				TlsLoadGenEndpoint::HandshakeNonBlocking,
+				mbedtls_ssl_handshake_step
+			);
+		}
+
+		return mbedRet;
+	}
+
+	/**
+	 * @brief Check if the finished handshake resumed an earlier session;
+	 *        i.e., the server's certificate was skipped, which is the case
+	 *        for abbreviated TLS 1.2 handshakes, and for TLS 1.3 handshakes
+	 *        with a pre-shared key.
+	 *
+	 */
+	bool IsResumed() const
+	{
+		return _Base::HasHandshakeOver() && !m_hasCertStep;
+	}
+
+private:
+
+	bool m_hasCertStep;
+
+}; // class TlsLoadGenEndpoint
+
+inline uint64_t GetPeakMemBytes() noexcept
+{
+#ifdef MBEDTLSCPP_INTERNAL_LOADGEN_RUSAGE
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#	ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#	else
+	// In kilobytes on Linux and BSDs.
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#	endif
+#else
+	return 0;
+#endif // MBEDTLSCPP_INTERNAL_LOADGEN_RUSAGE
+}
+
+} // namespace Internal
+
+
+/**
+ * @brief An in-process TLS load generator, for performance work and soak
+ *        tests. Each pair of client and server runs on its own thread, over
+ *        the in-memory transport (see \c TlsMemConn ), and makes
+ *        connections one after another, each with a handshake (full, or
+ *        resumed), followed by a bulk transfer. Since both sides run in the
+ *        same thread, the handshake rate covers the cost of both sides.
+ *
+ */
+class TlsLoadGen
+{
+public: // Static members:
+
+	/**
+	 * @brief The number of rounds after which a handshake that makes no
+	 *        progress is considered stalled.
+	 */
+	static constexpr size_t sk_maxHandshakeRounds = 1000;
+
+public:
+
+	/**
+	 * @brief Construct a new load generator.
+	 *
+	 * @exception InvalidArgumentException Thrown when a config is missing.
+	 * @param svrConfig The config of the servers.
+	 * @param cltConfig The config of the clients.
+	 * @param options   The options of the runs.
+	 */
+	TlsLoadGen(
+		std::shared_ptr<const TlsConfig> svrConfig,
+		std::shared_ptr<const TlsConfig> cltConfig,
+		const TlsLoadGenOptions& options
+	) :
+		m_svrConfig(std::move(svrConfig)),
+		m_cltConfig(std::move(cltConfig)),
+		m_options(options)
+	{
+		if (m_svrConfig == nullptr || m_cltConfig == nullptr)
+		{
+			throw InvalidArgumentException(
+				"TlsLoadGen::TlsLoadGen - Both configs are required."
+			);
+		}
+	}
+
+	TlsLoadGen(const TlsLoadGen& other) = delete;
+	TlsLoadGen(TlsLoadGen&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsLoadGen() = default;
+	// LCOV_EXCL_STOP
+
+	TlsLoadGen& operator=(const TlsLoadGen& other) = delete;
+	TlsLoadGen& operator=(TlsLoadGen&& other) = default;
+
+	/**
+	 * @brief Run the load, and wait for all the pairs to finish.
+	 *
+	 * @return TlsLoadGenReport The results of the run.
+	 */
+	TlsLoadGenReport Run() const
+	{
+		using Clock = std::chrono::steady_clock;
+
+		const Clock::time_point start = Clock::now();
+		const Clock::time_point deadline = (m_options.m_durationMs == 0) ?
+			Clock::time_point::max() :
+			(start + std::chrono::milliseconds(m_options.m_durationMs));
+
+		TlsLatencyHistogram hsLatency;
+		std::vector<PairCounters> counters(m_options.m_numOfPairs);
+		std::vector<std::thread> threads;
+		threads.reserve(m_options.m_numOfPairs);
+		for (size_t i = 0; i < m_options.m_numOfPairs; ++i)
+		{
+			threads.emplace_back(
+				&TlsLoadGen::RunPair, this,
+				deadline, std::ref(hsLatency), std::ref(counters[i])
+			);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+
+		TlsLoadGenReport report = TlsLoadGenReport();
+		for (const PairCounters& pair : counters)
+		{
+			report.m_numOfHandshakes  += pair.m_numOfHandshakes;
+			report.m_numOfResumptions += pair.m_numOfResumptions;
+			report.m_numOfResumptionFallbacks +=
+				pair.m_numOfResumptionFallbacks;
+			report.m_numOfFailures    += pair.m_numOfFailures;
+			report.m_bytesTransferred += pair.m_bytesTransferred;
+		}
+		report.m_elapsedNanoSec = static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				Clock::now() - start
+			).count()
+		);
+		report.m_hsLatencyP50 = hsLatency.GetPercentile(50);
+		report.m_hsLatencyP99 = hsLatency.GetPercentile(99);
+		report.m_peakMemBytes = Internal::GetPeakMemBytes();
+
+		return report;
+	}
+
+private:
+
+	/**
+	 * @brief The counters of one pair; each pair only touches its own, and
+	 *        they are merged once all threads have joined.
+	 */
+	struct PairCounters
+	{
+		PairCounters() :
+			m_numOfHandshakes(0),
+			m_numOfResumptions(0),
+			m_numOfResumptionFallbacks(0),
+			m_numOfFailures(0),
+			m_bytesTransferred(0)
+		{}
+
+		uint64_t m_numOfHandshakes;
+		uint64_t m_numOfResumptions;
+		uint64_t m_numOfResumptionFallbacks;
+		uint64_t m_numOfFailures;
+		uint64_t m_bytesTransferred;
+	}; // struct PairCounters
+
+	void RunPair(
+		std::chrono::steady_clock::time_point deadline,
+		TlsLatencyHistogram& hsLatency,
+		PairCounters& counters
+	) const noexcept
+	{
+		using Clock = std::chrono::steady_clock;
+
+		std::shared_ptr<const TlsSession> session;
+		double resumeCredit = 0.0;
+
+		for (size_t i = 0;
+			i < m_options.m_numOfConnsPerPair && Clock::now() < deadline;
+			++i)
+		{
+			// Spread the resumptions evenly among the connections.
+			bool isResuming = false;
+			if (session != nullptr)
+			{
+				resumeCredit += m_options.m_resumptionRatio;
+				if (resumeCredit >= 1.0)
+				{
+					resumeCredit -= 1.0;
+					isResuming = true;
+				}
+			}
+
+			try
+			{
+				auto conns = TlsMemConn::CreatePair(m_options.m_capacity);
+
+				const Clock::time_point start = Clock::now();
+				Internal::TlsLoadGenEndpoint clt(
+					m_cltConfig,
+					isResuming ? session : nullptr,
+					std::move(conns.first)
+				);
+				Internal::TlsLoadGenEndpoint svr(
+					m_svrConfig,
+					nullptr,
+					std::move(conns.second)
+				);
+				Handshake(clt, svr);
+				hsLatency.Record(static_cast<uint64_t>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+						Clock::now() - start
+					).count()
+				));
+
+				++counters.m_numOfHandshakes;
+				if (isResuming)
+				{
+					if (clt.IsResumed())
+					{
+						++counters.m_numOfResumptions;
+					}
+					else
+					{
+						++counters.m_numOfResumptionFallbacks;
+					}
+				}
+				else if (m_options.m_resumptionRatio > 0.0)
+				{
+					session = std::make_shared<TlsSession>(clt.GetSession());
+				}
+
+				counters.m_bytesTransferred += Transfer(clt, svr);
+			}
+			catch (const std::exception&)
+			{
+				++counters.m_numOfFailures;
+			}
+		}
+	}
+
+	static void Handshake(
+		Internal::TlsLoadGenEndpoint& clt,
+		Internal::TlsLoadGenEndpoint& svr
+	)
+	{
+		for (size_t i = 0;
+			!clt.HasHandshakeOver() || !svr.HasHandshakeOver();
+			++i)
+		{
+			if (i >= sk_maxHandshakeRounds)
+			{
+				throw mbedTLSRuntimeError(
+					MBEDTLS_ERR_SSL_TIMEOUT,
+					"TlsLoadGen::Handshake - The handshake has stalled."
+				);
+			}
+
+			if (!clt.HasHandshakeOver())
+			{
+				clt.HandshakeNonBlocking();
+			}
+			if (!svr.HasHandshakeOver())
+			{
+				svr.HandshakeNonBlocking();
+			}
+		}
+	}
+
+	uint64_t Transfer(
+		Internal::TlsLoadGenEndpoint& clt,
+		Internal::TlsLoadGenEndpoint& svr
+	) const
+	{
+		const size_t total = m_options.m_bulkBytes;
+		std::vector<uint8_t> buf(
+			total < MBEDTLS_SSL_OUT_CONTENT_LEN ?
+				total : MBEDTLS_SSL_OUT_CONTENT_LEN,
+			0x5A
+		);
+
+		size_t sent = 0;
+		size_t recv = 0;
+		while (recv < total)
+		{
+			if (sent < total)
+			{
+				// After WANT_WRITE, the same data is given again, as mbed
+				// TLS requires.
+				const size_t len = (total - sent) < buf.size() ?
+					(total - sent) : buf.size();
+				try
+				{
+					sent += static_cast<size_t>(clt.SendData(buf.data(), len));
+				}
+				catch (const mbedTLSRuntimeError& e)
+				{
+					if (e.GetErrorCode() != MBEDTLS_ERR_SSL_WANT_WRITE)
+					{
+						throw;
+					}
+				}
+			}
+
+			const int ret = svr.RecvData(buf.data(), buf.size());
+			if (ret > 0)
+			{
+				recv += static_cast<size_t>(ret);
+			}
+			else if (ret != MBEDTLS_ERR_SSL_WANT_READ || sent >= total)
+			{
+				// Nothing more is coming.
+				throw mbedTLSRuntimeError(
+					ret != 0 ? ret : MBEDTLS_ERR_SSL_CONN_EOF,
+					"TlsLoadGen::Transfer - The transfer is incomplete."
+				);
+			}
+		}
+
+		return recv;
+	}
+
+	std::shared_ptr<const TlsConfig> m_svrConfig;
+	std::shared_ptr<const TlsConfig> m_cltConfig;
+	TlsLoadGenOptions m_options;
+
+}; // class TlsLoadGen
+
+
+} // namespace mbedTLScpp
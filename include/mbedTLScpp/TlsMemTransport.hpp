@@ -0,0 +1,271 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+
+#include "Internal/make_unique.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief A lock-free byte ring buffer, for exactly one producer thread and
+ *        one consumer thread. The producer only writes the tail, and the
+ *        consumer only writes the head; each side publishes its position
+ *        with a release store, and reads the other's with an acquire load.
+ *
+ */
+class TlsMemRingBuffer
+{
+public:
+
+	/**
+	 * @brief Construct a new ring buffer.
+	 *
+	 * @exception InvalidArgumentException Thrown when the capacity is not a
+	 *                                     non-zero power of 2.
+	 * @param capacity The capacity, in bytes.
+	 */
+	TlsMemRingBuffer(size_t capacity) :
+		m_buf(capacity),
+		m_mask(capacity - 1),
+		m_head(0),
+		m_tail(0)
+	{
+		if (capacity == 0 || (capacity & m_mask) != 0)
+		{
+			throw InvalidArgumentException(
+				"TlsMemRingBuffer::TlsMemRingBuffer"
+				" - The capacity must be a power of 2."
+			);
+		}
+	}
+
+	TlsMemRingBuffer(const TlsMemRingBuffer& other) = delete;
+	TlsMemRingBuffer(TlsMemRingBuffer&& other) = delete;
+
+	// LCOV_EXCL_START
+	~TlsMemRingBuffer() = default;
+	// LCOV_EXCL_STOP
+
+	TlsMemRingBuffer& operator=(const TlsMemRingBuffer& other) = delete;
+	TlsMemRingBuffer& operator=(TlsMemRingBuffer&& other) = delete;
+
+	/**
+	 * @brief Write as many bytes as there is room for; only called by the
+	 *        producer.
+	 *
+	 * @param buf The bytes to write.
+	 * @param len The number of bytes to write.
+	 * @return size_t The number of bytes written; 0 if the buffer is full.
+	 */
+	size_t Write(const void* buf, size_t len) noexcept
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		const size_t head = m_head.load(std::memory_order_acquire);
+		const size_t room = m_buf.size() - (tail - head);
+		const size_t toWrite = len < room ? len : room;
+
+		CopyIn(tail, static_cast<const uint8_t*>(buf), toWrite);
+
+		m_tail.store(tail + toWrite, std::memory_order_release);
+		return toWrite;
+	}
+
+	/**
+	 * @brief Read as many bytes as available; only called by the consumer.
+	 *
+	 * @param buf The buffer to read into.
+	 * @param len The size of the buffer.
+	 * @return size_t The number of bytes read; 0 if the buffer is empty.
+	 */
+	size_t Read(void* buf, size_t len) noexcept
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		const size_t tail = m_tail.load(std::memory_order_acquire);
+		const size_t avail = tail - head;
+		const size_t toRead = len < avail ? len : avail;
+
+		CopyOut(head, static_cast<uint8_t*>(buf), toRead);
+
+		m_head.store(head + toRead, std::memory_order_release);
+		return toRead;
+	}
+
+	/**
+	 * @brief Get the number of bytes available for reading; exact for the
+	 *        consumer, and a lower bound for the producer.
+	 *
+	 */
+	size_t GetSize() const noexcept
+	{
+		return m_tail.load(std::memory_order_acquire) -
+			m_head.load(std::memory_order_acquire);
+	}
+
+	size_t GetCapacity() const noexcept
+	{
+		return m_buf.size();
+	}
+
+private:
+
+	void CopyIn(size_t pos, const uint8_t* src, size_t len) noexcept
+	{
+		if (len == 0)
+		{
+			return;
+		}
+
+		const size_t begin = pos & m_mask;
+		const size_t first = (m_buf.size() - begin) < len ?
+			(m_buf.size() - begin) : len;
+
+		std::memcpy(m_buf.data() + begin, src, first);
+		std::memcpy(m_buf.data(), src + first, len - first);
+	}
+
+	void CopyOut(size_t pos, uint8_t* dst, size_t len) const noexcept
+	{
+		if (len == 0)
+		{
+			return;
+		}
+
+		const size_t begin = pos & m_mask;
+		const size_t first = (m_buf.size() - begin) < len ?
+			(m_buf.size() - begin) : len;
+
+		std::memcpy(dst, m_buf.data() + begin, first);
+		std::memcpy(dst + first, m_buf.data(), len - first);
+	}
+
+	std::vector<uint8_t> m_buf;
+	size_t m_mask;
+	// The positions only grow (and wrap around at the size_t limit, which
+	// keeps the differences correct); they are masked when indexing.
+	std::atomic<size_t> m_head;
+	std::atomic<size_t> m_tail;
+
+}; // class TlsMemRingBuffer
+
+
+/**
+ * @brief One end of an in-memory duplex transport, to be used as the
+ *        \c ConnType of \c Tls (e.g., for tests and load generation, see
+ *        \c TlsLoadGen ); the two ends may be used by two threads. It never
+ *        blocks: \c MBEDTLS_ERR_SSL_WANT_WRITE is returned when the peer's
+ *        buffer is full, and \c MBEDTLS_ERR_SSL_WANT_READ when there is
+ *        nothing to receive.
+ *
+ */
+class TlsMemConn
+{
+public: // Static members:
+
+	static constexpr size_t sk_defCapacity = 64 * 1024;
+
+	/**
+	 * @brief Create the two ends of a new duplex transport.
+	 *
+	 * @param capacity The capacity of the buffer in each direction, which
+	 *                 must be a power of 2; it should hold at least one
+	 *                 full TLS record.
+	 * @return The two ends.
+	 */
+	static std::pair<std::unique_ptr<TlsMemConn>, std::unique_ptr<TlsMemConn> >
+	CreatePair(size_t capacity = sk_defCapacity)
+	{
+		std::shared_ptr<TlsMemRingBuffer> aToB =
+			std::make_shared<TlsMemRingBuffer>(capacity);
+		std::shared_ptr<TlsMemRingBuffer> bToA =
+			std::make_shared<TlsMemRingBuffer>(capacity);
+
+		return std::make_pair(
+			Internal::make_unique<TlsMemConn>(aToB, bToA),
+			Internal::make_unique<TlsMemConn>(bToA, aToB)
+		);
+	}
+
+public:
+
+	TlsMemConn(
+		std::shared_ptr<TlsMemRingBuffer> sendBuf,
+		std::shared_ptr<TlsMemRingBuffer> recvBuf
+	) :
+		m_sendBuf(std::move(sendBuf)),
+		m_recvBuf(std::move(recvBuf))
+	{}
+
+	TlsMemConn(const TlsMemConn& other) = delete;
+	TlsMemConn(TlsMemConn&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsMemConn() = default;
+	// LCOV_EXCL_STOP
+
+	TlsMemConn& operator=(const TlsMemConn& other) = delete;
+	TlsMemConn& operator=(TlsMemConn&& other) = default;
+
+	virtual int Send(const void* buf, size_t len)
+	{
+		const size_t sent = m_sendBuf->Write(buf, len);
+		return (sent == 0 && len != 0) ?
+			MBEDTLS_ERR_SSL_WANT_WRITE :
+			static_cast<int>(sent);
+	}
+
+	virtual int Recv(void* buf, size_t len)
+	{
+		const size_t recv = m_recvBuf->Read(buf, len);
+		return (recv == 0 && len != 0) ?
+			MBEDTLS_ERR_SSL_WANT_READ :
+			static_cast<int>(recv);
+	}
+
+	virtual int RecvTimeout(void* buf, size_t len, uint32_t /* t */)
+	{
+		return Recv(buf, len);
+	}
+
+	/**
+	 * @brief Get the number of bytes waiting to be received on this end.
+	 *
+	 */
+	size_t GetRecvSize() const noexcept
+	{
+		return m_recvBuf->GetSize();
+	}
+
+private:
+
+	std::shared_ptr<TlsMemRingBuffer> m_sendBuf;
+	std::shared_ptr<TlsMemRingBuffer> m_recvBuf;
+
+}; // class TlsMemConn
+
+
+} // namespace mbedTLScpp
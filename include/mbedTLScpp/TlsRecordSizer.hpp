@@ -0,0 +1,197 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+
+#include <chrono>
+
+#include <mbedtls/ssl.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief Dynamic record sizing policy (see \c Tls::SetRecordSizer ).
+ *
+ *        A record can only be decrypted by the peer once all of it has
+ *        arrived; so, while the TCP congestion window is still small (i.e.,
+ *        at the beginning of a connection, or after it has been idle), a
+ *        full 16 KiB record spans many round trips, and delays the first
+ *        bytes of a response. This policy starts with records that fit in
+ *        one TCP segment, doubles the record size every few records (roughly
+ *        following the slow start of TCP), until the maximum size is
+ *        reached for bulk transfer; and goes back to small records after the
+ *        connection has been idle.
+ *
+ *        The methods are virtual, so the policy can be tuned by subclasses.
+ */
+class TlsRecordSizer
+{
+public: // Static members:
+
+	using ClockType = std::chrono::steady_clock;
+
+	/**
+	 * @brief The default size of the small records: a 1460 bytes TCP
+	 *        segment (Ethernet MTU, without TCP options), minus the IP/TCP
+	 *        options usually present, and the overhead of an AES-GCM record.
+	 */
+	static constexpr size_t sk_defSmallSize = 1369;
+
+	/**
+	 * @brief The default number of records sent at each size before the size
+	 *        is doubled; it matches the initial TCP congestion window of 10
+	 *        segments.
+	 */
+	static constexpr size_t sk_defRecordsPerStep = 10;
+
+	/**
+	 * @brief The default idle time after which the sizing starts over.
+	 */
+	static constexpr uint32_t sk_defIdleTimeoutMs = 1000;
+
+	/**
+	 * @brief The default maximum record size (the maximum plaintext length
+	 *        of a TLS record).
+	 */
+	static constexpr size_t sk_defMaxSize = MBEDTLS_SSL_OUT_CONTENT_LEN;
+
+public:
+
+	/**
+	 * @brief Construct a new record sizer.
+	 *
+	 * @exception InvalidArgumentException Thrown when the sizes are zero, or
+	 *                                     the small size is larger than the
+	 *                                     maximum size.
+	 * @param smallSize      The size of the records at the beginning, and
+	 *                       after idle.
+	 * @param maxSize        The size of the records for bulk transfer.
+	 * @param recordsPerStep The number of records sent at each size before
+	 *                       the size is doubled; 0 to never ramp up.
+	 * @param idleTimeoutMs  The idle time, in milliseconds, after which the
+	 *                       sizing starts over.
+	 */
+	TlsRecordSizer(
+		size_t smallSize = sk_defSmallSize,
+		size_t maxSize = sk_defMaxSize,
+		size_t recordsPerStep = sk_defRecordsPerStep,
+		uint32_t idleTimeoutMs = sk_defIdleTimeoutMs
+	) :
+		m_smallSize(smallSize),
+		m_maxSize(maxSize),
+		m_recordsPerStep(recordsPerStep),
+		m_idleTimeout(std::chrono::milliseconds(idleTimeoutMs)),
+		m_curSize(smallSize),
+		m_numOfRecordsAtSize(0),
+		m_lastSent(),
+		m_hasSent(false)
+	{
+		if (smallSize == 0 || maxSize < smallSize)
+		{
+			throw InvalidArgumentException(
+				"TlsRecordSizer::TlsRecordSizer"
+				" - The record sizes are invalid."
+			);
+		}
+	}
+
+	TlsRecordSizer(const TlsRecordSizer& other) = default;
+	TlsRecordSizer(TlsRecordSizer&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsRecordSizer() = default;
+	// LCOV_EXCL_STOP
+
+	TlsRecordSizer& operator=(const TlsRecordSizer& other) = default;
+	TlsRecordSizer& operator=(TlsRecordSizer&& other) = default;
+
+	/**
+	 * @brief Get the size of the next record to send.
+	 *
+	 * @param now The current time.
+	 * @return size_t The maximum number of bytes to put in the next record.
+	 */
+	virtual size_t GetRecordSize(ClockType::time_point now)
+	{
+		if (m_hasSent && (now - m_lastSent) > m_idleTimeout)
+		{
+			// The congestion window has probably been reduced while idle.
+			Restart();
+		}
+		return m_curSize;
+	}
+
+	/**
+	 * @brief Notify the policy that a record has been sent.
+	 *
+	 * @param size The number of bytes in the record.
+	 * @param now  The current time.
+	 */
+	virtual void OnSent(size_t size, ClockType::time_point now)
+	{
+		m_lastSent = now;
+		m_hasSent = true;
+
+		// Partial records (e.g., the end of a response) don't need more
+		// room, so they don't ramp the size up.
+		if (size < m_curSize || m_recordsPerStep == 0)
+		{
+			return;
+		}
+
+		++m_numOfRecordsAtSize;
+		if (m_numOfRecordsAtSize >= m_recordsPerStep && m_curSize < m_maxSize)
+		{
+			m_curSize = (m_curSize > (m_maxSize / 2)) ? m_maxSize : (m_curSize * 2);
+			m_numOfRecordsAtSize = 0;
+		}
+	}
+
+	/**
+	 * @brief Go back to small records.
+	 *
+	 */
+	virtual void Restart()
+	{
+		m_curSize = m_smallSize;
+		m_numOfRecordsAtSize = 0;
+	}
+
+	size_t GetCurrentSize() const noexcept
+	{
+		return m_curSize;
+	}
+
+private:
+
+	size_t m_smallSize;
+	size_t m_maxSize;
+	size_t m_recordsPerStep;
+	ClockType::duration m_idleTimeout;
+
+	size_t m_curSize;
+	size_t m_numOfRecordsAtSize;
+	ClockType::time_point m_lastSent;
+	bool m_hasSent;
+
+}; // class TlsRecordSizer
+
+
+} // namespace mbedTLScpp
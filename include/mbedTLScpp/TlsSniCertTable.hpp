@@ -0,0 +1,294 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <mbedtls/x509_crt.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "PKey.hpp"
+#include "X509Cert.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief A table that maps server names (as given in the SNI extension) to
+ *        the certificate chain and private key a server should present.
+ *        It's given to \c TlsConfig::SetSniCertTable , so that one TLS
+ *        config can serve any number of domains.
+ *
+ *        Host names are case-insensitive. A name may start with a wildcard
+ *        label (e.g., \c *.example.com ), which matches exactly one label
+ *        (i.e., \c www.example.com , but neither \c example.com nor
+ *        \c a.b.example.com ), and exact names take precedence over
+ *        wildcards. Since a wildcard covers one label only, a lookup takes
+ *        at most two hash table lookups, regardless of the size of the
+ *        table.
+ *
+ *        NOTE: The table is not thread-safe for modification; populate it
+ *        before giving it to the TLS config.
+ */
+class TlsSniCertTable
+{
+public: // Static members:
+
+	/**
+	 * @brief The certificate chain and private key of a server name.
+	 *
+	 */
+	struct Entry
+	{
+		std::shared_ptr<const X509Cert> m_chain;
+		std::shared_ptr<const PKeyBase<> > m_prvKey;
+	}; // struct Entry
+
+	/**
+	 * @brief Normalize a host name for lookup, i.e., convert it to lower
+	 *        case (only ASCII letters, as in DNS) and remove the trailing
+	 *        dot of a fully qualified name.
+	 *
+	 * @param name The pointer to the name.
+	 * @param len  The length of the name.
+	 * @return std::string The normalized name.
+	 */
+	static std::string NormalizeName(const char* name, size_t len)
+	{
+		if (len > 0 && name[len - 1] == '.')
+		{
+			--len;
+		}
+
+		std::string res(name, len);
+		for (char& ch : res)
+		{
+			if (ch >= 'A' && ch <= 'Z')
+			{
+				ch = static_cast<char>(ch - 'A' + 'a');
+			}
+		}
+		return res;
+	}
+
+public:
+
+	TlsSniCertTable() :
+		m_exact(),
+		m_wildcard(),
+		m_keyByCert()
+	{}
+
+	TlsSniCertTable(const TlsSniCertTable& other) = default;
+
+	TlsSniCertTable(TlsSniCertTable&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TlsSniCertTable() = default;
+	// LCOV_EXCL_STOP
+
+	TlsSniCertTable& operator=(const TlsSniCertTable& other) = default;
+
+	TlsSniCertTable& operator=(TlsSniCertTable&& other) = default;
+
+	/**
+	 * @brief Add the certificate chain and private key for the given host
+	 *        name. If the name is already in the table, its entry is
+	 *        replaced.
+	 *
+	 * @exception InvalidArgumentException Thrown when the name is invalid,
+	 *                                     or the chain or the key is null.
+	 * @param hostname The host name, or a wildcard name (e.g.,
+	 *                 \c *.example.com ).
+	 * @param chain    The certificate chain, leaf first.
+	 * @param prvKey   The private key of the leaf certificate.
+	 */
+	void Add(
+		const std::string& hostname,
+		std::shared_ptr<const X509Cert> chain,
+		std::shared_ptr<const PKeyBase<> > prvKey
+	)
+	{
+		if (chain == nullptr || prvKey == nullptr)
+		{
+			throw InvalidArgumentException(
+				"TlsSniCertTable::Add"
+				" - The certificate chain and the private key are required."
+			);
+		}
+		chain->NullCheck();
+		prvKey->NullCheck();
+
+		std::string name = NormalizeName(hostname.data(), hostname.size());
+
+		bool isWildcard = false;
+		if (name.size() > 2 && name[0] == '*' && name[1] == '.')
+		{
+			isWildcard = true;
+			name.erase(0, 2);
+		}
+
+		if (name.empty() ||
+			name.find('*') != std::string::npos ||
+			name.front() == '.')
+		{
+			throw InvalidArgumentException(
+				"TlsSniCertTable::Add - The given host name is invalid."
+			);
+		}
+
+		std::unordered_map<std::string, Entry>& map =
+			isWildcard ? m_wildcard : m_exact;
+
+		Entry& entry = map[name];
+		std::shared_ptr<const X509Cert> oldChain = std::move(entry.m_chain);
+		entry.m_chain  = std::move(chain);
+		entry.m_prvKey = std::move(prvKey);
+
+		m_keyByCert[entry.m_chain->Get()] = entry.m_prvKey;
+
+		// The replaced chain (and its key) is no longer reachable, unless
+		// another name still uses it.
+		if (oldChain != nullptr &&
+			oldChain->Get() != entry.m_chain->Get() &&
+			!IsChainInUse(oldChain->Get()))
+		{
+			m_keyByCert.erase(oldChain->Get());
+		}
+	}
+
+	/**
+	 * @brief Find the entry for the given server name.
+	 *
+	 * @param name The pointer to the server name.
+	 * @param len  The length of the server name.
+	 * @return const Entry* The entry; \c nullptr if there is no match.
+	 */
+	const Entry* Find(const char* name, size_t len) const
+	{
+		if (len == 0 || name == nullptr)
+		{
+			return nullptr;
+		}
+
+		const std::string normName = NormalizeName(name, len);
+
+		auto exactIt = m_exact.find(normName);
+		if (exactIt != m_exact.end())
+		{
+			return &(exactIt->second);
+		}
+
+		// A wildcard matches the first label only.
+		const size_t dotPos = normName.find('.');
+		if (dotPos != std::string::npos && dotPos > 0)
+		{
+			auto wildcardIt = m_wildcard.find(normName.substr(dotPos + 1));
+			if (wildcardIt != m_wildcard.end())
+			{
+				return &(wildcardIt->second);
+			}
+		}
+
+		return nullptr;
+	}
+
+	/**
+	 * @brief Find the entry for the given server name.
+	 *
+	 * @param name The server name.
+	 * @return const Entry* The entry; \c nullptr if there is no match.
+	 */
+	const Entry* Find(const std::string& name) const
+	{
+		return Find(name.data(), name.size());
+	}
+
+	/**
+	 * @brief Find the private key of the given leaf certificate in the
+	 *        table.
+	 *
+	 * @param cert The leaf certificate.
+	 * @return The private key; \c nullptr if the certificate isn't in the
+	 *         table.
+	 */
+	std::shared_ptr<const PKeyBase<> > FindPrivKey(
+		const mbedtls_x509_crt& cert
+	) const
+	{
+		auto it = m_keyByCert.find(&cert);
+		return it != m_keyByCert.end() ? it->second : nullptr;
+	}
+
+	/**
+	 * @brief Get the number of names (including wildcard names) in the
+	 *        table.
+	 *
+	 * @return size_t The number of names.
+	 */
+	size_t GetSize() const noexcept
+	{
+		return m_exact.size() + m_wildcard.size();
+	}
+
+	/**
+	 * @brief Get the mapping from the leaf certificates to their private
+	 *        keys.
+	 *
+	 */
+	const std::unordered_map<
+		const mbedtls_x509_crt*,
+		std::shared_ptr<const PKeyBase<> >
+	>& GetPrivKeys() const noexcept
+	{
+		return m_keyByCert;
+	}
+
+private:
+
+	bool IsChainInUse(const mbedtls_x509_crt* cert) const
+	{
+		for (const auto& item : m_exact)
+		{
+			if (item.second.m_chain->Get() == cert)
+			{
+				return true;
+			}
+		}
+		for (const auto& item : m_wildcard)
+		{
+			if (item.second.m_chain->Get() == cert)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::unordered_map<std::string, Entry> m_exact;
+	std::unordered_map<std::string, Entry> m_wildcard;
+	std::unordered_map<
+		const mbedtls_x509_crt*,
+		std::shared_ptr<const PKeyBase<> >
+	> m_keyByCert;
+
+}; // class TlsSniCertTable
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,236 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <mbedtls/x509_crt.h>
+
+#include "Common.hpp"
+#include "Exceptions.hpp"
+#include "Hash.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief A cache of certificate chains that have passed verification, so
+ *        that peers presenting the same chain again (e.g., clients of a
+ *        mutual TLS server) can skip the expensive part of the verification.
+ *        It's given to \c TlsConfig::SetVerifyCache .
+ *
+ *        Entries are keyed by the SHA-256 hash of the DER of every
+ *        certificate in the presented chain, together with the versions of
+ *        the trusted CAs and the CRLs; so, changing the CAs or the CRLs makes
+ *        the previous entries unreachable. Only successful verifications
+ *        are cached, and each entry expires after a fixed time to live.
+ *        When the cache is full, the oldest entries are evicted first.
+ *
+ *        The cache is thread-safe, and can be shared by multiple TLS
+ *        configs.
+ */
+class TlsVerifyCache
+{
+public: // Static members:
+
+	using ClockType = std::chrono::steady_clock;
+
+	/**
+	 * @brief Compute the cache key of a certificate chain.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param chain        The chain, starting from the certificate given;
+	 *                     i.e., the given certificate and every one after it.
+	 * @param trustVersion The version of the trusted CAs.
+	 * @param crlVersion   The version of the CRLs.
+	 * @return std::string The cache key.
+	 */
+	static std::string MakeKey(
+		const mbedtls_x509_crt& chain,
+		uint64_t trustVersion,
+		uint64_t crlVersion
+	)
+	{
+		KeyHasher hasher;
+
+		hasher.UpdateUint64(trustVersion);
+		hasher.UpdateUint64(crlVersion);
+		for (const mbedtls_x509_crt* cert = &chain;
+			cert != nullptr && cert->raw.p != nullptr;
+			cert = cert->next)
+		{
+			// Length prefixed, so the boundaries between the certificates
+			// are part of the key.
+			hasher.UpdateUint64(cert->raw.len);
+			hasher.UpdateRaw(cert->raw.p, cert->raw.len);
+		}
+
+		Hash<HashType::SHA256> hash = hasher.Finish();
+		return std::string(hash.m_data.begin(), hash.m_data.end());
+	}
+
+public:
+
+	/**
+	 * @brief Construct a new verification cache.
+	 *
+	 * @exception InvalidArgumentException Thrown when \c maxNumOfEntries is
+	 *                                     zero.
+	 * @param maxNumOfEntries The maximum number of chains cached.
+	 * @param ttl             How long a verification result is trusted.
+	 */
+	TlsVerifyCache(size_t maxNumOfEntries, ClockType::duration ttl) :
+		m_maxNumOfEntries(maxNumOfEntries),
+		m_ttl(ttl),
+		m_mutex(),
+		m_entries(),
+		m_order()
+	{
+		if (m_maxNumOfEntries == 0)
+		{
+			throw InvalidArgumentException(
+				"TlsVerifyCache::TlsVerifyCache"
+				" - The maximum number of entries must be greater than zero."
+			);
+		}
+	}
+
+	TlsVerifyCache(const TlsVerifyCache& other) = delete;
+	TlsVerifyCache(TlsVerifyCache&& other) = delete;
+
+	// LCOV_EXCL_START
+	virtual ~TlsVerifyCache() = default;
+	// LCOV_EXCL_STOP
+
+	TlsVerifyCache& operator=(const TlsVerifyCache& other) = delete;
+	TlsVerifyCache& operator=(TlsVerifyCache&& other) = delete;
+
+	/**
+	 * @brief Check if the chain of the given key has passed verification,
+	 *        and the result hasn't expired yet.
+	 *
+	 * @param key The cache key (see \c MakeKey ).
+	 * @return true if there is a valid entry for the key.
+	 */
+	bool Contains(const std::string& key) const
+	{
+		const ClockType::time_point now = ClockType::now();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_entries.find(key);
+		return it != m_entries.end() && now < it->second;
+	}
+
+	/**
+	 * @brief Record that the chain of the given key has passed verification.
+	 *
+	 * @param key The cache key (see \c MakeKey ).
+	 */
+	void Insert(const std::string& key)
+	{
+		const ClockType::time_point now = ClockType::now();
+		const ClockType::time_point expiry = now + m_ttl;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Entries expire in the order they are inserted, since they have the
+		// same time to live.
+		while (!m_order.empty() &&
+			(m_order.front().second <= now ||
+				m_entries.size() >= m_maxNumOfEntries))
+		{
+			EvictFront();
+		}
+
+		m_entries[key] = expiry;
+		m_order.emplace_back(key, expiry);
+	}
+
+	/**
+	 * @brief Remove all entries.
+	 *
+	 */
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_order.clear();
+	}
+
+	/**
+	 * @brief Get the number of entries, including the ones that have expired
+	 *        but haven't been evicted yet.
+	 *
+	 * @return size_t The number of entries.
+	 */
+	size_t GetSize() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries.size();
+	}
+
+private:
+
+	class KeyHasher : public Hasher<HashType::SHA256>
+	{
+	public:
+
+		KeyHasher() :
+			Hasher()
+		{}
+
+		void UpdateRaw(const void* data, size_t size)
+		{
+			UpdateNoCheck(data, size);
+		}
+
+		void UpdateUint64(uint64_t val)
+		{
+			uint8_t bytes[sizeof(val)];
+			for (size_t i = 0; i < sizeof(val); ++i)
+			{
+				bytes[i] = static_cast<uint8_t>((val >> (i * 8)) & 0xFFU);
+			}
+			UpdateNoCheck(bytes, sizeof(bytes));
+		}
+	}; // class KeyHasher
+
+	void EvictFront()
+	{
+		auto it = m_entries.find(m_order.front().first);
+		// The entry may have been re-inserted after this record.
+		if (it != m_entries.end() && it->second == m_order.front().second)
+		{
+			m_entries.erase(it);
+		}
+		m_order.pop_front();
+	}
+
+	size_t m_maxNumOfEntries;
+	ClockType::duration m_ttl;
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, ClockType::time_point> m_entries;
+	std::deque<std::pair<std::string, ClockType::time_point> > m_order;
+
+}; // class TlsVerifyCache
+
+
+} // namespace mbedTLScpp
@@ -0,0 +1,389 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <mbedtls/platform.h>
+#include <mbedtls/x509_crt.h>
+
+#include "Common.hpp"
+#include "Container.hpp"
+#include "Exceptions.hpp"
+#include "X509Cert.hpp"
+
+#include "Internal/X509Helper.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief A set of trusted CA certificates, indexed by subject name and by
+ *        subject key identifier.
+ *
+ *        When a CA chain is given to mbed TLS with
+ *        \c mbedtls_ssl_conf_ca_chain , finding the issuer of a certificate
+ *        walks the whole CA list, and compares the names of every CA; this
+ *        becomes expensive with large trust stores (e.g., a system bundle
+ *        with hundreds of roots). Instead, this store is plugged in through
+ *        the trusted-CA callback (see \c TlsConfig::SetTrustStore and
+ *        \c VerifyChain ), and only the CAs whose subject matches the issuer
+ *        of the certificate are handed to mbed TLS.
+ *
+ *        NOTE: The store is not thread-safe for modification; populate it
+ *        before giving it to a TLS config. The store must outlive every
+ *        verification that uses it.
+ */
+class TrustStore
+{
+public: // Static members:
+
+	/**
+	 * @brief The callback given to mbed TLS
+	 *        (see \c mbedtls_x509_crt_ca_cb_t ) that finds the candidate
+	 *        issuers of a certificate.
+	 *
+	 * @param inst          The pointer to the \c TrustStore instance.
+	 * @param child         The certificate whose issuer is looked for.
+	 * @param candidateCas  Receives the list of candidates, which is
+	 *                      freed by mbed TLS; \c nullptr if there is none.
+	 * @return int The mbed TLS error code.
+	 */
+	static int CaCallBack(
+		void* inst,
+		const mbedtls_x509_crt* child,
+		mbedtls_x509_crt** candidateCas
+	) noexcept
+	{
+		if (inst == nullptr || child == nullptr || candidateCas == nullptr)
+		{
+			return MBEDTLS_ERR_X509_BAD_INPUT_DATA;
+		}
+		*candidateCas = nullptr;
+
+		const TrustStore* store = static_cast<const TrustStore*>(inst);
+
+		mbedtls_x509_crt* res = nullptr;
+		int ret = MBEDTLS_EXIT_SUCCESS;
+		try
+		{
+			for (const mbedtls_x509_crt* ca : store->FindIssuers(*child))
+			{
+				if (res == nullptr)
+				{
+					res = static_cast<mbedtls_x509_crt*>(
+						mbedtls_calloc(1, sizeof(mbedtls_x509_crt))
+					);
+					if (res == nullptr)
+					{
+						return MBEDTLS_ERR_X509_ALLOC_FAILED;
+					}
+					mbedtls_x509_crt_init(res);
+				}
+
+				// The raw DER is owned by the store, so the candidates only
+				// reference it.
+				ret = mbedtls_x509_crt_parse_der_nocopy(
+					res, ca->raw.p, ca->raw.len
+				);
+				if (ret != MBEDTLS_EXIT_SUCCESS)
+				{
+					break;
+				}
+			}
+		}
+		catch (...)
+		{
+			ret = MBEDTLS_ERR_X509_ALLOC_FAILED;
+		}
+
+		if (ret != MBEDTLS_EXIT_SUCCESS)
+		{
+			if (res != nullptr)
+			{
+				mbedtls_x509_crt_free(res);
+				mbedtls_free(res);
+			}
+			return ret;
+		}
+
+		*candidateCas = res;
+		return MBEDTLS_EXIT_SUCCESS;
+	}
+
+public:
+
+	TrustStore() :
+		m_certs(X509Cert::Empty()),
+		m_tail(nullptr),
+		m_size(0),
+		m_version(Internal::NewX509TrustVersion()),
+		m_bySubject(),
+		m_byKeyId()
+	{}
+
+	TrustStore(const TrustStore& other) = delete;
+
+	TrustStore(TrustStore&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~TrustStore() = default;
+	// LCOV_EXCL_STOP
+
+	TrustStore& operator=(const TrustStore& other) = delete;
+
+	TrustStore& operator=(TrustStore&& other) = default;
+
+	/**
+	 * @brief Add every certificate in the given chain to the store.
+	 *        Certificates that are already in the store are skipped.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param certs The certificate(s) to trust.
+	 */
+	template<typename _X509CertObjTrait>
+	void Add(const X509CertBase<_X509CertObjTrait>& certs)
+	{
+		certs.NullCheck();
+
+		for (const mbedtls_x509_crt* cert = certs.Get();
+			cert != nullptr && cert->raw.p != nullptr;
+			cert = cert->next)
+		{
+			AddOne(*cert);
+		}
+	}
+
+	/**
+	 * @brief Take every certificate in the given chain into the store,
+	 *        without copying them (e.g., a large bundle loaded by
+	 *        \c X509CertBundleLoader ). Certificates that are already in the
+	 *        store are skipped. The given chain will be empty afterwards.
+	 *
+	 * @exception InvalidObjectException Thrown when the given chain is null.
+	 * @param certs The certificate(s) to trust.
+	 */
+	void Add(X509Cert&& certs)
+	{
+		certs.NullCheck();
+
+		m_certs.AppendChain(std::move(certs));
+
+		const mbedtls_x509_crt* cert =
+			(m_tail == nullptr) ? m_certs.Get() : m_tail->next;
+		for (; cert != nullptr && cert->raw.p != nullptr; cert = cert->next)
+		{
+			// Duplicates stay in the list, but they are never indexed.
+			std::string subjKey = Internal::GetX509NameLookupKey(cert->subject);
+			if (!IsInStore(*cert, subjKey))
+			{
+				Index(cert, std::move(subjKey));
+			}
+			m_tail = cert;
+		}
+	}
+
+	/**
+	 * @brief Find the trusted CAs that may have issued the given
+	 *        certificate, i.e., whose subject matches its issuer. CAs whose
+	 *        subject key identifier matches the authority key identifier of
+	 *        the certificate come first.
+	 *
+	 * @param child The certificate whose issuer is looked for.
+	 * @return std::vector<const mbedtls_x509_crt*> The candidates.
+	 */
+	std::vector<const mbedtls_x509_crt*> FindIssuers(
+		const mbedtls_x509_crt& child
+	) const
+	{
+		std::vector<const mbedtls_x509_crt*> res;
+
+		const std::string issuerKey = Internal::GetX509NameLookupKey(child.issuer);
+		auto subjRange = m_bySubject.equal_range(issuerKey);
+		if (subjRange.first == subjRange.second)
+		{
+			return res;
+		}
+
+		const mbedtls_x509_buf& aki = child.authority_key_id.keyIdentifier;
+		if (aki.p != nullptr && aki.len > 0)
+		{
+			auto kidRange = m_byKeyId.equal_range(
+				std::string(reinterpret_cast<const char*>(aki.p), aki.len)
+			);
+			for (auto it = kidRange.first; it != kidRange.second; ++it)
+			{
+				if (Internal::GetX509NameLookupKey(it->second->subject) ==
+					issuerKey)
+				{
+					res.push_back(it->second);
+				}
+			}
+		}
+
+		const size_t numOfKidMatches = res.size();
+		for (auto it = subjRange.first; it != subjRange.second; ++it)
+		{
+			bool isListed = false;
+			for (size_t i = 0; i < numOfKidMatches && !isListed; ++i)
+			{
+				isListed = (res[i] == it->second);
+			}
+			if (!isListed)
+			{
+				res.push_back(it->second);
+			}
+		}
+
+		return res;
+	}
+
+	/**
+	 * @brief Verify the given certificate chain against the CAs in this
+	 *        store.
+	 *
+	 *        NOTE: CRLs are not checked by mbed TLS when the trusted CAs are
+	 *        given through the callback.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call
+	 *                                failed, including when the verification
+	 *                                failed.
+	 * @param chain     The certificate chain to verify, leaf first.
+	 * @param cn        The expected Common Name; can be \c nullptr .
+	 * @param flags     Receives the verification result flags.
+	 * @param prof      The security profile for the verification.
+	 * @param vrfyFunc  The verification callback; can be \c nullptr .
+	 * @param vrfyParam The parameter given to the verification callback.
+	 */
+	template<typename _X509CertObjTrait>
+	void VerifyChain(
+		const X509CertBase<_X509CertObjTrait>& chain,
+		const char* cn,
+		uint32_t& flags,
+		const mbedtls_x509_crt_profile& prof,
+		typename X509CertBase<_X509CertObjTrait>::VerifyFunc vrfyFunc,
+		void* vrfyParam
+	) const
+	{
+		chain.NullCheck();
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			TrustStore::VerifyChain,
+			mbedtls_x509_crt_verify_with_ca_cb,
+			// mbed TLS doesn't modify the chain; the parameter just isn't
+			// declared as const.
+			const_cast<mbedtls_x509_crt*>(chain.Get()),
+			&TrustStore::CaCallBack,
+			const_cast<TrustStore*>(this),
+			&prof,
+			cn,
+			&flags,
+			vrfyFunc,
+			vrfyParam
+		);
+	}
+
+	/**
+	 * @brief Get the number of certificates in the store.
+	 *
+	 * @return size_t The number of certificates.
+	 */
+	size_t GetSize() const noexcept
+	{
+		return m_size;
+	}
+
+	/**
+	 * @brief Get the version of the store, which changes whenever a
+	 *        certificate is added.
+	 *
+	 * @return uint64_t The version.
+	 */
+	uint64_t GetVersion() const noexcept
+	{
+		return m_version;
+	}
+
+private:
+
+	bool IsInStore(
+		const mbedtls_x509_crt& cert,
+		const std::string& subjKey
+	) const
+	{
+		auto subjRange = m_bySubject.equal_range(subjKey);
+		for (auto it = subjRange.first; it != subjRange.second; ++it)
+		{
+			const mbedtls_x509_buf& raw = it->second->raw;
+			if (raw.len == cert.raw.len &&
+				std::memcmp(raw.p, cert.raw.p, raw.len) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void AddOne(const mbedtls_x509_crt& cert)
+	{
+		std::string subjKey = Internal::GetX509NameLookupKey(cert.subject);
+		if (IsInStore(cert, subjKey))
+		{
+			return;
+		}
+
+		std::vector<uint8_t> der(cert.raw.p, cert.raw.p + cert.raw.len);
+		m_certs.AppendDER(CtnFullR(der));
+
+		const mbedtls_x509_crt* added =
+			(m_tail == nullptr) ? m_certs.Get() : m_tail->next;
+		m_tail = added;
+
+		Index(added, std::move(subjKey));
+	}
+
+	void Index(const mbedtls_x509_crt* added, std::string subjKey)
+	{
+		// Nodes of the list never move, so they can be indexed by pointer.
+		++m_size;
+		m_version = Internal::NewX509TrustVersion();
+
+		m_bySubject.emplace(std::move(subjKey), added);
+
+		const mbedtls_x509_buf& ski = added->subject_key_id;
+		if (ski.p != nullptr && ski.len > 0)
+		{
+			m_byKeyId.emplace(
+				std::string(reinterpret_cast<const char*>(ski.p), ski.len),
+				added
+			);
+		}
+	}
+
+	X509Cert m_certs;
+	const mbedtls_x509_crt* m_tail;
+	size_t m_size;
+	uint64_t m_version;
+	std::unordered_multimap<std::string, const mbedtls_x509_crt*> m_bySubject;
+	std::unordered_multimap<std::string, const mbedtls_x509_crt*> m_byKeyId;
+
+}; // class TrustStore
+
+
+} // namespace mbedTLScpp
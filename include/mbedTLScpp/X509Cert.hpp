@@ -3,7 +3,10 @@
 #include "ObjectBase.hpp"
 
 #include <map>
+#include <memory>
+#include <new>
 
+#include <mbedtls/platform.h>
 #include <mbedtls/x509_crt.h>
 
 #include "BigNumber.hpp"
@@ -489,6 +492,33 @@ public: // Static members:
 	}
 
 
+	/**
+	 * @brief Construct a X509 certificate from a given DER bytes, without
+	 *        copying them; i.e., the parsed certificate references the given
+	 *        buffer, which must stay alive and unchanged as long as the
+	 *        certificate is in use.
+	 *        Unlike \c FromDER , this saves a heap allocation and a copy of
+	 *        the whole DER, which adds up when loading large bundles.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param der      DER bytes referenced by ContCtnReadOnlyRef
+	 * @param derOwner The owner of the buffer (e.g., the \c shared_ptr
+	 *                 holding the blob, or the memory mapping), which is kept
+	 *                 alive by the certificate; can be \c nullptr , if the
+	 *                 caller guarantees the lifetime of the buffer.
+	 */
+	template<typename _SecCtnType>
+	static X509CertBase<DefaultX509CertObjTrait> FromDERNoCopy(
+		const ContCtnReadOnlyRef<_SecCtnType, false>& der,
+		std::shared_ptr<const void> derOwner
+	)
+	{
+		X509CertBase<DefaultX509CertObjTrait> cert;
+		cert.AppendDERNoCopy(der, std::move(derOwner));
+		return cert;
+	}
+
+
 	static X509CertBase<DefaultX509CertObjTrait> Empty()
 	{
 		X509CertBase<DefaultX509CertObjTrait> cert;
@@ -507,7 +537,8 @@ public:
 	X509CertBase(X509CertBase&& rhs) :
 		_Base::ObjectBase(std::forward<_Base>(rhs)), //noexcept
 		m_certStack(std::move(rhs.m_certStack)),
-		m_currPtr(rhs.m_currPtr)
+		m_currPtr(rhs.m_currPtr),
+		m_derOwners(std::move(rhs.m_derOwners))
 	{
 		rhs.m_currPtr = nullptr;
 	}
@@ -527,7 +558,8 @@ public:
 	X509CertBase(mbedtls_x509_crt* ptr) :
 		_Base::ObjectBase(ptr),
 		m_certStack(1, NonVirtualGet()),
-		m_currPtr(NonVirtualGet())
+		m_currPtr(NonVirtualGet()),
+		m_derOwners()
 	{}
 
 
@@ -554,6 +586,7 @@ public:
 		{
 			m_certStack = std::move(rhs.m_certStack);
 			m_currPtr = rhs.m_currPtr;
+			m_derOwners = std::move(rhs.m_derOwners);
 
 			rhs.m_currPtr = nullptr;
 		}
@@ -1168,6 +1201,121 @@ public:
 	}
 
 
+	/**
+	 * @brief Append a certificate in DER to the end of the chain, without
+	 *        copying it (see \c FromDERNoCopy ).
+	 *
+	 *        NOTE: mbed TLS doesn't support the extension callback in this
+	 *        mode, so unknown critical extensions are always rejected.
+	 *
+	 * @exception mbedTLSRuntimeError Thrown when mbed TLS C function call failed.
+	 * @param der      DER bytes referenced by ContCtnReadOnlyRef
+	 * @param derOwner The owner of the buffer, which is kept alive by this
+	 *                 certificate chain; can be \c nullptr , if the caller
+	 *                 guarantees the lifetime of the buffer.
+	 */
+	template<
+		typename _SecCtnType,
+		typename _dummy_CertTrait = X509CertTrait,
+		enable_if_t<
+			!_dummy_CertTrait::sk_isBorrower && !_dummy_CertTrait::sk_isConst,
+			int
+		> = 0
+	>
+	void AppendDERNoCopy(
+		const ContCtnReadOnlyRef<_SecCtnType, false>& der,
+		std::shared_ptr<const void> derOwner
+	)
+	{
+		if (derOwner != nullptr)
+		{
+			// Reserve first, so nothing is thrown after the parsing.
+			m_derOwners.reserve(m_derOwners.size() + 1);
+		}
+
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			X509CertBase::AppendDERNoCopy,
+			mbedtls_x509_crt_parse_der_nocopy,
+			Get(),
+			der.BeginBytePtr(),
+			der.GetRegionSize()
+		);
+
+		if (derOwner != nullptr)
+		{
+			m_derOwners.push_back(std::move(derOwner));
+		}
+	}
+
+
+	/**
+	 * @brief Move every certificate of the given chain to the end of this
+	 *        chain, without copying or parsing them again (e.g., to join the
+	 *        chains parsed on different threads). The given chain will be
+	 *        empty afterwards.
+	 *
+	 * @exception InvalidObjectException Thrown when either chain is null.
+	 * @exception std::bad_alloc         Thrown when memory allocation failed.
+	 * @param other The chain to be appended.
+	 */
+	template<
+		typename _dummy_CertTrait = X509CertTrait,
+		enable_if_t<
+			!_dummy_CertTrait::sk_isBorrower && !_dummy_CertTrait::sk_isConst,
+			int
+		> = 0
+	>
+	void AppendChain(X509CertBase&& other)
+	{
+		NullCheck();
+		other.NullCheck();
+
+		mbedtls_x509_crt* otherHead = other.Get();
+		if (this == &other || otherHead->version == 0)
+		{
+			// Nothing to append.
+			return;
+		}
+
+		m_derOwners.reserve(m_derOwners.size() + other.m_derOwners.size());
+
+		mbedtls_x509_crt* tail = Get();
+		while (tail->next != nullptr)
+		{
+			tail = tail->next;
+		}
+
+		// The head of a chain is owned by the C++ object, while the rest of
+		// the nodes are allocated by mbed TLS; so the content of the other
+		// head is moved into a new node (the content doesn't point to the
+		// node itself), and the nodes after it are linked as they are.
+		if (tail->version == 0)
+		{
+			*tail = *otherHead;
+		}
+		else
+		{
+			mbedtls_x509_crt* node = static_cast<mbedtls_x509_crt*>(
+				mbedtls_calloc(1, sizeof(mbedtls_x509_crt))
+			);
+			if (node == nullptr)
+			{
+				throw std::bad_alloc();
+			}
+			*node = *otherHead;
+			tail->next = node;
+		}
+		mbedtls_x509_crt_init(otherHead);
+		other.GoToFirstCert();
+
+		for (std::shared_ptr<const void>& owner : other.m_derOwners)
+		{
+			m_derOwners.push_back(std::move(owner));
+		}
+		other.m_derOwners.clear();
+	}
+
+
 protected:
 
 
@@ -1180,7 +1328,8 @@ protected:
 	X509CertBase() :
 		_Base::ObjectBase(),
 		m_certStack(1, NonVirtualGet()),
-		m_currPtr(NonVirtualGet())
+		m_currPtr(NonVirtualGet()),
+		m_derOwners()
 	{}
 
 
@@ -1235,6 +1384,9 @@ private:
 
 	std::vector<CObjPtrType> m_certStack;
 	CObjPtrType m_currPtr; // For noexcept
+	// Owners of the buffers referenced by the certificates parsed without
+	// copying.
+	std::vector<std::shared_ptr<const void> > m_derOwners;
 
 
 }; // class X509CertBase
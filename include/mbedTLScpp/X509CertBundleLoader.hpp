@@ -0,0 +1,477 @@
+// Copyright (c) 2022 Haofan Zheng
+// Use of this source code is governed by an MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT.
+
+
+#pragma once
+
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mbedtls/asn1.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/x509_crt.h>
+
+#include "Common.hpp"
+#include "Container.hpp"
+#include "Exceptions.hpp"
+#include "TrustStore.hpp"
+#include "X509Cert.hpp"
+
+#include "Internal/FileMapping.hpp"
+
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+namespace mbedTLScpp
+#else
+namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+#endif
+{
+
+
+/**
+ * @brief Loads large certificate bundles (e.g., a CA bundle, or a
+ *        certificate inventory with tens of thousands of certificates) into
+ *        one certificate chain, or into a \c TrustStore .
+ *
+ *        Unlike \c X509Cert::FromPEM , which decodes and parses the
+ *        certificates one by one, the loader first finds the boundaries of
+ *        every certificate in the bundle, and then decodes and parses slices
+ *        of the bundle on multiple threads; the chains of the slices are
+ *        joined at the end without copying, in the order they appear in the
+ *        bundle. Nothing is copied from DER bundles, which are referenced by
+ *        the parsed certificates; PEM bundles are decoded into one buffer per
+ *        slice, and aren't kept after the loading.
+ *
+ *        Both PEM bundles (certificates between \c BEGIN/END \c CERTIFICATE
+ *        lines; anything else is ignored) and DER bundles (concatenated DER
+ *        certificates) are supported, and detected automatically.
+ *        Loading fails if any certificate in the bundle is invalid.
+ */
+class X509CertBundleLoader
+{
+public: // Static members:
+
+	/**
+	 * @brief The minimum number of certificates parsed by a thread; smaller
+	 *        bundles aren't worth the cost of starting threads.
+	 *
+	 */
+	static constexpr size_t sk_minCertsPerThread = 16;
+
+	/**
+	 * @brief A region of the bundle that holds a certificate; i.e., the
+	 *        Base64 body for PEM bundles, or the DER for DER bundles.
+	 *
+	 */
+	struct Region
+	{
+		const uint8_t* m_data;
+		size_t m_size;
+	}; // struct Region
+
+	/**
+	 * @brief Check if the given bundle is in PEM format.
+	 *
+	 * @param data The pointer to the bundle.
+	 * @param size The size of the bundle.
+	 * @return true if there is a PEM certificate header in the bundle.
+	 */
+	static bool IsPem(const uint8_t* data, size_t size) noexcept
+	{
+		return Find(data, data + size, GetPemHeader()) != (data + size);
+	}
+
+	/**
+	 * @brief Find the Base64 bodies of the certificates in the given PEM
+	 *        bundle.
+	 *
+	 * @exception InvalidArgumentException Thrown when a certificate has no
+	 *                                     footer.
+	 * @param data The pointer to the bundle.
+	 * @param size The size of the bundle.
+	 * @return std::vector<Region> The bodies of the certificates.
+	 */
+	static std::vector<Region> FindPemCerts(const uint8_t* data, size_t size)
+	{
+		const std::string& header = GetPemHeader();
+		const std::string& footer = GetPemFooter();
+
+		std::vector<Region> res;
+
+		const uint8_t* end = data + size;
+		const uint8_t* pos = Find(data, end, header);
+		while (pos != end)
+		{
+			const uint8_t* bodyBegin = pos + header.size();
+			const uint8_t* bodyEnd = Find(bodyBegin, end, footer);
+			if (bodyEnd == end)
+			{
+				throw InvalidArgumentException(
+					"X509CertBundleLoader::FindPemCerts"
+					" - The bundle has a certificate without a footer."
+				);
+			}
+			res.push_back(
+				Region{ bodyBegin, static_cast<size_t>(bodyEnd - bodyBegin) }
+			);
+
+			pos = Find(bodyEnd + footer.size(), end, header);
+		}
+
+		return res;
+	}
+
+	/**
+	 * @brief Find the certificates in the given DER bundle.
+	 *
+	 * @exception InvalidArgumentException Thrown when the bundle is not a
+	 *                                     sequence of DER certificates.
+	 * @param data The pointer to the bundle.
+	 * @param size The size of the bundle.
+	 * @return std::vector<Region> The DER of the certificates.
+	 */
+	static std::vector<Region> FindDerCerts(const uint8_t* data, size_t size)
+	{
+		std::vector<Region> res;
+
+		const unsigned char* end = data + size;
+		unsigned char* pos = const_cast<unsigned char*>(data);
+		while (pos < end)
+		{
+			const unsigned char* certBegin = pos;
+			size_t len = 0;
+			if (mbedtls_asn1_get_tag(
+					&pos, end, &len,
+					MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE
+				) != 0)
+			{
+				throw InvalidArgumentException(
+					"X509CertBundleLoader::FindDerCerts"
+					" - The bundle is not a sequence of DER certificates."
+				);
+			}
+			pos += len;
+
+			res.push_back(
+				Region{ certBegin, static_cast<size_t>(pos - certBegin) }
+			);
+		}
+
+		return res;
+	}
+
+public:
+
+	/**
+	 * @brief Construct a new bundle loader.
+	 *
+	 * @param numOfThreads The maximum number of threads used for parsing,
+	 *                     including the calling thread; \c 0 to use the
+	 *                     number of hardware threads.
+	 */
+	explicit X509CertBundleLoader(size_t numOfThreads = 0) :
+		m_numOfThreads(numOfThreads)
+	{
+		if (m_numOfThreads == 0)
+		{
+			m_numOfThreads = std::max<size_t>(
+				1, std::thread::hardware_concurrency()
+			);
+		}
+	}
+
+	X509CertBundleLoader(const X509CertBundleLoader& other) = default;
+
+	X509CertBundleLoader(X509CertBundleLoader&& other) = default;
+
+	// LCOV_EXCL_START
+	virtual ~X509CertBundleLoader() = default;
+	// LCOV_EXCL_STOP
+
+	X509CertBundleLoader& operator=(const X509CertBundleLoader& other) = default;
+
+	X509CertBundleLoader& operator=(X509CertBundleLoader&& other) = default;
+
+	/**
+	 * @brief Parse every certificate in the given bundle into one chain.
+	 *
+	 * @exception InvalidArgumentException Thrown when the bundle is malformed,
+	 *                                     or has no certificate.
+	 * @exception mbedTLSRuntimeError      Thrown when mbed TLS C function
+	 *                                     call failed, including when a
+	 *                                     certificate is invalid.
+	 * @param bundle      The bundle referenced by ContCtnReadOnlyRef
+	 * @param bundleOwner The owner of a DER bundle, which is kept alive by
+	 *                    the chain (see \c X509Cert::FromDERNoCopy ); can be
+	 *                    \c nullptr , if the caller guarantees the lifetime
+	 *                    of the bundle. It's not needed for PEM bundles.
+	 * @return X509Cert The certificate chain, in the order of the bundle.
+	 */
+	template<typename _SecCtnType>
+	X509Cert Parse(
+		const ContCtnReadOnlyRef<_SecCtnType, false>& bundle,
+		std::shared_ptr<const void> bundleOwner
+	) const
+	{
+		const uint8_t* data = bundle.BeginBytePtr();
+		const size_t size = bundle.GetRegionSize();
+
+		const bool isPem = IsPem(data, size);
+		const std::vector<Region> regions = isPem ?
+			FindPemCerts(data, size) :
+			FindDerCerts(data, size);
+		if (regions.empty())
+		{
+			throw InvalidArgumentException(
+				"X509CertBundleLoader::Parse"
+				" - No certificate is found in the bundle."
+			);
+		}
+
+		return ParseRegions(regions, isPem, bundleOwner);
+	}
+
+#ifdef MBEDTLSCPP_INTERNAL_FILE_MAPPING
+	/**
+	 * @brief Load every certificate in the given bundle file into one chain.
+	 *        The file is memory-mapped rather than read; a DER bundle stays
+	 *        mapped as long as the chain is alive.
+	 *
+	 * @exception RuntimeException Thrown when the file can't be mapped, the
+	 *                             bundle is malformed, or a certificate is
+	 *                             invalid (see \c Parse ).
+	 * @param path The path to the bundle file.
+	 * @return X509Cert The certificate chain, in the order of the bundle.
+	 */
+	X509Cert LoadFile(const std::string& path) const
+	{
+		std::shared_ptr<const Internal::MappedFile> file =
+			std::make_shared<Internal::MappedFile>(path);
+
+		return Parse(
+			CtnFullR(CDynArray<const uint8_t>{ file->GetData(), file->GetSize() }),
+			file
+		);
+	}
+
+	/**
+	 * @brief Load every certificate in the given bundle file into the given
+	 *        trust store (see \c LoadFile ).
+	 *
+	 * @exception RuntimeException Thrown when the loading failed.
+	 * @param path  The path to the bundle file.
+	 * @param store The trust store.
+	 */
+	void LoadFile(const std::string& path, TrustStore& store) const
+	{
+		store.Add(LoadFile(path));
+	}
+#endif // MBEDTLSCPP_INTERNAL_FILE_MAPPING
+
+	/**
+	 * @brief Get the maximum number of threads used for parsing.
+	 *
+	 * @return size_t The maximum number of threads.
+	 */
+	size_t GetNumOfThreads() const noexcept
+	{
+		return m_numOfThreads;
+	}
+
+private: // Static members:
+
+	static const std::string& GetPemHeader()
+	{
+		static const std::string sk_header = "-----BEGIN CERTIFICATE-----";
+		return sk_header;
+	}
+
+	static const std::string& GetPemFooter()
+	{
+		static const std::string sk_footer = "-----END CERTIFICATE-----";
+		return sk_footer;
+	}
+
+	static const uint8_t* Find(
+		const uint8_t* begin,
+		const uint8_t* end,
+		const std::string& pattern
+	) noexcept
+	{
+		const size_t patLen = pattern.size();
+		while (static_cast<size_t>(end - begin) >= patLen)
+		{
+			const void* found = std::memchr(
+				begin, pattern[0], static_cast<size_t>(end - begin) - patLen + 1
+			);
+			if (found == nullptr)
+			{
+				break;
+			}
+			begin = static_cast<const uint8_t*>(found);
+			if (std::memcmp(begin, pattern.data(), patLen) == 0)
+			{
+				return begin;
+			}
+			++begin;
+		}
+		return end;
+	}
+
+	static X509Cert ParsePemSlice(const Region* begin, const Region* end)
+	{
+		// Every certificate of the slice is decoded into one buffer, which
+		// never grows, so the certificates can reference it.
+		size_t bufSize = 0;
+		for (const Region* region = begin; region != end; ++region)
+		{
+			bufSize += ((region->m_size / 4) + 1) * 3;
+		}
+		std::shared_ptr<std::vector<uint8_t> > buf =
+			std::make_shared<std::vector<uint8_t> >(bufSize);
+		std::shared_ptr<const void> bufOwner = buf;
+
+		X509Cert chain = X509Cert::Empty();
+		size_t offset = 0;
+		for (const Region* region = begin; region != end; ++region)
+		{
+			size_t derLen = 0;
+			MBEDTLSCPP_MAKE_C_FUNC_CALL(
+				X509CertBundleLoader::ParsePemSlice,
+				mbedtls_base64_decode,
+				buf->data() + offset,
+				buf->size() - offset,
+				&derLen,
+				region->m_data,
+				region->m_size
+			);
+
+			// The chain takes the buffer with the first certificate.
+			chain.AppendDERNoCopy(
+				CtnFullR(CDynArray<const uint8_t>{ buf->data() + offset, derLen }),
+				std::move(bufOwner)
+			);
+			offset += derLen;
+		}
+
+		return chain;
+	}
+
+	static X509Cert ParseDerSlice(
+		const Region* begin,
+		const Region* end,
+		std::shared_ptr<const void> bundleOwner
+	)
+	{
+		X509Cert chain = X509Cert::Empty();
+		for (const Region* region = begin; region != end; ++region)
+		{
+			// The chain takes the owner with the first certificate.
+			chain.AppendDERNoCopy(
+				CtnFullR(CDynArray<const uint8_t>{ region->m_data, region->m_size }),
+				std::move(bundleOwner)
+			);
+		}
+
+		return chain;
+	}
+
+private:
+
+	X509Cert ParseRegions(
+		const std::vector<Region>& regions,
+		bool isPem,
+		const std::shared_ptr<const void>& bundleOwner
+	) const
+	{
+		const size_t numOfSlices = std::max<size_t>(
+			1,
+			std::min(
+				m_numOfThreads,
+				regions.size() / sk_minCertsPerThread
+			)
+		);
+
+		std::vector<X509Cert> chains;
+		chains.reserve(numOfSlices);
+		for (size_t i = 0; i < numOfSlices; ++i)
+		{
+			chains.push_back(X509Cert::Empty());
+		}
+		std::vector<std::exception_ptr> errors(numOfSlices);
+
+		auto parseSlice = [&](size_t i)
+		{
+			// Contiguous slices, so the order of the bundle is kept.
+			const Region* begin =
+				regions.data() + (regions.size() * i / numOfSlices);
+			const Region* end =
+				regions.data() + (regions.size() * (i + 1) / numOfSlices);
+			try
+			{
+				chains[i] = isPem ?
+					ParsePemSlice(begin, end) :
+					ParseDerSlice(begin, end, bundleOwner);
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(numOfSlices - 1);
+		try
+		{
+			for (size_t i = 1; i < numOfSlices; ++i)
+			{
+				workers.emplace_back(parseSlice, i);
+			}
+		}
+		catch (...)
+		{
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+			throw;
+		}
+
+		parseSlice(0);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error != nullptr)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+
+		X509Cert res = std::move(chains[0]);
+		for (size_t i = 1; i < numOfSlices; ++i)
+		{
+			res.AppendChain(std::move(chains[i]));
+		}
+		return res;
+	}
+
+	size_t m_numOfThreads;
+
+}; // class X509CertBundleLoader
+
+
+} // namespace mbedTLScpp
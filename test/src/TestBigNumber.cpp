@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include <mbedTLScpp/BigNumber.hpp>
+#include <mbedTLScpp/BigNumberOps.hpp>
 #include <mbedTLScpp/DefaultRbg.hpp>
 
 #include "MemoryTest.hpp"
@@ -313,6 +314,95 @@ GTEST_TEST(TestBigNumber, BigNumberCalc)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 }
 
+GTEST_TEST(TestBigNumber, BigNumberOps)
+{
+	int64_t initCount = 0;
+	InitMemLeakCount(initCount);
+
+	static constexpr size_t testLoopTime = 500;
+	{
+		std::random_device rd;
+		std::mt19937 gen(rd());
+		std::uniform_int_distribution<int64_t> distSqr(
+			-1518500249LL,
+			1518500249LL);
+		std::uniform_int_distribution<int64_t> distMod(
+			1,
+			3037000499LL);
+
+		BigNumScratch scratch;
+		BigNum dest;
+		BigNum bigA;
+		BigNum bigB;
+		BigNum bigC;
+		BigNum bigM;
+
+		for(size_t i = 0; i < testLoopTime; ++i)
+		{
+			const int64_t a = distSqr(gen);
+			const int64_t b = distSqr(gen);
+			const int64_t c = distSqr(gen);
+			const int64_t m = distMod(gen);
+			bigA = a;
+			bigB = b;
+			bigC = c;
+			bigM = m;
+
+			// No new big number is allocated by the fused operations.
+			int64_t loopCount = 0;
+			MEMORY_LEAK_TEST_GET_COUNT(loopCount);
+
+			MulAddMod(dest, bigA, bigB, bigC, bigM, scratch);
+			MEMORY_LEAK_TEST_INCR_COUNT(loopCount, 0);
+			EXPECT_EQ(dest, Mod(bigA * bigB + bigC, bigM));
+
+			MulMod(dest, bigA, bigB, bigM, scratch);
+			EXPECT_EQ(dest, Mod(bigA * bigB, bigM));
+
+			AddMod(dest, bigA, bigB, bigM, scratch);
+			EXPECT_EQ(dest, Mod(bigA + bigB, bigM));
+
+			SubMod(dest, bigA, bigB, bigM, scratch);
+			EXPECT_EQ(dest, Mod(bigA - bigB, bigM));
+			EXPECT_GE(dest, 0);
+			EXPECT_LT(dest, bigM);
+		}
+
+		// The destination may be one of the operands.
+		bigA = 123456789;
+		bigB = 987654321;
+		bigM = 1000003;
+		MulAddMod(bigA, bigA, bigA, bigB, bigM, scratch);
+		EXPECT_EQ(bigA, Mod(BigNum(123456789) * BigNum(123456789) + bigB, bigM));
+
+		// The Montgomery constant is reused, and replaced with the modulus.
+		bigA = 3;
+		bigB = 200;
+		ExpMod(dest, bigA, bigB, bigM, scratch);
+		EXPECT_EQ(dest, 333986);
+		ExpMod(dest, bigA, bigB, bigM, scratch);
+		EXPECT_EQ(dest, 333986);
+
+		bigA = 7;
+		bigB = 65537;
+		bigM = 1000033;
+		ExpMod(dest, bigA, bigB, bigM, scratch);
+		EXPECT_EQ(dest, 140915);
+
+		bigA = 12345;
+		bigM = 1000003;
+		InvMod(dest, bigA, bigM);
+		EXPECT_EQ(dest, 775863);
+
+		EXPECT_THROW(MulAddMod(bigM, bigA, bigB, bigC, bigM, scratch), InvalidArgumentException);
+		EXPECT_THROW(ExpMod(bigB, bigA, bigB, bigM, scratch), InvalidArgumentException);
+		EXPECT_THROW(MulMod(dest, bigA, bigB, BigNum(), scratch), mbedTLSRuntimeError);
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+}
+
 GTEST_TEST(TestBigNumber, Rand)
 {
 	std::unique_ptr<RbgInterface> rand =
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <mbedTLScpp/CppMutexIntf.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "MemoryTest.hpp"
+
+#ifdef MBEDTLSCPPTEST_TEST_STD_NS
+using namespace std;
+#endif
+
+#ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
+using namespace mbedTLScpp;
+#else
+using namespace MBEDTLSCPP_CUSTOMIZED_NAMESPACE;
+#endif
+
+namespace mbedTLScpp_Test
+{
+	extern size_t g_numOfTestFile;
+}
+
+GTEST_TEST(TestCppMutexIntf, CountTestFile)
+{
+	++mbedTLScpp_Test::g_numOfTestFile;
+}
+
+#ifdef MBEDTLS_THREADING_ALT
+
+GTEST_TEST(TestCppMutexIntf, BadInput)
+{
+	mbedtls_threading_mutex_t nullMutex = nullptr;
+
+	EXPECT_EQ(CppMutexIntf::MutexLock(nullptr), MBEDTLS_ERR_THREADING_BAD_INPUT_DATA);
+	EXPECT_EQ(CppMutexIntf::MutexUnlock(nullptr), MBEDTLS_ERR_THREADING_BAD_INPUT_DATA);
+	EXPECT_EQ(CppMutexIntf::MutexLock(&nullMutex), MBEDTLS_ERR_THREADING_BAD_INPUT_DATA);
+	EXPECT_EQ(CppMutexIntf::MutexUnlock(&nullMutex), MBEDTLS_ERR_THREADING_BAD_INPUT_DATA);
+
+	// Should be no-op
+	CppMutexIntf::MutexInit(nullptr);
+	CppMutexIntf::MutexFree(nullptr);
+}
+
+GTEST_TEST(TestCppMutexIntf, LockUnlock)
+{
+	int64_t initCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+
+	{
+		mbedtls_threading_mutex_t mutex = nullptr;
+		CppMutexIntf::MutexInit(&mutex);
+		ASSERT_TRUE(mutex != nullptr);
+
+		// Only the initialization allocates
+		MEMORY_LEAK_TEST_INCR_COUNT(initCount, 1);
+
+		static constexpr size_t sk_numThreads = 4;
+		static constexpr size_t sk_numIncrPerThread = 10000;
+
+		size_t counter = 0;
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < sk_numThreads; ++i)
+		{
+			threads.emplace_back(
+				[&mutex, &counter]()
+				{
+					for (size_t j = 0; j < sk_numIncrPerThread; ++j)
+					{
+						ASSERT_EQ(CppMutexIntf::MutexLock(&mutex), MBEDTLS_EXIT_SUCCESS);
+						++counter;
+						ASSERT_EQ(CppMutexIntf::MutexUnlock(&mutex), MBEDTLS_EXIT_SUCCESS);
+					}
+				}
+			);
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		const size_t expCount = sk_numThreads * sk_numIncrPerThread;
+		EXPECT_EQ(counter, expCount);
+
+		// Locking doesn't allocate
+		MEMORY_LEAK_TEST_INCR_COUNT(initCount, 1);
+
+#ifdef MBEDTLSCPP_MUTEX_STATS
+		MutexStats stats = CppMutexIntf::GetStats(mutex);
+		EXPECT_EQ(stats.m_lockCount, static_cast<uint64_t>(expCount));
+		EXPECT_LE(stats.m_blockedCount, stats.m_contendedCount);
+		EXPECT_LE(stats.m_contendedCount, stats.m_lockCount);
+
+		MutexStats globalStats = CppMutexIntf::GetGlobalStats();
+		EXPECT_LE(stats.m_lockCount, globalStats.m_lockCount);
+#endif // MBEDTLSCPP_MUTEX_STATS
+
+		CppMutexIntf::MutexFree(&mutex);
+		EXPECT_TRUE(mutex == nullptr);
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+}
+
+#endif // MBEDTLS_THREADING_ALT
@@ -67,3 +67,62 @@ GTEST_TEST(TestException, MakeCFuncCall)
 		mbedTLSRuntimeError
 	);
 }
+
+#ifdef MBEDTLSCPP_TRACE_HOOKS
+GTEST_TEST(TestException, TraceHooks)
+{
+	struct TraceLog
+	{
+		std::string m_begin;
+		std::string m_end;
+		int m_retVal;
+	};
+
+	TraceLog log = { "", "", 0 };
+	const TraceHooks hooks = {
+		[](void* ctx, const char* caller, const char* callee)
+		{
+			static_cast<TraceLog*>(ctx)->m_begin =
+				std::string(caller) + "->" + callee;
+		},
+		[](void* ctx, const char* caller, const char* callee, int retVal)
+		{
+			static_cast<TraceLog*>(ctx)->m_end =
+				std::string(caller) + "->" + callee;
+			static_cast<TraceLog*>(ctx)->m_retVal = retVal;
+		},
+		&log
+	};
+
+	Metrics::SetTraceHooks(&hooks);
+	EXPECT_THROW(
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			TestCaller,
+			mbedtls_md_setup,
+			nullptr,
+			nullptr,
+			false
+		),
+		mbedTLSRuntimeError
+	);
+	Metrics::SetTraceHooks(nullptr);
+
+	EXPECT_EQ(log.m_begin, "TestCaller->mbedtls_md_setup");
+	EXPECT_EQ(log.m_end, "TestCaller->mbedtls_md_setup");
+	EXPECT_EQ(log.m_retVal, MBEDTLS_ERR_MD_BAD_INPUT_DATA);
+
+	// Not traced anymore.
+	log.m_begin.clear();
+	EXPECT_THROW(
+		MBEDTLSCPP_MAKE_C_FUNC_CALL(
+			TestCaller,
+			mbedtls_md_setup,
+			nullptr,
+			nullptr,
+			false
+		),
+		mbedTLSRuntimeError
+	);
+	EXPECT_TRUE(log.m_begin.empty());
+}
+#endif // MBEDTLSCPP_TRACE_HOOKS
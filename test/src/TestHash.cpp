@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include <mbedTLScpp/Hash.hpp>
 #include <mbedTLScpp/Internal/Codec.hpp>
 
@@ -335,3 +337,28 @@ GTEST_TEST(TestHash, HasherCalc)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+#ifdef MBEDTLSCPP_METRICS
+GTEST_TEST(TestHash, Metrics)
+{
+	const MetricsSnapshot before = Metrics::Snapshot();
+
+	Hasher<HashType::SHA256>().Calc(CtnFullR("TestMessage1"));
+
+	// Counts of exited threads are kept.
+	std::thread thread([]()
+	{
+		Hasher<HashType::SHA256> hasher;
+		hasher.Update(CtnFullR("TestMessage2"));
+		hasher.Update(CtnFullR("TestMessage3"));
+		hasher.Finish();
+	});
+	thread.join();
+
+	const MetricsSnapshot diff = Metrics::Snapshot().Since(before);
+	EXPECT_EQ(diff.GetOps(MetricOp::Hash), 2U);
+	// The string literals include the null terminators.
+	EXPECT_EQ(diff.GetBytes(MetricOp::Hash), 39U);
+	EXPECT_EQ(diff.GetOps(MetricOp::Hmac), 0U);
+}
+#endif // MBEDTLSCPP_METRICS
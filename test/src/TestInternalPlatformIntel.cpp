@@ -17,6 +17,9 @@
 
 #ifdef MBEDTLSCPPTEST_ARCH_X86
 #	include <mbedTLScpp/Internal/PlatformIntel/Drng.hpp>
+#	include <mbedTLScpp/Internal/PlatformIntel/DrngEntropy.hpp>
+#	include <mbedTLScpp/Entropy.hpp>
+#	include <mbedTLScpp/CtrDrbg.hpp>
 
 #	ifndef MBEDTLSCPP_CUSTOMIZED_NAMESPACE
 using namespace mbedTLScpp;
@@ -356,4 +359,126 @@ GTEST_TEST(TestInternalPlatformIntel, ReadRandTest)
 
 	}
 }
+
+GTEST_TEST(TestInternalPlatformIntel, ReadRandBulkTest)
+{
+	if (!Internal::PlatformIntel::IsRdRandSupportedCached())
+	{
+		std::cout<< "RdRand is not supported, " <<
+			"RdRand tests are disabled." << std::endl;
+		return;
+	}
+
+	// larger than the staging buffer, misaligned, and with a residual
+	{
+		std::array<uint64_t, 1000> randArr;
+		randArr.fill(0);
+		size_t offset = 3;
+
+		EXPECT_NO_THROW(
+			try
+			{
+				Internal::PlatformIntel::ReadRandBulk(
+					((uint8_t*)randArr.data()) + offset,
+					(sizeof(uint64_t) * (randArr.size() - 1)) + 1
+				);
+
+				std::set<uint64_t> randSet;
+				for (size_t i = 1; i < randArr.size() - 1; ++i)
+				{
+					bool insertRes = false;
+					std::tie(std::ignore, insertRes) =
+						randSet.insert(randArr[i]);
+				}
+				EXPECT_GT(randSet.size(), randArr.size() / 2);
+			}
+			catch(const Internal::PlatformIntel::PlatformBusyException&)
+			{
+				// platform is busy, that's ok
+				std::cerr << "Platform was busy" << std::endl;
+			}
+		);
+	}
+}
+
+GTEST_TEST(TestInternalPlatformIntel, ReadSeedBulkTest)
+{
+	if (!Internal::PlatformIntel::IsRdSeedSupportedCached())
+	{
+		std::cout<< "RdSeed is not supported, " <<
+			"RdSeed tests are disabled." << std::endl;
+		return;
+	}
+
+	{
+		std::array<uint64_t, 500> randArr;
+		size_t offset = 5;
+		size_t reqSize = (sizeof(uint64_t) * (randArr.size() - 1)) + 2;
+
+		size_t generated = 0;
+		EXPECT_NO_THROW(
+			generated = Internal::PlatformIntel::ReadSeedBulk(
+				((uint8_t*)randArr.data()) + offset,
+				reqSize
+			);
+		);
+		EXPECT_LE(generated, reqSize);
+
+		if (generated > (sizeof(uint64_t) * 10))
+		{
+			std::set<uint64_t> randSet;
+			for (size_t i = 1; i < (generated / sizeof(uint64_t)); ++i)
+			{
+				bool insertRes = false;
+				std::tie(std::ignore, insertRes) =
+					randSet.insert(randArr[i]);
+			}
+			EXPECT_GT(randSet.size(), 1);
+		}
+	}
+}
+
+GTEST_TEST(TestInternalPlatformIntel, RdSeedEntropySourceTest)
+{
+	if (!Internal::PlatformIntel::IsRdSeedSupportedCached())
+	{
+		std::cout<< "RdSeed is not supported, " <<
+			"RdSeed tests are disabled." << std::endl;
+		Entropy<> entropy;
+		EXPECT_THROW(
+			Internal::PlatformIntel::AddRdSeedEntropySource(entropy),
+			Internal::PlatformIntel::FeatureUnsupportedException
+		);
+		return;
+	}
+
+	// Poll function
+	{
+		std::array<uint8_t, 64> buf;
+		size_t olen = 0;
+		EXPECT_EQ(
+			Internal::PlatformIntel::RdSeedEntropyPoll(
+				nullptr, buf.data(), buf.size(), &olen),
+			0
+		);
+		EXPECT_LE(olen, buf.size());
+	}
+
+	// Plugged into an entropy pool, which seeds a DRBG
+	{
+		std::unique_ptr<Entropy<> > entropy = Internal::make_unique<Entropy<> >();
+		Internal::PlatformIntel::AddRdSeedEntropySource(*entropy);
+
+		std::array<uint64_t, 4> entropyArr;
+		EXPECT_NO_THROW(
+			entropy->FillEntropy(entropyArr.data(), sizeof(entropyArr));
+		);
+
+		CtrDrbg<> rbg(std::move(entropy));
+		for(size_t i = 0; i < 100; ++i)
+		{
+			EXPECT_NE(rbg.GetRand<uint64_t>(), rbg.GetRand<uint64_t>());
+		}
+	}
+}
 #endif // MBEDTLSCPPTEST_ARCH_X86
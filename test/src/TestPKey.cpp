@@ -7,6 +7,8 @@
 
 #include <mbedTLScpp/DefaultRbg.hpp>
 #include <mbedTLScpp/PKey.hpp>
+#include <mbedTLScpp/RsaKey.hpp>
+#include <mbedTLScpp/RsaKeyGen.hpp>
 
 #include "SharedVars.hpp"
 #include "MemoryTest.hpp"
@@ -347,3 +349,241 @@ GTEST_TEST(TestPKey, SignAndVerifySign)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+#if defined(MBEDTLS_RSA_C)
+GTEST_TEST(TestPKey, RsaKeys)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	Hash<HashType::SHA256> testHash1 =
+		Hasher<HashType::SHA256>().Calc(CtnFullR("TestString"));
+	Hash<HashType::SHA256> testHash2 =
+		Hasher<HashType::SHA256>().Calc(CtnFullR("XTestStringX"));
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		RsaKeyPair<> prvKey = RsaKeyPair<>::FromPEM(
+			SecretString(
+				GetTestRsaPrivKeyPem().data(), GetTestRsaPrivKeyPem().size()
+			),
+			*rand
+		);
+		RsaPublicKey<> pubKey = RsaPublicKey<>::FromPEM(
+			std::string(
+				GetTestRsaPubKeyPem().data(), GetTestRsaPubKeyPem().size()
+			)
+		);
+
+		EXPECT_EQ(prvKey.GetAlgorithmCat(), PKeyAlgmCat::RSA);
+		EXPECT_EQ(prvKey.GetKeyType(),      PKeyType::Private);
+		EXPECT_EQ(pubKey.GetKeyType(),      PKeyType::Public);
+		EXPECT_EQ(prvKey.GetByteSize(),     pubKey.GetByteSize());
+		EXPECT_EQ(prvKey.GetBitSize(),      prvKey.GetByteSize() * 8);
+
+		// Export and import
+		{
+			std::string oriPem(GetTestRsaPubKeyPem().data());
+			EXPECT_EQ(prvKey.GetPublicPem(), oriPem);
+
+			auto der = prvKey.GetPrivateDer();
+			RsaKeyPair<> prvKey2 = RsaKeyPair<>::FromDER(CtnFullR(der), *rand);
+			EXPECT_EQ(prvKey2.GetPublicDer(), prvKey.GetPublicDer());
+
+			auto pubDer = pubKey.GetPublicDer();
+			RsaPublicKey<> pubKey2 = RsaPublicKey<>::FromDER(CtnFullR(pubDer));
+			EXPECT_EQ(pubKey2.GetPublicDer(), pubDer);
+		}
+
+		// Wrong key types
+		EXPECT_THROW(
+			RsaKeyPair<>::FromPEM(
+				SecretString(
+					GetTestEcPrivKeyPem().data(), GetTestEcPrivKeyPem().size()
+				),
+				*rand
+			),
+			InvalidArgumentException
+		);
+		EXPECT_THROW(
+			RsaKeyPair<>::FromPKeyBase(
+				PKeyBase<>::FromPEM(
+					std::string(
+						GetTestRsaPubKeyPem().data(),
+						GetTestRsaPubKeyPem().size()
+					)
+				)
+			),
+			InvalidArgumentException
+		);
+
+		EXPECT_NO_THROW(pubKey.WarmUp());
+		EXPECT_NO_THROW(prvKey.WarmUp(*rand));
+
+#if defined(MBEDTLS_PKCS1_V15)
+		{
+			auto sign = prvKey.SignPkcs1v15(testHash1, *rand);
+			EXPECT_EQ(sign.size(), prvKey.GetByteSize());
+			EXPECT_NO_THROW(pubKey.VerifyPkcs1v15Sign(testHash1, CtnFullR(sign)));
+			EXPECT_THROW(
+				pubKey.VerifyPkcs1v15Sign(testHash2, CtnFullR(sign)),
+				mbedTLSRuntimeError
+			);
+
+			// Interoperable with the generic path
+			PKeyBase<> pkey = PKeyBase<>::FromDER(
+				CtnFullR(prvKey.GetPublicDer())
+			);
+			EXPECT_NO_THROW(pkey.VerifyDerSign(testHash1, CtnFullR(sign)));
+
+			sign.pop_back();
+			EXPECT_THROW(
+				pubKey.VerifyPkcs1v15Sign(testHash1, CtnFullR(sign)),
+				InvalidArgumentException
+			);
+		}
+#endif // MBEDTLS_PKCS1_V15
+
+#if defined(MBEDTLS_PKCS1_V21)
+		{
+			auto sign = prvKey.SignPss(testHash1, *rand);
+			EXPECT_NO_THROW(pubKey.VerifyPssSign(testHash1, CtnFullR(sign)));
+			EXPECT_THROW(
+				pubKey.VerifyPssSign(testHash2, CtnFullR(sign)),
+				mbedTLSRuntimeError
+			);
+#if defined(MBEDTLS_PKCS1_V15)
+			// The generic path still uses the PKCS#1 v1.5 padding
+			sign = prvKey.SignInDer(testHash1, *rand);
+			EXPECT_NO_THROW(pubKey.VerifyPkcs1v15Sign(testHash1, CtnFullR(sign)));
+#endif // MBEDTLS_PKCS1_V15
+
+			const std::vector<uint8_t> plain = { 'T', 'e', 's', 't' };
+			const std::vector<uint8_t> label = { 'L' };
+
+			auto cipher =
+				pubKey.OaepEncrypt<HashType::SHA256>(CtnFullR(plain), *rand);
+			EXPECT_EQ(cipher.size(), pubKey.GetByteSize());
+			auto decrypted =
+				prvKey.OaepDecrypt<HashType::SHA256>(CtnFullR(cipher), *rand);
+			EXPECT_EQ(
+				std::vector<uint8_t>(decrypted.begin(), decrypted.end()),
+				plain
+			);
+
+			cipher = pubKey.OaepEncrypt<HashType::SHA256>(
+				CtnFullR(plain), CtnFullR(label), *rand
+			);
+			EXPECT_THROW(
+				prvKey.OaepDecrypt<HashType::SHA256>(CtnFullR(cipher), *rand),
+				mbedTLSRuntimeError
+			);
+			decrypted = prvKey.OaepDecrypt<HashType::SHA256>(
+				CtnFullR(cipher), CtnFullR(label), *rand
+			);
+			EXPECT_EQ(
+				std::vector<uint8_t>(decrypted.begin(), decrypted.end()),
+				plain
+			);
+		}
+#endif // MBEDTLS_PKCS1_V21
+	}
+
+#if defined(MBEDTLS_GENPRIME) && defined(MBEDTLS_PKCS1_V21)
+	{
+		RsaKeyPair<> prvKey = RsaKeyPair<>::Generate(1024, *rand);
+		EXPECT_EQ(prvKey.GetBitSize(), 1024U);
+
+		RsaPublicKey<> pubKey = RsaPublicKey<>::FromDER(
+			CtnFullR(prvKey.GetPublicDer())
+		);
+		auto sign = prvKey.SignPss(testHash1, *rand);
+		EXPECT_NO_THROW(pubKey.VerifyPssSign(testHash1, CtnFullR(sign)));
+	}
+#endif // MBEDTLS_GENPRIME && MBEDTLS_PKCS1_V21
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+#endif // MBEDTLS_RSA_C
+
+#if defined(MBEDTLS_RSA_C) && defined(MBEDTLS_GENPRIME) && defined(MBEDTLS_PKCS1_V21)
+GTEST_TEST(TestPKey, RsaKeyGenerator)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	Hash<HashType::SHA256> testHash =
+		Hasher<HashType::SHA256>().Calc(CtnFullR("TestString"));
+
+	EXPECT_THROW(RsaKeyGenerator(0), InvalidArgumentException);
+
+	RsaKeyGenerator gen(2);
+	EXPECT_EQ(gen.GetNumOfThreads(), 2U);
+
+	EXPECT_THROW(gen.Generate(1000 + 1), InvalidArgumentException);
+	EXPECT_THROW(gen.Generate(1024, 65536), InvalidArgumentException);
+	EXPECT_THROW(gen.GeneratePrime(2), InvalidArgumentException);
+
+	// Primes
+	{
+		BigNum prime = gen.GeneratePrime(128);
+		EXPECT_EQ(mbedtls_mpi_bitlen(prime.Get()), 128U);
+		EXPECT_EQ(
+			mbedtls_mpi_is_prime_ext(
+				prime.Get(), 40, &RbgInterface::CallBack, rand.get()
+			),
+			0
+		);
+
+		BigNum safePrime = gen.GeneratePrime(128, true);
+		EXPECT_EQ(mbedtls_mpi_bitlen(safePrime.Get()), 128U);
+		BigNum half = safePrime;
+		mbedtls_mpi_shift_r(half.Get(), 1);
+		EXPECT_EQ(
+			mbedtls_mpi_is_prime_ext(
+				half.Get(), 40, &RbgInterface::CallBack, rand.get()
+			),
+			0
+		);
+
+		std::atomic<bool> cancel(true);
+		EXPECT_THROW(
+			gen.GeneratePrime(128, false, &cancel),
+			RuntimeException
+		);
+	}
+
+	// Key pairs
+	{
+		RsaKeyPair<> prvKey = gen.Generate(1024);
+		EXPECT_EQ(prvKey.GetBitSize(), 1024U);
+		EXPECT_EQ(mbedtls_rsa_check_privkey(&prvKey.GetRsaContextRef()), 0);
+
+		RsaPublicKey<> pubKey = RsaPublicKey<>::FromDER(
+			CtnFullR(prvKey.GetPublicDer())
+		);
+		auto sign = prvKey.SignPss(testHash, *rand);
+		EXPECT_NO_THROW(pubKey.VerifyPssSign(testHash, CtnFullR(sign)));
+	}
+
+	// Pool
+	{
+		RsaKeyPool pool(gen, 1024, 2);
+		pool.WaitForKeys(1);
+		EXPECT_GE(pool.GetNumOfKeys(), 1U);
+
+		RsaKeyPair<> prvKey = pool.Get();
+		EXPECT_EQ(prvKey.GetBitSize(), 1024U);
+
+		RsaKeyPair<> prvKey2 = pool.Get();
+		EXPECT_EQ(prvKey2.GetBitSize(), 1024U);
+		EXPECT_NE(prvKey.GetPublicDer(), prvKey2.GetPublicDer());
+	}
+}
+#endif // MBEDTLS_RSA_C && MBEDTLS_GENPRIME && MBEDTLS_PKCS1_V21
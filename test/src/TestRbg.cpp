@@ -1,9 +1,13 @@
 #include <random>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <mbedTLScpp/CtrDrbg.hpp>
 #include <mbedTLScpp/HmacDrbg.hpp>
+#include <mbedTLScpp/ThreadLocalRbg.hpp>
+#include <mbedTLScpp/BufferedRbg.hpp>
 
 #include "MemoryTest.hpp"
 #include "SelfMoveTest.hpp"
@@ -207,3 +211,137 @@ GTEST_TEST(TestRbg, DefaultRbg)
 		EXPECT_TRUE((110 <= randInt && randInt <= 150));
 	}
 }
+
+GTEST_TEST(TestRbg, DrbgReseed)
+{
+	CtrDrbg<> ctrRbg;
+	EXPECT_NO_THROW(ctrRbg.Reseed());
+	EXPECT_NE(ctrRbg.GetRand<uint64_t>(), ctrRbg.GetRand<uint64_t>());
+
+	HmacDrbg<> hmacRbg;
+	EXPECT_NO_THROW(hmacRbg.Reseed());
+	EXPECT_NE(hmacRbg.GetRand<uint64_t>(), hmacRbg.GetRand<uint64_t>());
+}
+
+template<typename _ThreadLocalRbgType>
+static void TestThreadLocalRbgImpl()
+{
+	SettleMemTestCountOnEntropy();
+	int64_t initCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+
+	static constexpr size_t sk_numThreads = 4;
+
+	_ThreadLocalRbgType sharedRbg;
+
+	std::vector<uint64_t> randVals(sk_numThreads, 0);
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < sk_numThreads; ++i)
+	{
+		threads.emplace_back([&sharedRbg, &randVals, i]()
+		{
+			// Same thread always gets the same instance.
+			const void* inst1 = &_ThreadLocalRbgType::GetThreadInstance();
+			const void* inst2 = &_ThreadLocalRbgType::GetThreadInstance();
+			EXPECT_EQ(inst1, inst2);
+
+			for (size_t j = 0; j < 100; ++j)
+			{
+				EXPECT_NE(sharedRbg.template GetRand<uint64_t>(), sharedRbg.template GetRand<uint64_t>());
+			}
+
+			int res = 0;
+			EXPECT_EQ(RbgInterface::CallBack(&sharedRbg, reinterpret_cast<unsigned char*>(&res), sizeof(res)), MBEDTLS_EXIT_SUCCESS);
+
+			randVals[i] = sharedRbg.template GetRand<uint64_t>();
+		});
+	}
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	// Different threads get different random streams.
+	for (size_t i = 0; i < sk_numThreads; ++i)
+	{
+		for (size_t j = i + 1; j < sk_numThreads; ++j)
+		{
+			EXPECT_NE(randVals[i], randVals[j]);
+		}
+	}
+
+	// Per-thread instances are released when their threads exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+}
+
+GTEST_TEST(TestRbg, ThreadLocalRbg)
+{
+	TestThreadLocalRbgImpl<ThreadLocalCtrDrbg>();
+	TestThreadLocalRbgImpl<ThreadLocalHmacDrbg>();
+}
+
+GTEST_TEST(TestRbg, BufferedRbg)
+{
+	SettleMemTestCountOnEntropy();
+	int64_t initCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+
+	{
+		const size_t blockSize = BufferedRbg<>::sk_blockSize;
+
+		BufferedRbg<> rbg1;
+		EXPECT_EQ(rbg1.GetBufferedSize(), 0U);
+
+		// Small requests are served from the block.
+		uint64_t rand1 = rbg1.GetRand<uint64_t>();
+		EXPECT_EQ(rbg1.GetBufferedSize(), blockSize - sizeof(uint64_t));
+		uint64_t rand2 = rbg1.GetRand<uint64_t>();
+		EXPECT_EQ(rbg1.GetBufferedSize(), blockSize - (2 * sizeof(uint64_t)));
+		EXPECT_NE(rand1, rand2);
+
+		for(size_t i = 0; i < 1000; ++i)
+		{
+			EXPECT_NE(rbg1.GetRand<uint64_t>(), rbg1.GetRand<uint64_t>());
+		}
+
+		// Requests crossing the block boundary.
+		std::vector<uint8_t> buf(BufferedRbg<>::sk_maxDrawSize - 1);
+		for(size_t i = 0; i < 10; ++i)
+		{
+			rbg1.Rand(buf.data(), buf.size());
+		}
+
+		// Large requests bypass the block.
+		rbg1.Discard();
+		EXPECT_EQ(rbg1.GetBufferedSize(), 0U);
+		std::vector<uint8_t> largeBuf1(5000, 0);
+		std::vector<uint8_t> largeBuf2(5000, 0);
+		rbg1.Rand(largeBuf1.data(), largeBuf1.size());
+		rbg1.Rand(largeBuf2.data(), largeBuf2.size());
+		EXPECT_EQ(rbg1.GetBufferedSize(), 0U);
+		EXPECT_NE(largeBuf1, largeBuf2);
+
+		// Works with the call back.
+		int res = 0;
+		EXPECT_EQ(RbgInterface::CallBack(&rbg1, reinterpret_cast<unsigned char*>(&res), sizeof(res)), MBEDTLS_EXIT_SUCCESS);
+
+		// Move
+		BufferedRbg<> rbg2(std::move(rbg1));
+		EXPECT_THROW(rbg1.GetRand<uint64_t>(), InvalidObjectException);
+		EXPECT_EQ(rbg1.GetBufferedSize(), 0U);
+		EXPECT_NE(rbg2.GetRand<uint64_t>(), rbg2.GetRand<uint64_t>());
+
+		// Other underlying RBG
+		BufferedRbg<256> rbg3(Internal::make_unique<HmacDrbg<> >());
+		for(size_t i = 0; i < 100; ++i)
+		{
+			EXPECT_NE(rbg3.GetRand<uint64_t>(), rbg3.GetRand<uint64_t>());
+		}
+
+		EXPECT_THROW(BufferedRbg<>(nullptr), InvalidArgumentException);
+	}
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+}
@@ -6,12 +6,32 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+
 #include <mbedTLScpp/DefaultRbg.hpp>
 #include <mbedTLScpp/EcKey.hpp>
 #include <mbedTLScpp/Tls.hpp>
+#include <mbedTLScpp/TlsAsyncPrivKey.hpp>
+#include <mbedTLScpp/TlsDtlsServerDemux.hpp>
+#include <mbedTLScpp/TlsHandshakeStats.hpp>
+#include <mbedTLScpp/TlsLoadGen.hpp>
+#include <mbedTLScpp/TlsMemTransport.hpp>
 #include <mbedTLScpp/TlsSessTktMgr.hpp>
+#include <mbedTLScpp/TlsVerifyCache.hpp>
 #include <mbedTLScpp/X509Cert.hpp>
 
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+#	include <arpa/inet.h>
+#	include <netinet/in.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#endif // MBEDTLSCPP_INTERNAL_KTLS
+
 #include "MemoryTest.hpp"
 #include "SelfMoveTest.hpp"
 
@@ -500,8 +520,1605 @@ GTEST_TEST(TestTlsIntf, TlsCom)
 
 		EXPECT_EQ(svrTls->BorrowPeerCert().GetDer(), cltCert->GetDer());
 		EXPECT_EQ(svrTls->GetPeerCert().GetDer(), cltCert->GetDer());
+
+		std::shared_ptr<const X509Cert> sharedPeerCert =
+			svrTls->GetSharedPeerCert();
+		EXPECT_EQ(sharedPeerCert->GetDer(), cltCert->GetDer());
+		EXPECT_EQ(svrTls->GetSharedPeerCert(), sharedPeerCert);
+
+		// Concurrent calls.
+		std::vector<std::shared_ptr<const X509Cert> > results(4);
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			threads.emplace_back(
+				[&svrTls, &results, i]()
+				{
+					for (size_t j = 0; j < 100; ++j)
+					{
+						results[i] = svrTls->GetSharedPeerCert();
+					}
+				}
+			);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		for (const auto& result : results)
+		{
+			EXPECT_EQ(result, sharedPeerCert);
+		}
 	}
 
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+
+static std::shared_ptr<X509Cert> CreateSelfSignedCert(
+	const EcKeyPair<EcType::SECP256R1>& prvKey,
+	const std::string& subject,
+	RbgInterface& rand
+)
+{
+	auto certDer = X509CertWriter::SelfSign(
+		HashType::SHA256,
+		prvKey,
+		subject
+	).SetBasicConstraints(
+		true, -1
+	).SetKeyUsage(
+		MBEDTLS_X509_KU_DIGITAL_SIGNATURE |
+		MBEDTLS_X509_KU_KEY_CERT_SIGN
+	).SetSerialNum(
+		BigNumber<>(12345)
+	).SetValidationTime(
+		"20210101000000", "29991231235959"
+	).GetDer(rand);
+
+	return std::make_shared<X509Cert>(X509Cert::FromDER(CtnFullR(certDer)));
+}
+
+GTEST_TEST(TestTlsIntf, TlsAsyncWorkerPool)
+{
+	EXPECT_THROW(TlsAsyncWorkerPool(0, 10), InvalidArgumentException);
+
+	std::atomic<size_t> count(0);
+	{
+		TlsAsyncWorkerPool pool(4, 1000);
+		EXPECT_EQ(pool.GetNumOfThreads(), 4U);
+
+		for (size_t i = 0; i < 1000; ++i)
+		{
+			EXPECT_TRUE(pool.Submit([&count]() { ++count; }));
+		}
+	}
+	// Pending tasks are still run before the pool is destroyed.
+	EXPECT_EQ(count.load(), 1000U);
+
+	{
+		// No room in the queue, so every task is rejected.
+		TlsAsyncWorkerPool pool(1, 0);
+		EXPECT_FALSE(pool.Submit([&count]() { ++count; }));
+		EXPECT_EQ(pool.GetQueueSize(), 0U);
+	}
+	EXPECT_EQ(count.load(), 1000U);
+}
+
+
+GTEST_TEST(TestTlsIntf, TlsHandshakeStats)
+{
+	EXPECT_EQ(TlsLatencyHistogram::GetBucketIndex(0), 0U);
+	EXPECT_EQ(TlsLatencyHistogram::GetBucketIndex(1), 1U);
+	EXPECT_EQ(TlsLatencyHistogram::GetBucketIndex(1000), 10U);
+	EXPECT_EQ(
+		TlsLatencyHistogram::GetBucketIndex(UINT64_MAX),
+		TlsLatencyHistogram::sk_numOfBuckets - 1
+	);
+	EXPECT_EQ(TlsLatencyHistogram::GetBucketUpperBound(10), 1024U);
+
+	TlsLatencyHistogram hist;
+	EXPECT_EQ(hist.GetPercentile(50), 0U);
+	hist.Record(1000);
+	hist.Record(1000);
+	hist.Record(100000);
+	EXPECT_EQ(hist.GetCount(), 3U);
+	EXPECT_EQ(hist.GetSum(), 102000U);
+	EXPECT_EQ(hist.GetBucketCount(10), 2U);
+	EXPECT_EQ(hist.GetPercentile(50), 1024U);
+	EXPECT_EQ(hist.GetPercentile(100), 131072U);
+	EXPECT_THROW(
+		hist.GetBucketCount(TlsLatencyHistogram::sk_numOfBuckets),
+		InvalidArgumentException
+	);
+	hist.Reset();
+	EXPECT_EQ(hist.GetCount(), 0U);
+
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	std::shared_ptr<TlsHandshakeStats> stats =
+		std::make_shared<TlsHandshakeStats>();
+	EXPECT_EQ(svrConfig->GetHandshakeStats(), nullptr);
+	svrConfig->SetHandshakeStats(stats);
+	EXPECT_EQ(svrConfig->GetHandshakeStats(), stats);
+
+	TestConn::s_testBufC2S.clear();
+	TestConn::s_testBufS2C.clear();
+
+	{
+		TestTls svrTls(
+			svrConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(false)
+		);
+		TestTls cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+		// Not traced without statistics.
+		EXPECT_EQ(cltTls.GetHandshakeTrace(), nullptr);
+		ASSERT_NE(svrTls.GetHandshakeTrace(), nullptr);
+
+		uint64_t bytesC2S = 0;
+		uint64_t bytesS2C = 0;
+		for (size_t i = 0;
+			i < 100 &&
+			(!cltTls.HasHandshakeOver() || !svrTls.HasHandshakeOver());
+			++i)
+		{
+			// Only the server touches the buffers during its step.
+			bytesS2C -= TestConn::s_testBufS2C.size();
+			bytesC2S += TestConn::s_testBufC2S.size();
+			svrTls.HandshakeNonBlocking();
+			bytesS2C += TestConn::s_testBufS2C.size();
+			bytesC2S -= TestConn::s_testBufC2S.size();
+
+			cltTls.HandshakeNonBlocking();
+		}
+		ASSERT_TRUE(svrTls.HasHandshakeOver());
+
+		const TlsHandshakeTrace& trace = *svrTls.GetHandshakeTrace();
+		EXPECT_TRUE(trace.IsFinished());
+		EXPECT_GT(trace.GetSteps().size(), 5U);
+		EXPECT_EQ(trace.GetSteps().front().m_state, MBEDTLS_SSL_HELLO_REQUEST);
+		EXPECT_GT(trace.GetTotalTime(), 0U);
+		EXPECT_EQ(trace.GetSent().GetBytes(), bytesS2C);
+		EXPECT_EQ(trace.GetRecv().GetBytes(), bytesC2S);
+		// ServerHello...ServerHelloDone, ChangeCipherSpec, and Finished.
+		EXPECT_GE(trace.GetSent().GetRecords(), 3U);
+		// ClientKeyExchange, ChangeCipherSpec, and Finished, at least.
+		EXPECT_GE(trace.GetRecv().GetRecords(), 3U);
+
+		// The data exchange afterwards isn't traced.
+		uint32_t secretDataSent = 80127368UL;
+		uint32_t secretDataRecv = 0;
+		cltTls.SendData(&secretDataSent, sizeof(secretDataSent));
+		svrTls.RecvData(&secretDataRecv, sizeof(secretDataRecv));
+		EXPECT_EQ(secretDataSent, secretDataRecv);
+		EXPECT_EQ(trace.GetRecv().GetBytes(), bytesC2S);
+	}
+
+	EXPECT_EQ(stats->GetNumOfHandshakes(), 1U);
+	EXPECT_EQ(stats->GetNumOfFailures(), 0U);
+	EXPECT_EQ(stats->GetTotalHistogram().GetCount(), 1U);
+	EXPECT_EQ(stats->GetIoWaitHistogram().GetCount(), 1U);
+	EXPECT_EQ(
+		stats->GetStateHistogram(MBEDTLS_SSL_SERVER_KEY_EXCHANGE).GetCount(),
+		1U
+	);
+	EXPECT_GT(stats->GetBytesSent(), 0U);
+	EXPECT_GT(stats->GetRecordsRecv(), 0U);
+	EXPECT_THROW(stats->GetStateHistogram(-1), InvalidArgumentException);
+
+	stats->Reset();
+	EXPECT_EQ(stats->GetNumOfHandshakes(), 0U);
+	EXPECT_EQ(stats->GetBytesSent(), 0U);
+}
+
+GTEST_TEST(TestTlsIntf, TlsRecordSizer)
+{
+	EXPECT_THROW(TlsRecordSizer(0), InvalidArgumentException);
+	EXPECT_THROW(TlsRecordSizer(200, 100), InvalidArgumentException);
+
+	{
+		using Clock = TlsRecordSizer::ClockType;
+		const Clock::time_point t0 = Clock::now();
+
+		TlsRecordSizer sizer(1000, 16384, 2, 1000);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 1000U);
+		sizer.OnSent(1000, t0);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 1000U);
+		// Partial records don't ramp the size up.
+		sizer.OnSent(10, t0);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 1000U);
+		sizer.OnSent(1000, t0);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 2000U);
+		for (size_t i = 0; i < 6; ++i)
+		{
+			sizer.OnSent(sizer.GetRecordSize(t0), t0);
+		}
+		EXPECT_EQ(sizer.GetRecordSize(t0), 16000U);
+		sizer.OnSent(16000, t0);
+		sizer.OnSent(16000, t0);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 16384U);
+		sizer.OnSent(16384, t0);
+		sizer.OnSent(16384, t0);
+		EXPECT_EQ(sizer.GetRecordSize(t0), 16384U);
+
+		// Not idle yet.
+		EXPECT_EQ(
+			sizer.GetRecordSize(t0 + std::chrono::milliseconds(1000)),
+			16384U
+		);
+		// Back to small records after idle.
+		EXPECT_EQ(
+			sizer.GetRecordSize(t0 + std::chrono::milliseconds(1001)),
+			1000U
+		);
+	}
+
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	TestConn::s_testBufC2S.clear();
+	TestConn::s_testBufS2C.clear();
+
+	TestTls svrTls(
+		svrConfig,
+		nullptr,
+		Internal::make_unique<TestConn>(false)
+	);
+	TestTls cltTls(
+		cltConfig,
+		nullptr,
+		Internal::make_unique<TestConn>(true)
+	);
+
+	for (size_t i = 0;
+		i < 100 &&
+		(!cltTls.HasHandshakeOver() || !svrTls.HasHandshakeOver());
+		++i)
+	{
+		svrTls.HandshakeNonBlocking();
+		cltTls.HandshakeNonBlocking();
+	}
+	ASSERT_TRUE(cltTls.HasHandshakeOver());
+	ASSERT_TRUE(svrTls.HasHandshakeOver());
+
+	EXPECT_EQ(cltTls.GetRecordSizer(), nullptr);
+	cltTls.SetRecordSizer(
+		Internal::make_unique<TlsRecordSizer>(100, 400, 2, 1000)
+	);
+	ASSERT_NE(cltTls.GetRecordSizer(), nullptr);
+
+	std::vector<uint8_t> dataSent(1000);
+	for (size_t i = 0; i < dataSent.size(); ++i)
+	{
+		dataSent[i] = static_cast<uint8_t>(i);
+	}
+
+	TestConn::s_testBufC2S.clear();
+	std::vector<int> recordSizes;
+	for (size_t sent = 0; sent < dataSent.size(); )
+	{
+		const int ret =
+			cltTls.SendData(dataSent.data() + sent, dataSent.size() - sent);
+		ASSERT_GT(ret, 0);
+		recordSizes.push_back(ret);
+		sent += static_cast<size_t>(ret);
+	}
+	EXPECT_EQ(recordSizes, std::vector<int>({ 100, 100, 200, 200, 400 }));
+
+	// One record per call.
+	size_t numOfRecords = 0;
+	for (size_t pos = 0; pos + 5 <= TestConn::s_testBufC2S.size(); ++numOfRecords)
+	{
+		pos += 5 + ((TestConn::s_testBufC2S[pos + 3] << 8) |
+			TestConn::s_testBufC2S[pos + 4]);
+	}
+	EXPECT_EQ(numOfRecords, recordSizes.size());
+
+	std::vector<uint8_t> dataRecv(dataSent.size());
+	for (size_t recv = 0; recv < dataRecv.size(); )
+	{
+		const int ret =
+			svrTls.RecvData(dataRecv.data() + recv, dataRecv.size() - recv);
+		ASSERT_GT(ret, 0);
+		recv += static_cast<size_t>(ret);
+	}
+	EXPECT_EQ(dataSent, dataRecv);
+}
+
+GTEST_TEST(TestTlsIntf, TlsDtlsTimer)
+{
+	using Clock = TlsDtlsTimer::ClockType;
+	const Clock::time_point t0 = Clock::now();
+
+	TlsDtlsTimer timer;
+	EXPECT_FALSE(timer.IsRunning());
+	EXPECT_EQ(timer.Get(t0), -1);
+
+	timer.Set(100, 400, t0);
+	EXPECT_TRUE(timer.IsRunning());
+	EXPECT_EQ(timer.Get(t0), 0);
+	EXPECT_EQ(timer.Get(t0 + std::chrono::milliseconds(100)), 1);
+	EXPECT_EQ(timer.Get(t0 + std::chrono::milliseconds(400)), 2);
+	EXPECT_TRUE(timer.GetExpiry() == t0 + std::chrono::milliseconds(400));
+
+	timer.Set(0, 0, t0);
+	EXPECT_FALSE(timer.IsRunning());
+	EXPECT_EQ(timer.Get(t0), -1);
+}
+
+#if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_COOKIE_C)
+GTEST_TEST(TestTlsIntf, TlsDtlsServerDemux)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			false, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			false, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	EXPECT_TRUE(svrConfig->IsDatagram());
+	EXPECT_THROW(
+		svrConfig->SetDtlsHandshakeTimeout(2000, 1000),
+		InvalidArgumentException
+	);
+	svrConfig->SetDtlsHandshakeTimeout(1000, 8000);
+	svrConfig->SetDtlsCookie(std::make_shared<TlsDtlsCookie>(*rand));
+
+	std::deque<std::vector<uint8_t> > dgramC2S;
+	std::deque<std::vector<uint8_t> > dgramS2C;
+	const std::string cltAddr = "192.0.2.1:4433";
+
+	auto pushTo = [](std::deque<std::vector<uint8_t> >& ch,
+		const void* buf, size_t len)
+	{
+		const uint8_t* begin = static_cast<const uint8_t*>(buf);
+		ch.emplace_back(begin, begin + len);
+		return static_cast<int>(len);
+	};
+
+	EXPECT_THROW(
+		TlsDtlsServerDemux(cltConfig, nullptr),
+		InvalidArgumentException
+	);
+	TlsDtlsServerDemux demux(
+		svrConfig,
+		[&](const std::string& addr, const void* buf, size_t len)
+		{
+			EXPECT_EQ(addr, cltAddr);
+			return pushTo(dgramS2C, buf, len);
+		}
+	);
+	TlsDtlsPeer cltTls(
+		cltConfig,
+		Internal::make_unique<TlsDtlsPeerConn>(
+			"server",
+			[&](const std::string&, const void* buf, size_t len)
+			{
+				return pushTo(dgramC2S, buf, len);
+			}
+		)
+	);
+	ASSERT_NE(cltTls.GetDtlsTimer(), nullptr);
+
+	TlsDtlsPeer* svrTls = nullptr;
+	for (size_t i = 0;
+		i < 100 && (!cltTls.HasHandshakeOver() || svrTls == nullptr);
+		++i)
+	{
+		cltTls.HandshakeNonBlocking();
+		EXPECT_TRUE(cltTls.HasHandshakeOver() || cltTls.GetDtlsTimer()->IsRunning());
+
+		for (; !dgramC2S.empty(); dgramC2S.pop_front())
+		{
+			TlsDtlsPeer* peer = demux.OnDatagram(
+				cltAddr, dgramC2S.front().data(), dgramC2S.front().size()
+			);
+			svrTls = (peer != nullptr) ? peer : svrTls;
+		}
+		if (i == 0)
+		{
+			// No state is kept before the client proves its address.
+			EXPECT_EQ(demux.GetNumOfPeers(), 0U);
+			EXPECT_EQ(dgramS2C.size(), 1U);
+		}
+
+		for (; !dgramS2C.empty(); dgramS2C.pop_front())
+		{
+			cltTls.GetConn().PushDatagram(
+				dgramS2C.front().data(), dgramS2C.front().size()
+			);
+		}
+	}
+	ASSERT_TRUE(cltTls.HasHandshakeOver());
+	ASSERT_NE(svrTls, nullptr);
+	EXPECT_EQ(demux.GetNumOfPeers(), 1U);
+	EXPECT_EQ(demux.Find(cltAddr), svrTls);
+	EXPECT_EQ(demux.Find("192.0.2.2:4433"), nullptr);
+	EXPECT_EQ(demux.OnTimer(), 0U);
+
+	uint32_t secretDataSent = 80127368UL;
+	uint32_t secretDataRecv = 0;
+	cltTls.SendData(&secretDataSent, sizeof(secretDataSent));
+	ASSERT_EQ(dgramC2S.size(), 1U);
+	EXPECT_EQ(
+		demux.OnDatagram(
+			cltAddr, dgramC2S.front().data(), dgramC2S.front().size()
+		),
+		svrTls
+	);
+	dgramC2S.pop_front();
+	EXPECT_EQ(
+		svrTls->RecvData(&secretDataRecv, sizeof(secretDataRecv)),
+		static_cast<int>(sizeof(secretDataRecv))
+	);
+	EXPECT_EQ(secretDataSent, secretDataRecv);
+	EXPECT_EQ(
+		svrTls->RecvData(&secretDataRecv, sizeof(secretDataRecv)),
+		MBEDTLS_ERR_SSL_WANT_READ
+	);
+
+	EXPECT_TRUE(demux.Remove(cltAddr));
+	EXPECT_FALSE(demux.Remove(cltAddr));
+	EXPECT_EQ(demux.GetNumOfPeers(), 0U);
+
+	// New peers are dropped once the table is full.
+	TlsDtlsServerDemux fullDemux(
+		svrConfig,
+		[&](const std::string&, const void* buf, size_t len)
+		{
+			return pushTo(dgramS2C, buf, len);
+		},
+		0
+	);
+	uint8_t dgram[] = { 0x16, 0xFE, 0xFD };
+	EXPECT_EQ(fullDemux.OnDatagram(cltAddr, dgram, sizeof(dgram)), nullptr);
+	EXPECT_EQ(fullDemux.GetNumOfPeers(), 0U);
+	EXPECT_TRUE(dgramS2C.empty());
+
+	// Junk, and ClientHellos without a cookie, from many addresses don't
+	// add peers.
+	TlsDtlsServerDemux junkDemux(
+		svrConfig,
+		[&](const std::string&, const void* buf, size_t len)
+		{
+			return pushTo(dgramS2C, buf, len);
+		},
+		16
+	);
+	TlsDtlsPeer junkCltTls(
+		cltConfig,
+		Internal::make_unique<TlsDtlsPeerConn>(
+			"server",
+			[&](const std::string&, const void* buf, size_t len)
+			{
+				return pushTo(dgramC2S, buf, len);
+			}
+		)
+	);
+	junkCltTls.HandshakeNonBlocking();
+	ASSERT_EQ(dgramC2S.size(), 1U);
+	const std::vector<uint8_t> cltHello = dgramC2S.front();
+	dgramC2S.pop_front();
+
+	for (size_t i = 0; i < 64; ++i)
+	{
+		const std::string addr = "198.51.100." + std::to_string(i) + ":4433";
+		EXPECT_EQ(junkDemux.OnDatagram(addr, dgram, sizeof(dgram)), nullptr);
+		EXPECT_EQ(
+			junkDemux.OnDatagram(addr + "0", cltHello.data(), cltHello.size()),
+			nullptr
+		);
+	}
+	EXPECT_EQ(junkDemux.GetNumOfPeers(), 0U);
+	EXPECT_EQ(junkDemux.OnTimer(), 0U);
+	// Only the ClientHellos are answered, with a HelloVerifyRequest each.
+	EXPECT_EQ(dgramS2C.size(), 64U);
+}
+#endif // MBEDTLS_SSL_DTLS_HELLO_VERIFY && MBEDTLS_SSL_COOKIE_C
+
+
+GTEST_TEST(TestTlsIntf, TlsMemTransport)
+{
+	EXPECT_THROW(TlsMemRingBuffer(0), InvalidArgumentException);
+	EXPECT_THROW(TlsMemRingBuffer(100), InvalidArgumentException);
+
+	auto conns = TlsMemConn::CreatePair(8);
+	uint8_t out[] = { 1, 2, 3, 4, 5, 6 };
+	uint8_t in[8] = { 0 };
+
+	EXPECT_EQ(conns.second->Recv(in, sizeof(in)), MBEDTLS_ERR_SSL_WANT_READ);
+	EXPECT_EQ(conns.first->Send(out, sizeof(out)), 6);
+	EXPECT_EQ(conns.first->Send(out, sizeof(out)), 2);
+	EXPECT_EQ(conns.first->Send(out, sizeof(out)), MBEDTLS_ERR_SSL_WANT_WRITE);
+	EXPECT_EQ(conns.second->GetRecvSize(), 8U);
+
+	// Wraps around the end of the buffer.
+	EXPECT_EQ(conns.second->Recv(in, 4), 4);
+	EXPECT_EQ(conns.first->Send(out, sizeof(out)), 4);
+	EXPECT_EQ(conns.second->Recv(in, sizeof(in)), 8);
+	EXPECT_EQ(
+		std::vector<uint8_t>(in, in + sizeof(in)),
+		std::vector<uint8_t>({ 5, 6, 1, 2, 1, 2, 3, 4 })
+	);
+
+	// The other direction is independent.
+	EXPECT_EQ(conns.first->Recv(in, sizeof(in)), MBEDTLS_ERR_SSL_WANT_READ);
+}
+
+GTEST_TEST(TestTlsIntf, TlsLoadGen)
+{
+	using TestingTktMgtType =
+		TlsSessTktMgr<CipherType::AES, 256, CipherMode::GCM, 86400>;
+
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			std::make_shared<TestingTktMgtType>(
+				Internal::make_unique<DefaultRbg>()
+			)
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	EXPECT_THROW(
+		TlsLoadGen(nullptr, cltConfig, TlsLoadGenOptions()),
+		InvalidArgumentException
+	);
+
+	TlsLoadGenOptions opts;
+	opts.m_numOfPairs = 2;
+	opts.m_numOfConnsPerPair = 5;
+	opts.m_resumptionRatio = 0.5;
+	opts.m_bulkBytes = 64 * 1024;
+
+	const TlsLoadGenReport report =
+		TlsLoadGen(svrConfig, cltConfig, opts).Run();
+
+	EXPECT_EQ(report.m_numOfFailures, 0U);
+	EXPECT_EQ(report.m_numOfHandshakes, 10U);
+	// 2 of the 4 connections after the first one, in each pair.
+	EXPECT_EQ(report.m_numOfResumptions, 4U);
+	EXPECT_EQ(report.m_numOfResumptionFallbacks, 0U);
+	EXPECT_EQ(report.m_bytesTransferred, 10U * 64 * 1024);
+	EXPECT_GT(report.m_elapsedNanoSec, 0U);
+	EXPECT_GT(report.m_hsLatencyP50, 0U);
+	EXPECT_GE(report.m_hsLatencyP99, report.m_hsLatencyP50);
+	EXPECT_GT(report.GetHandshakesPerSec(), 0.0);
+	EXPECT_GT(report.GetThroughput(), 0.0);
+
+	// A server without session tickets (or a session cache) declines the
+	// offered sessions.
+	std::shared_ptr<TlsConfig> noResumeSvrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	const TlsLoadGenReport noResumeReport =
+		TlsLoadGen(noResumeSvrConfig, cltConfig, opts).Run();
+
+	EXPECT_EQ(noResumeReport.m_numOfFailures, 0U);
+	EXPECT_EQ(noResumeReport.m_numOfHandshakes, 10U);
+	EXPECT_EQ(noResumeReport.m_numOfResumptions, 0U);
+	EXPECT_EQ(noResumeReport.m_numOfResumptionFallbacks, 4U);
+}
+
+
+#ifdef MBEDTLS_SSL_ASYNC_PRIVATE
+GTEST_TEST(TestTlsIntf, TlsAsyncPrivKey)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	std::shared_ptr<TlsAsyncDeferredExecutor> executor =
+		std::make_shared<TlsAsyncDeferredExecutor>();
+	svrConfig->SetAsyncPrivKeyExecutor(executor);
+
+	TestConn::s_testBufC2S.clear();
+	TestConn::s_testBufS2C.clear();
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		TestTls svrTls(
+			svrConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(false)
+		);
+		TestTls cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+
+		size_t numOfAsyncOps = 0;
+		int cltRet = MBEDTLS_ERR_SSL_WANT_READ;
+		int svrRet = MBEDTLS_ERR_SSL_WANT_READ;
+		for (size_t i = 0;
+			i < 100 &&
+			(cltRet != MBEDTLS_EXIT_SUCCESS || svrRet != MBEDTLS_EXIT_SUCCESS);
+			++i)
+		{
+			cltRet = cltTls.HandshakeNonBlocking();
+			svrRet = svrTls.HandshakeNonBlocking();
+
+			if (svrRet == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS)
+			{
+				// Nothing moves until the executor runs the operation.
+				EXPECT_EQ(
+					svrTls.HandshakeNonBlocking(),
+					MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS
+				);
+				EXPECT_EQ(executor->GetPendingCount(), 1U);
+
+				numOfAsyncOps += executor->RunPending();
+			}
+		}
+
+		EXPECT_EQ(cltRet, MBEDTLS_EXIT_SUCCESS);
+		EXPECT_EQ(svrRet, MBEDTLS_EXIT_SUCCESS);
+		// The server key exchange is signed on the executor.
+		EXPECT_EQ(numOfAsyncOps, 1U);
+
+		uint32_t secretDataSent = 80127368UL;
+		uint32_t secretDataRecv = 0;
+
+		cltTls.SendData(&secretDataSent, sizeof(secretDataSent));
+		svrTls.RecvData(&secretDataRecv, sizeof(secretDataRecv));
+		EXPECT_EQ(secretDataSent, secretDataRecv);
+	}
+
+	// The blocking handshake can't wait for an executor driven by the
+	// caller, so it's refused, rather than waiting forever.
+	TestConn::s_testBufC2S.clear();
+	TestConn::s_testBufS2C.clear();
+	{
+		TestTls svrTls(
+			svrConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(false)
+		);
+		TestTls cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+
+		EXPECT_EQ(cltTls.HandshakeNonBlocking(), MBEDTLS_ERR_SSL_WANT_READ);
+
+		bool isRefused = false;
+		try
+		{
+			svrTls.Handshake();
+		}
+		catch (const mbedTLSRuntimeError&)
+		{}
+		catch (const RuntimeException&)
+		{
+			isRefused = true;
+		}
+		EXPECT_TRUE(isRefused);
+		EXPECT_EQ(executor->GetPendingCount(), 1U);
+	}
+	// The operation of the closed handshake is dropped.
+	EXPECT_EQ(executor->RunPending(), 1U);
+
+	// The Tls may hold the last reference to its config (e.g., after the
+	// config is rotated), and be destroyed with an operation in progress;
+	// the operation is cancelled through the config, which must still be
+	// alive by then.
+	TestConn::s_testBufC2S.clear();
+	TestConn::s_testBufS2C.clear();
+	{
+		std::shared_ptr<TlsConfig> lastSvrConfig =
+			std::make_shared<TlsConfig>(
+				true, true, false,
+				MBEDTLS_SSL_PRESET_SUITEB,
+				nullptr,
+				nullptr,
+				svrCert,
+				svrPrvKey,
+				Internal::make_unique<DefaultRbg>(),
+				nullptr
+			);
+		lastSvrConfig->SetAsyncPrivKeyExecutor(executor);
+
+		std::unique_ptr<TestTls> svrTls = Internal::make_unique<TestTls>(
+			lastSvrConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(false)
+		);
+		TestTls cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+
+		int svrRet = MBEDTLS_ERR_SSL_WANT_READ;
+		for (size_t i = 0;
+			i < 100 && svrRet != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+			++i)
+		{
+			cltTls.HandshakeNonBlocking();
+			svrRet = svrTls->HandshakeNonBlocking();
+		}
+		EXPECT_EQ(svrRet, MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS);
+		EXPECT_EQ(executor->GetPendingCount(), 1U);
+
+		std::weak_ptr<TlsConfig> configRef = lastSvrConfig;
+		lastSvrConfig.reset();
+		EXPECT_FALSE(configRef.expired());
+
+		svrTls.reset();
+		EXPECT_TRUE(configRef.expired());
+	}
+	EXPECT_EQ(executor->RunPending(), 1U);
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+
+	// Without executor, the operation is done inline.
+	svrConfig->SetAsyncPrivKeyExecutor(nullptr);
+	{
+		TestTls svrTls(
+			svrConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(false)
+		);
+		TestTls cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+
+		while (!cltTls.HasHandshakeOver() || !svrTls.HasHandshakeOver())
+		{
+			EXPECT_NE(
+				cltTls.HandshakeNonBlocking(),
+				MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS
+			);
+			EXPECT_NE(
+				svrTls.HandshakeNonBlocking(),
+				MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS
+			);
+		}
+		EXPECT_EQ(executor->GetPendingCount(), 0U);
+	}
+}
+
+
+namespace
+{
+
+/**
+ * @brief Blocking wrapper of \c TlsMemConn , for the blocking \c Tls APIs;
+ *        it gives up after a while, so a failed peer can't hang the test.
+ *
+ */
+class BlockingMemConn
+{
+public:
+
+	BlockingMemConn(std::unique_ptr<TlsMemConn> conn) :
+		m_conn(std::move(conn)),
+		m_deadline(std::chrono::steady_clock::now() + std::chrono::seconds(60))
+	{}
+
+	virtual ~BlockingMemConn() = default;
+
+	int Send(const void* buf, size_t len)
+	{
+		int ret = m_conn->Send(buf, len);
+		while (ret == MBEDTLS_ERR_SSL_WANT_WRITE && !IsExpired())
+		{
+			std::this_thread::yield();
+			ret = m_conn->Send(buf, len);
+		}
+		return ret == MBEDTLS_ERR_SSL_WANT_WRITE ? MBEDTLS_ERR_SSL_TIMEOUT : ret;
+	}
+
+	int Recv(void* buf, size_t len)
+	{
+		int ret = m_conn->Recv(buf, len);
+		while (ret == MBEDTLS_ERR_SSL_WANT_READ && !IsExpired())
+		{
+			std::this_thread::yield();
+			ret = m_conn->Recv(buf, len);
+		}
+		return ret == MBEDTLS_ERR_SSL_WANT_READ ? MBEDTLS_ERR_SSL_TIMEOUT : ret;
+	}
+
+	int RecvTimeout(void* buf, size_t len, uint32_t /* t */)
+	{
+		return Recv(buf, len);
+	}
+
+private:
+
+	bool IsExpired() const
+	{
+		return std::chrono::steady_clock::now() > m_deadline;
+	}
+
+	std::unique_ptr<TlsMemConn> m_conn;
+	std::chrono::steady_clock::time_point m_deadline;
+};
+
+class CountingWorkerPool : public TlsAsyncWorkerPool
+{
+public:
+
+	CountingWorkerPool(size_t numOfThreads, size_t maxQueueSize) :
+		TlsAsyncWorkerPool(numOfThreads, maxQueueSize),
+		m_numOfTasks(0)
+	{}
+
+	virtual ~CountingWorkerPool() = default;
+
+	virtual bool Submit(std::function<void()> task) override
+	{
+		const bool isAccepted = TlsAsyncWorkerPool::Submit(std::move(task));
+		if (isAccepted)
+		{
+			++m_numOfTasks;
+		}
+		return isAccepted;
+	}
+
+	std::atomic<size_t> m_numOfTasks;
+};
+
+} // namespace
+
+
+GTEST_TEST(TestTlsIntf, TlsAsyncPrivKeyConcurrent)
+{
+	static constexpr size_t sk_numOfPairs = 8;
+
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	std::shared_ptr<CountingWorkerPool> executor =
+		std::make_shared<CountingWorkerPool>(2, 64);
+	svrConfig->SetAsyncPrivKeyExecutor(executor);
+
+	// All servers sign with the same key at the same time, on the executor;
+	// both ends use the blocking APIs, so the servers wait for the
+	// executor.
+	std::atomic<size_t> numOfSuccess(0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < sk_numOfPairs; ++i)
+	{
+		auto conns = TlsMemConn::CreatePair();
+		std::shared_ptr<TlsMemConn> cltConn(std::move(conns.first));
+		std::shared_ptr<TlsMemConn> svrConn(std::move(conns.second));
+
+		threads.emplace_back(
+			[cltConfig, cltConn, i]()
+			{
+				try
+				{
+					Tls<BlockingMemConn> cltTls(
+						cltConfig,
+						nullptr,
+						Internal::make_unique<BlockingMemConn>(
+							Internal::make_unique<TlsMemConn>(std::move(*cltConn))
+						)
+					);
+					const uint64_t data = i;
+					cltTls.SendData(&data, sizeof(data));
+				}
+				catch (...)
+				{}
+			}
+		);
+		threads.emplace_back(
+			[svrConfig, svrConn, i, &numOfSuccess]()
+			{
+				try
+				{
+					Tls<BlockingMemConn> svrTls(
+						svrConfig,
+						nullptr,
+						Internal::make_unique<BlockingMemConn>(
+							Internal::make_unique<TlsMemConn>(std::move(*svrConn))
+						)
+					);
+					uint64_t data = 0;
+					svrTls.RecvData(&data, sizeof(data));
+					if (data == i)
+					{
+						++numOfSuccess;
+					}
+				}
+				catch (...)
+				{}
+			}
+		);
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	EXPECT_EQ(numOfSuccess.load(), sk_numOfPairs);
+	EXPECT_EQ(executor->m_numOfTasks.load(), sk_numOfPairs);
+
+	svrConfig->SetAsyncPrivKeyExecutor(nullptr);
+}
+#endif // MBEDTLS_SSL_ASYNC_PRIVATE
+
+
+#ifdef MBEDTLS_SSL_SERVER_NAME_INDICATION
+GTEST_TEST(TestTlsIntf, TlsSniCertSelection)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > defaultKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > exactKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > wildcardKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> defaultCert =
+		CreateSelfSignedCert(*defaultKey, "C=US,CN=default", *rand);
+	std::shared_ptr<X509Cert> exactCert =
+		CreateSelfSignedCert(*exactKey, "C=US,CN=a.example.com", *rand);
+	std::shared_ptr<X509Cert> wildcardCert =
+		CreateSelfSignedCert(*wildcardKey, "C=US,CN=*.example.net", *rand);
+
+	std::shared_ptr<TlsSniCertTable> sniTable =
+		std::make_shared<TlsSniCertTable>();
+	sniTable->Add("a.example.com", exactCert, exactKey);
+	sniTable->Add("*.example.net", wildcardCert, wildcardKey);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			defaultCert,
+			defaultKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	svrConfig->SetSniCertTable(sniTable);
+
+	std::shared_ptr<TlsConfig> svrNoDefaultConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	svrNoDefaultConfig->SetSniCertTable(sniTable);
+
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	auto connectTo = [&cltConfig](
+		std::shared_ptr<TlsConfig> svrCfg,
+		const std::string& hostname
+	) -> std::vector<uint8_t>
+	{
+		TestConn::s_testBufC2S.clear();
+		TestConn::s_testBufS2C.clear();
+
+		TestTls svrTls(svrCfg, nullptr, Internal::make_unique<TestConn>(false));
+		TestTls cltTls(cltConfig, nullptr, Internal::make_unique<TestConn>(true));
+		cltTls.SetHostname(hostname);
+
+		while (!cltTls.HasHandshakeOver() || !svrTls.HasHandshakeOver())
+		{
+			cltTls.HandshakeNonBlocking();
+			svrTls.HandshakeNonBlocking();
+		}
+
+		return cltTls.BorrowPeerCert().GetDer();
+	};
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	EXPECT_EQ(connectTo(svrConfig, "a.example.com"), exactCert->GetDer());
+	EXPECT_EQ(connectTo(svrConfig, "A.Example.COM"), exactCert->GetDer());
+	EXPECT_EQ(connectTo(svrConfig, "www.example.net"), wildcardCert->GetDer());
+	EXPECT_EQ(connectTo(svrConfig, "b.example.com"), defaultCert->GetDer());
+	EXPECT_EQ(connectTo(svrConfig, "a.b.example.net"), defaultCert->GetDer());
+
+	EXPECT_EQ(
+		connectTo(svrNoDefaultConfig, "www.example.net"),
+		wildcardCert->GetDer()
+	);
+	EXPECT_THROW(
+		connectTo(svrNoDefaultConfig, "b.example.com"),
+		mbedTLSRuntimeError
+	);
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+#endif // MBEDTLS_SSL_SERVER_NAME_INDICATION
+
+
+#ifdef MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+
+GTEST_TEST(TestTlsIntf, TlsVerifyCache)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	EcKeyPair<EcType::SECP256R1> caPrvKey =
+		EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+	EcKeyPair<EcType::SECP256R1> otherCaPrvKey =
+		EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > cltPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> caCert =
+		CreateSelfSignedCert(caPrvKey, "C=US,CN=Test CA", *rand);
+	// Same name, different key.
+	std::shared_ptr<X509Cert> otherCaCert =
+		CreateSelfSignedCert(otherCaPrvKey, "C=US,CN=Test CA", *rand);
+
+	auto issueCert = [&rand](
+		const X509Cert& ca,
+		const EcKeyPair<EcType::SECP256R1>& caKey,
+		const EcKeyPair<EcType::SECP256R1>& key,
+		const std::string& subject
+	) -> std::shared_ptr<X509Cert>
+	{
+		auto der = X509CertWriter::CaSign(
+			HashType::SHA256,
+			ca,
+			caKey,
+			key,
+			subject
+		).SetBasicConstraints(
+			false, 0
+		).SetSerialNum(
+			BigNumber<>(12345)
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		).GetDer(*rand);
+		return std::make_shared<X509Cert>(X509Cert::FromDER(CtnFullR(der)));
+	};
+
+	std::shared_ptr<X509Cert> svrCert =
+		issueCert(*caCert, caPrvKey, *svrPrvKey, "C=US,CN=Test Server");
+	std::shared_ptr<X509Cert> cltCert =
+		issueCert(*caCert, caPrvKey, *cltPrvKey, "C=US,CN=Test Client");
+	std::shared_ptr<X509Cert> badCltCert =
+		issueCert(*otherCaCert, otherCaPrvKey, *cltPrvKey, "C=US,CN=Test Client");
+
+	std::shared_ptr<TlsVerifyCache> cache =
+		std::make_shared<TlsVerifyCache>(16, std::chrono::hours(1));
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, true,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			caCert,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	svrConfig->SetVerifyCache(cache);
+
+	auto connect = [&caCert, &svrConfig, &cltPrvKey](
+		std::shared_ptr<X509Cert> cltCertToUse
+	) -> std::vector<uint8_t>
+	{
+		std::shared_ptr<TlsConfig> cltConfig =
+			std::make_shared<TlsConfig>(
+				true, false, true,
+				MBEDTLS_SSL_PRESET_SUITEB,
+				caCert,
+				nullptr,
+				cltCertToUse,
+				cltPrvKey,
+				Internal::make_unique<DefaultRbg>(),
+				nullptr
+			);
+
+		TestConn::s_testBufC2S.clear();
+		TestConn::s_testBufS2C.clear();
+
+		TestTls svrTls(svrConfig, nullptr, Internal::make_unique<TestConn>(false));
+		TestTls cltTls(cltConfig, nullptr, Internal::make_unique<TestConn>(true));
+
+		while (!cltTls.HasHandshakeOver() || !svrTls.HasHandshakeOver())
+		{
+			cltTls.HandshakeNonBlocking();
+			svrTls.HandshakeNonBlocking();
+		}
+
+		return svrTls.BorrowPeerCert().GetDer();
+	};
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	// The first handshake runs the full verification, and caches the chain.
+	EXPECT_EQ(connect(cltCert), cltCert->GetDer());
+	EXPECT_EQ(cache->GetSize(), 1U);
+
+	// The second one is accepted by the cache.
+	EXPECT_EQ(connect(cltCert), cltCert->GetDer());
+	EXPECT_EQ(cache->GetSize(), 1U);
+
+	// Chains not in the cache still go through the full verification.
+	EXPECT_THROW(connect(badCltCert), mbedTLSRuntimeError);
+	EXPECT_EQ(cache->GetSize(), 1U);
+
+	// Cached results are not used once the trusted CAs change.
+	std::shared_ptr<TrustStore> store = std::make_shared<TrustStore>();
+	store->Add(*otherCaCert);
+	svrConfig->SetTrustStore(store);
+	EXPECT_THROW(connect(cltCert), mbedTLSRuntimeError);
+
+	svrConfig->SetTrustStore(nullptr);
+	EXPECT_EQ(connect(cltCert), cltCert->GetDer());
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+
+#endif // MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK
+
+
+#ifdef MBEDTLSCPP_INTERNAL_KTLS
+
+class TestSockConn
+{
+public:
+	TestSockConn(int sock) :
+		m_sock(sock)
+	{}
+
+	virtual ~TestSockConn()
+	{}
+
+	virtual int Send(const void* buf, size_t len)
+	{
+		const ssize_t ret = ::send(m_sock, buf, len, MSG_NOSIGNAL);
+		return ret < 0 ? MBEDTLS_ERR_NET_SEND_FAILED : static_cast<int>(ret);
+	}
+
+	virtual int Recv(void* buf, size_t len)
+	{
+		const ssize_t ret = ::recv(m_sock, buf, len, 0);
+		return ret < 0 ? MBEDTLS_ERR_NET_RECV_FAILED : static_cast<int>(ret);
+	}
+
+	virtual int RecvTimeout(void* /* buf */, size_t /* len */, uint32_t /* t */)
+	{
+		throw mbedTLSRuntimeError(
+			MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE,
+			"TestSockConn does not support RecvTimeout"
+		);
+	}
+
+private:
+
+	int m_sock;
+
+}; // class TestSockConn
+
+GTEST_TEST(TestTlsIntf, TlsKtlsLoopback)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > svrPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	std::shared_ptr<X509Cert> svrCert =
+		CreateSelfSignedCert(*svrPrvKey, "C=US,CN=Test Server", *rand);
+
+	std::shared_ptr<TlsConfig> svrConfig =
+		std::make_shared<TlsConfig>(
+			true, true, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			svrCert,
+			svrPrvKey,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	std::shared_ptr<TlsConfig> cltConfig =
+		std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+	// Without the offload enabled in the config, nothing is captured.
+	{
+		TestTls tls(
+			std::make_shared<TlsConfig>(
+				true, false, false,
+				MBEDTLS_SSL_PRESET_SUITEB,
+				nullptr,
+				nullptr,
+				nullptr,
+				nullptr,
+				Internal::make_unique<DefaultRbg>(),
+				nullptr
+			),
+			nullptr,
+			Internal::make_unique<TestConn>(true)
+		);
+		EXPECT_FALSE(tls.EnableKtls(-1));
+		EXPECT_FALSE(tls.IsKtlsTxEnabled());
+		EXPECT_FALSE(tls.IsKtlsRxEnabled());
+	}
+
+	EXPECT_FALSE(svrConfig->IsKtlsOffloadEnabled());
+	svrConfig->SetKtlsOffload(true);
+	cltConfig->SetKtlsOffload(true);
+	EXPECT_TRUE(svrConfig->IsKtlsOffloadEnabled());
+	EXPECT_TRUE(cltConfig->IsKtlsOffloadEnabled());
+
+	// A TCP connection over loopback.
+	const int listenSock = ::socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(listenSock, 0);
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t addrLen = sizeof(addr);
+	ASSERT_EQ(::bind(listenSock, reinterpret_cast<sockaddr*>(&addr), addrLen), 0);
+	ASSERT_EQ(::listen(listenSock, 1), 0);
+	ASSERT_EQ(
+		::getsockname(listenSock, reinterpret_cast<sockaddr*>(&addr), &addrLen),
+		0
+	);
+
+	const int cltSock = ::socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(cltSock, 0);
+	ASSERT_EQ(::connect(cltSock, reinterpret_cast<sockaddr*>(&addr), addrLen), 0);
+	const int svrSock = ::accept(listenSock, nullptr, nullptr);
+	ASSERT_GE(svrSock, 0);
+
+	bool isOffloaded = false;
+	{
+		std::unique_ptr<Tls<TestSockConn> > svrTls;
+		std::thread svrThread(
+			[&svrTls, &svrConfig, svrSock]()
+			{
+				EXPECT_NO_THROW(
+					svrTls = Internal::make_unique<Tls<TestSockConn> >(
+						svrConfig,
+						nullptr,
+						Internal::make_unique<TestSockConn>(svrSock)
+					)
+				);
+			}
+		);
+		Tls<TestSockConn> cltTls(
+			cltConfig,
+			nullptr,
+			Internal::make_unique<TestSockConn>(cltSock)
+		);
+		svrThread.join();
+		ASSERT_NE(svrTls, nullptr);
+
+		// The kernel may refuse (e.g., when the tls module isn't loaded), in
+		// which case the connection stays with mbed TLS.
+		const bool isSvrOffloaded = svrTls->EnableKtls(svrSock);
+		const bool isCltOffloaded = cltTls.EnableKtls(cltSock);
+		isOffloaded = isSvrOffloaded && isCltOffloaded;
+
+		uint32_t secretDataSent = 80127368UL;
+		uint32_t secretDataRecv = 0;
+
+		if (isOffloaded)
+		{
+			EXPECT_TRUE(svrTls->IsKtlsRxEnabled());
+			EXPECT_TRUE(cltTls.IsKtlsRxEnabled());
+			// The secrets are gone after the first attempt.
+			EXPECT_TRUE(svrTls->EnableKtls(svrSock));
+
+			// Through the kernel, in both directions.
+			cltTls.SendData(&secretDataSent, sizeof(secretDataSent));
+			svrTls->RecvData(&secretDataRecv, sizeof(secretDataRecv));
+			EXPECT_EQ(secretDataSent, secretDataRecv);
+
+			secretDataRecv = 0;
+			svrTls->SendData(&secretDataSent, sizeof(secretDataSent));
+			cltTls.RecvData(&secretDataRecv, sizeof(secretDataRecv));
+			EXPECT_EQ(secretDataSent, secretDataRecv);
+
+			// Plain data written to the socket is encrypted by the kernel.
+			if (cltTls.IsKtlsTxEnabled())
+			{
+				secretDataRecv = 0;
+				ASSERT_EQ(
+					::send(cltSock, &secretDataSent, sizeof(secretDataSent), 0),
+					static_cast<ssize_t>(sizeof(secretDataSent))
+				);
+				svrTls->RecvData(&secretDataRecv, sizeof(secretDataRecv));
+				EXPECT_EQ(secretDataSent, secretDataRecv);
+			}
+			if (svrTls->IsKtlsTxEnabled())
+			{
+				secretDataRecv = 0;
+				svrTls->SendData(&secretDataSent, sizeof(secretDataSent));
+				ASSERT_EQ(
+					::recv(cltSock, &secretDataRecv, sizeof(secretDataRecv), MSG_WAITALL),
+					static_cast<ssize_t>(sizeof(secretDataRecv))
+				);
+				EXPECT_EQ(secretDataSent, secretDataRecv);
+			}
+		}
+		else
+		{
+			EXPECT_EQ(svrTls->IsKtlsRxEnabled(), isSvrOffloaded);
+			EXPECT_EQ(cltTls.IsKtlsRxEnabled(), isCltOffloaded);
+		}
+
+		if (!isSvrOffloaded && !isCltOffloaded)
+		{
+			EXPECT_FALSE(svrTls->IsKtlsTxEnabled());
+			EXPECT_FALSE(cltTls.IsKtlsTxEnabled());
+
+			// Falls back cleanly; mbed TLS still carries the data, in both
+			// directions.
+			cltTls.SendData(&secretDataSent, sizeof(secretDataSent));
+			svrTls->RecvData(&secretDataRecv, sizeof(secretDataRecv));
+			EXPECT_EQ(secretDataSent, secretDataRecv);
+
+			secretDataRecv = 0;
+			svrTls->SendData(&secretDataSent, sizeof(secretDataSent));
+			cltTls.RecvData(&secretDataRecv, sizeof(secretDataRecv));
+			EXPECT_EQ(secretDataSent, secretDataRecv);
+		}
+	}
+
+	::close(svrSock);
+	::close(cltSock);
+	::close(listenSock);
+
+	if (!isOffloaded)
+	{
+		GTEST_SKIP() << "kTLS is not supported here"
+			" (e.g., the tls kernel module isn't loaded).";
+	}
+}
+
+#endif // MBEDTLSCPP_INTERNAL_KTLS
@@ -6,7 +6,15 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
 #include <mbedTLScpp/TlsConfig.hpp>
+#include <mbedTLScpp/TlsConfigHolder.hpp>
+#include <mbedTLScpp/TlsVerifyCache.hpp>
 
 #include <mbedTLScpp/DefaultRbg.hpp>
 #include <mbedTLScpp/EcKey.hpp>
@@ -150,3 +158,423 @@ GTEST_TEST(TestTlsConfig, TlsConfigClass)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+GTEST_TEST(TestTlsConfig, TlsConfigGroups)
+{
+	EXPECT_EQ(ToTlsGroupId(EcType::CURVE25519), MBEDTLS_SSL_IANA_TLS_GROUP_X25519);
+	EXPECT_EQ(ToTlsGroupId(EcType::SECP256R1), MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1);
+	EXPECT_EQ(GetFastTlsGroupPreference()[0], EcType::CURVE25519);
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		TlsConfig tlsConf1(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_DEFAULT,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+		EXPECT_THROW(
+			tlsConf1.SetGroups(std::vector<EcType>()),
+			InvalidArgumentException
+		);
+
+		tlsConf1.SetGroups(GetFastTlsGroupPreference());
+
+		// The group list must survive moves
+		TlsConfig tlsConf2(std::move(tlsConf1));
+		tlsConf2.NullCheck();
+		EXPECT_THROW(tlsConf1.SetGroups(GetFastTlsGroupPreference()), InvalidObjectException);
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+
+GTEST_TEST(TestTlsConfig, TlsConfigCipherSuites)
+{
+	CpuFeatures withAes = CpuFeatures();
+	withAes.m_hasAes = true;
+	withAes.m_hasClmul = true;
+	CpuFeatures withoutAes = CpuFeatures();
+	withoutAes.m_hasAes = true;
+	EXPECT_TRUE(withAes.HasFastAesGcm());
+	EXPECT_FALSE(withoutAes.HasFastAesGcm());
+
+	const CpuFeatures& hostCpu = GetCpuFeatures();
+	EXPECT_EQ(&hostCpu, &GetCpuFeatures());
+
+	const std::vector<int> aesFirst = GetFastTlsCipherSuitePreference(withAes);
+	const std::vector<int> chachaFirst =
+		GetFastTlsCipherSuitePreference(withoutAes);
+	auto suitePos = [](const std::vector<int>& suites, int suite)
+	{
+		return std::find(suites.begin(), suites.end(), suite) - suites.begin();
+	};
+	ASSERT_FALSE(aesFirst.empty());
+	EXPECT_LT(
+		suitePos(aesFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256),
+		suitePos(aesFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256)
+	);
+	EXPECT_LT(
+		suitePos(chachaFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256),
+		suitePos(chachaFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256)
+	);
+	EXPECT_LT(
+		suitePos(aesFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256),
+		suitePos(aesFirst, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384)
+	);
+	// Only the order changes; the other enabled suites are kept.
+	EXPECT_EQ(aesFirst.size(), chachaFirst.size());
+	EXPECT_TRUE(
+		std::is_permutation(aesFirst.begin(), aesFirst.end(), chachaFirst.begin())
+	);
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		TlsConfig tlsConf1(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_DEFAULT,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+
+		EXPECT_THROW(
+			tlsConf1.SetCipherSuites(std::vector<int>()),
+			InvalidArgumentException
+		);
+		EXPECT_THROW(
+			tlsConf1.SetCipherSuites(std::vector<int>({ 0xFFFF })),
+			InvalidArgumentException
+		);
+
+		const std::vector<int> defSuites = tlsConf1.GetCipherSuites();
+		const std::vector<uint16_t> defGroups = tlsConf1.GetGroups();
+		ASSERT_FALSE(defSuites.empty());
+		ASSERT_FALSE(defGroups.empty());
+
+		tlsConf1.SetFastPreference();
+		tlsConf1.SetFastPreference(withoutAes);
+		EXPECT_EQ(tlsConf1.GetCipherSuites()[0], chachaFirst[0]);
+		EXPECT_TRUE(std::is_permutation(
+			defSuites.begin(), defSuites.end(),
+			tlsConf1.GetCipherSuites().begin()
+		));
+		EXPECT_EQ(tlsConf1.GetCipherSuites().size(), defSuites.size());
+		EXPECT_EQ(tlsConf1.GetGroups().size(), defGroups.size());
+
+		// The suite list must survive moves
+		TlsConfig tlsConf2(std::move(tlsConf1));
+		tlsConf2.NullCheck();
+		EXPECT_THROW(tlsConf1.SetCipherSuites(aesFirst), InvalidObjectException);
+
+		// A restrictive preset is only reordered, not widened.
+		TlsConfig suiteBConf(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_SUITEB,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+		const std::vector<int> suiteBSuites = suiteBConf.GetCipherSuites();
+		const std::vector<uint16_t> suiteBGroups = suiteBConf.GetGroups();
+
+		suiteBConf.SetFastPreference(withAes);
+		const std::vector<int> fastSuites = suiteBConf.GetCipherSuites();
+		ASSERT_EQ(fastSuites.size(), suiteBSuites.size());
+		EXPECT_TRUE(std::is_permutation(
+			suiteBSuites.begin(), suiteBSuites.end(), fastSuites.begin()
+		));
+		EXPECT_LT(
+			suitePos(fastSuites, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256),
+			suitePos(fastSuites, MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384)
+		);
+		const std::vector<uint16_t> fastGroups = suiteBConf.GetGroups();
+		ASSERT_EQ(fastGroups.size(), suiteBGroups.size());
+		EXPECT_TRUE(std::is_permutation(
+			suiteBGroups.begin(), suiteBGroups.end(), fastGroups.begin()
+		));
+		EXPECT_EQ(
+			std::find(
+				fastGroups.begin(),
+				fastGroups.end(),
+				ToTlsGroupId(EcType::CURVE25519)
+			),
+			fastGroups.end()
+		);
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+
+GTEST_TEST(TestTlsConfig, TlsSniCertTable)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > testPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+
+	auto testCertDer = X509CertWriter::SelfSign(
+		HashType::SHA256,
+		*testPrvKey,
+		"C=US,CN=Test CA"
+	).SetBasicConstraints(
+		true, -1
+	).SetSerialNum(
+		BigNumber<>(12345)
+	).SetValidationTime(
+		"20210101000000", "29991231235959"
+	).GetDer(*rand);
+
+	std::shared_ptr<X509Cert> cert1 =
+		std::make_shared<X509Cert>(X509Cert::FromDER(CtnFullR(testCertDer)));
+	std::shared_ptr<X509Cert> cert2 =
+		std::make_shared<X509Cert>(X509Cert::FromDER(CtnFullR(testCertDer)));
+
+	TlsSniCertTable table;
+	table.Add("Example.COM.", cert1, testPrvKey);
+	table.Add("*.example.com", cert2, testPrvKey);
+	EXPECT_EQ(table.GetSize(), 2U);
+
+	EXPECT_THROW(table.Add("", cert1, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add("*", cert1, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add("*.", cert1, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add("a.*.com", cert1, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add(".example.com", cert1, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add("a.com", nullptr, testPrvKey), InvalidArgumentException);
+	EXPECT_THROW(table.Add("a.com", cert1, nullptr), InvalidArgumentException);
+	EXPECT_EQ(table.GetSize(), 2U);
+
+	// Exact names, case-insensitive, with or without the trailing dot.
+	ASSERT_NE(table.Find("example.com"), nullptr);
+	EXPECT_EQ(table.Find("example.com")->m_chain, cert1);
+	ASSERT_NE(table.Find("EXAMPLE.com."), nullptr);
+	EXPECT_EQ(table.Find("EXAMPLE.com.")->m_chain, cert1);
+
+	// Wildcard matches exactly one label.
+	ASSERT_NE(table.Find("www.Example.com"), nullptr);
+	EXPECT_EQ(table.Find("www.Example.com")->m_chain, cert2);
+	EXPECT_EQ(table.Find("a.www.example.com"), nullptr);
+	EXPECT_EQ(table.Find(".example.com"), nullptr);
+	EXPECT_EQ(table.Find("example.org"), nullptr);
+	EXPECT_EQ(table.Find(""), nullptr);
+
+	// Private keys by certificate.
+	EXPECT_EQ(table.FindPrivKey(*cert1->Get()), testPrvKey);
+	EXPECT_EQ(table.FindPrivKey(*cert2->Get()), testPrvKey);
+	EXPECT_EQ(table.GetPrivKeys().size(), 2U);
+
+	// Replacing a name drops the mapping of the old chain.
+	std::shared_ptr<EcKeyPair<EcType::SECP256R1> > newPrvKey =
+		std::make_shared<EcKeyPair<EcType::SECP256R1> >(
+			EcKeyPair<EcType::SECP256R1>::Generate(*rand)
+		);
+	std::shared_ptr<X509Cert> cert3 =
+		std::make_shared<X509Cert>(X509Cert::FromDER(CtnFullR(testCertDer)));
+	const long keyUseCount = testPrvKey.use_count();
+
+	table.Add("example.com", cert3, newPrvKey);
+	EXPECT_EQ(table.GetSize(), 2U);
+	ASSERT_NE(table.Find("example.com"), nullptr);
+	EXPECT_EQ(table.Find("example.com")->m_chain, cert3);
+	EXPECT_EQ(table.FindPrivKey(*cert1->Get()), nullptr);
+	EXPECT_EQ(table.FindPrivKey(*cert3->Get()), newPrvKey);
+	EXPECT_EQ(table.FindPrivKey(*cert2->Get()), testPrvKey);
+	EXPECT_EQ(table.GetPrivKeys().size(), 2U);
+	EXPECT_EQ(testPrvKey.use_count(), keyUseCount - 2);
+	EXPECT_EQ(cert1.use_count(), 1);
+
+	// A chain shared by another name keeps its mapping.
+	table.Add("www.example.org", cert2, testPrvKey);
+	table.Add("www.example.org", cert1, testPrvKey);
+	EXPECT_EQ(table.FindPrivKey(*cert2->Get()), testPrvKey);
+	EXPECT_EQ(table.FindPrivKey(*cert1->Get()), testPrvKey);
+	EXPECT_EQ(table.GetPrivKeys().size(), 3U);
+}
+
+GTEST_TEST(TestTlsConfig, TlsVerifyCache)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	auto testPrvKey = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+
+	auto makeCertPem = [&rand, &testPrvKey](const std::string& subject)
+	{
+		return X509CertWriter::SelfSign(
+			HashType::SHA256,
+			testPrvKey,
+			subject
+		).SetBasicConstraints(
+			true, -1
+		).SetSerialNum(
+			BigNumber<>(12345)
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		).GetPem(*rand);
+	};
+	const std::string pem1 = makeCertPem("C=US,CN=Test 1");
+	const std::string pem2 = makeCertPem("C=US,CN=Test 2");
+
+	X509Cert cert1  = X509Cert::FromPEM(pem1);
+	X509Cert chain1 = X509Cert::FromPEM(pem1 + "\n" + pem2);
+	X509Cert chain2 = X509Cert::FromPEM(pem2 + "\n" + pem1);
+
+	int64_t initCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+
+	// Keys
+	{
+		const std::string key = TlsVerifyCache::MakeKey(*cert1.Get(), 1, 2);
+		EXPECT_EQ(key.size(), 32U);
+		EXPECT_EQ(key, TlsVerifyCache::MakeKey(*cert1.Get(), 1, 2));
+		EXPECT_NE(key, TlsVerifyCache::MakeKey(*cert1.Get(), 3, 2));
+		EXPECT_NE(key, TlsVerifyCache::MakeKey(*cert1.Get(), 1, 3));
+		EXPECT_NE(key, TlsVerifyCache::MakeKey(*chain1.Get(), 1, 2));
+		EXPECT_NE(
+			TlsVerifyCache::MakeKey(*chain1.Get(), 1, 2),
+			TlsVerifyCache::MakeKey(*chain2.Get(), 1, 2)
+		);
+		// The key of a part of the chain.
+		EXPECT_EQ(
+			TlsVerifyCache::MakeKey(*chain2.Get()->next, 1, 2),
+			key
+		);
+	}
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+
+	EXPECT_THROW(
+		TlsVerifyCache(0, std::chrono::seconds(1)),
+		InvalidArgumentException
+	);
+
+	// Eviction
+	{
+		TlsVerifyCache cache(2, std::chrono::hours(1));
+		cache.Insert("a");
+		cache.Insert("b");
+		EXPECT_TRUE(cache.Contains("a"));
+		EXPECT_TRUE(cache.Contains("b"));
+		EXPECT_FALSE(cache.Contains("c"));
+
+		cache.Insert("c");
+		EXPECT_EQ(cache.GetSize(), 2U);
+		EXPECT_FALSE(cache.Contains("a"));
+		EXPECT_TRUE(cache.Contains("b"));
+		EXPECT_TRUE(cache.Contains("c"));
+
+		cache.Clear();
+		EXPECT_EQ(cache.GetSize(), 0U);
+		EXPECT_FALSE(cache.Contains("b"));
+	}
+
+	// Time to live
+	{
+		TlsVerifyCache cache(10, std::chrono::milliseconds(20));
+		cache.Insert("a");
+		EXPECT_TRUE(cache.Contains("a"));
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(40));
+		EXPECT_FALSE(cache.Contains("a"));
+
+		// Expired entries are evicted by later insertions.
+		cache.Insert("b");
+		EXPECT_EQ(cache.GetSize(), 1U);
+		EXPECT_TRUE(cache.Contains("b"));
+	}
+}
+
+GTEST_TEST(TestTlsConfig, TlsConfigHolder)
+{
+	auto newConfig = []()
+	{
+		return std::make_shared<TlsConfig>(
+			true, false, false,
+			MBEDTLS_SSL_PRESET_DEFAULT,
+			nullptr,
+			nullptr,
+			nullptr,
+			nullptr,
+			Internal::make_unique<DefaultRbg>(),
+			nullptr
+		);
+	};
+
+	std::shared_ptr<const TlsConfig> config1 = newConfig();
+	std::shared_ptr<const TlsConfig> config2 = newConfig();
+
+	EXPECT_THROW(TlsConfigHolder(nullptr), InvalidArgumentException);
+
+	TlsConfigHolder holder(config1);
+	EXPECT_EQ(holder.GetConfig(), config1);
+	EXPECT_EQ(holder.GetVersion(), 0U);
+
+	EXPECT_THROW(holder.SetConfig(nullptr), InvalidArgumentException);
+	EXPECT_EQ(holder.GetConfig(), config1);
+
+	// Connections that took the old config keep it.
+	std::shared_ptr<const TlsConfig> inUse = holder.GetConfig();
+	EXPECT_EQ(holder.ExchangeConfig(config2), config1);
+	EXPECT_EQ(holder.GetConfig(), config2);
+	EXPECT_EQ(inUse, config1);
+	EXPECT_EQ(holder.GetVersion(), 1U);
+
+	// Concurrent readers always see a valid config.
+	std::atomic<bool> isStopping(false);
+	std::vector<std::thread> readers;
+	std::atomic<size_t> numOfBadReads(0);
+	for (size_t i = 0; i < 4; ++i)
+	{
+		readers.emplace_back(
+			[&holder, &isStopping, &numOfBadReads]()
+			{
+				while (!isStopping.load())
+				{
+					std::shared_ptr<const TlsConfig> config =
+						holder.GetConfig();
+					if (config == nullptr || config->IsNull())
+					{
+						++numOfBadReads;
+					}
+				}
+			}
+		);
+	}
+	for (size_t i = 0; i < 100; ++i)
+	{
+		holder.SetConfig(newConfig());
+	}
+	isStopping.store(true);
+	for (std::thread& reader : readers)
+	{
+		reader.join();
+	}
+	EXPECT_EQ(numOfBadReads.load(), 0U);
+	EXPECT_EQ(holder.GetVersion(), 101U);
+}
@@ -4,11 +4,15 @@
 // https://opensource.org/licenses/MIT.
 
 
+#include <cstring>
+
 #include <gtest/gtest.h>
 
 #include <mbedTLScpp/EcKey.hpp>
 #include <mbedTLScpp/DefaultRbg.hpp>
+#include <mbedTLScpp/TrustStore.hpp>
 #include <mbedTLScpp/X509Cert.hpp>
+#include <mbedTLScpp/X509CertBundleLoader.hpp>
 
 #include "SharedVars.hpp"
 #include "MemoryTest.hpp"
@@ -320,6 +324,57 @@ GTEST_TEST(TestX509Cert, X509CertDERAndPEM)
 }
 
 
+GTEST_TEST(TestX509Cert, X509CertNoCopy)
+{
+	const std::string pem = GetTestX509CertPem().data();
+	const std::vector<uint8_t> derCopy = X509Cert::FromPEM(pem).GetDer();
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		std::weak_ptr<const std::vector<uint8_t> > derRef;
+		{
+			std::shared_ptr<const std::vector<uint8_t> > der =
+				std::make_shared<std::vector<uint8_t> >(derCopy);
+			derRef = der;
+
+			X509Cert cert1 = X509Cert::FromDERNoCopy(CtnFullR(*der), der);
+			der.reset();
+
+			// The certificate references the buffer, and keeps it alive.
+			ASSERT_FALSE(derRef.expired());
+			EXPECT_EQ(cert1.Get()->raw.p, derRef.lock()->data());
+			EXPECT_EQ(cert1.GetPem(), pem);
+
+			// The owner is moved along with the certificate.
+			X509Cert cert2 = std::move(cert1);
+			EXPECT_FALSE(derRef.expired());
+			EXPECT_EQ(cert2.GetDer(), derCopy);
+
+			// Append to a chain; the caller owns the buffer.
+			cert2.AppendDERNoCopy(CtnFullR(derCopy), nullptr);
+			ASSERT_TRUE(cert2.HasNext());
+			cert2.NextCert();
+			EXPECT_EQ(cert2.GetCurr()->raw.p, derCopy.data());
+
+			std::vector<uint8_t> badDer(derCopy.begin(), derCopy.begin() + 10);
+			EXPECT_THROW(
+				cert2.AppendDERNoCopy(CtnFullR(badDer), nullptr),
+				mbedTLSRuntimeError
+			);
+		}
+		EXPECT_TRUE(derRef.expired());
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
+
+
 GTEST_TEST(TestX509Cert, X509CertGetters)
 {
 	int64_t initCount = 0;
@@ -634,3 +689,374 @@ GTEST_TEST(TestX509CertWrt, X509CertChain)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+GTEST_TEST(TestX509Cert, TrustStore)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+
+	auto testCaKey1  = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+	auto testCaKey2  = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+	auto testSubKey  = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+
+	auto makeCa = [&rand](
+		const EcKeyPair<EcType::SECP256R1>& key,
+		const std::string& subject
+	) -> std::string
+	{
+		X509CertWriter writer = X509CertWriter::SelfSign(
+			HashType::SHA256,
+			key,
+			subject
+		);
+		writer.SetBasicConstraints(
+			true, -1
+		).SetKeyUsage(
+			MBEDTLS_X509_KU_KEY_CERT_SIGN |
+			MBEDTLS_X509_KU_CRL_SIGN
+		).SetSerialNum(
+			BigNumber<>(1)
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		);
+		return writer.GetPem(*rand);
+	};
+
+	auto makeSub = [&rand, &testSubKey](
+		const std::string& caPem,
+		const EcKeyPair<EcType::SECP256R1>& caKey
+	) -> std::string
+	{
+		X509Cert certCa = X509Cert::FromPEM(caPem);
+		X509CertWriter writer = X509CertWriter::CaSign(
+			HashType::SHA256,
+			certCa,
+			caKey,
+			testSubKey,
+			"C=UK,O=ARM,CN=mbed TLS Client 1"
+		);
+		writer.SetBasicConstraints(
+			false, 0
+		).SetSerialNum(
+			BigNumber<>(2)
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		);
+		return writer.GetPem(*rand);
+	};
+
+	// Two CAs share the same subject (e.g., a re-keyed CA), and the subject
+	// of another one only differs in case.
+	const std::string caPem1  = makeCa(testCaKey1, "C=UK,O=ARM,CN=Test CA 1");
+	const std::string caPem1b = makeCa(testCaKey2, "C=UK,O=ARM,CN=Test CA 1");
+	const std::string caPem2  = makeCa(testCaKey2, "C=UK,O=ARM,CN=Test CA 2");
+	const std::string caPem3  = makeCa(testCaKey1, "C=UK,O=ARM,CN=TEST CA 3");
+	const std::string caPem3l = makeCa(testCaKey2, "C=UK,O=ARM,CN=test ca 3");
+
+	const std::string subPem1 = makeSub(caPem1, testCaKey1);
+	const std::string subPem3 = makeSub(caPem3, testCaKey1);
+	const std::string subPemX = makeSub(
+		makeCa(testCaKey1, "C=UK,O=ARM,CN=Unknown CA"), testCaKey1
+	);
+
+	int64_t initCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+
+	{
+		TrustStore store;
+		EXPECT_EQ(store.GetSize(), 0U);
+
+		store.Add(X509Cert::FromPEM(caPem1 + "\n" + caPem2));
+		store.Add(X509Cert::FromPEM(caPem1b));
+		store.Add(X509Cert::FromPEM(caPem3l));
+		EXPECT_EQ(store.GetSize(), 4U);
+
+		// Duplicates are skipped
+		store.Add(X509Cert::FromPEM(caPem2 + "\n" + caPem1));
+		EXPECT_EQ(store.GetSize(), 4U);
+
+		X509Cert sub1 = X509Cert::FromPEM(subPem1);
+		X509Cert sub3 = X509Cert::FromPEM(subPem3);
+		X509Cert subX = X509Cert::FromPEM(subPemX);
+
+		X509Cert ca1  = X509Cert::FromPEM(caPem1);
+		X509Cert ca1b = X509Cert::FromPEM(caPem1b);
+
+		std::vector<const mbedtls_x509_crt*> issuers =
+			store.FindIssuers(*sub1.Get());
+		ASSERT_EQ(issuers.size(), 2U);
+		EXPECT_EQ(issuers[0]->raw.len, ca1.Get()->raw.len);
+		EXPECT_EQ(
+			std::memcmp(issuers[0]->raw.p, ca1.Get()->raw.p, ca1.Get()->raw.len),
+			0
+		);
+		EXPECT_EQ(
+			std::memcmp(issuers[1]->raw.p, ca1b.Get()->raw.p, ca1b.Get()->raw.len),
+			0
+		);
+
+		// Names are matched without regard to case.
+		EXPECT_EQ(store.FindIssuers(*sub3.Get()).size(), 1U);
+		EXPECT_EQ(store.FindIssuers(*subX.Get()).size(), 0U);
+
+		auto vrfyFunc = [](void *, mbedtls_x509_crt *, int, uint32_t *){
+			return 0;
+		};
+
+		uint32_t flag = 0;
+		EXPECT_NO_THROW(
+			store.VerifyChain(
+				sub1,
+				"mbed TLS Client 1",
+				flag,
+				mbedtls_x509_crt_profile_default,
+				vrfyFunc,
+				nullptr
+			);
+		);
+		EXPECT_EQ(flag, 0U);
+
+		// The only candidate of sub3 has the same name as its issuer, but a
+		// different key.
+		flag = 0;
+		EXPECT_THROW(
+			store.VerifyChain(
+				sub3,
+				nullptr,
+				flag,
+				mbedtls_x509_crt_profile_default,
+				vrfyFunc,
+				nullptr
+			);,
+			mbedTLSRuntimeError
+		);
+		EXPECT_NE(flag, 0U);
+
+		flag = 0;
+		EXPECT_THROW(
+			store.VerifyChain(
+				subX,
+				nullptr,
+				flag,
+				mbedtls_x509_crt_profile_default,
+				vrfyFunc,
+				nullptr
+			);,
+			mbedTLSRuntimeError
+		);
+		EXPECT_NE(flag & MBEDTLS_X509_BADCERT_NOT_TRUSTED, 0U);
+	}
+
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+}
+
+GTEST_TEST(TestX509Cert, X509CertBundleLoader)
+{
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+	auto key = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+
+	// Enough certificates for multiple threads.
+	static constexpr size_t sk_numOfCerts =
+		(X509CertBundleLoader::sk_minCertsPerThread * 3) + 5;
+
+	std::vector<std::vector<uint8_t> > ders;
+	std::string pemBundle = "# A comment before the certificates\n";
+	std::shared_ptr<std::vector<uint8_t> > derBundle =
+		std::make_shared<std::vector<uint8_t> >();
+	for (size_t i = 0; i < sk_numOfCerts; ++i)
+	{
+		X509CertWriter writer = X509CertWriter::SelfSign(
+			HashType::SHA256,
+			key,
+			"C=UK,O=ARM,CN=Bundle CA " + std::to_string(i)
+		);
+		writer.SetSerialNum(
+			BigNumber<>(static_cast<int64_t>(i + 1))
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		);
+		std::vector<uint8_t> der = writer.GetDer(*rand);
+
+		std::string pem = X509Cert::FromDER(CtnFullR(der)).GetPem();
+		if (i == 1)
+		{
+			// Windows line endings
+			for (size_t pos = pem.find('\n');
+				pos != std::string::npos;
+				pos = pem.find('\n', pos + 2))
+			{
+				pem.replace(pos, 1, "\r\n");
+			}
+		}
+		pemBundle += pem;
+		derBundle->insert(derBundle->end(), der.begin(), der.end());
+		ders.push_back(std::move(der));
+	}
+
+	auto checkChain = [&ders](X509Cert& chain)
+	{
+		chain.GoToFirstCert();
+		for (size_t i = 0; i < ders.size(); ++i)
+		{
+			EXPECT_EQ(chain.GetDer(), ders[i]);
+			if (i + 1 < ders.size())
+			{
+				ASSERT_TRUE(chain.HasNext());
+				chain.NextCert();
+			}
+		}
+		EXPECT_FALSE(chain.HasNext());
+	};
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		const uint8_t* pemPtr =
+			reinterpret_cast<const uint8_t*>(pemBundle.data());
+		EXPECT_TRUE(X509CertBundleLoader::IsPem(pemPtr, pemBundle.size()));
+		EXPECT_FALSE(
+			X509CertBundleLoader::IsPem(derBundle->data(), derBundle->size())
+		);
+		EXPECT_EQ(
+			X509CertBundleLoader::FindPemCerts(pemPtr, pemBundle.size()).size(),
+			sk_numOfCerts
+		);
+		EXPECT_EQ(
+			X509CertBundleLoader::FindDerCerts(
+				derBundle->data(), derBundle->size()
+			).size(),
+			sk_numOfCerts
+		);
+
+		X509CertBundleLoader loader(4);
+		EXPECT_EQ(loader.GetNumOfThreads(), 4U);
+		EXPECT_GE(X509CertBundleLoader().GetNumOfThreads(), 1U);
+
+		// PEM bundle; it's not needed after the parsing.
+		{
+			X509Cert chain = X509CertBundleLoader(1).Parse(
+				CtnFullR(pemBundle), nullptr
+			);
+			checkChain(chain);
+		}
+		{
+			X509Cert chain = loader.Parse(CtnFullR(pemBundle), nullptr);
+			checkChain(chain);
+		}
+
+		// DER bundle; the chain keeps the bundle alive.
+		std::weak_ptr<std::vector<uint8_t> > derBundleRef = derBundle;
+		{
+			X509Cert chain = loader.Parse(CtnFullR(*derBundle), derBundle);
+			derBundle.reset();
+			EXPECT_FALSE(derBundleRef.expired());
+			checkChain(chain);
+
+			// Into a trust store, without copying.
+			TrustStore store;
+			store.Add(X509Cert::FromDER(CtnFullR(ders[0])));
+			store.Add(std::move(chain));
+			EXPECT_EQ(store.GetSize(), sk_numOfCerts);
+			X509Cert cert5 = X509Cert::FromDER(CtnFullR(ders[5]));
+			EXPECT_EQ(store.FindIssuers(*cert5.Get()).size(), 1U);
+			EXPECT_FALSE(derBundleRef.expired());
+		}
+		EXPECT_TRUE(derBundleRef.expired());
+
+		// Invalid bundles
+		std::string noFooter = pemBundle.substr(0, pemBundle.size() - 10);
+		EXPECT_THROW(
+			loader.Parse(CtnFullR(noFooter), nullptr),
+			InvalidArgumentException
+		);
+		std::string badBody = pemBundle;
+		badBody[badBody.find("-----\n") + 20] = '#';
+		EXPECT_THROW(
+			loader.Parse(CtnFullR(badBody), nullptr),
+			mbedTLSRuntimeError
+		);
+		std::vector<uint8_t> truncDer(ders[0].begin(), ders[0].end() - 1);
+		EXPECT_THROW(
+			loader.Parse(CtnFullR(truncDer), nullptr),
+			InvalidArgumentException
+		);
+		std::string notBundle = "nothing here";
+		EXPECT_THROW(
+			loader.Parse(CtnFullR(notBundle), nullptr),
+			InvalidArgumentException
+		);
+		std::vector<uint8_t> emptyBundle;
+		EXPECT_THROW(
+			loader.Parse(CtnFullR(emptyBundle), nullptr),
+			InvalidArgumentException
+		);
+
+#ifdef MBEDTLSCPP_INTERNAL_FILE_MAPPING
+		// Bundle files, through the memory mapping.
+		auto writeTempFile = [](const void* data, size_t size)
+		{
+			char path[] = "/tmp/mbedTLScppTestXXXXXX";
+			const int fd = ::mkstemp(path);
+			EXPECT_GE(fd, 0);
+			EXPECT_EQ(
+				::write(fd, data, size),
+				static_cast<ssize_t>(size)
+			);
+			::close(fd);
+			return std::string(path);
+		};
+
+		std::vector<uint8_t> derFileData;
+		for (const auto& der : ders)
+		{
+			derFileData.insert(derFileData.end(), der.begin(), der.end());
+		}
+		const std::string pemPath =
+			writeTempFile(pemBundle.data(), pemBundle.size());
+		const std::string derPath =
+			writeTempFile(derFileData.data(), derFileData.size());
+		const std::string emptyPath = writeTempFile(nullptr, 0);
+
+		{
+			Internal::MappedFile file(derPath);
+			ASSERT_EQ(file.GetSize(), derFileData.size());
+			EXPECT_EQ(
+				std::memcmp(file.GetData(), derFileData.data(), file.GetSize()),
+				0
+			);
+
+			Internal::MappedFile emptyFile(emptyPath);
+			EXPECT_EQ(emptyFile.GetData(), nullptr);
+			EXPECT_EQ(emptyFile.GetSize(), 0U);
+		}
+		{
+			X509Cert chain = loader.LoadFile(pemPath);
+			checkChain(chain);
+		}
+		{
+			X509Cert chain = loader.LoadFile(derPath);
+			// The mapping outlives the file.
+			::unlink(derPath.c_str());
+			checkChain(chain);
+
+			TrustStore store;
+			loader.LoadFile(pemPath, store);
+			EXPECT_EQ(store.GetSize(), sk_numOfCerts);
+		}
+
+		EXPECT_THROW(loader.LoadFile(derPath), RuntimeException);
+		EXPECT_THROW(loader.LoadFile(emptyPath), InvalidArgumentException);
+
+		::unlink(pemPath.c_str());
+		::unlink(emptyPath.c_str());
+#endif // MBEDTLSCPP_INTERNAL_FILE_MAPPING
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}
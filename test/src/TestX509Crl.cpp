@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 
 #include <mbedTLScpp/X509Crl.hpp>
+#include <mbedTLScpp/RevocationIndex.hpp>
+#include <mbedTLScpp/X509Cert.hpp>
+#include <mbedTLScpp/EcKey.hpp>
+#include <mbedTLScpp/DefaultRbg.hpp>
 
 #include "SharedVars.hpp"
 #include "MemoryTest.hpp"
@@ -101,3 +105,114 @@ GTEST_TEST(TestX509Crl, X509CrlExport)
 	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
 	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
 }
+
+GTEST_TEST(TestX509Crl, RevocationIndex)
+{
+	// Issued by "C=US,CN=Test CRL CA";
+	// revokes 0x1001 (keyCompromise) and 0x1002 (no reason code).
+	static const char sk_baseCrlPem[] =
+		"-----BEGIN X509 CRL-----\n"
+		"MIH3MIGeAgEBMAoGCCqGSM49BAMCMCMxCzAJBgNVBAYTAlVTMRQwEgYDVQQDDAtU\n"
+		"ZXN0IENSTCBDQRcNMjYxMDE4MjAwOTM0WhgPMjEyNjA5MjQyMDA5MzRaMDgwIQIC\n"
+		"EAEXDTIxMDEwMTAwMDAwMFowDDAKBgNVHRUEAwoBATATAgIQAhcNMjEwMTAxMDAw\n"
+		"MDAwWqAOMAwwCgYDVR0UBAMCAQEwCgYIKoZIzj0EAwIDSAAwRQIgPRCc/AIeiXIm\n"
+		"y53gqxAO+Z8JRUx44iqRzZFDKF4wuhQCIQCGH75ipZqrTfKr8P/HulzOXdo9LnIK\n"
+		"sids+vTAj+WE1w==\n"
+		"-----END X509 CRL-----\n";
+	// Delta CRL; 0x1002 (removeFromCRL) and 0x1003 (certificateHold).
+	static const char sk_deltaCrlPem[] =
+		"-----BEGIN X509 CRL-----\n"
+		"MIIBBTCBrAIBATAKBggqhkjOPQQDAjAjMQswCQYDVQQGEwJVUzEUMBIGA1UEAwwL\n"
+		"VGVzdCBDUkwgQ0EXDTI2MTAxODIwMDkzNFoYDzIxMjYwOTI0MjAwOTM0WjBGMCEC\n"
+		"AhACFw0yMTAxMDEwMDAwMDBaMAwwCgYDVR0VBAMKAQgwIQICEAMXDTIxMDIwMTAw\n"
+		"MDAwMFowDDAKBgNVHRUEAwoBBqAOMAwwCgYDVR0UBAMCAQIwCgYIKoZIzj0EAwID\n"
+		"SAAwRQIgF8jItlxgN/zeqiFKeYpnHJZhseEavx8ZFd9LiqIvCgACIQDqlEx6ezC6\n"
+		"E/NOz3CVPAhTf8A1coiiO0XVxj/+xPnUFA==\n"
+		"-----END X509 CRL-----\n";
+
+	std::unique_ptr<RbgInterface> rand =
+		Internal::make_unique<DefaultRbg>();
+	auto key = EcKeyPair<EcType::SECP256R1>::Generate(*rand);
+
+	auto makeCert = [&rand, &key](
+		const std::string& subject,
+		int64_t serial
+	) -> X509Cert
+	{
+		X509CertWriter writer = X509CertWriter::SelfSign(
+			HashType::SHA256,
+			key,
+			subject
+		);
+		writer.SetSerialNum(
+			BigNumber<>(serial)
+		).SetValidationTime(
+			"20210101000000", "29991231235959"
+		);
+		return X509Cert::FromPEM(writer.GetPem(*rand));
+	};
+
+	// The issuer name only differs in case.
+	const X509Cert cert1 = makeCert("C=US,CN=TEST CRL CA", 0x1001);
+	const X509Cert cert2 = makeCert("C=US,CN=Test CRL CA", 0x1002);
+	const X509Cert cert3 = makeCert("C=US,CN=Test CRL CA", 0x1003);
+	const X509Cert certX = makeCert("C=US,CN=Other CRL CA", 0x1001);
+
+	int64_t initCount = 0;
+	int64_t initSecCount = 0;
+	MEMORY_LEAK_TEST_GET_COUNT(initCount);
+	SECRET_MEMORY_LEAK_TEST_GET_COUNT(initSecCount);
+
+	{
+		X509Crl baseCrl = X509Crl::FromPEM(sk_baseCrlPem);
+		X509Crl deltaCrl = X509Crl::FromPEM(sk_deltaCrlPem);
+
+		const mbedtls_x509_crl_entry& entry1 = baseCrl.Get()->entry;
+		ASSERT_NE(entry1.next, nullptr);
+		EXPECT_EQ(RevocationIndex::GetReasonCode(entry1), 1);
+		EXPECT_EQ(RevocationIndex::GetReasonCode(*entry1.next), -1);
+		EXPECT_EQ(
+			RevocationIndex::GetReasonCode(deltaCrl.Get()->entry),
+			RevocationIndex::sk_reasonRemoveFromCrl
+		);
+
+		RevocationIndex emptyIndex;
+		EXPECT_EQ(emptyIndex.GetSize(), 0U);
+		EXPECT_FALSE(emptyIndex.IsRevoked(*cert1.Get()));
+
+		RevocationIndex baseIndex(baseCrl);
+		EXPECT_EQ(baseIndex.GetSize(), 2U);
+		EXPECT_NE(baseIndex.GetVersion(), emptyIndex.GetVersion());
+		EXPECT_TRUE(baseIndex.IsRevoked(*cert1.Get()));
+		EXPECT_TRUE(baseIndex.IsRevoked(*cert2.Get()));
+		EXPECT_FALSE(baseIndex.IsRevoked(*cert3.Get()));
+		EXPECT_FALSE(baseIndex.IsRevoked(*certX.Get()));
+
+		// Merge the delta into a copy.
+		RevocationIndex index = baseIndex;
+		EXPECT_NE(index.GetVersion(), baseIndex.GetVersion());
+		const uint64_t prevVer = index.GetVersion();
+		index.Merge(deltaCrl);
+		EXPECT_NE(index.GetVersion(), prevVer);
+		EXPECT_EQ(index.GetSize(), 2U);
+		EXPECT_TRUE(index.IsRevoked(*cert1.Get()));
+		EXPECT_FALSE(index.IsRevoked(*cert2.Get()));
+		EXPECT_TRUE(index.IsRevoked(*cert3.Get()));
+		EXPECT_FALSE(index.IsRevoked(*certX.Get()));
+
+		// The original one is untouched.
+		EXPECT_TRUE(baseIndex.IsRevoked(*cert2.Get()));
+		EXPECT_FALSE(baseIndex.IsRevoked(*cert3.Get()));
+
+		// Merging the same CRL again changes nothing but the version.
+		index.Merge(deltaCrl);
+		EXPECT_EQ(index.GetSize(), 2U);
+
+		X509Crl movedCrl = std::move(deltaCrl);
+		EXPECT_THROW(index.Merge(deltaCrl), InvalidObjectException);
+	}
+
+	// Finally, all allocation should be cleaned after exit.
+	MEMORY_LEAK_TEST_INCR_COUNT(initCount, 0);
+	SECRET_MEMORY_LEAK_TEST_INCR_COUNT(initSecCount, 0);
+}